@@ -0,0 +1,64 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/db/builder.cc" "CMakeFiles/leveldb.dir/db/builder.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/builder.cc.o.d"
+  "/root/repo/db/c.cc" "CMakeFiles/leveldb.dir/db/c.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/c.cc.o.d"
+  "/root/repo/db/db_impl.cc" "CMakeFiles/leveldb.dir/db/db_impl.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/db_impl.cc.o.d"
+  "/root/repo/db/db_iter.cc" "CMakeFiles/leveldb.dir/db/db_iter.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/db_iter.cc.o.d"
+  "/root/repo/db/dbformat.cc" "CMakeFiles/leveldb.dir/db/dbformat.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/dbformat.cc.o.d"
+  "/root/repo/db/dumpfile.cc" "CMakeFiles/leveldb.dir/db/dumpfile.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/dumpfile.cc.o.d"
+  "/root/repo/db/filename.cc" "CMakeFiles/leveldb.dir/db/filename.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/filename.cc.o.d"
+  "/root/repo/db/log_reader.cc" "CMakeFiles/leveldb.dir/db/log_reader.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/log_reader.cc.o.d"
+  "/root/repo/db/log_writer.cc" "CMakeFiles/leveldb.dir/db/log_writer.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/log_writer.cc.o.d"
+  "/root/repo/db/memtable.cc" "CMakeFiles/leveldb.dir/db/memtable.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/memtable.cc.o.d"
+  "/root/repo/db/repair.cc" "CMakeFiles/leveldb.dir/db/repair.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/repair.cc.o.d"
+  "/root/repo/db/table_cache.cc" "CMakeFiles/leveldb.dir/db/table_cache.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/table_cache.cc.o.d"
+  "/root/repo/db/version_edit.cc" "CMakeFiles/leveldb.dir/db/version_edit.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/version_edit.cc.o.d"
+  "/root/repo/db/version_set.cc" "CMakeFiles/leveldb.dir/db/version_set.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/version_set.cc.o.d"
+  "/root/repo/db/write_batch.cc" "CMakeFiles/leveldb.dir/db/write_batch.cc.o" "gcc" "CMakeFiles/leveldb.dir/db/write_batch.cc.o.d"
+  "/root/repo/helpers/memenv/memenv.cc" "CMakeFiles/leveldb.dir/helpers/memenv/memenv.cc.o" "gcc" "CMakeFiles/leveldb.dir/helpers/memenv/memenv.cc.o.d"
+  "/root/repo/table/block.cc" "CMakeFiles/leveldb.dir/table/block.cc.o" "gcc" "CMakeFiles/leveldb.dir/table/block.cc.o.d"
+  "/root/repo/table/block_builder.cc" "CMakeFiles/leveldb.dir/table/block_builder.cc.o" "gcc" "CMakeFiles/leveldb.dir/table/block_builder.cc.o.d"
+  "/root/repo/table/filter_block.cc" "CMakeFiles/leveldb.dir/table/filter_block.cc.o" "gcc" "CMakeFiles/leveldb.dir/table/filter_block.cc.o.d"
+  "/root/repo/table/format.cc" "CMakeFiles/leveldb.dir/table/format.cc.o" "gcc" "CMakeFiles/leveldb.dir/table/format.cc.o.d"
+  "/root/repo/table/iterator.cc" "CMakeFiles/leveldb.dir/table/iterator.cc.o" "gcc" "CMakeFiles/leveldb.dir/table/iterator.cc.o.d"
+  "/root/repo/table/merger.cc" "CMakeFiles/leveldb.dir/table/merger.cc.o" "gcc" "CMakeFiles/leveldb.dir/table/merger.cc.o.d"
+  "/root/repo/table/table.cc" "CMakeFiles/leveldb.dir/table/table.cc.o" "gcc" "CMakeFiles/leveldb.dir/table/table.cc.o.d"
+  "/root/repo/table/table_builder.cc" "CMakeFiles/leveldb.dir/table/table_builder.cc.o" "gcc" "CMakeFiles/leveldb.dir/table/table_builder.cc.o.d"
+  "/root/repo/table/two_level_iterator.cc" "CMakeFiles/leveldb.dir/table/two_level_iterator.cc.o" "gcc" "CMakeFiles/leveldb.dir/table/two_level_iterator.cc.o.d"
+  "/root/repo/util/arena.cc" "CMakeFiles/leveldb.dir/util/arena.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/arena.cc.o.d"
+  "/root/repo/util/bloom.cc" "CMakeFiles/leveldb.dir/util/bloom.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/bloom.cc.o.d"
+  "/root/repo/util/cache.cc" "CMakeFiles/leveldb.dir/util/cache.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/cache.cc.o.d"
+  "/root/repo/util/coding.cc" "CMakeFiles/leveldb.dir/util/coding.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/coding.cc.o.d"
+  "/root/repo/util/comparator.cc" "CMakeFiles/leveldb.dir/util/comparator.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/comparator.cc.o.d"
+  "/root/repo/util/crc32c.cc" "CMakeFiles/leveldb.dir/util/crc32c.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/crc32c.cc.o.d"
+  "/root/repo/util/env.cc" "CMakeFiles/leveldb.dir/util/env.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/env.cc.o.d"
+  "/root/repo/util/env_instrumented.cc" "CMakeFiles/leveldb.dir/util/env_instrumented.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/env_instrumented.cc.o.d"
+  "/root/repo/util/env_posix.cc" "CMakeFiles/leveldb.dir/util/env_posix.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/env_posix.cc.o.d"
+  "/root/repo/util/filter_policy.cc" "CMakeFiles/leveldb.dir/util/filter_policy.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/filter_policy.cc.o.d"
+  "/root/repo/util/hash.cc" "CMakeFiles/leveldb.dir/util/hash.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/hash.cc.o.d"
+  "/root/repo/util/hedged_read.cc" "CMakeFiles/leveldb.dir/util/hedged_read.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/hedged_read.cc.o.d"
+  "/root/repo/util/histogram.cc" "CMakeFiles/leveldb.dir/util/histogram.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/histogram.cc.o.d"
+  "/root/repo/util/keyspace.cc" "CMakeFiles/leveldb.dir/util/keyspace.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/keyspace.cc.o.d"
+  "/root/repo/util/logging.cc" "CMakeFiles/leveldb.dir/util/logging.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/logging.cc.o.d"
+  "/root/repo/util/options.cc" "CMakeFiles/leveldb.dir/util/options.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/options.cc.o.d"
+  "/root/repo/util/perf_context.cc" "CMakeFiles/leveldb.dir/util/perf_context.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/perf_context.cc.o.d"
+  "/root/repo/util/rate_limiter.cc" "CMakeFiles/leveldb.dir/util/rate_limiter.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/rate_limiter.cc.o.d"
+  "/root/repo/util/status.cc" "CMakeFiles/leveldb.dir/util/status.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/status.cc.o.d"
+  "/root/repo/util/tracing.cc" "CMakeFiles/leveldb.dir/util/tracing.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/tracing.cc.o.d"
+  "/root/repo/util/xor_filter.cc" "CMakeFiles/leveldb.dir/util/xor_filter.cc.o" "gcc" "CMakeFiles/leveldb.dir/util/xor_filter.cc.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
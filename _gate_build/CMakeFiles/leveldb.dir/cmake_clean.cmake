@@ -0,0 +1,101 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/leveldb.dir/db/builder.cc.o"
+  "CMakeFiles/leveldb.dir/db/builder.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/c.cc.o"
+  "CMakeFiles/leveldb.dir/db/c.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/db_impl.cc.o"
+  "CMakeFiles/leveldb.dir/db/db_impl.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/db_iter.cc.o"
+  "CMakeFiles/leveldb.dir/db/db_iter.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/dbformat.cc.o"
+  "CMakeFiles/leveldb.dir/db/dbformat.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/dumpfile.cc.o"
+  "CMakeFiles/leveldb.dir/db/dumpfile.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/filename.cc.o"
+  "CMakeFiles/leveldb.dir/db/filename.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/log_reader.cc.o"
+  "CMakeFiles/leveldb.dir/db/log_reader.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/log_writer.cc.o"
+  "CMakeFiles/leveldb.dir/db/log_writer.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/memtable.cc.o"
+  "CMakeFiles/leveldb.dir/db/memtable.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/repair.cc.o"
+  "CMakeFiles/leveldb.dir/db/repair.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/table_cache.cc.o"
+  "CMakeFiles/leveldb.dir/db/table_cache.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/version_edit.cc.o"
+  "CMakeFiles/leveldb.dir/db/version_edit.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/version_set.cc.o"
+  "CMakeFiles/leveldb.dir/db/version_set.cc.o.d"
+  "CMakeFiles/leveldb.dir/db/write_batch.cc.o"
+  "CMakeFiles/leveldb.dir/db/write_batch.cc.o.d"
+  "CMakeFiles/leveldb.dir/helpers/memenv/memenv.cc.o"
+  "CMakeFiles/leveldb.dir/helpers/memenv/memenv.cc.o.d"
+  "CMakeFiles/leveldb.dir/table/block.cc.o"
+  "CMakeFiles/leveldb.dir/table/block.cc.o.d"
+  "CMakeFiles/leveldb.dir/table/block_builder.cc.o"
+  "CMakeFiles/leveldb.dir/table/block_builder.cc.o.d"
+  "CMakeFiles/leveldb.dir/table/filter_block.cc.o"
+  "CMakeFiles/leveldb.dir/table/filter_block.cc.o.d"
+  "CMakeFiles/leveldb.dir/table/format.cc.o"
+  "CMakeFiles/leveldb.dir/table/format.cc.o.d"
+  "CMakeFiles/leveldb.dir/table/iterator.cc.o"
+  "CMakeFiles/leveldb.dir/table/iterator.cc.o.d"
+  "CMakeFiles/leveldb.dir/table/merger.cc.o"
+  "CMakeFiles/leveldb.dir/table/merger.cc.o.d"
+  "CMakeFiles/leveldb.dir/table/table.cc.o"
+  "CMakeFiles/leveldb.dir/table/table.cc.o.d"
+  "CMakeFiles/leveldb.dir/table/table_builder.cc.o"
+  "CMakeFiles/leveldb.dir/table/table_builder.cc.o.d"
+  "CMakeFiles/leveldb.dir/table/two_level_iterator.cc.o"
+  "CMakeFiles/leveldb.dir/table/two_level_iterator.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/arena.cc.o"
+  "CMakeFiles/leveldb.dir/util/arena.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/bloom.cc.o"
+  "CMakeFiles/leveldb.dir/util/bloom.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/cache.cc.o"
+  "CMakeFiles/leveldb.dir/util/cache.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/coding.cc.o"
+  "CMakeFiles/leveldb.dir/util/coding.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/comparator.cc.o"
+  "CMakeFiles/leveldb.dir/util/comparator.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/crc32c.cc.o"
+  "CMakeFiles/leveldb.dir/util/crc32c.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/env.cc.o"
+  "CMakeFiles/leveldb.dir/util/env.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/env_instrumented.cc.o"
+  "CMakeFiles/leveldb.dir/util/env_instrumented.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/env_posix.cc.o"
+  "CMakeFiles/leveldb.dir/util/env_posix.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/filter_policy.cc.o"
+  "CMakeFiles/leveldb.dir/util/filter_policy.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/hash.cc.o"
+  "CMakeFiles/leveldb.dir/util/hash.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/hedged_read.cc.o"
+  "CMakeFiles/leveldb.dir/util/hedged_read.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/histogram.cc.o"
+  "CMakeFiles/leveldb.dir/util/histogram.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/keyspace.cc.o"
+  "CMakeFiles/leveldb.dir/util/keyspace.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/logging.cc.o"
+  "CMakeFiles/leveldb.dir/util/logging.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/options.cc.o"
+  "CMakeFiles/leveldb.dir/util/options.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/perf_context.cc.o"
+  "CMakeFiles/leveldb.dir/util/perf_context.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/rate_limiter.cc.o"
+  "CMakeFiles/leveldb.dir/util/rate_limiter.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/status.cc.o"
+  "CMakeFiles/leveldb.dir/util/status.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/tracing.cc.o"
+  "CMakeFiles/leveldb.dir/util/tracing.cc.o.d"
+  "CMakeFiles/leveldb.dir/util/xor_filter.cc.o"
+  "CMakeFiles/leveldb.dir/util/xor_filter.cc.o.d"
+  "libleveldb.a"
+  "libleveldb.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/leveldb.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
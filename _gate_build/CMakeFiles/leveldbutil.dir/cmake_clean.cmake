@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/leveldbutil.dir/db/leveldbutil.cc.o"
+  "CMakeFiles/leveldbutil.dir/db/leveldbutil.cc.o.d"
+  "leveldbutil"
+  "leveldbutil.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/leveldbutil.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -1,4 +1,4 @@
-# Install script for directory: /Users/xingeqi/CLionProjects/leveldb
+# Install script for directory: /root/repo
 
 # Set the install prefix
 if(NOT DEFINED CMAKE_INSTALL_PREFIX)
@@ -12,7 +12,7 @@ if(NOT DEFINED CMAKE_INSTALL_CONFIG_NAME)
     string(REGEX REPLACE "^[^A-Za-z0-9_]+" ""
            CMAKE_INSTALL_CONFIG_NAME "${BUILD_TYPE}")
   else()
-    set(CMAKE_INSTALL_CONFIG_NAME "Debug")
+    set(CMAKE_INSTALL_CONFIG_NAME "Release")
   endif()
   message(STATUS "Install configuration: \"${CMAKE_INSTALL_CONFIG_NAME}\"")
 endif()
@@ -27,6 +27,11 @@ if(NOT CMAKE_INSTALL_COMPONENT)
   endif()
 endif()
 
+# Install shared libraries without execute permission?
+if(NOT DEFINED CMAKE_INSTALL_SO_NO_EXE)
+  set(CMAKE_INSTALL_SO_NO_EXE "1")
+endif()
+
 # Is this installation the result of a crosscompile?
 if(NOT DEFINED CMAKE_CROSSCOMPILING)
   set(CMAKE_CROSSCOMPILING "FALSE")
@@ -34,34 +39,36 @@ endif()
 
 # Set default install directory permissions.
 if(NOT DEFINED CMAKE_OBJDUMP)
-  set(CMAKE_OBJDUMP "/Library/Developer/CommandLineTools/usr/bin/objdump")
+  set(CMAKE_OBJDUMP "/usr/bin/objdump")
 endif()
 
 if(CMAKE_INSTALL_COMPONENT STREQUAL "Unspecified" OR NOT CMAKE_INSTALL_COMPONENT)
-  file(INSTALL DESTINATION "${CMAKE_INSTALL_PREFIX}/lib" TYPE STATIC_LIBRARY FILES "/Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/libleveldb.a")
-  if(EXISTS "$ENV{DESTDIR}${CMAKE_INSTALL_PREFIX}/lib/libleveldb.a" AND
-     NOT IS_SYMLINK "$ENV{DESTDIR}${CMAKE_INSTALL_PREFIX}/lib/libleveldb.a")
-    execute_process(COMMAND "/Library/Developer/CommandLineTools/usr/bin/ranlib" "$ENV{DESTDIR}${CMAKE_INSTALL_PREFIX}/lib/libleveldb.a")
-  endif()
+  file(INSTALL DESTINATION "${CMAKE_INSTALL_PREFIX}/lib" TYPE STATIC_LIBRARY FILES "/root/repo/_gate_build/libleveldb.a")
 endif()
 
 if(CMAKE_INSTALL_COMPONENT STREQUAL "Unspecified" OR NOT CMAKE_INSTALL_COMPONENT)
   file(INSTALL DESTINATION "${CMAKE_INSTALL_PREFIX}/include/leveldb" TYPE FILE FILES
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/c.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/cache.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/comparator.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/db.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/dumpfile.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/env.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/export.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/filter_policy.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/iterator.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/options.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/slice.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/status.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/table_builder.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/table.h"
-    "/Users/xingeqi/CLionProjects/leveldb/include/leveldb/write_batch.h"
+    "/root/repo/include/leveldb/c.h"
+    "/root/repo/include/leveldb/cache.h"
+    "/root/repo/include/leveldb/comparator.h"
+    "/root/repo/include/leveldb/compaction_picker.h"
+    "/root/repo/include/leveldb/db.h"
+    "/root/repo/include/leveldb/dumpfile.h"
+    "/root/repo/include/leveldb/env.h"
+    "/root/repo/include/leveldb/event_listener.h"
+    "/root/repo/include/leveldb/export.h"
+    "/root/repo/include/leveldb/filter_policy.h"
+    "/root/repo/include/leveldb/iterator.h"
+    "/root/repo/include/leveldb/keyspace.h"
+    "/root/repo/include/leveldb/merge_operator.h"
+    "/root/repo/include/leveldb/options.h"
+    "/root/repo/include/leveldb/perf_context.h"
+    "/root/repo/include/leveldb/rate_limiter.h"
+    "/root/repo/include/leveldb/slice.h"
+    "/root/repo/include/leveldb/status.h"
+    "/root/repo/include/leveldb/table_builder.h"
+    "/root/repo/include/leveldb/table.h"
+    "/root/repo/include/leveldb/write_batch.h"
     )
 endif()
 
@@ -69,7 +76,7 @@ if(CMAKE_INSTALL_COMPONENT STREQUAL "Unspecified" OR NOT CMAKE_INSTALL_COMPONENT
   if(EXISTS "$ENV{DESTDIR}${CMAKE_INSTALL_PREFIX}/lib/cmake/leveldb/leveldbTargets.cmake")
     file(DIFFERENT _cmake_export_file_changed FILES
          "$ENV{DESTDIR}${CMAKE_INSTALL_PREFIX}/lib/cmake/leveldb/leveldbTargets.cmake"
-         "/Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/CMakeFiles/Export/f90a79f6c24c38ae6b0a9cccec147da8/leveldbTargets.cmake")
+         "/root/repo/_gate_build/CMakeFiles/Export/f90a79f6c24c38ae6b0a9cccec147da8/leveldbTargets.cmake")
     if(_cmake_export_file_changed)
       file(GLOB _cmake_old_config_files "$ENV{DESTDIR}${CMAKE_INSTALL_PREFIX}/lib/cmake/leveldb/leveldbTargets-*.cmake")
       if(_cmake_old_config_files)
@@ -82,26 +89,19 @@ if(CMAKE_INSTALL_COMPONENT STREQUAL "Unspecified" OR NOT CMAKE_INSTALL_COMPONENT
     endif()
     unset(_cmake_export_file_changed)
   endif()
-  file(INSTALL DESTINATION "${CMAKE_INSTALL_PREFIX}/lib/cmake/leveldb" TYPE FILE FILES "/Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/CMakeFiles/Export/f90a79f6c24c38ae6b0a9cccec147da8/leveldbTargets.cmake")
-  if(CMAKE_INSTALL_CONFIG_NAME MATCHES "^([Dd][Ee][Bb][Uu][Gg])$")
-    file(INSTALL DESTINATION "${CMAKE_INSTALL_PREFIX}/lib/cmake/leveldb" TYPE FILE FILES "/Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/CMakeFiles/Export/f90a79f6c24c38ae6b0a9cccec147da8/leveldbTargets-debug.cmake")
+  file(INSTALL DESTINATION "${CMAKE_INSTALL_PREFIX}/lib/cmake/leveldb" TYPE FILE FILES "/root/repo/_gate_build/CMakeFiles/Export/f90a79f6c24c38ae6b0a9cccec147da8/leveldbTargets.cmake")
+  if(CMAKE_INSTALL_CONFIG_NAME MATCHES "^([Rr][Ee][Ll][Ee][Aa][Ss][Ee])$")
+    file(INSTALL DESTINATION "${CMAKE_INSTALL_PREFIX}/lib/cmake/leveldb" TYPE FILE FILES "/root/repo/_gate_build/CMakeFiles/Export/f90a79f6c24c38ae6b0a9cccec147da8/leveldbTargets-release.cmake")
   endif()
 endif()
 
 if(CMAKE_INSTALL_COMPONENT STREQUAL "Unspecified" OR NOT CMAKE_INSTALL_COMPONENT)
   file(INSTALL DESTINATION "${CMAKE_INSTALL_PREFIX}/lib/cmake/leveldb" TYPE FILE FILES
-    "/Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/cmake/leveldbConfig.cmake"
-    "/Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/cmake/leveldbConfigVersion.cmake"
+    "/root/repo/_gate_build/cmake/leveldbConfig.cmake"
+    "/root/repo/_gate_build/cmake/leveldbConfigVersion.cmake"
     )
 endif()
 
-if(NOT CMAKE_INSTALL_LOCAL_ONLY)
-  # Include the install script for each subdirectory.
-  include("/Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/third_party/googletest/cmake_install.cmake")
-  include("/Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/third_party/benchmark/cmake_install.cmake")
-
-endif()
-
 if(CMAKE_INSTALL_COMPONENT)
   set(CMAKE_INSTALL_MANIFEST "install_manifest_${CMAKE_INSTALL_COMPONENT}.txt")
 else()
@@ -110,5 +110,5 @@ endif()
 
 string(REPLACE ";" "\n" CMAKE_INSTALL_MANIFEST_CONTENT
        "${CMAKE_INSTALL_MANIFEST_FILES}")
-file(WRITE "/Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/${CMAKE_INSTALL_MANIFEST}"
+file(WRITE "/root/repo/_gate_build/${CMAKE_INSTALL_MANIFEST}"
      "${CMAKE_INSTALL_MANIFEST_CONTENT}")
@@ -7,12 +7,12 @@
 
 // Define to 1 if you have a definition for fdatasync() in <unistd.h>.
 #if !defined(HAVE_FDATASYNC)
-#define HAVE_FDATASYNC 0
+#define HAVE_FDATASYNC 1
 #endif  // !defined(HAVE_FDATASYNC)
 
 // Define to 1 if you have a definition for F_FULLFSYNC in <fcntl.h>.
 #if !defined(HAVE_FULLFSYNC)
-#define HAVE_FULLFSYNC 1
+#define HAVE_FULLFSYNC 0
 #endif  // !defined(HAVE_FULLFSYNC)
 
 // Define to 1 if you have a definition for O_CLOEXEC in <fcntl.h>.
@@ -35,4 +35,14 @@
 #define HAVE_ZSTD 0
 #endif  // !defined(HAVE_ZSTD)
 
+// Define to 1 if you have LZ4.
+#if !defined(HAVE_LZ4)
+#define HAVE_LZ4 0
+#endif  // !defined(HAVE_LZ4)
+
+// Define to 1 if you have liburing.
+#if !defined(HAVE_LIBURING)
+#define HAVE_LIBURING 0
+#endif  // !defined(HAVE_LIBURING)
+
 #endif  // STORAGE_LEVELDB_PORT_PORT_CONFIG_H_
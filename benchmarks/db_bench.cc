@@ -5,6 +5,7 @@
 #include <sys/types.h>
 
 #include <atomic>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 
@@ -67,6 +68,19 @@ static const char* FLAGS_benchmarks =
 // Number of key/values to place in database
 static int FLAGS_num = 1000000;
 
+// Key distribution for random benchmarks and "mixed":
+// uniform, zipfian, or latest (zipfian over recently written keys).
+static const char* FLAGS_key_distribution = "uniform";
+
+// Zipfian skew parameter (theta); higher is more skewed.
+static double FLAGS_zipfian_theta = 0.99;
+
+// Fractions of the "mixed" workload that are reads and scans; the
+// remainder are writes.  A scan reads FLAGS_scan_length entries.
+static double FLAGS_mixed_read_ratio = 0.8;
+static double FLAGS_mixed_scan_ratio = 0.0;
+static int FLAGS_scan_length = 100;
+
 // Number of read operations to do.  If negative, do FLAGS_num reads.
 static int FLAGS_reads = -1;
 
@@ -129,6 +143,19 @@ static const char* FLAGS_db = nullptr;
 // ZSTD compression level to try out
 static int FLAGS_zstd_compression_level = 1;
 
+// If non-null, write structured per-benchmark results (micros/op,
+// throughput, latency percentiles, stall time, per-run DB stats) to
+// this file as JSON, one object per benchmark.
+static const char* FLAGS_json = nullptr;
+
+// If non-null, load a baseline JSON written by --json from this path
+// and report benchmarks whose micros/op regressed beyond
+// --regression_threshold; the process exits non-zero if any did.
+static const char* FLAGS_compare = nullptr;
+
+// Relative micros/op increase treated as a regression by --compare.
+static double FLAGS_regression_threshold = 0.10;
+
 namespace leveldb {
 
 namespace {
@@ -314,6 +341,18 @@ class Stats {
 
   void AddBytes(int64_t n) { bytes_ += n; }
 
+  double MicrosPerOp() const {
+    return seconds_ * 1e6 / (done_ < 1 ? 1 : done_);
+  }
+  double OpsPerSec() const {
+    return seconds_ > 0 ? done_ / seconds_ : 0;
+  }
+  double MBPerSec() const {
+    const double elapsed = (finish_ - start_) * 1e-6;
+    return (bytes_ > 0 && elapsed > 0) ? (bytes_ / 1048576.0) / elapsed : 0;
+  }
+  double HistPercentile(double p) const { return hist_.Percentile(p); }
+
   void Report(const Slice& name) {
     // Pretend at least one op was done in case we are running a benchmark
     // that does not call FinishedSingleOp().
@@ -342,6 +381,32 @@ class Stats {
   }
 };
 
+// One benchmark's structured result for --json / --compare.
+struct BenchResult {
+  std::string name;
+  double micros_per_op;
+  double ops_per_sec;
+  double mb_per_sec;
+  double p50, p99, p999;
+  uint64_t stall_micros;
+};
+static std::vector<BenchResult> g_results;
+
+// Extract "micros_per_op" for the named benchmark from a baseline
+// JSON file written by --json.  Returns a negative value if absent.
+// The parser only understands our own writer's one-object-per-line
+// layout, which is all --compare needs.
+static double BaselineMicrosPerOp(const std::string& contents,
+                                  const std::string& name) {
+  const std::string needle = "\"name\": \"" + name + "\"";
+  size_t pos = contents.find(needle);
+  if (pos == std::string::npos) return -1;
+  const std::string field = "\"micros_per_op\": ";
+  pos = contents.find(field, pos);
+  if (pos == std::string::npos) return -1;
+  return strtod(contents.c_str() + pos + field.size(), nullptr);
+}
+
 // State shared by all concurrent executions of the same benchmark.
 struct SharedState {
   port::Mutex mu;
@@ -609,6 +674,8 @@ class Benchmark {
         method = &Benchmark::ReadReverse;
       } else if (name == Slice("readrandom")) {
         method = &Benchmark::ReadRandom;
+      } else if (name == Slice("mixed")) {
+        method = &Benchmark::Mixed;
       } else if (name == Slice("readmissing")) {
         method = &Benchmark::ReadMissing;
       } else if (name == Slice("seekrandom")) {
@@ -741,6 +808,23 @@ class Benchmark {
       arg[0].thread->stats.Merge(arg[i].thread->stats);
     }
     arg[0].thread->stats.Report(name);
+    if (FLAGS_json != nullptr || FLAGS_compare != nullptr) {
+      BenchResult result;
+      result.name = name.ToString();
+      result.micros_per_op = arg[0].thread->stats.MicrosPerOp();
+      result.ops_per_sec = arg[0].thread->stats.OpsPerSec();
+      result.mb_per_sec = arg[0].thread->stats.MBPerSec();
+      result.p50 = arg[0].thread->stats.HistPercentile(50);
+      result.p99 = arg[0].thread->stats.HistPercentile(99);
+      result.p999 = arg[0].thread->stats.HistPercentile(99.9);
+      result.stall_micros = 0;
+      if (db_ != nullptr) {
+        DBStats db_stats;
+        db_->GetStats(&db_stats);
+        result.stall_micros = db_stats.write_stall_micros;
+      }
+      g_results.push_back(result);
+    }
     if (FLAGS_comparisons) {
       fprintf(stdout, "Comparisons: %zu\n", count_comparator_.comparisons());
       count_comparator_.reset();
@@ -891,13 +975,92 @@ class Benchmark {
     thread->stats.AddBytes(bytes);
   }
 
+  // YCSB-style zipfian generator over [0, n) using the rejection
+  // method of Gray et al.; deterministic per thread.
+  int ZipfianKey(ThreadState* thread, int n) {
+    const double theta = FLAGS_zipfian_theta;
+    // Cached constants, recomputed when n changes.
+    static thread_local int cached_n = 0;
+    static thread_local double zetan = 0, alpha = 0, eta = 0;
+    if (cached_n != n) {
+      cached_n = n;
+      zetan = 0;
+      for (int i = 1; i <= n; i++) {
+        zetan += 1.0 / std::pow(static_cast<double>(i), theta);
+      }
+      alpha = 1.0 / (1.0 - theta);
+      const double zeta2 = 1.0 + std::pow(0.5, theta);
+      eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+    const double u = (thread->rand.Next() % 1000000) / 1000000.0;
+    const double uz = u * zetan;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + std::pow(0.5, theta)) return 1;
+    return static_cast<int>(n * std::pow(eta * u - eta + 1.0, alpha));
+  }
+
+  // Pick a key index according to FLAGS_key_distribution.
+  int ChooseKey(ThreadState* thread) {
+    if (strcmp(FLAGS_key_distribution, "zipfian") == 0) {
+      return ZipfianKey(thread, FLAGS_num);
+    }
+    if (strcmp(FLAGS_key_distribution, "latest") == 0) {
+      // Hot keys are the most recently written ones.
+      const int offset = ZipfianKey(thread, FLAGS_num);
+      return FLAGS_num - 1 - offset;
+    }
+    return thread->rand.Uniform(FLAGS_num);
+  }
+
+  // Per-thread read/scan/write mix; see FLAGS_mixed_*.
+  void Mixed(ThreadState* thread) {
+    ReadOptions options;
+    RandomGenerator gen;
+    std::string value;
+    KeyBuffer key;
+    int found = 0, gets = 0, scans = 0, writes = 0;
+    for (int i = 0; i < reads_; i++) {
+      const double op = (thread->rand.Next() % 1000000) / 1000000.0;
+      const int k = ChooseKey(thread);
+      key.Set(k);
+      if (op < FLAGS_mixed_read_ratio) {
+        gets++;
+        if (db_->Get(options, key.slice(), &value).ok()) {
+          found++;
+        }
+      } else if (op < FLAGS_mixed_read_ratio + FLAGS_mixed_scan_ratio) {
+        scans++;
+        Iterator* iter = db_->NewIterator(options);
+        iter->Seek(key.slice());
+        for (int j = 0; j < FLAGS_scan_length && iter->Valid(); j++) {
+          iter->Next();
+        }
+        delete iter;
+      } else {
+        writes++;
+        if (!db_->Put(write_options_, key.slice(),
+                      gen.Generate(value_size_))
+                 .ok()) {
+          std::fprintf(stderr, "put error\n");
+          std::exit(1);
+        }
+      }
+      thread->stats.FinishedSingleOp();
+    }
+    char msg[120];
+    std::snprintf(msg, sizeof(msg),
+                  "(%d gets (%d found), %d scans, %d writes)", gets, found,
+                  scans, writes);
+    thread->stats.AddMessage(msg);
+  }
+
   void ReadRandom(ThreadState* thread) {
     ReadOptions options;
     std::string value;
     int found = 0;
     KeyBuffer key;
     for (int i = 0; i < reads_; i++) {
-      const int k = thread->rand.Uniform(FLAGS_num);
+      const int k = ChooseKey(thread);
       key.Set(k);
       if (db_->Get(options, key.slice(), &value).ok()) {
         found++;
@@ -1076,6 +1239,16 @@ int main(int argc, char** argv) {
     char junk;
     if (leveldb::Slice(argv[i]).starts_with("--benchmarks=")) {
       FLAGS_benchmarks = argv[i] + strlen("--benchmarks=");
+    } else if (leveldb::Slice(argv[i]).starts_with("--key_distribution=")) {
+      FLAGS_key_distribution = argv[i] + strlen("--key_distribution=");
+    } else if (sscanf(argv[i], "--zipfian_theta=%lf%c", &d, &junk) == 1) {
+      FLAGS_zipfian_theta = d;
+    } else if (sscanf(argv[i], "--mixed_read_ratio=%lf%c", &d, &junk) == 1) {
+      FLAGS_mixed_read_ratio = d;
+    } else if (sscanf(argv[i], "--mixed_scan_ratio=%lf%c", &d, &junk) == 1) {
+      FLAGS_mixed_scan_ratio = d;
+    } else if (sscanf(argv[i], "--scan_length=%d%c", &n, &junk) == 1) {
+      FLAGS_scan_length = n;
     } else if (sscanf(argv[i], "--compression_ratio=%lf%c", &d, &junk) == 1) {
       FLAGS_compression_ratio = d;
     } else if (sscanf(argv[i], "--histogram=%d%c", &n, &junk) == 1 &&
@@ -1115,6 +1288,13 @@ int main(int argc, char** argv) {
       FLAGS_bloom_bits = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
       FLAGS_open_files = n;
+    } else if (strncmp(argv[i], "--json=", 7) == 0) {
+      FLAGS_json = argv[i] + 7;
+    } else if (strncmp(argv[i], "--compare=", 10) == 0) {
+      FLAGS_compare = argv[i] + 10;
+    } else if (sscanf(argv[i], "--regression_threshold=%lf%c", &d, &junk) ==
+               1) {
+      FLAGS_regression_threshold = d;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
       FLAGS_db = argv[i] + 5;
     } else {
@@ -1134,5 +1314,57 @@ int main(int argc, char** argv) {
 
   leveldb::Benchmark benchmark;
   benchmark.Run();
-  return 0;
+
+  int exit_code = 0;
+  if (FLAGS_json != nullptr) {
+    FILE* f = std::fopen(FLAGS_json, "w");
+    if (f != nullptr) {
+      std::fprintf(f, "{\n\"benchmarks\": [\n");
+      for (size_t i = 0; i < leveldb::g_results.size(); i++) {
+        const leveldb::BenchResult& r = leveldb::g_results[i];
+        std::fprintf(
+            f,
+            "{\"name\": \"%s\", \"micros_per_op\": %.4f, "
+            "\"ops_per_sec\": %.1f, \"mb_per_sec\": %.2f, "
+            "\"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, "
+            "\"stall_micros\": %llu}%s\n",
+            r.name.c_str(), r.micros_per_op, r.ops_per_sec, r.mb_per_sec,
+            r.p50, r.p99, r.p999,
+            static_cast<unsigned long long>(r.stall_micros),
+            i + 1 < leveldb::g_results.size() ? "," : "");
+      }
+      std::fprintf(f, "]\n}\n");
+      std::fclose(f);
+    } else {
+      std::fprintf(stderr, "cannot write %s\n", FLAGS_json);
+      exit_code = 1;
+    }
+  }
+  if (FLAGS_compare != nullptr) {
+    std::string baseline;
+    leveldb::Status s = leveldb::ReadFileToString(
+        leveldb::g_env, FLAGS_compare, &baseline);
+    if (!s.ok()) {
+      std::fprintf(stderr, "cannot read baseline %s: %s\n",
+                   FLAGS_compare, s.ToString().c_str());
+      exit_code = 1;
+    } else {
+      for (size_t i = 0; i < leveldb::g_results.size(); i++) {
+        const leveldb::BenchResult& r = leveldb::g_results[i];
+        const double base =
+            leveldb::BaselineMicrosPerOp(baseline, r.name);
+        if (base <= 0) {
+          continue;
+        }
+        const double delta = (r.micros_per_op - base) / base;
+        if (delta > FLAGS_regression_threshold) {
+          std::fprintf(stderr,
+                       "REGRESSION %-12s %.3f -> %.3f micros/op (%+.1f%%)\n",
+                       r.name.c_str(), base, r.micros_per_op, delta * 100);
+          exit_code = 1;
+        }
+      }
+    }
+  }
+  return exit_code;
 }
@@ -0,0 +1,132 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Replays a trace captured with DB::StartTrace() against a database.
+//
+//   db_replay --db=<path> --trace=<file> [--as_fast_as_possible]
+//
+// Without --as_fast_as_possible the original inter-operation gaps are
+// reproduced, so option changes can be evaluated under real traffic.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "db/write_batch_internal.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "leveldb/write_batch.h"
+
+namespace {
+
+std::string FLAGS_db;
+std::string FLAGS_trace;
+bool FLAGS_as_fast_as_possible = false;
+
+bool HexDecode(const std::string& hex, std::string* out) {
+  if (hex.size() % 2 != 0) return false;
+  out->clear();
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    int hi = std::isdigit(hex[i]) ? hex[i] - '0' : hex[i] - 'a' + 10;
+    int lo = std::isdigit(hex[i + 1]) ? hex[i + 1] - '0' : hex[i + 1] - 'a' + 10;
+    if (hi < 0 || hi > 15 || lo < 0 || lo > 15) return false;
+    out->push_back(static_cast<char>((hi << 4) | lo));
+  }
+  return true;
+}
+
+int Replay() {
+  leveldb::Options options;
+  options.create_if_missing = true;
+  leveldb::DB* db;
+  leveldb::Status s = leveldb::DB::Open(options, FLAGS_db, &db);
+  if (!s.ok()) {
+    std::fprintf(stderr, "open: %s\n", s.ToString().c_str());
+    return 1;
+  }
+
+  std::FILE* trace = std::fopen(FLAGS_trace.c_str(), "r");
+  if (trace == nullptr) {
+    std::fprintf(stderr, "cannot open trace %s\n", FLAGS_trace.c_str());
+    delete db;
+    return 1;
+  }
+
+  leveldb::Env* env = leveldb::Env::Default();
+  uint64_t first_trace_micros = 0;
+  uint64_t replay_start_micros = 0;
+  uint64_t ops = 0, errors = 0;
+  char line[1 << 20];
+  std::string payload;
+  while (std::fgets(line, sizeof(line), trace) != nullptr) {
+    unsigned long long micros;
+    char op[16];
+    char hex[sizeof(line)];
+    if (std::sscanf(line, "%llu %15s %s", &micros, op, hex) != 3 ||
+        !HexDecode(hex, &payload)) {
+      std::fprintf(stderr, "skipping malformed trace line\n");
+      continue;
+    }
+    if (ops == 0) {
+      first_trace_micros = micros;
+      replay_start_micros = env->NowMicros();
+    } else if (!FLAGS_as_fast_as_possible) {
+      const uint64_t target =
+          replay_start_micros + (micros - first_trace_micros);
+      const uint64_t now = env->NowMicros();
+      if (target > now) {
+        env->SleepForMicroseconds(static_cast<int>(target - now));
+      }
+    }
+    ops++;
+
+    if (std::strcmp(op, "get") == 0) {
+      std::string value;
+      db->Get(leveldb::ReadOptions(), payload, &value);
+    } else if (std::strcmp(op, "write") == 0) {
+      leveldb::WriteBatch batch;
+      leveldb::WriteBatchInternal::SetContents(&batch, payload);
+      if (!db->Write(leveldb::WriteOptions(), &batch).ok()) errors++;
+    } else if (std::strcmp(op, "seek") == 0) {
+      leveldb::Iterator* iter = db->NewIterator(leveldb::ReadOptions());
+      iter->Seek(payload);
+      delete iter;
+    } else {
+      std::fprintf(stderr, "unknown op %s\n", op);
+    }
+  }
+  std::fclose(trace);
+
+  const double elapsed = (env->NowMicros() - replay_start_micros) / 1e6;
+  std::fprintf(stdout, "replayed %llu ops in %.3f s (%d errors)\n",
+               static_cast<unsigned long long>(ops), elapsed,
+               static_cast<int>(errors));
+  delete db;
+  return errors == 0 ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (std::strncmp(argv[i], "--db=", 5) == 0) {
+      FLAGS_db = argv[i] + 5;
+    } else if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+      FLAGS_trace = argv[i] + 8;
+    } else if (std::strcmp(argv[i], "--as_fast_as_possible") == 0) {
+      FLAGS_as_fast_as_possible = true;
+    } else {
+      std::fprintf(stderr, "unknown flag %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (FLAGS_db.empty() || FLAGS_trace.empty()) {
+    std::fprintf(stderr,
+                 "usage: db_replay --db=<path> --trace=<file> "
+                 "[--as_fast_as_possible]\n");
+    return 1;
+  }
+  return Replay();
+}
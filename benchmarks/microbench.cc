@@ -0,0 +1,174 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Microbenchmarks for internal data structures, so a SkipList or
+// Block::Iter change can be measured in isolation from whole-DB runs.
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "db/skiplist.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+#include "leveldb/comparator.h"
+#include "leveldb/options.h"
+#include "util/arena.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/hash.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+namespace {
+
+typedef uint64_t Key;
+
+struct KeyComparator {
+  int operator()(const Key& a, const Key& b) const {
+    return (a < b) ? -1 : (a > b) ? +1 : 0;
+  }
+};
+
+std::string MakeKey(int i) {
+  char buf[24];
+  std::snprintf(buf, sizeof(buf), "key%012d", i);
+  return std::string(buf);
+}
+
+void BM_SkipListInsert(benchmark::State& state) {
+  while (state.KeepRunningBatch(100000)) {
+    state.PauseTiming();
+    Arena arena;
+    KeyComparator cmp;
+    SkipList<Key, KeyComparator> list(cmp, &arena);
+    Random rnd(301);
+    state.ResumeTiming();
+    for (int i = 0; i < 100000; i++) {
+      list.Insert((static_cast<uint64_t>(rnd.Next()) << 16) | i);
+    }
+  }
+}
+BENCHMARK(BM_SkipListInsert);
+
+void BM_SkipListLookup(benchmark::State& state) {
+  Arena arena;
+  KeyComparator cmp;
+  SkipList<Key, KeyComparator> list(cmp, &arena);
+  for (int i = 0; i < 100000; i++) {
+    list.Insert(static_cast<uint64_t>(i) * 7);
+  }
+  Random rnd(301);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        list.Contains(static_cast<uint64_t>(rnd.Uniform(100000)) * 7));
+  }
+}
+BENCHMARK(BM_SkipListLookup);
+
+// Build one data block shared by the seek/scan benchmarks.
+std::string BuildBlock(int entries, std::vector<std::string>* keys) {
+  Options options;
+  BlockBuilder builder(&options);
+  for (int i = 0; i < entries; i++) {
+    std::string key = MakeKey(i);
+    keys->push_back(key);
+    builder.Add(key, "value-payload-0123456789");
+  }
+  return builder.Finish().ToString();
+}
+
+void BM_BlockIterSeek(benchmark::State& state) {
+  std::vector<std::string> keys;
+  const std::string contents = BuildBlock(1000, &keys);
+  BlockContents block_contents;
+  block_contents.data = Slice(contents);
+  block_contents.cachable = false;
+  block_contents.heap_allocated = false;
+  Block block(block_contents);
+  Random rnd(301);
+  for (auto _ : state) {
+    Iterator* iter = block.NewIterator(BytewiseComparator());
+    iter->Seek(keys[rnd.Uniform(keys.size())]);
+    benchmark::DoNotOptimize(iter->Valid());
+    delete iter;
+  }
+}
+BENCHMARK(BM_BlockIterSeek);
+
+void BM_BlockIterScan(benchmark::State& state) {
+  std::vector<std::string> keys;
+  const std::string contents = BuildBlock(1000, &keys);
+  BlockContents block_contents;
+  block_contents.data = Slice(contents);
+  block_contents.cachable = false;
+  block_contents.heap_allocated = false;
+  Block block(block_contents);
+  for (auto _ : state) {
+    Iterator* iter = block.NewIterator(BytewiseComparator());
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      benchmark::DoNotOptimize(iter->value());
+    }
+    delete iter;
+  }
+}
+BENCHMARK(BM_BlockIterScan);
+
+void BM_BlockBuilderAdd(benchmark::State& state) {
+  Options options;
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; i++) {
+    keys.push_back(MakeKey(i));
+  }
+  for (auto _ : state) {
+    BlockBuilder builder(&options);
+    for (size_t i = 0; i < keys.size(); i++) {
+      builder.Add(keys[i], "value-payload-0123456789");
+    }
+    benchmark::DoNotOptimize(builder.Finish());
+  }
+}
+BENCHMARK(BM_BlockBuilderAdd);
+
+void BM_VarintRoundTrip(benchmark::State& state) {
+  std::string encoded;
+  for (uint32_t i = 0; i < 1000; i++) {
+    PutVarint32(&encoded, i * 2675);
+  }
+  for (auto _ : state) {
+    const char* p = encoded.data();
+    const char* limit = p + encoded.size();
+    uint32_t value;
+    while (p < limit) {
+      p = GetVarint32Ptr(p, limit, &value);
+      benchmark::DoNotOptimize(value);
+    }
+  }
+}
+BENCHMARK(BM_VarintRoundTrip);
+
+void BM_Crc32c(benchmark::State& state) {
+  std::string data(state.range(0), 'x');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(crc32c::Value(data.data(), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Crc32c)->Arg(4096)->Arg(65536);
+
+void BM_XXHash64(benchmark::State& state) {
+  std::string data(state.range(0), 'x');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(XXHash64(data.data(), data.size(), 0));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_XXHash64)->Arg(4096)->Arg(65536);
+
+}  // namespace
+}  // namespace leveldb
+
+BENCHMARK_MAIN();
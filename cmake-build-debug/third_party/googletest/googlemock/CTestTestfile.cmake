@@ -1,7 +0,0 @@
-# CMake generated Testfile for 
-# Source directory: /Users/xingeqi/CLionProjects/leveldb/third_party/googletest/googlemock
-# Build directory: /Users/xingeqi/CLionProjects/leveldb/cmake-build-debug/third_party/googletest/googlemock
-# 
-# This file includes the relevant testing commands required for 
-# testing this directory and lists subdirectories to be tested as well.
-subdirs("../googletest")
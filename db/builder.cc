@@ -11,6 +11,8 @@
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
+#include "util/coding.h"
+#include "util/rate_limiter.h"
 
 namespace leveldb {
 
@@ -27,20 +29,67 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
     if (!s.ok()) {
       return s;
     }
+    file->HintStreamingWrites(1 << 20);  // Flushes are smaller files
+    file->Preallocate(options.max_file_size);
+    if (options.rate_limiter != nullptr) {
+      file = NewRateLimitedWritableFile(file, options.rate_limiter,
+                                        RateLimiter::kFlush);
+    }
+
+    // Large values are appended to a companion blob file and replaced
+    // by a (file, offset, size) handle; the handle rides through all
+    // future compactions while the value stays put.
+    WritableFile* blob_file = nullptr;
+    uint64_t blob_offset = 0;
+    const std::string blob_fname = BlobFileName(dbname, meta->number);
 
     TableBuilder* builder = new TableBuilder(options, file);
     meta->smallest.DecodeFrom(iter->key());
     Slice key;
-    for (; iter->Valid(); iter->Next()) {
+    std::string handle_key;
+    for (; s.ok() && iter->Valid(); iter->Next()) {
       key = iter->key();
-      builder->Add(key, iter->value());
+      ParsedInternalKey ikey;
+      if (options.blob_value_threshold != 0 &&
+          iter->value().size() >= options.blob_value_threshold &&
+          ParseInternalKey(key, &ikey) && ikey.type == kTypeValue) {
+        if (blob_file == nullptr) {
+          s = env->NewWritableFile(blob_fname, &blob_file);
+          if (!s.ok()) break;
+        }
+        const Slice value = iter->value();
+        std::string handle;
+        PutVarint64(&handle, meta->number);
+        PutVarint64(&handle, blob_offset);
+        PutVarint64(&handle, value.size());
+        s = blob_file->Append(value);
+        if (!s.ok()) break;
+        blob_offset += value.size();
+        handle_key.clear();
+        AppendInternalKey(&handle_key, ParsedInternalKey(ikey.user_key,
+                                                         ikey.sequence,
+                                                         kTypeBlobHandle));
+        key = Slice(handle_key);
+        builder->Add(key, handle);
+      } else {
+        builder->Add(key, iter->value());
+      }
     }
     if (!key.empty()) {
       meta->largest.DecodeFrom(key);
     }
 
-    // Finish and check for builder errors
-    s = builder->Finish();
+    // Finish and check for blob and builder errors
+    if (blob_file != nullptr) {
+      if (s.ok()) s = blob_file->Sync();
+      if (s.ok()) s = blob_file->Close();
+      delete blob_file;
+    }
+    if (s.ok()) {
+      s = builder->Finish();
+    } else {
+      builder->Abandon();
+    }
     if (s.ok()) {
       meta->file_size = builder->FileSize();
       assert(meta->file_size > 0);
@@ -75,6 +124,7 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
     // Keep it
   } else {
     env->RemoveFile(fname);
+    env->RemoveFile(BlobFileName(dbname, meta->number));
   }
   return s;
 }
@@ -10,6 +10,7 @@
 #include <cstdlib>
 
 #include "leveldb/cache.h"
+#include "util/coding.h"
 #include "leveldb/comparator.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
@@ -216,6 +217,35 @@ char* leveldb_get(leveldb_t* db, const leveldb_readoptions_t* options,
   return result;
 }
 
+void leveldb_multiget(leveldb_t* db, const leveldb_readoptions_t* options,
+                      size_t num_keys, const char* const* keys,
+                      const size_t* key_lens, char** values,
+                      size_t* value_lens, char** statuses) {
+  std::vector<Slice> key_slices;
+  key_slices.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    key_slices.push_back(Slice(keys[i], key_lens[i]));
+  }
+  std::vector<std::string> results;
+  std::vector<Status> ss = db->rep->MultiGet(options->rep, key_slices,
+                                             &results);
+  for (size_t i = 0; i < num_keys; i++) {
+    if (ss[i].ok()) {
+      values[i] = CopyString(results[i]);
+      value_lens[i] = results[i].size();
+    } else {
+      values[i] = nullptr;
+      value_lens[i] = 0;
+    }
+    if (statuses != nullptr) {
+      statuses[i] = nullptr;
+      if (!ss[i].ok() && !ss[i].IsNotFound()) {
+        SaveError(&statuses[i], ss[i]);
+      }
+    }
+  }
+}
+
 leveldb_iterator_t* leveldb_create_iterator(
     leveldb_t* db, const leveldb_readoptions_t* options) {
   leveldb_iterator_t* result = new leveldb_iterator_t;
@@ -303,6 +333,31 @@ void leveldb_iter_seek(leveldb_iterator_t* iter, const char* k, size_t klen) {
 
 void leveldb_iter_next(leveldb_iterator_t* iter) { iter->rep->Next(); }
 
+size_t leveldb_iter_next_many(leveldb_iterator_t* iter, size_t max_entries,
+                              char* buffer, size_t buffer_len,
+                              size_t* bytes_used) {
+  size_t count = 0;
+  size_t used = 0;
+  while (count < max_entries && iter->rep->Valid()) {
+    const Slice key = iter->rep->key();
+    const Slice value = iter->rep->value();
+    const size_t need = 8 + key.size() + value.size();
+    if (used + need > buffer_len) {
+      break;  // Entry stays pending for the next call
+    }
+    leveldb::EncodeFixed32(buffer + used, static_cast<uint32_t>(key.size()));
+    memcpy(buffer + used + 4, key.data(), key.size());
+    used += 4 + key.size();
+    leveldb::EncodeFixed32(buffer + used, static_cast<uint32_t>(value.size()));
+    memcpy(buffer + used + 4, value.data(), value.size());
+    used += 4 + value.size();
+    count++;
+    iter->rep->Next();
+  }
+  *bytes_used = used;
+  return count;
+}
+
 void leveldb_iter_prev(leveldb_iterator_t* iter) { iter->rep->Prev(); }
 
 const char* leveldb_iter_key(const leveldb_iterator_t* iter, size_t* klen) {
@@ -334,6 +389,21 @@ void leveldb_writebatch_put(leveldb_writebatch_t* b, const char* key,
   b->rep.Put(Slice(key, klen), Slice(val, vlen));
 }
 
+void leveldb_writebatch_put_many(leveldb_writebatch_t* b, size_t num_entries,
+                                 const char* const* keys,
+                                 const size_t* key_lens,
+                                 const char* const* vals,
+                                 const size_t* val_lens) {
+  size_t bytes = 0;
+  for (size_t i = 0; i < num_entries; i++) {
+    bytes += key_lens[i] + val_lens[i] + 16;
+  }
+  b->rep.Reserve(b->rep.ApproximateSize() + bytes);
+  for (size_t i = 0; i < num_entries; i++) {
+    b->rep.Put(Slice(keys[i], key_lens[i]), Slice(vals[i], val_lens[i]));
+  }
+}
+
 void leveldb_writebatch_delete(leveldb_writebatch_t* b, const char* key,
                                size_t klen) {
   b->rep.Delete(Slice(key, klen));
@@ -8,6 +8,8 @@
 #include <atomic>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <thread>
 #include <set>
 #include <string>
 #include <vector>
@@ -24,6 +26,9 @@
 #include "db/write_batch_internal.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/event_listener.h"
+#include "leveldb/merge_operator.h"
+#include "leveldb/perf_context.h"
 #include "leveldb/status.h"
 #include "leveldb/table.h"
 #include "leveldb/table_builder.h"
@@ -34,9 +39,15 @@
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/tracing.h"
+#include "util/rate_limiter.h"
 
 namespace leveldb {
 
+// Declared in util/env.cc: write "data" to the named file and Sync().
+Status WriteStringToFileSync(Env* env, const Slice& data,
+                             const std::string& fname);
+
 const int kNumNonTableCacheFiles = 10;
 
 // Information kept for every waiting writer
@@ -49,9 +60,24 @@ struct DBImpl::Writer {
   bool sync;
   bool done;
   port::CondVar cv;
+
+  // Non-null for writers enqueued by WriteAsync(); such writers are
+  // heap-allocated and are deleted after the callback is invoked.
+  std::function<void(Status)> callback;
 };
 
 struct DBImpl::CompactionState {
+  // Live snapshot sequences (sorted) at the start of the compaction;
+  // an overwritten entry may be dropped when no snapshot separates it
+  // from the newer entry that shadows it.
+  std::vector<SequenceNumber> snapshots;
+
+  bool SameSnapshotStratum(SequenceNumber older, SequenceNumber newer) const {
+    std::vector<SequenceNumber>::const_iterator it =
+        std::lower_bound(snapshots.begin(), snapshots.end(), older);
+    return it == snapshots.end() || *it >= newer;
+  }
+
   // Files produced by compaction
   struct Output {
     uint64_t number;
@@ -64,12 +90,28 @@ struct DBImpl::CompactionState {
   explicit CompactionState(Compaction* c)
       : compaction(c),
         smallest_snapshot(0),
+        exclusive(true),
+        has_begin(false),
+        has_end(false),
         outfile(nullptr),
         builder(nullptr),
         total_bytes(0) {}
 
   Compaction* const compaction;
 
+  // True if this state owns the whole compaction; false for one shard
+  // of a parallel compaction.  Shards avoid the stateful per-Compaction
+  // heuristics (grandparent cut points, IsBaseLevelForKey) since those
+  // assume a single sequential scan over all inputs.
+  bool exclusive;
+
+  // User-key range [begin,end) processed by this state.  has_begin or
+  // has_end is false when the range is unbounded on that side.
+  bool has_begin;
+  bool has_end;
+  std::string begin;
+  std::string end;
+
   // Sequence numbers < smallest_snapshot are not significant since we
   // will never have to service a snapshot below smallest_snapshot.
   // Therefore if we have seen a sequence number S <= smallest_snapshot,
@@ -85,6 +127,19 @@ struct DBImpl::CompactionState {
   uint64_t total_bytes;
 };
 
+// One shard of a parallel compaction, run via Env::Schedule().
+struct DBImpl::SubcompactionState {
+  DBImpl* db;
+  CompactionState* compact;
+  Iterator* input;
+  Status status;
+
+  // Completion signalling back to the coordinating thread.
+  port::Mutex* mu;
+  port::CondVar* cv;
+  int* pending;  // Guarded by *mu
+};
+
 // Fix user-supplied options to be reasonable
 template <class T, class V>
 static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
@@ -98,7 +153,40 @@ Options SanitizeOptions(const std::string& dbname,
   Options result = src;
   result.comparator = icmp;
   result.filter_policy = (src.filter_policy != nullptr) ? ipolicy : nullptr;
-  ClipToRange(&result.max_open_files, 64 + kNumNonTableCacheFiles, 50000);
+  if (result.max_open_files != -1) {
+    ClipToRange(&result.max_open_files, 64 + kNumNonTableCacheFiles, 50000);
+  }
+  ClipToRange(&result.max_background_compactions, 1, config::kNumLevels - 1);
+  ClipToRange(&result.max_subcompactions, 1, 16);
+  ClipToRange(&result.max_immutable_memtables, 1, 8);
+  ClipToRange(&result.max_mem_compact_level, 0, config::kNumLevels - 1);
+  if (result.write_buffer_size < 2 * ArenaBlockPool::kSlabSize) {
+    // Slab-granular memory accounting would dwarf a small write buffer
+    // and force a memtable switch on nearly every write.
+    result.recycle_memtable_arena = false;
+  }
+  if (result.wal_block_size != 0) {
+    ClipToRange(&result.wal_block_size, static_cast<size_t>(log::kBlockSize),
+                static_cast<size_t>(1 << 26));
+    result.wal_block_size =
+        ((result.wal_block_size + log::kBlockSize - 1) / log::kBlockSize) *
+        log::kBlockSize;
+  }
+  if (result.wal_compression || result.wal_block_size != 0) {
+    // v2 logs cannot be appended to with the classic writer, and
+    // recyclable records are not combined with the v2 stream format.
+    result.reuse_logs = false;
+    result.recycle_log_files = 0;
+  }
+  if (result.merge_operator != nullptr || result.blob_value_threshold != 0) {
+    // Both transform stored values, which would break the trailing
+    // per-entry crc.
+    result.value_checksums = false;
+  }
+  if (result.value_checksums) {
+    // The per-entry crc covers the plain value; do not re-encode it.
+    result.memtable_compression = false;
+  }
   ClipToRange(&result.write_buffer_size, 64 << 10, 1 << 30);
   ClipToRange(&result.max_file_size, 1 << 20, 1 << 30);
   ClipToRange(&result.block_size, 1 << 10, 4 << 20);
@@ -118,12 +206,52 @@ Options SanitizeOptions(const std::string& dbname,
   return result;
 }
 
+// Create a log writer for a fresh log file, honoring the v2 WAL
+// options.
+static log::Writer* NewLogWriter(const Options& options, WritableFile* file,
+                                 uint64_t log_number) {
+  // A log grows to about one write buffer before rotation; reserving
+  // the extents up front keeps allocation journaling out of fsyncs.
+  file->Preallocate(options.write_buffer_size + (options.write_buffer_size / 8));
+  if (options.wal_compression || options.wal_block_size != 0) {
+    const size_t block_size =
+        options.wal_block_size != 0 ? options.wal_block_size : log::kBlockSize;
+    return new log::Writer(file, block_size, options.wal_compression);
+  }
+  log::Writer* writer = new log::Writer(file);
+  if (options.recycle_log_files > 0) {
+    writer->SetRecycleLogNumber(static_cast<uint32_t>(log_number));
+  }
+  return writer;
+}
+
+EventListener::~EventListener() = default;
+
+// Invoke cb(listener) for each configured listener with mutex_
+// released; no-op when there are none.
+template <typename NotifyFn>
+static void NotifyListeners(const Options& options, port::Mutex* mu,
+                            NotifyFn cb) {
+  if (options.listeners.empty()) {
+    return;
+  }
+  mu->Unlock();
+  for (size_t i = 0; i < options.listeners.size(); i++) {
+    cb(options.listeners[i]);
+  }
+  mu->Lock();
+}
+
 static int TableCacheSize(const Options& sanitized_options) {
+  if (sanitized_options.max_open_files == -1) {
+    return -1;  // Keep every table permanently open
+  }
   // Reserve ten files or so for other uses and give the rest to TableCache.
   return sanitized_options.max_open_files - kNumNonTableCacheFiles;
 }
 
-DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
+DBImpl::DBImpl(const Options& raw_options, const std::string& dbname,
+               bool read_only)
     : env_(raw_options.env),
       internal_comparator_(raw_options.comparator),
       internal_filter_policy_(raw_options.filter_policy),
@@ -131,31 +259,182 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
                                &internal_filter_policy_, raw_options)),
       owns_info_log_(options_.info_log != raw_options.info_log),
       owns_cache_(options_.block_cache != raw_options.block_cache),
+      read_only_(read_only),
       dbname_(dbname),
       table_cache_(new TableCache(dbname_, options_, TableCacheSize(options_))),
       db_lock_(nullptr),
       shutting_down_(false),
       background_work_finished_signal_(&mutex_),
       mem_(nullptr),
-      imm_(nullptr),
       has_imm_(false),
       logfile_(nullptr),
       logfile_number_(0),
       log_(nullptr),
       seed_(0),
-      tmp_batch_(new WriteBatch),
-      background_compaction_scheduled_(false),
+      last_allocated_sequence_(0),
+      apply_done_signal_(&mutex_),
+      async_writer_running_(false),
+      group_size_limit_(1 << 20),
+      log_appended_epoch_(0),
+      log_synced_epoch_(0),
+      log_sync_in_progress_(false),
+      sync_done_signal_(&mutex_),
+      background_compactions_scheduled_(0),
+      tuned_write_buffer_size_(options_.write_buffer_size),
+      tuned_l0_slowdown_trigger_(options_.l0_slowdown_writes_trigger),
+      tuned_l0_stop_trigger_(options_.l0_stop_writes_trigger),
+      imm_compacting_(false),
+      manifest_write_in_progress_(false),
       manual_compaction_(nullptr),
       versions_(new VersionSet(dbname_, &options_, table_cache_,
-                               &internal_comparator_)) {}
+                               &internal_comparator_)),
+      arena_pool_(options_.recycle_memtable_arena
+                      ? new ArenaBlockPool(
+                            (options_.write_buffer_size /
+                                 ArenaBlockPool::kSlabSize +
+                             2) *
+                            (options_.max_immutable_memtables + 1))
+                      : nullptr),
+      write_slowdown_micros_(0),
+      write_stall_micros_(0),
+      last_ttl_check_micros_(0),
+      last_tombstone_check_micros_(0),
+      next_txn_id_(raw_options.env->NowMicros()),
+      tracing_(false),
+      trace_file_(nullptr) {
+  for (int i = 0; i < kSnapshotSlots; i++) {
+    snapshot_slots_[i].store(0, std::memory_order_relaxed);
+  }
+  if (options_.negative_cache_size != 0) {
+    negative_cache_ = NewLRUCache(options_.negative_cache_size);
+  }
+  read_state_.store(nullptr, std::memory_order_relaxed);
+  for (int i = 0; i < kReadStateSlots; i++) {
+    read_state_slots_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+void DBImpl::RefreshReadState() {
+  mutex_.AssertHeld();
+  ReadState* state = new ReadState;
+  state->version = versions_->current();
+  state->version->Ref();
+  state->mem = mem_;
+  if (state->mem != nullptr) {
+    state->mem->Ref();
+  }
+  for (size_t i = imms_.size(); i > 0; i--) {
+    imms_[i - 1].mem->Ref();
+    state->imms.push_back(imms_[i - 1].mem);
+  }
+  ReadState* old = read_state_.exchange(state, std::memory_order_acq_rel);
+  if (old != nullptr) {
+    retired_read_states_.push_back(old);
+  }
+  ReclaimRetiredReadStates();
+}
+
+void DBImpl::ReclaimRetiredReadStates() {
+  mutex_.AssertHeld();
+  for (size_t i = 0; i < retired_read_states_.size();) {
+    ReadState* state = retired_read_states_[i];
+    bool referenced = false;
+    for (int slot = 0; slot < kReadStateSlots && !referenced; slot++) {
+      referenced =
+          (read_state_slots_[slot].load(std::memory_order_seq_cst) == state);
+    }
+    if (referenced) {
+      i++;
+      continue;
+    }
+    state->version->Unref();
+    if (state->mem != nullptr) {
+      state->mem->Unref();
+    }
+    for (size_t j = 0; j < state->imms.size(); j++) {
+      state->imms[j]->Unref();
+    }
+    delete state;
+    retired_read_states_[i] = retired_read_states_.back();
+    retired_read_states_.pop_back();
+  }
+}
 
 DBImpl::~DBImpl() {
-  // Wait for background work to finish.
   mutex_.Lock();
+  bool clean = !read_only_ && bg_error_.ok();
+  bool mem_empty = true;
+  if (clean && mem_ != nullptr) {
+    Iterator* it = mem_->NewIterator();
+    it->SeekToFirst();
+    mem_empty = !it->Valid();
+    delete it;
+  }
+  if (clean && options_.flush_on_close) {
+    // Opt-in: flush everything buffered so the clean-shutdown marker
+    // below always applies.  The default keeps the stock contract that
+    // unflushed data lives only in the WAL.
+    if (!mem_empty) {
+      ImmutableMemTable retired;
+      retired.mem = mem_;
+      retired.log_number = logfile_number_;
+      imms_.push_back(retired);
+      has_imm_.store(true, std::memory_order_release);
+      mem_ = new MemTable(internal_comparator_, arena_pool_,
+                          options_.memtable_hash_index,
+                          options_.value_checksums, &negative_stamps_,
+                          options_.memtable_compression);
+      mem_->Ref();
+      mem_empty = true;
+    }
+    while (clean && !imms_.empty()) {
+      if (imm_compacting_) {
+        background_work_finished_signal_.Wait();
+      } else {
+        CompactMemTable();
+      }
+      clean = bg_error_.ok();
+    }
+  }
+
+  // Wait for background work to finish.
   shutting_down_.store(true, std::memory_order_release);
-  while (background_compaction_scheduled_) {
+  while (background_compactions_scheduled_ > 0 || preparing_logfile_ ||
+         wal_syncer_running_ || obsolete_deleter_running_ ||
+         output_verifications_running_ > 0) {
     background_work_finished_signal_.Wait();
   }
+  if (prepared_logfile_ != nullptr) {
+    delete prepared_logfile_;
+    env_->RemoveFile(LogFileName(dbname_, prepared_logfile_number_));
+    prepared_logfile_ = nullptr;
+  }
+  // Retire the published read state and wait out any in-flight
+  // lock-free readers (callers must not race reads with close, but be
+  // defensive about stragglers).
+  ReadState* state = read_state_.exchange(nullptr, std::memory_order_acq_rel);
+  if (state != nullptr) {
+    retired_read_states_.push_back(state);
+  }
+  for (int attempt = 0; attempt < 1000 && !retired_read_states_.empty();
+       attempt++) {
+    ReclaimRetiredReadStates();
+    if (!retired_read_states_.empty()) {
+      mutex_.Unlock();
+      env_->SleepForMicroseconds(1000);
+      mutex_.Lock();
+    }
+  }
+  if (clean && bg_error_.ok() && mem_empty && imms_.empty()) {
+    // Everything is in tables and the manifest: record that so the
+    // next open can prove log replay unnecessary.
+    char marker[100];
+    std::snprintf(marker, sizeof(marker), "%llu %llu",
+                  static_cast<unsigned long long>(logfile_number_),
+                  static_cast<unsigned long long>(versions_->LastSequence()));
+    WriteStringToFileSync(env_, marker,
+                          dbname_ + "/CLEAN_SHUTDOWN");
+  }
   mutex_.Unlock();
 
   if (db_lock_ != nullptr) {
@@ -163,9 +442,14 @@ DBImpl::~DBImpl() {
   }
 
   delete versions_;
+  for (size_t i = 0; i < retired_version_sets_.size(); i++) {
+    delete retired_version_sets_[i];
+  }
   if (mem_ != nullptr) mem_->Unref();
-  if (imm_ != nullptr) imm_->Unref();
-  delete tmp_batch_;
+  while (!imms_.empty()) {
+    imms_.front().mem->Unref();
+    imms_.pop_front();
+  }
   delete log_;
   delete logfile_;
   delete table_cache_;
@@ -176,6 +460,31 @@ DBImpl::~DBImpl() {
   if (owns_cache_) {
     delete options_.block_cache;
   }
+  delete negative_cache_;
+  delete arena_pool_;  // After the memtables that draw from it
+}
+
+size_t DBImpl::BlockSizeForLevel(int level) const {
+  const std::vector<size_t>& per_level = options_.block_size_per_level;
+  if (per_level.empty()) {
+    return options_.block_size;
+  }
+  if (static_cast<size_t>(level) >= per_level.size()) {
+    return per_level.back();
+  }
+  return per_level[level];
+}
+
+CompressionType DBImpl::CompressionForLevel(int level) const {
+  const std::vector<CompressionType>& per_level =
+      options_.compression_per_level;
+  if (per_level.empty()) {
+    return options_.compression;
+  }
+  if (static_cast<size_t>(level) >= per_level.size()) {
+    return per_level.back();
+  }
+  return per_level[level];
 }
 
 Status DBImpl::NewDB() {
@@ -231,27 +540,68 @@ void DBImpl::RemoveObsoleteFiles() {
     return;
   }
 
+  // Scan the directory with the lock released -- GetChildren is I/O --
+  // and only then compute the live set and cutoffs, under the relocked
+  // mutex.  Classifying against post-scan state is what makes the
+  // unlocked window safe: a file created meanwhile is either still in
+  // pending_outputs_ or already installed in a version, so it lands in
+  // "live" either way, and at worst an obsolete file is kept for one
+  // extra round.
+  std::vector<std::string> filenames;
+  mutex_.Unlock();
+  env_->GetChildren(dbname_, &filenames);  // Ignoring errors on purpose
+  mutex_.Lock();
+  if (!bg_error_.ok()) {
+    // An error landed while we were scanning; same uncertainty as the
+    // check at the top.
+    return;
+  }
+
   // Make a set of all of the live files
   std::set<uint64_t> live = pending_outputs_;
-  versions_->AddLiveFiles(&live);
+  if (scan_cursors_.empty()) {
+    versions_->AddLiveFiles(&live);
+  } else {
+    // Long release-mode scans report their cursor; files wholly behind
+    // every cursor of a version held only by such scans are fair game.
+    std::vector<std::pair<Version*, std::string>> cursors;
+    for (std::map<const void*, ScanCursor>::const_iterator it =
+             scan_cursors_.begin();
+         it != scan_cursors_.end(); ++it) {
+      if (it->second.started) {
+        cursors.emplace_back(it->second.version, it->second.user_key);
+      } else {
+        // No progress yet: pin the whole version.
+        cursors.emplace_back(it->second.version, std::string());
+      }
+    }
+    versions_->AddLiveFilesExcept(&live, cursors);
+  }
+  const uint64_t min_log = versions_->LogNumber();
+  const uint64_t prev_log = versions_->PrevLogNumber();
+  const uint64_t manifest_number = versions_->ManifestFileNumber();
 
-  std::vector<std::string> filenames;
-  env_->GetChildren(dbname_, &filenames);  // Ignoring errors on purpose
   uint64_t number;
   FileType type;
-  std::vector<std::string> files_to_delete;
+  bool queued = false;
   for (std::string& filename : filenames) {
     if (ParseFileName(filename, &number, &type)) {
       bool keep = true;
       switch (type) {
         case kLogFile:
-          keep = ((number >= versions_->LogNumber()) ||
-                  (number == versions_->PrevLogNumber()));
+          keep = ((number >= min_log) || (number == prev_log));
+          if (!keep && options_.recycle_log_files > 0 &&
+              recycled_log_pool_.size() <
+                  static_cast<size_t>(options_.recycle_log_files)) {
+            // Park the file for reuse instead of unlinking it.
+            recycled_log_pool_.push_back(filename);
+            continue;
+          }
           break;
         case kDescriptorFile:
           // Keep my manifest file, and any newer incarnations'
           // (in case there is a race that allows other incarnations)
-          keep = (number >= versions_->ManifestFileNumber());
+          keep = (number >= manifest_number);
           break;
         case kTableFile:
           keep = (live.find(number) != live.end());
@@ -261,6 +611,11 @@ void DBImpl::RemoveObsoleteFiles() {
           // be recorded in pending_outputs_, which is inserted into "live"
           keep = (live.find(number) != live.end());
           break;
+        case kBlobFile:
+          // Blob files may be referenced by tables other than their
+          // companion; only GarbageCollectBlobs() removes them.
+          keep = true;
+          break;
         case kCurrentFile:
         case kDBLockFile:
         case kInfoLogFile:
@@ -269,24 +624,43 @@ void DBImpl::RemoveObsoleteFiles() {
       }
 
       if (!keep) {
-        files_to_delete.push_back(std::move(filename));
         if (type == kTableFile) {
           table_cache_->Evict(number);
         }
         Log(options_.info_log, "Delete type=%d #%lld\n", static_cast<int>(type),
             static_cast<unsigned long long>(number));
+        // Hand the unlink to the paced background deleter: after a big
+        // compaction, hundreds of inline unlinks used to stall the
+        // calling thread (and with it compaction scheduling).
+        obsolete_queue_.push_back(std::move(filename));
+        queued = true;
       }
     }
   }
+  if (queued && !obsolete_deleter_running_) {
+    obsolete_deleter_running_ = true;
+    env_->StartThread(&DBImpl::BGDeleteObsolete, this);
+  }
+}
 
-  // While deleting all files unblock other threads. All files being deleted
-  // have unique names which will not collide with newly created files and
-  // are therefore safe to delete while allowing other threads to proceed.
-  mutex_.Unlock();
-  for (const std::string& filename : files_to_delete) {
-    env_->RemoveFile(dbname_ + "/" + filename);
+void DBImpl::BGDeleteObsolete(void* db) {
+  reinterpret_cast<DBImpl*>(db)->DeleteObsoleteWork();
+}
+
+void DBImpl::DeleteObsoleteWork() {
+  MutexLock l(&mutex_);
+  while (!obsolete_queue_.empty()) {
+    const std::string fname = dbname_ + "/" + obsolete_queue_.front();
+    obsolete_queue_.pop_front();
+    mutex_.Unlock();
+    env_->RemoveFile(fname);
+    // Pace the unlinks; each can cost milliseconds of filesystem
+    // journal traffic for a large file.
+    env_->SleepForMicroseconds(500);
+    mutex_.Lock();
   }
-  mutex_.Lock();
+  obsolete_deleter_running_ = false;
+  background_work_finished_signal_.SignalAll();
 }
 
 Status DBImpl::Recover(VersionEdit* edit, bool* save_manifest) {
@@ -360,8 +734,36 @@ Status DBImpl::Recover(VersionEdit* edit, bool* save_manifest) {
     return Status::Corruption(buf, TableFileName(dbname_, *(expected.begin())));
   }
 
-  // Recover in the order in which the logs were generated
+  // A clean-shutdown marker proves every record in these logs is
+  // already in tables and the manifest; if it covers all present logs,
+  // skip the replay.  The marker is consumed (removed) either way so a
+  // crash can never be mistaken for a clean close.
   std::sort(logs.begin(), logs.end());
+  const std::string marker_name = dbname_ + "/CLEAN_SHUTDOWN";
+  if (env_->FileExists(marker_name)) {
+    std::string marker;
+    uint64_t marker_log = 0;
+    unsigned long long parsed_log = 0, parsed_sequence = 0;
+    if (ReadFileToString(env_, marker_name, &marker).ok() &&
+        std::sscanf(marker.c_str(), "%llu %llu", &parsed_log,
+                    &parsed_sequence) == 2) {
+      marker_log = parsed_log;
+    }
+    env_->RemoveFile(marker_name);
+    if (marker_log != 0 && (logs.empty() || logs.back() <= marker_log)) {
+      Log(options_.info_log,
+          "Clean shutdown marker: skipping replay of %d log(s)",
+          static_cast<int>(logs.size()));
+      for (size_t i = 0; i < logs.size(); i++) {
+        versions_->MarkFileNumberUsed(logs[i]);
+      }
+      if (versions_->LastSequence() < parsed_sequence) {
+        versions_->SetLastSequence(parsed_sequence);
+      }
+      return Status::OK();
+    }
+  }
+
   for (size_t i = 0; i < logs.size(); i++) {
     s = RecoverLogFile(logs[i], (i == logs.size() - 1), save_manifest, edit,
                        &max_sequence);
@@ -382,6 +784,64 @@ Status DBImpl::Recover(VersionEdit* edit, bool* save_manifest) {
   return Status::OK();
 }
 
+namespace {
+
+// Shared state for the pipelined log replay in RecoverLogFile(): a
+// reader thread decodes records ahead while the recovery thread
+// applies them to the memtable.
+struct LogReplayQueue {
+  port::Mutex mu;
+  port::CondVar cv;
+  std::deque<std::string> records;
+  size_t buffered_bytes;
+  bool done;
+  Status status;  // Reader-side status, merged by the consumer
+
+  log::Reader* reader;
+
+  LogReplayQueue() : cv(&mu), buffered_bytes(0), done(false) {}
+
+  static const size_t kMaxBufferedBytes = 8 * 1024 * 1024;
+
+  static void ReadAll(void* arg) {
+    LogReplayQueue* queue = reinterpret_cast<LogReplayQueue*>(arg);
+    std::string scratch;
+    Slice record;
+    while (queue->reader->ReadRecord(&record, &scratch)) {
+      queue->mu.Lock();
+      while (queue->buffered_bytes > kMaxBufferedBytes) {
+        queue->cv.Wait();
+      }
+      queue->records.push_back(record.ToString());
+      queue->buffered_bytes += record.size();
+      queue->cv.SignalAll();
+      queue->mu.Unlock();
+    }
+    queue->mu.Lock();
+    queue->done = true;
+    queue->cv.SignalAll();
+    queue->mu.Unlock();
+  }
+
+  // Pop the next record into *record; false at end of log.
+  bool Pop(std::string* record) {
+    MutexLock l(&mu);
+    while (records.empty() && !done) {
+      cv.Wait();
+    }
+    if (records.empty()) {
+      return false;
+    }
+    record->swap(records.front());
+    records.pop_front();
+    buffered_bytes -= record->size();
+    cv.SignalAll();
+    return true;
+  }
+};
+
+}  // namespace
+
 Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
                               bool* save_manifest, VersionEdit* edit,
                               SequenceNumber* max_sequence) {
@@ -414,34 +874,65 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
   reporter.env = env_;
   reporter.info_log = options_.info_log;
   reporter.fname = fname.c_str();
-  reporter.status = (options_.paranoid_checks ? &status : nullptr);
   // We intentionally make log::Reader do checksumming even if
   // paranoid_checks==false so that corruptions cause entire commits
   // to be skipped instead of propagating bad information (like overly
   // large sequence numbers).
-  log::Reader reader(file, &reporter, true /*checksum*/, 0 /*initial_offset*/);
+  log::Reader reader(file, &reporter, true /*checksum*/, 0 /*initial_offset*/,
+                     static_cast<uint32_t>(log_number));
+  prepared_txns_.SetLogHint(log_number);
   Log(options_.info_log, "Recovering log #%llu",
       (unsigned long long)log_number);
 
-  // Read all the records and add to a memtable
+  // Read all the records and add to a memtable.  Large logs decode on
+  // a separate thread so checksumming and parsing overlap the memtable
+  // inserts; small logs are replayed inline.
+  uint64_t log_size = 0;
+  env_->GetFileSize(fname, &log_size);
+  const bool pipelined = log_size > 4 * 1024 * 1024;
+  LogReplayQueue queue;
+  // In pipelined mode the reader's reporter runs on the spawned
+  // thread, so it must not share a Status with this thread: it writes
+  // into the queue-owned status, merged below once the reader has
+  // provably exited.  The consumer keeps its own reporter for records
+  // it rejects itself.
+  reporter.status = options_.paranoid_checks
+                        ? (pipelined ? &queue.status : &status)
+                        : nullptr;
+  LogReporter consumer_reporter = reporter;
+  consumer_reporter.status = options_.paranoid_checks ? &status : nullptr;
+  if (pipelined) {
+    queue.reader = &reader;
+    env_->StartThread(&LogReplayQueue::ReadAll, &queue);
+  }
+
   std::string scratch;
+  std::string pipelined_record;
   Slice record;
   WriteBatch batch;
   int compactions = 0;
   MemTable* mem = nullptr;
-  while (reader.ReadRecord(&record, &scratch) && status.ok()) {
+  while (status.ok()) {
+    if (pipelined) {
+      if (!queue.Pop(&pipelined_record)) {
+        break;
+      }
+      record = Slice(pipelined_record);
+    } else if (!reader.ReadRecord(&record, &scratch)) {
+      break;
+    }
     if (record.size() < 12) {
-      reporter.Corruption(record.size(),
-                          Status::Corruption("log record too small"));
+      consumer_reporter.Corruption(record.size(),
+                                   Status::Corruption("log record too small"));
       continue;
     }
     WriteBatchInternal::SetContents(&batch, record);
 
     if (mem == nullptr) {
-      mem = new MemTable(internal_comparator_);
+      mem = new MemTable(internal_comparator_, arena_pool_, options_.memtable_hash_index, options_.value_checksums, &negative_stamps_, options_.memtable_compression);
       mem->Ref();
     }
-    status = WriteBatchInternal::InsertInto(&batch, mem);
+    status = WriteBatchInternal::InsertInto(&batch, mem, &prepared_txns_);
     MaybeIgnoreError(&status);
     if (!status.ok()) {
       break;
@@ -452,10 +943,17 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
       *max_sequence = last_seq;
     }
 
-    if (mem->ApproximateMemoryUsage() > options_.write_buffer_size) {
+    if (mem->ApproximateMemoryUsage() > options_.write_buffer_size &&
+        !mem->HasRangeTombstones()) {
+      // (Memtables holding range tombstones are kept until the end of
+      // the log so their deletions can be materialized in one pass.)
       compactions++;
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, nullptr);
+      Iterator* iter = mem->NewIterator();
+      uint64_t pending_number = 0;
+      status = WriteLevel0Table(iter, edit, nullptr, &pending_number);
+      pending_outputs_.erase(pending_number);
+      delete iter;
       mem->Unref();
       mem = nullptr;
       if (!status.ok()) {
@@ -466,6 +964,20 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     }
   }
 
+  if (pipelined) {
+    // The reader thread touches the file and log reader until it hits
+    // the end of the log; drain whatever it still has queued so it is
+    // guaranteed to have exited before the file is deleted.
+    std::string discard;
+    while (queue.Pop(&discard)) {
+    }
+    // The reader has exited (Pop returned false only after it set
+    // "done" under the queue mutex), so its status is safe to read.
+    if (status.ok()) {
+      status = queue.status;
+    }
+  }
+
   delete file;
 
   // See if we should keep reusing the last log file.
@@ -478,13 +990,16 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
         env_->NewAppendableFile(fname, &logfile_).ok()) {
       Log(options_.info_log, "Reusing old log %s \n", fname.c_str());
       log_ = new log::Writer(logfile_, lfile_size);
+      if (options_.recycle_log_files > 0) {
+        log_->SetRecycleLogNumber(static_cast<uint32_t>(log_number));
+      }
       logfile_number_ = log_number;
       if (mem != nullptr) {
         mem_ = mem;
         mem = nullptr;
       } else {
         // mem can be nullptr if lognum exists but was empty.
-        mem_ = new MemTable(internal_comparator_);
+        mem_ = new MemTable(internal_comparator_, arena_pool_, options_.memtable_hash_index, options_.value_checksums, &negative_stamps_, options_.memtable_compression);
         mem_->Ref();
       }
     }
@@ -494,7 +1009,26 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     // mem did not get reused; compact it.
     if (status.ok()) {
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, nullptr);
+      Version* base = versions_->current();
+      base->Ref();
+      MemTable* materialized =
+          MaterializeRangeDeletions(std::vector<MemTable*>(1, mem), base);
+      Iterator* iter;
+      if (materialized != nullptr) {
+        Iterator* children[2] = {mem->NewIterator(),
+                                 materialized->NewIterator()};
+        iter = NewMergingIterator(&internal_comparator_, children, 2);
+      } else {
+        iter = mem->NewIterator();
+      }
+      uint64_t pending_number = 0;
+      status = WriteLevel0Table(iter, edit, nullptr, &pending_number);
+      pending_outputs_.erase(pending_number);
+      delete iter;
+      if (materialized != nullptr) {
+        materialized->Unref();
+      }
+      base->Unref();
     }
     mem->Unref();
   }
@@ -502,29 +1036,36 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
   return status;
 }
 
-Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
-                                Version* base) {
+Status DBImpl::WriteLevel0Table(Iterator* iter, VersionEdit* edit,
+                                Version* base, uint64_t* pending_number) {
   mutex_.AssertHeld();
+  ScopedSpan span("flush.build-table", env_);
   const uint64_t start_micros = env_->NowMicros();
   FileMetaData meta;
   meta.number = versions_->NewFileNumber();
   pending_outputs_.insert(meta.number);
-  Iterator* iter = mem->NewIterator();
+  *pending_number = meta.number;
   Log(options_.info_log, "Level-0 table #%llu: started",
       (unsigned long long)meta.number);
 
   Status s;
   {
     mutex_.Unlock();
-    s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    // Memtable output lands in the upper levels; use their settings.
+    Options build_options = options_;
+    build_options.compression = CompressionForLevel(0);
+    build_options.block_size = BlockSizeForLevel(0);
+    s = BuildTable(dbname_, env_, build_options, table_cache_, iter, &meta);
     mutex_.Lock();
   }
 
   Log(options_.info_log, "Level-0 table #%llu: %lld bytes %s",
       (unsigned long long)meta.number, (unsigned long long)meta.file_size,
       s.ToString().c_str());
-  delete iter;
-  pending_outputs_.erase(meta.number);
+  // NOTE: meta.number stays in pending_outputs_ until the caller has
+  // installed (or abandoned) the file; with concurrent background
+  // threads, erasing it here would let another thread's
+  // RemoveObsoleteFiles() delete the table before the install.
 
   // Note that if file_size is zero, the file has been deleted and
   // should not be added to the manifest.
@@ -546,40 +1087,148 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
   return s;
 }
 
-void DBImpl::CompactMemTable() {
+MemTable* DBImpl::MaterializeRangeDeletions(
+    const std::vector<MemTable*>& mems, Version* base) {
   mutex_.AssertHeld();
-  assert(imm_ != nullptr);
+  std::vector<MemTable::RangeTombstone> tombstones;
+  for (size_t i = 0; i < mems.size(); i++) {
+    mems[i]->GetRangeTombstones(kMaxSequenceNumber, &tombstones);
+  }
+  if (tombstones.empty()) {
+    return nullptr;
+  }
 
-  // Save the contents of the memtable as a new Table
-  VersionEdit edit;
+  // Scan the memtables plus *base for user keys covered by each
+  // tombstone and emit point deletions at the tombstone's sequence.
+  MemTable* materialized = new MemTable(internal_comparator_);
+  materialized->Ref();
+  std::vector<Iterator*> scan_list;
+  for (size_t i = 0; i < mems.size(); i++) {
+    scan_list.push_back(mems[i]->NewIterator());
+  }
+  base->AddIterators(ReadOptions(), &scan_list);
+  Iterator* scan = NewMergingIterator(&internal_comparator_, &scan_list[0],
+                                      static_cast<int>(scan_list.size()));
+  const Comparator* ucmp = user_comparator();
+  mutex_.Unlock();
+  for (size_t ti = 0; ti < tombstones.size(); ti++) {
+    const MemTable::RangeTombstone& t = tombstones[ti];
+    InternalKey start(t.begin, kMaxSequenceNumber, kValueTypeForSeek);
+    std::string last_user_key;
+    bool has_last = false;
+    for (scan->Seek(start.Encode()); scan->Valid(); scan->Next()) {
+      ParsedInternalKey ikey;
+      if (!ParseInternalKey(scan->key(), &ikey)) {
+        continue;
+      }
+      if (ucmp->Compare(ikey.user_key, t.end) >= 0) {
+        break;
+      }
+      if (has_last && ucmp->Compare(ikey.user_key, last_user_key) == 0) {
+        continue;
+      }
+      last_user_key.assign(ikey.user_key.data(), ikey.user_key.size());
+      has_last = true;
+      materialized->Add(t.seq, kTypeDeletion, ikey.user_key, Slice());
+    }
+  }
+  mutex_.Lock();
+  delete scan;
+  return materialized;
+}
+
+void DBImpl::CompactMemTable() {
+  mutex_.AssertHeld();
+  assert(!imms_.empty());
+  assert(!imm_compacting_);
+  ScopedSpan span("flush", env_);
+  imm_compacting_ = true;
+  const uint64_t flush_start_micros = env_->NowMicros();
+
+  // Save the contents of every queued memtable as one new Table.  More
+  // memtables may be queued while the lock is released below; those
+  // are left for the next flush.
+  const size_t count = imms_.size();
   Version* base = versions_->current();
   base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
+
+  // Materialize range deletions before building the table, so that
+  // table files and compactions never see range records.
+  std::vector<MemTable*> flushing;
+  for (size_t i = 0; i < count; i++) {
+    flushing.push_back(imms_[i].mem);
+  }
+  MemTable* materialized = MaterializeRangeDeletions(flushing, base);
+
+  std::vector<Iterator*> iters;
+  for (size_t i = 0; i < count; i++) {
+    iters.push_back(imms_[i].mem->NewIterator());
+  }
+  if (materialized != nullptr) {
+    iters.push_back(materialized->NewIterator());
+  }
+  Iterator* iter =
+      (iters.size() == 1)
+          ? iters[0]
+          : NewMergingIterator(&internal_comparator_, &iters[0],
+                               static_cast<int>(iters.size()));
+  VersionEdit edit;
+  uint64_t pending_number = 0;
+  Status s = WriteLevel0Table(iter, &edit, base, &pending_number);
   base->Unref();
+  delete iter;  // A merging iterator deletes its children.
+  if (materialized != nullptr) {
+    materialized->Unref();
+  }
 
   if (s.ok() && shutting_down_.load(std::memory_order_acquire)) {
     s = Status::IOError("Deleting DB during memtable compaction");
   }
 
-  // Replace immutable memtable with the generated Table
+  // Replace the flushed memtables with the generated Table
   if (s.ok()) {
     edit.SetPrevLogNumber(0);
-    edit.SetLogNumber(logfile_number_);  // Earlier logs no longer needed
-    s = versions_->LogAndApply(&edit, &mutex_);
+    // Logs older than the oldest unflushed memtable's backing log --
+    // or the oldest pending prepared transaction -- are still needed.
+    uint64_t log_cutoff = imms_.size() > count ? imms_[count].log_number
+                                               : logfile_number_;
+    const uint64_t oldest_prepare = prepared_txns_.OldestLogNumber();
+    if (oldest_prepare < log_cutoff) {
+      log_cutoff = oldest_prepare;
+    }
+    edit.SetLogNumber(log_cutoff);
+    s = InstallVersionEdit(&edit);
   }
+  pending_outputs_.erase(pending_number);
 
   if (s.ok()) {
     // Commit to the new state
-    imm_->Unref();
-    imm_ = nullptr;
-    has_imm_.store(false, std::memory_order_release);
+    for (size_t i = 0; i < count; i++) {
+      imms_.front().mem->Unref();
+      imms_.pop_front();
+    }
+    has_imm_.store(!imms_.empty(), std::memory_order_release);
+    RefreshReadState();
     RemoveObsoleteFiles();
   } else {
     RecordBackgroundError(s);
   }
+  imm_compacting_ = false;
+
+  if (!options_.listeners.empty()) {
+    FlushInfo info;
+    info.status = s;
+    info.micros = env_->NowMicros() - flush_start_micros;
+    NotifyListeners(options_, &mutex_, [&info](EventListener* listener) {
+      listener->OnFlushCompleted(info);
+    });
+  }
 }
 
 void DBImpl::CompactRange(const Slice* begin, const Slice* end) {
+  if (read_only_) {
+    return;
+  }
   int max_level_with_files = 1;
   {
     MutexLock l(&mutex_);
@@ -631,9 +1280,16 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,
   }
   // Finish current background compaction in the case where
   // `background_work_finished_signal_` was signalled due to an error.
-  while (background_compaction_scheduled_) {
+  while (background_compactions_scheduled_ > 0 || preparing_logfile_ ||
+         wal_syncer_running_ || obsolete_deleter_running_ ||
+         output_verifications_running_ > 0) {
     background_work_finished_signal_.Wait();
   }
+  if (prepared_logfile_ != nullptr) {
+    delete prepared_logfile_;
+    env_->RemoveFile(LogFileName(dbname_, prepared_logfile_number_));
+    prepared_logfile_ = nullptr;
+  }
   if (manual_compaction_ == &manual) {
     // Cancel my manual compaction since we aborted early for some reason.
     manual_compaction_ = nullptr;
@@ -646,10 +1302,10 @@ Status DBImpl::TEST_CompactMemTable() {
   if (s.ok()) {
     // Wait until the compaction completes
     MutexLock l(&mutex_);
-    while (imm_ != nullptr && bg_error_.ok()) {
+    while (!imms_.empty() && bg_error_.ok()) {
       background_work_finished_signal_.Wait();
     }
-    if (imm_ != nullptr) {
+    if (!imms_.empty()) {
       s = bg_error_;
     }
   }
@@ -664,20 +1320,60 @@ void DBImpl::RecordBackgroundError(const Status& s) {
   }
 }
 
+Status DBImpl::InstallVersionEdit(VersionEdit* edit) {
+  ScopedSpan span("manifest.log-and-apply", env_);
+  mutex_.AssertHeld();
+  while (manifest_write_in_progress_) {
+    background_work_finished_signal_.Wait();
+  }
+  manifest_write_in_progress_ = true;
+  Status s = versions_->LogAndApply(edit, &mutex_);
+  manifest_write_in_progress_ = false;
+  background_work_finished_signal_.SignalAll();
+  if (s.ok()) {
+    RefreshReadState();
+  }
+  return s;
+}
+
+bool DBImpl::HasSchedulableWork() {
+  mutex_.AssertHeld();
+  if (!imms_.empty() && !imm_compacting_) {
+    return true;
+  }
+  if (manual_compaction_ != nullptr) {
+    // Manual compactions are ordinary work: they only need their own
+    // level pair to be free.
+    return levels_in_compaction_.count(manual_compaction_->level) == 0 &&
+           levels_in_compaction_.count(manual_compaction_->level + 1) == 0;
+  }
+  const int level = versions_->PickCompactionLevel();
+  return level >= 0 && levels_in_compaction_.count(level) == 0 &&
+         levels_in_compaction_.count(level + 1) == 0;
+}
+
 void DBImpl::MaybeScheduleCompaction() {
   mutex_.AssertHeld();
-  if (background_compaction_scheduled_) {
-    // Already scheduled
+  if (read_only_) {
+    // Secondaries never compact
   } else if (shutting_down_.load(std::memory_order_acquire)) {
     // DB is being deleted; no more background compactions
   } else if (!bg_error_.ok()) {
     // Already got an error; no more changes
-  } else if (imm_ == nullptr && manual_compaction_ == nullptr &&
-             !versions_->NeedsCompaction()) {
-    // No work to be done
-  } else {
-    background_compaction_scheduled_ = true;
-    env_->Schedule(&DBImpl::BGWork, this);
+  } else if (background_compactions_scheduled_ <
+                 options_.max_background_compactions &&
+             HasSchedulableWork()) {
+    background_compactions_scheduled_++;
+    const Env::SchedulePriority priority =
+        (!imms_.empty() && !imm_compacting_) ? Env::kScheduleHigh
+                                             : Env::kScheduleDefault;
+    if (background_compactions_scheduled_ == 1) {
+      env_->Schedule(&DBImpl::BGWork, this, priority);
+    } else {
+      // The Schedule() pool may be a single thread; additional
+      // concurrent compactions get threads of their own.
+      env_->StartThread(&DBImpl::BGWork, this);
+    }
   }
 }
 
@@ -687,7 +1383,7 @@ void DBImpl::BGWork(void* db) {
 
 void DBImpl::BackgroundCall() {
   MutexLock l(&mutex_);
-  assert(background_compaction_scheduled_);
+  assert(background_compactions_scheduled_ > 0);
   if (shutting_down_.load(std::memory_order_acquire)) {
     // No more background work when shutting down.
   } else if (!bg_error_.ok()) {
@@ -696,7 +1392,7 @@ void DBImpl::BackgroundCall() {
     BackgroundCompaction();
   }
 
-  background_compaction_scheduled_ = false;
+  background_compactions_scheduled_--;
 
   // Previous compaction may have produced too many files in a level,
   // so reschedule another compaction if needed.
@@ -704,10 +1400,138 @@ void DBImpl::BackgroundCall() {
   background_work_finished_signal_.SignalAll();
 }
 
+void DBImpl::MaybeExpireFiles() {
+  mutex_.AssertHeld();
+  const uint64_t now_micros = env_->NowMicros();
+  uint64_t interval_micros = options_.ttl_seconds * 1000000 / 10;
+  if (interval_micros < 60 * 1000000ull) {
+    interval_micros = 60 * 1000000ull;
+  }
+  if (now_micros - last_ttl_check_micros_ < interval_micros) {
+    return;
+  }
+  last_ttl_check_micros_ = now_micros;
+
+  Version* base = versions_->current();
+  base->Ref();
+  VersionEdit edit;
+  int expired = 0;
+  const uint64_t now_seconds = now_micros / 1000000;
+  // Bottom-up so removing a file cannot expose older overlapping data.
+  for (int level = config::kNumLevels - 1; level >= 0; level--) {
+    std::vector<FileMetaData*> files;
+    base->GetOverlappingInputs(level, nullptr, nullptr, &files);
+    for (size_t i = 0; i < files.size(); i++) {
+      FileMetaData* f = files[i];
+      uint64_t mtime = 0;
+      if (!env_->GetFileModificationTime(TableFileName(dbname_, f->number),
+                                         &mtime)
+               .ok() ||
+          now_seconds < mtime + options_.ttl_seconds) {
+        continue;
+      }
+      // Only remove if no deeper level overlaps this file's range.
+      bool deeper_overlap = false;
+      const Slice smallest = f->smallest.user_key();
+      const Slice largest = f->largest.user_key();
+      for (int deeper = level + 1;
+           !deeper_overlap && deeper < config::kNumLevels; deeper++) {
+        deeper_overlap = base->OverlapInLevel(deeper, &smallest, &largest);
+      }
+      if (!deeper_overlap) {
+        edit.RemoveFile(level, f->number);
+        expired++;
+      }
+    }
+  }
+  base->Unref();
+
+  if (expired > 0) {
+    Log(options_.info_log, "TTL sweep expiring %d table files", expired);
+    Status s = InstallVersionEdit(&edit);
+    if (s.ok()) {
+      RemoveObsoleteFiles();
+    } else {
+      RecordBackgroundError(s);
+    }
+  }
+}
+
+void DBImpl::MaybeScheduleTombstoneCompaction() {
+  mutex_.AssertHeld();
+  const uint64_t now_micros = env_->NowMicros();
+  if (now_micros - last_tombstone_check_micros_ < 60 * 1000000ull) {
+    return;
+  }
+  last_tombstone_check_micros_ = now_micros;
+
+  // Collect candidates under the mutex, read their properties with it
+  // released (table opens touch disk), then mark the worst offender.
+  Version* base = versions_->current();
+  base->Ref();
+  struct Candidate {
+    int level;
+    FileMetaData* file;
+  };
+  std::vector<Candidate> candidates;
+  for (int level = 0; level < config::kNumLevels - 1; level++) {
+    std::vector<FileMetaData*> files;
+    base->GetOverlappingInputs(level, nullptr, nullptr, &files);
+    for (size_t i = 0; i < files.size(); i++) {
+      Candidate c;
+      c.level = level;
+      c.file = files[i];
+      candidates.push_back(c);
+    }
+  }
+
+  mutex_.Unlock();
+  FileMetaData* worst = nullptr;
+  int worst_level = 0;
+  double worst_ratio = options_.tombstone_compaction_ratio;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    TableProperties properties;
+    if (!table_cache_
+             ->GetTableProperties(candidates[i].file->number,
+                                  candidates[i].file->file_size, &properties)
+             .ok() ||
+        properties.num_entries == 0) {
+      continue;
+    }
+    const double ratio = static_cast<double>(properties.num_deletions) /
+                         properties.num_entries;
+    if (ratio >= worst_ratio) {
+      worst_ratio = ratio;
+      worst = candidates[i].file;
+      worst_level = candidates[i].level;
+    }
+  }
+  mutex_.Lock();
+
+  // The files are pinned by our version reference; only mark if the
+  // version is still current so the level is still right.
+  if (worst != nullptr && base == versions_->current()) {
+    Log(options_.info_log,
+        "Marking table #%llu (level %d, %.0f%% tombstones) for compaction",
+        static_cast<unsigned long long>(worst->number), worst_level,
+        worst_ratio * 100);
+    base->MarkFileForCompaction(worst_level, worst);
+    MaybeScheduleCompaction();
+  }
+  base->Unref();
+}
+
 void DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
 
-  if (imm_ != nullptr) {
+  if (options_.ttl_seconds > 0 && !read_only_) {
+    MaybeExpireFiles();
+  }
+  if (options_.tombstone_compaction_ratio > 0 && !read_only_) {
+    MaybeScheduleTombstoneCompaction();
+  }
+
+  if (!imms_.empty() && !imm_compacting_) {
     CompactMemTable();
     return;
   }
@@ -715,7 +1539,14 @@ void DBImpl::BackgroundCompaction() {
   Compaction* c;
   bool is_manual = (manual_compaction_ != nullptr);
   InternalKey manual_end;
-  if (is_manual) {
+  if (is_manual &&
+      (levels_in_compaction_.count(manual_compaction_->level) != 0 ||
+       levels_in_compaction_.count(manual_compaction_->level + 1) != 0)) {
+    // The manual compaction's levels are busy; it is rescheduled when
+    // the running compaction finishes.  Automatic work on other levels
+    // proceeds concurrently in the meantime.
+    return;
+  } else if (is_manual) {
     ManualCompaction* m = manual_compaction_;
     c = versions_->CompactRange(m->level, m->begin, m->end);
     m->done = (c == nullptr);
@@ -729,6 +1560,17 @@ void DBImpl::BackgroundCompaction() {
         (m->done ? "(end)" : manual_end.DebugString().c_str()));
   } else {
     c = versions_->PickCompaction();
+    if (c != nullptr && (levels_in_compaction_.count(c->level()) != 0 ||
+                         levels_in_compaction_.count(c->level() + 1) != 0)) {
+      // Another background thread is already compacting these levels.
+      delete c;
+      c = nullptr;
+    }
+  }
+
+  if (c != nullptr) {
+    levels_in_compaction_.insert(c->level());
+    levels_in_compaction_.insert(c->level() + 1);
   }
 
   Status status;
@@ -741,7 +1583,7 @@ void DBImpl::BackgroundCompaction() {
     c->edit()->RemoveFile(c->level(), f->number);
     c->edit()->AddFile(c->level() + 1, f->number, f->file_size, f->smallest,
                        f->largest);
-    status = versions_->LogAndApply(c->edit(), &mutex_);
+    status = InstallVersionEdit(c->edit());
     if (!status.ok()) {
       RecordBackgroundError(status);
     }
@@ -756,9 +1598,29 @@ void DBImpl::BackgroundCompaction() {
     if (!status.ok()) {
       RecordBackgroundError(status);
     }
+    // Collect the input names before releasing the inputs; the
+    // FileMetaData objects die with the input version.
+    std::vector<std::string> input_files;
+    for (int which = 0; which < 2; which++) {
+      for (int i = 0; i < c->num_input_files(which); i++) {
+        input_files.push_back(
+            TableFileName(dbname_, c->input(which, i)->number));
+      }
+    }
     CleanupCompaction(compact);
     c->ReleaseInputs();
     RemoveObsoleteFiles();
+
+    // The inputs were streamed through once; drop their pages so they
+    // stop displacing genuinely hot data (best effort -- the files may
+    // already be unlinked).
+    for (size_t i = 0; i < input_files.size(); i++) {
+      env_->InvalidateCache(input_files[i]);
+    }
+  }
+  if (c != nullptr) {
+    levels_in_compaction_.erase(c->level());
+    levels_in_compaction_.erase(c->level() + 1);
   }
   delete c;
 
@@ -820,15 +1682,32 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
 
   // Make the output file
   std::string fname = TableFileName(dbname_, file_number);
-  Status s = env_->NewWritableFile(fname, &compact->outfile);
+  Status s = options_.use_direct_io_for_compaction
+                 ? env_->NewUnbufferedWritableFile(fname, &compact->outfile)
+                 : env_->NewWritableFile(fname, &compact->outfile);
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    compact->outfile->HintStreamingWrites(4 << 20);
+    compact->outfile->Preallocate(
+        compact->compaction->MaxOutputFileSize() != ~static_cast<uint64_t>(0)
+            ? compact->compaction->MaxOutputFileSize()
+            : options_.max_file_size);
+    if (options_.rate_limiter != nullptr) {
+      compact->outfile = NewRateLimitedWritableFile(
+          compact->outfile, options_.rate_limiter, RateLimiter::kCompaction);
+    }
+    Options output_options = options_;
+    output_options.compression =
+        CompressionForLevel(compact->compaction->output_level());
+    output_options.block_size =
+        BlockSizeForLevel(compact->compaction->output_level());
+    compact->builder = new TableBuilder(output_options, compact->outfile);
   }
   return s;
 }
 
 Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
                                           Iterator* input) {
+  ScopedSpan span("compaction.finish-output", env_);
   assert(compact != nullptr);
   assert(compact->outfile != nullptr);
   assert(compact->builder != nullptr);
@@ -861,11 +1740,19 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   compact->outfile = nullptr;
 
   if (s.ok() && current_entries > 0) {
-    // Verify that the table is usable
-    Iterator* iter =
-        table_cache_->NewIterator(ReadOptions(), output_number, current_bytes);
-    s = iter->status();
-    delete iter;
+    // Drop the freshly written pages before verification so the
+    // check reads what actually hit storage and compaction output does
+    // not evict serving-path cache.
+    env_->InvalidateCache(TableFileName(dbname_, output_number));
+    if (!options_.verify_compaction_output) {
+      // Verify that the table is usable.  With
+      // verify_compaction_output the background sampler below makes a
+      // stronger check off the critical path.
+      Iterator* iter = table_cache_->NewIterator(ReadOptions(), output_number,
+                                                 current_bytes);
+      s = iter->status();
+      delete iter;
+    }
     if (s.ok()) {
       Log(options_.info_log, "Generated table #%llu@%d: %lld keys, %lld bytes",
           (unsigned long long)output_number, compact->compaction->level(),
@@ -876,6 +1763,89 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   return s;
 }
 
+// One background content check of a compaction's outputs
+// (Options::verify_compaction_output).  The compaction's inputs are
+// pinned in pending_outputs_ until the check passes, so a bad output
+// is caught while its sources still exist.
+struct OutputVerifyJob {
+  DBImpl* db;
+  struct Output {
+    uint64_t number;
+    uint64_t file_size;
+    InternalKey smallest, largest;
+  };
+  std::vector<Output> outputs;
+  std::vector<uint64_t> pinned_inputs;
+};
+
+void DBImpl::VerifyOutputWork(void* arg) {
+  OutputVerifyJob* job = reinterpret_cast<OutputVerifyJob*>(arg);
+  DBImpl* db = job->db;
+  Status s;
+  ReadOptions read_options;
+  read_options.verify_checksums = true;
+  read_options.fill_cache = false;
+  for (size_t i = 0; s.ok() && i < job->outputs.size(); i++) {
+    const OutputVerifyJob::Output& out = job->outputs[i];
+    Table* tableptr = nullptr;
+    Iterator* iter = db->table_cache_->NewIterator(
+        read_options, out.number, out.file_size, &tableptr);
+    s = iter->status();
+    if (s.ok() && tableptr != nullptr) {
+      // Sample ~16 blocks spread over the file: seek to each sampled
+      // index entry's last key, which reads and checksums that block,
+      // and check the keys stay ordered and inside the output's
+      // bounds.
+      Iterator* index = tableptr->IndexBlockIterator(read_options);
+      uint64_t blocks = 0;
+      for (index->SeekToFirst(); index->Valid(); index->Next()) blocks++;
+      const uint64_t stride = blocks <= 16 ? 1 : blocks / 16;
+      std::string prev_key;
+      uint64_t block_index = 0;
+      for (index->SeekToFirst(); s.ok() && index->Valid(); index->Next()) {
+        if (block_index++ % stride != 0) {
+          continue;
+        }
+        const std::string target = index->key().ToString();
+        iter->Seek(Slice(target));
+        if (!iter->status().ok()) {
+          s = iter->status();
+        } else if (iter->Valid()) {
+          const Slice found = iter->key();
+          if (!prev_key.empty() &&
+              db->internal_comparator_.Compare(found, Slice(prev_key)) < 0) {
+            s = Status::Corruption("compaction output keys out of order");
+          } else if (db->internal_comparator_.Compare(
+                         found, out.smallest.Encode()) < 0 ||
+                     db->internal_comparator_.Compare(
+                         found, out.largest.Encode()) > 0) {
+            s = Status::Corruption("compaction output key outside bounds");
+          }
+          prev_key.assign(found.data(), found.size());
+        }
+      }
+      if (s.ok()) {
+        s = index->status();
+      }
+      delete index;
+    }
+    delete iter;
+  }
+
+  MutexLock l(&db->mutex_);
+  if (!s.ok()) {
+    Log(db->options_.info_log, "Compaction output verification failed: %s",
+        s.ToString().c_str());
+    db->RecordBackgroundError(s);
+  }
+  for (size_t i = 0; i < job->pinned_inputs.size(); i++) {
+    db->pending_outputs_.erase(job->pinned_inputs[i]);
+  }
+  db->output_verifications_running_--;
+  db->background_work_finished_signal_.SignalAll();
+  delete job;
+}
+
 Status DBImpl::InstallCompactionResults(CompactionState* compact) {
   mutex_.AssertHeld();
   Log(options_.info_log, "Compacted %d@%d + %d@%d files => %lld bytes",
@@ -885,60 +1855,51 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
 
   // Add compaction outputs
   compact->compaction->AddInputDeletions(compact->compaction->edit());
-  const int level = compact->compaction->level();
+  const int level = compact->compaction->output_level();
   for (size_t i = 0; i < compact->outputs.size(); i++) {
     const CompactionState::Output& out = compact->outputs[i];
-    compact->compaction->edit()->AddFile(level + 1, out.number, out.file_size,
+    compact->compaction->edit()->AddFile(level, out.number, out.file_size,
                                          out.smallest, out.largest);
   }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  return InstallVersionEdit(compact->compaction->edit());
 }
 
-Status DBImpl::DoCompactionWork(CompactionState* compact) {
-  const uint64_t start_micros = env_->NowMicros();
-  int64_t imm_micros = 0;  // Micros spent doing imm_ compactions
-
-  Log(options_.info_log, "Compacting %d@%d + %d@%d files",
-      compact->compaction->num_input_files(0), compact->compaction->level(),
-      compact->compaction->num_input_files(1),
-      compact->compaction->level() + 1);
-
-  assert(versions_->NumLevelFiles(compact->compaction->level()) > 0);
-  assert(compact->builder == nullptr);
-  assert(compact->outfile == nullptr);
-  if (snapshots_.empty()) {
-    compact->smallest_snapshot = versions_->LastSequence();
+Status DBImpl::RunSubcompaction(CompactionState* compact, Iterator* input,
+                                bool allow_imm_flush) {
+  if (compact->has_begin) {
+    InternalKey start(compact->begin, kMaxSequenceNumber, kValueTypeForSeek);
+    input->Seek(start.Encode());
   } else {
-    compact->smallest_snapshot = snapshots_.oldest()->sequence_number();
+    input->SeekToFirst();
   }
-
-  Iterator* input = versions_->MakeInputIterator(compact->compaction);
-
-  // Release mutex while we're actually doing the compaction work
-  mutex_.Unlock();
-
-  input->SeekToFirst();
   Status status;
   ParsedInternalKey ikey;
   std::string current_user_key;
+  std::string zeroed_key;  // Scratch for sequence-zeroed output keys
   bool has_current_user_key = false;
-  SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
+  // Sequence of the newest value/deletion entry seen for the current
+  // user key.  Merge entries do not shadow older entries (they depend
+  // on them), so they do not update this.
+  SequenceNumber last_shadow_seq_for_key = kMaxSequenceNumber;
   while (input->Valid() && !shutting_down_.load(std::memory_order_acquire)) {
     // Prioritize immutable compaction work
-    if (has_imm_.load(std::memory_order_relaxed)) {
-      const uint64_t imm_start = env_->NowMicros();
+    if (allow_imm_flush && has_imm_.load(std::memory_order_relaxed)) {
       mutex_.Lock();
-      if (imm_ != nullptr) {
+      if (!imms_.empty() && !imm_compacting_) {
         CompactMemTable();
         // Wake up MakeRoomForWrite() if necessary.
         background_work_finished_signal_.SignalAll();
       }
       mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
     }
 
     Slice key = input->key();
-    if (compact->compaction->ShouldStopBefore(key) &&
+    if (compact->has_end &&
+        user_comparator()->Compare(ExtractUserKey(key), compact->end) >= 0) {
+      // The rest of the inputs belong to the next shard.
+      break;
+    }
+    if (compact->exclusive && compact->compaction->ShouldStopBefore(key) &&
         compact->builder != nullptr) {
       status = FinishCompactionOutputFile(compact, input);
       if (!status.ok()) {
@@ -952,7 +1913,7 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
       // Do not hide error keys
       current_user_key.clear();
       has_current_user_key = false;
-      last_sequence_for_key = kMaxSequenceNumber;
+      last_shadow_seq_for_key = kMaxSequenceNumber;
     } else {
       if (!has_current_user_key ||
           user_comparator()->Compare(ikey.user_key, Slice(current_user_key)) !=
@@ -960,14 +1921,19 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         // First occurrence of this user key
         current_user_key.assign(ikey.user_key.data(), ikey.user_key.size());
         has_current_user_key = true;
-        last_sequence_for_key = kMaxSequenceNumber;
+        last_shadow_seq_for_key = kMaxSequenceNumber;
       }
 
-      if (last_sequence_for_key <= compact->smallest_snapshot) {
-        // Hidden by an newer entry for same user key
+      if (last_shadow_seq_for_key <= compact->smallest_snapshot ||
+          (last_shadow_seq_for_key != kMaxSequenceNumber &&
+           compact->SameSnapshotStratum(ikey.sequence,
+                                        last_shadow_seq_for_key))) {
+        // Hidden by a newer entry for the same user key, and no live
+        // snapshot falls between the two versions.
         drop = true;  // (A)
       } else if (ikey.type == kTypeDeletion &&
                  ikey.sequence <= compact->smallest_snapshot &&
+                 compact->exclusive &&
                  compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
         // For this user key:
         // (1) there is no data in higher levels
@@ -979,7 +1945,9 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         drop = true;
       }
 
-      last_sequence_for_key = ikey.sequence;
+      if (ikey.type != kTypeMerge) {
+        last_shadow_seq_for_key = ikey.sequence;
+      }
     }
 #if 0
     Log(options_.info_log,
@@ -988,10 +1956,25 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         ikey.user_key.ToString().c_str(),
         (int)ikey.sequence, ikey.type, kTypeValue, drop,
         compact->compaction->IsBaseLevelForKey(ikey.user_key),
-        (int)last_sequence_for_key, (int)compact->smallest_snapshot);
+        (int)last_shadow_seq_for_key, (int)compact->smallest_snapshot);
 #endif
 
     if (!drop) {
+      // When this is the only surviving version of the key and nothing
+      // deeper can hold older data, the sequence number no longer
+      // carries information; zeroing it makes bottom-level keys
+      // prefix-compress and compare better.  (All later entries for
+      // this user key are guaranteed to be dropped by rule (A).)
+      if (compact->exclusive && ikey.sequence != 0 &&
+          ikey.sequence <= compact->smallest_snapshot &&
+          (ikey.type == kTypeValue || ikey.type == kTypeBlobHandle) &&
+          compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
+        zeroed_key.clear();
+        AppendInternalKey(&zeroed_key,
+                          ParsedInternalKey(ikey.user_key, 0, ikey.type));
+        key = Slice(zeroed_key);
+      }
+
       // Open output file if necessary
       if (compact->builder == nullptr) {
         status = OpenCompactionOutputFile(compact);
@@ -1027,11 +2010,186 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   if (status.ok()) {
     status = input->status();
   }
-  delete input;
-  input = nullptr;
+  return status;
+}
+
+void DBImpl::SubcompactionWork(void* arg) {
+  SubcompactionState* sub = reinterpret_cast<SubcompactionState*>(arg);
+  sub->status = sub->db->RunSubcompaction(sub->compact, sub->input,
+                                          false /*allow_imm_flush*/);
+  sub->mu->Lock();
+  --*sub->pending;
+  sub->cv->SignalAll();
+  sub->mu->Unlock();
+}
+
+struct DBImpl::VerifyJob {
+  DBImpl* db;
+  uint64_t number;
+  uint64_t file_size;
+};
+
+void DBImpl::VerifyInputWork(void* arg) {
+  VerifyJob* job = reinterpret_cast<VerifyJob*>(arg);
+  DBImpl* db = job->db;
+  ReadOptions options;
+  options.verify_checksums = true;
+  options.fill_cache = false;
+  Iterator* iter =
+      db->table_cache_->NewIterator(options, job->number, job->file_size);
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+  }
+  Status s = iter->status();
+  delete iter;
+  if (!s.ok() && !s.IsNotFound()) {
+    // NotFound just means the input was already deleted post-install.
+    MutexLock l(&db->mutex_);
+    db->RecordBackgroundError(s);
+  }
+  delete job;
+}
+
+Status DBImpl::DoCompactionWork(CompactionState* compact) {
+  ScopedSpan span("compaction", env_);
+  const uint64_t start_micros = env_->NowMicros();
+
+  Log(options_.info_log, "Compacting %d@%d + %d@%d files",
+      compact->compaction->num_input_files(0), compact->compaction->level(),
+      compact->compaction->num_input_files(1),
+      compact->compaction->level() + 1);
+
+  assert(versions_->NumLevelFiles(compact->compaction->level()) > 0);
+  assert(compact->builder == nullptr);
+  assert(compact->outfile == nullptr);
+  compact->smallest_snapshot = SmallestSnapshot();
+  // Collect every live snapshot so overwrites BETWEEN long-lived
+  // snapshots can be collapsed too, not only those below the oldest.
+  for (int i = 0; i < kSnapshotSlots; i++) {
+    const uint64_t v = snapshot_slots_[i].load(std::memory_order_acquire);
+    if (v != 0) {
+      compact->snapshots.push_back(v - 1);
+    }
+  }
+  snapshots_.AppendSequences(&compact->snapshots);
+  std::sort(compact->snapshots.begin(), compact->snapshots.end());
+
+  Compaction* const c = compact->compaction;
+
+  // With async input verification the merge reads skip inline
+  // checksumming; a low-priority worker verifies each input file in
+  // parallel and reports corruption as a background error.
+  const bool async_verify = options_.paranoid_checks &&
+                            options_.async_verify_compaction_inputs;
+  if (async_verify) {
+    for (int which = 0; which < 2; which++) {
+      for (int i = 0; i < c->num_input_files(which); i++) {
+        VerifyJob* job = new VerifyJob;
+        job->db = this;
+        job->number = c->input(which, i)->number;
+        job->file_size = c->input(which, i)->file_size;
+        env_->Schedule(&DBImpl::VerifyInputWork, job, Env::kScheduleLow);
+      }
+    }
+  }
+
+  // Split a wide compaction at the boundary keys of its level+1 inputs
+  // so the pieces can be compacted in parallel.  Those files do not
+  // overlap, so every version of a user key lands in exactly one shard.
+  std::vector<std::string> boundaries;
+  if (options_.max_subcompactions > 1 && c->num_input_files(1) >= 2) {
+    const int shards = std::min(options_.max_subcompactions,
+                                c->num_input_files(1));
+    for (int i = 1; i < shards; i++) {
+      const int file_index = (i * c->num_input_files(1)) / shards - 1;
+      Slice key = c->input(1, file_index)->largest.user_key();
+      if (boundaries.empty() ||
+          user_comparator()->Compare(key, boundaries.back()) > 0) {
+        boundaries.push_back(key.ToString());
+      }
+    }
+  }
+
+  Status status;
+  if (boundaries.empty()) {
+    Iterator* input = versions_->MakeInputIterator(c);
+
+    // Release mutex while we're actually doing the compaction work
+    mutex_.Unlock();
+    status = RunSubcompaction(compact, input, true /*allow_imm_flush*/);
+    delete input;
+  } else {
+    const int shards = static_cast<int>(boundaries.size()) + 1;
+    std::vector<CompactionState*> states;
+    std::vector<Iterator*> inputs;
+    for (int i = 0; i < shards; i++) {
+      CompactionState* sub = new CompactionState(c);
+      sub->smallest_snapshot = compact->smallest_snapshot;
+      sub->exclusive = false;
+      if (i > 0) {
+        sub->has_begin = true;
+        sub->begin = boundaries[i - 1];
+      }
+      if (i < shards - 1) {
+        sub->has_end = true;
+        sub->end = boundaries[i];
+      }
+      states.push_back(sub);
+      inputs.push_back(versions_->MakeInputIterator(c));
+    }
+
+    mutex_.Unlock();
+    Log(options_.info_log, "Splitting compaction into %d subcompactions",
+        shards);
+
+    port::Mutex wait_mu;
+    port::CondVar wait_cv(&wait_mu);
+    int pending = shards - 1;
+    std::vector<SubcompactionState> subs(shards - 1);
+    for (int i = 1; i < shards; i++) {
+      SubcompactionState* sub = &subs[i - 1];
+      sub->db = this;
+      sub->compact = states[i];
+      sub->input = inputs[i];
+      sub->mu = &wait_mu;
+      sub->cv = &wait_cv;
+      sub->pending = &pending;
+      // Not Env::Schedule(): that queue is the thread we are running
+      // on, and waiting here for work queued behind us would deadlock.
+      env_->StartThread(&DBImpl::SubcompactionWork, sub);
+    }
+    status = RunSubcompaction(states[0], inputs[0], true /*allow_imm_flush*/);
+
+    wait_mu.Lock();
+    while (pending > 0) {
+      wait_cv.Wait();
+    }
+    wait_mu.Unlock();
+
+    // Stitch the shard results into *compact, in key order.
+    for (int i = 0; i < shards; i++) {
+      CompactionState* sub = states[i];
+      if (status.ok() && i > 0) {
+        status = subs[i - 1].status;
+      }
+      if (sub->builder != nullptr) {
+        // Shutdown or error part-way through a shard.
+        sub->builder->Abandon();
+        delete sub->builder;
+        sub->builder = nullptr;
+      }
+      delete sub->outfile;
+      sub->outfile = nullptr;
+      for (size_t j = 0; j < sub->outputs.size(); j++) {
+        compact->outputs.push_back(sub->outputs[j]);
+      }
+      compact->total_bytes += sub->total_bytes;
+      delete sub;
+      delete inputs[i];
+    }
+  }
 
   CompactionStats stats;
-  stats.micros = env_->NowMicros() - start_micros - imm_micros;
+  stats.micros = env_->NowMicros() - start_micros;
   for (int which = 0; which < 2; which++) {
     for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
       stats.bytes_read += compact->compaction->input(which, i)->file_size;
@@ -1042,11 +2200,50 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   }
 
   mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
+  stats_[compact->compaction->output_level()].Add(stats);
 
   if (status.ok()) {
     status = InstallCompactionResults(compact);
   }
+  if (status.ok() && options_.verify_compaction_output &&
+      !compact->outputs.empty()) {
+    // Pin the inputs until the background content check clears the
+    // outputs, then sample-verify off the compaction path.
+    OutputVerifyJob* job = new OutputVerifyJob;
+    job->db = this;
+    for (size_t i = 0; i < compact->outputs.size(); i++) {
+      OutputVerifyJob::Output out;
+      out.number = compact->outputs[i].number;
+      out.file_size = compact->outputs[i].file_size;
+      out.smallest = compact->outputs[i].smallest;
+      out.largest = compact->outputs[i].largest;
+      job->outputs.push_back(out);
+    }
+    Compaction* const c = compact->compaction;
+    for (int which = 0; which < 2; which++) {
+      for (int i = 0; i < c->num_input_files(which); i++) {
+        job->pinned_inputs.push_back(c->input(which, i)->number);
+        pending_outputs_.insert(c->input(which, i)->number);
+      }
+    }
+    output_verifications_running_++;
+    env_->Schedule(&DBImpl::VerifyOutputWork, job, Env::kScheduleLow);
+  }
+  if (!options_.listeners.empty()) {
+    CompactionInfo info;
+    info.level = compact->compaction->level();
+    info.output_level = compact->compaction->output_level();
+    info.input_files = compact->compaction->num_input_files(0) +
+                       compact->compaction->num_input_files(1);
+    info.output_files = static_cast<int>(compact->outputs.size());
+    info.bytes_read = stats.bytes_read;
+    info.bytes_written = stats.bytes_written;
+    info.micros = stats.micros;
+    info.status = status;
+    NotifyListeners(options_, &mutex_, [&info](EventListener* listener) {
+      listener->OnCompactionCompleted(info);
+    });
+  }
   if (!status.ok()) {
     RecordBackgroundError(status);
   }
@@ -1060,18 +2257,18 @@ namespace {
 struct IterState {
   port::Mutex* const mu;
   Version* const version GUARDED_BY(mu);
-  MemTable* const mem GUARDED_BY(mu);
-  MemTable* const imm GUARDED_BY(mu);
+  std::vector<MemTable*> mems GUARDED_BY(mu);
 
-  IterState(port::Mutex* mutex, MemTable* mem, MemTable* imm, Version* version)
-      : mu(mutex), version(version), mem(mem), imm(imm) {}
+  IterState(port::Mutex* mutex, Version* version)
+      : mu(mutex), version(version) {}
 };
 
 static void CleanupIteratorState(void* arg1, void* arg2) {
   IterState* state = reinterpret_cast<IterState*>(arg1);
   state->mu->Lock();
-  state->mem->Unref();
-  if (state->imm != nullptr) state->imm->Unref();
+  for (size_t i = 0; i < state->mems.size(); i++) {
+    state->mems[i]->Unref();
+  }
   state->version->Unref();
   state->mu->Unlock();
   delete state;
@@ -1079,27 +2276,39 @@ static void CleanupIteratorState(void* arg1, void* arg2) {
 
 }  // anonymous namespace
 
-Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
-                                      SequenceNumber* latest_snapshot,
-                                      uint32_t* seed) {
+Iterator* DBImpl::NewInternalIterator(
+    const ReadOptions& options, SequenceNumber* latest_snapshot,
+    uint32_t* seed, std::vector<MemTable::RangeTombstone>* range_tombstones,
+    Version** version_out) {
   mutex_.Lock();
   *latest_snapshot = versions_->LastSequence();
 
   // Collect together all needed child iterators
   std::vector<Iterator*> list;
+  IterState* cleanup = new IterState(&mutex_, versions_->current());
   list.push_back(mem_->NewIterator());
   mem_->Ref();
-  if (imm_ != nullptr) {
-    list.push_back(imm_->NewIterator());
-    imm_->Ref();
+  cleanup->mems.push_back(mem_);
+  for (size_t i = 0; i < imms_.size(); i++) {
+    list.push_back(imms_[i].mem->NewIterator());
+    imms_[i].mem->Ref();
+    cleanup->mems.push_back(imms_[i].mem);
+  }
+  if (range_tombstones != nullptr) {
+    mem_->GetRangeTombstones(kMaxSequenceNumber, range_tombstones);
+    for (size_t i = 0; i < imms_.size(); i++) {
+      imms_[i].mem->GetRangeTombstones(kMaxSequenceNumber, range_tombstones);
+    }
   }
   versions_->current()->AddIterators(options, &list);
   Iterator* internal_iter =
       NewMergingIterator(&internal_comparator_, &list[0], list.size());
   versions_->current()->Ref();
 
-  IterState* cleanup = new IterState(&mutex_, mem_, imm_, versions_->current());
   internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, nullptr);
+  if (version_out != nullptr) {
+    *version_out = versions_->current();
+  }
 
   *seed = ++seed_;
   mutex_.Unlock();
@@ -1109,7 +2318,7 @@ Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
 Iterator* DBImpl::TEST_NewInternalIterator() {
   SequenceNumber ignored;
   uint32_t ignored_seed;
-  return NewInternalIterator(ReadOptions(), &ignored, &ignored_seed);
+  return NewInternalIterator(ReadOptions(), &ignored, &ignored_seed, nullptr);
 }
 
 int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
@@ -1117,10 +2326,118 @@ int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
   return versions_->MaxNextLevelOverlappingBytes();
 }
 
+// Point lookup when a merge operator is configured: walk the entries
+// for the key newest to oldest through the internal iterator,
+// collecting merge operands until a base value, a deletion, a covering
+// range tombstone or the end of the key is found, then apply the
+// operator once.
+Status DBImpl::GetWithMerge(const ReadOptions& options, const Slice& key,
+                            std::string* value) {
+  SequenceNumber latest_snapshot;
+  uint32_t seed;
+  std::vector<MemTable::RangeTombstone> tombstones;
+  Iterator* iter =
+      NewInternalIterator(options, &latest_snapshot, &seed, &tombstones);
+  const SequenceNumber snapshot =
+      (options.snapshot != nullptr
+           ? static_cast<const SnapshotImpl*>(options.snapshot)
+                 ->sequence_number()
+           : latest_snapshot);
+
+  SequenceNumber tombstone_seq = 0;
+  for (size_t i = 0; i < tombstones.size(); i++) {
+    const MemTable::RangeTombstone& t = tombstones[i];
+    if (t.seq <= snapshot && t.seq > tombstone_seq &&
+        user_comparator()->Compare(key, t.begin) >= 0 &&
+        user_comparator()->Compare(key, t.end) < 0) {
+      tombstone_seq = t.seq;
+    }
+  }
+
+  LookupKey lkey(key, snapshot);
+  iter->Seek(lkey.internal_key());
+
+  std::vector<std::string> operands;  // Newest first
+  bool have_base = false;
+  std::string base;
+  Status s;
+  for (; iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    if (!ParseInternalKey(iter->key(), &ikey)) {
+      s = Status::Corruption("corrupted internal key");
+      break;
+    }
+    if (user_comparator()->Compare(ikey.user_key, key) != 0) {
+      break;
+    }
+    if (ikey.sequence > snapshot) {
+      continue;
+    }
+    if (ikey.sequence < tombstone_seq) {
+      break;  // Everything older is range deleted
+    }
+    if (ikey.type == kTypeMerge) {
+      operands.push_back(iter->value().ToString());
+      continue;
+    }
+    if (ikey.type == kTypeValue) {
+      have_base = true;
+      base = iter->value().ToString();
+    } else if (ikey.type == kTypeBlobHandle) {
+      have_base = true;
+      s = ReadBlobValue(iter->value(), &base);
+      if (!s.ok()) break;
+    }
+    break;  // Value or deletion terminates the chain
+  }
+  if (s.ok()) {
+    s = iter->status();
+  }
+  delete iter;
+  if (!s.ok()) {
+    return s;
+  }
+
+  if (operands.empty()) {
+    if (!have_base) {
+      return Status::NotFound(Slice());
+    }
+    value->assign(base);
+    return Status::OK();
+  }
+
+  std::vector<Slice> operand_slices;  // Oldest first
+  for (size_t i = operands.size(); i > 0; i--) {
+    operand_slices.push_back(Slice(operands[i - 1]));
+  }
+  Slice base_slice(base);
+  value->clear();
+  if (!options_.merge_operator->Merge(key, have_base ? &base_slice : nullptr,
+                                      operand_slices, value)) {
+    return Status::Corruption("merge operator failed");
+  }
+  return Status::OK();
+}
+
+namespace {
+void DeletePinnedIterator(void* arg1, void* arg2) {
+  delete reinterpret_cast<Iterator*>(arg1);
+  (void)arg2;
+}
+}  // namespace
+
 Status DBImpl::Get(const ReadOptions& options, const Slice& key,
-                   std::string* value) {
+                   PinnableSlice* value) {
+  if (options_.merge_operator != nullptr) {
+    Status s = GetWithMerge(options, key, value->buffer());
+    if (s.ok()) {
+      value->PinBuffer();
+    }
+    return s;
+  }
+
   Status s;
-  MutexLock l(&mutex_);
+  mutex_.Lock();
   SequenceNumber snapshot;
   if (options.snapshot != nullptr) {
     snapshot =
@@ -1128,341 +2445,2764 @@ Status DBImpl::Get(const ReadOptions& options, const Slice& key,
   } else {
     snapshot = versions_->LastSequence();
   }
-
   MemTable* mem = mem_;
-  MemTable* imm = imm_;
+  std::vector<MemTable*> imms;  // Newest first
+  for (size_t i = imms_.size(); i > 0; i--) {
+    imms.push_back(imms_[i - 1].mem);
+  }
   Version* current = versions_->current();
   mem->Ref();
-  if (imm != nullptr) imm->Ref();
+  for (size_t i = 0; i < imms.size(); i++) imms[i]->Ref();
   current->Ref();
+  mutex_.Unlock();
 
   bool have_stat_update = false;
   Version::GetStats stats;
+  Iterator* pinned_iter = nullptr;
+  Slice pinned_value;
+
+  LookupKey lkey(key, snapshot);
+  SequenceNumber entry_seq = 0;
+  bool done = mem->Get(lkey, value->buffer(), &s, &entry_seq);
+  for (size_t i = 0; !done && i < imms.size(); i++) {
+    done = imms[i]->Get(lkey, value->buffer(), &s, &entry_seq);
+  }
+  bool is_blob = false;
+  if (!done) {
+    s = current->Get(options, lkey, value->buffer(), &stats, &entry_seq,
+                     &is_blob, &pinned_iter, &pinned_value);
+    have_stat_update = true;
+  }
+  if (s.ok() && is_blob) {
+    const std::string handle = pinned_value.ToString();
+    delete pinned_iter;
+    pinned_iter = nullptr;
+    s = ReadBlobValue(handle, value->buffer());
+  }
+  if (s.ok()) {
+    // A newer range tombstone hides the entry.
+    SequenceNumber tombstone_seq = mem->MaxRangeTombstoneSeq(key, snapshot);
+    for (size_t i = 0; i < imms.size(); i++) {
+      const SequenceNumber t = imms[i]->MaxRangeTombstoneSeq(key, snapshot);
+      if (t > tombstone_seq) tombstone_seq = t;
+    }
+    if (tombstone_seq > entry_seq) {
+      s = Status::NotFound(Slice());
+    }
+  }
 
-  // Unlock while reading from files and memtables
-  {
-    mutex_.Unlock();
-    // First look in the memtable, then in the immutable memtable (if any).
-    LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, &s)) {
-      // Done
-    } else if (imm != nullptr && imm->Get(lkey, value, &s)) {
-      // Done
+  if (s.ok()) {
+    if (pinned_iter != nullptr) {
+      // Zero copy: the value references the cached block, which stays
+      // pinned through the iterator until the caller resets the slice.
+      value->PinSlice(pinned_value, &DeletePinnedIterator, pinned_iter,
+                      nullptr);
+      pinned_iter = nullptr;
     } else {
-      s = current->Get(options, lkey, value, &stats);
-      have_stat_update = true;
+      value->PinBuffer();
     }
-    mutex_.Lock();
   }
+  delete pinned_iter;
 
+  mutex_.Lock();
   if (have_stat_update && current->UpdateStats(stats)) {
     MaybeScheduleCompaction();
   }
   mem->Unref();
-  if (imm != nullptr) imm->Unref();
+  for (size_t i = 0; i < imms.size(); i++) imms[i]->Unref();
   current->Unref();
+  mutex_.Unlock();
   return s;
 }
 
-Iterator* DBImpl::NewIterator(const ReadOptions& options) {
-  SequenceNumber latest_snapshot;
-  uint32_t seed;
-  Iterator* iter = NewInternalIterator(options, &latest_snapshot, &seed);
-  return NewDBIterator(this, user_comparator(), iter,
-                       (options.snapshot != nullptr
-                            ? static_cast<const SnapshotImpl*>(options.snapshot)
-                                  ->sequence_number()
-                            : latest_snapshot),
-                       seed);
-}
-
-void DBImpl::RecordReadSample(Slice key) {
-  MutexLock l(&mutex_);
-  if (versions_->current()->RecordReadSample(key)) {
-    MaybeScheduleCompaction();
-  }
-}
-
-const Snapshot* DBImpl::GetSnapshot() {
-  MutexLock l(&mutex_);
-  return snapshots_.New(versions_->LastSequence());
+bool DBImpl::LatencyStatsEnabled() const {
+  return options_.enable_latency_stats;
 }
 
-void DBImpl::ReleaseSnapshot(const Snapshot* snapshot) {
-  MutexLock l(&mutex_);
-  snapshots_.Delete(static_cast<const SnapshotImpl*>(snapshot));
+void DBImpl::RecordSeekLatency(uint64_t micros) {
+  seek_latency_.Record(micros);
 }
 
-// Convenience methods
-Status DBImpl::Put(const WriteOptions& o, const Slice& key, const Slice& val) {
-  return DB::Put(o, key, val);
+Status DBImpl::Get(const ReadOptions& options, const Slice& key,
+                   std::string* value) {
+  if (TracingActive()) {
+    TraceOperation("get", key);
+  }
+  if (options_.enable_latency_stats) {
+    const uint64_t start = env_->NowMicros();
+    Status s = GetInternal(options, key, value);
+    get_latency_.Record(env_->NowMicros() - start);
+    return s;
+  }
+  return GetInternal(options, key, value);
 }
 
-Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
-  return DB::Delete(options, key);
+namespace {
+void NopNegativeDeleter(const Slice& key, void* value) {
+  (void)key;
+  (void)value;
 }
+}  // namespace
 
-Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
-  Writer w(&mutex_);
-  w.batch = updates;
-  w.sync = options.sync;
-  w.done = false;
+Status DBImpl::GetInternal(const ReadOptions& options, const Slice& key,
+                           std::string* value) {
+  if (options_.merge_operator != nullptr) {
+    return GetWithMerge(options, key, value);
+  }
 
-  MutexLock l(&mutex_);
-  writers_.push_back(&w);
-  while (!w.done && &w != writers_.front()) {
-    w.cv.Wait();
+  // Lock-free fast path: pin the published ReadState through a slot
+  // instead of taking mutex_ and bumping refcounts.  The store-then-
+  // revalidate dance guarantees the reclaimer either sees our slot or
+  // we see the replacement state.
+  // Read the sequence before pinning the read state: the pinned state
+  // may be a republication older than a just-completed write, and a
+  // cached-absence proof must never claim a sequence newer than the
+  // state that produced it.
+  const SequenceNumber snapshot =
+      (options.snapshot != nullptr)
+          ? static_cast<const SnapshotImpl*>(options.snapshot)
+                ->sequence_number()
+          : versions_->LastSequence();
+
+  int slot = -1;
+  ReadState* state = nullptr;
+  // Start the slot probe at a per-thread position: with every reader
+  // starting at slot 0, concurrent Gets all fail the same CAS chain
+  // and scaling flattens well before the slots run out.
+  static thread_local int preferred_slot =
+      static_cast<int>(std::hash<std::thread::id>{}(
+                           std::this_thread::get_id()) %
+                       kReadStateSlots);
+  for (int probe = 0; probe < kReadStateSlots; probe++) {
+    const int i = (preferred_slot + probe) % kReadStateSlots;
+    ReadState* expected = nullptr;
+    if (read_state_slots_[i].compare_exchange_strong(
+            expected, reinterpret_cast<ReadState*>(1),
+            std::memory_order_seq_cst)) {
+      slot = i;
+      break;
+    }
   }
-  if (w.done) {
-    return w.status;
+  if (slot >= 0) {
+    while (true) {
+      state = read_state_.load(std::memory_order_seq_cst);
+      if (state == nullptr) {
+        break;
+      }
+      read_state_slots_[slot].store(state, std::memory_order_seq_cst);
+      if (read_state_.load(std::memory_order_seq_cst) == state) {
+        break;
+      }
+    }
+    if (state == nullptr) {
+      read_state_slots_[slot].store(nullptr, std::memory_order_seq_cst);
+      slot = -1;
+    }
   }
 
-  // May temporarily unlock and wait.
-  Status status = MakeRoomForWrite(updates == nullptr);
-  uint64_t last_sequence = versions_->LastSequence();
-  Writer* last_writer = &w;
-  if (status.ok() && updates != nullptr) {  // nullptr batch is for compactions
-    WriteBatch* write_batch = BuildBatchGroup(&last_writer);
-    WriteBatchInternal::SetSequence(write_batch, last_sequence + 1);
-    last_sequence += WriteBatchInternal::Count(write_batch);
-
-    // Add to log and apply to memtable.  We can release the lock
-    // during this phase since &w is currently responsible for logging
-    // and protects against concurrent loggers and concurrent writes
-    // into mem_.
-    {
-      mutex_.Unlock();
-      status = log_->AddRecord(WriteBatchInternal::Contents(write_batch));
-      bool sync_error = false;
-      if (status.ok() && options.sync) {
-        status = logfile_->Sync();
-        if (!status.ok()) {
-          sync_error = true;
+  if (slot >= 0) {
+    Status s;
+    // Negative-lookup cache: a previously proven absence still holds
+    // if no write to the key's hash slot has happened since.
+    Cache::Handle* negative_handle = nullptr;
+    if (negative_cache_ != nullptr) {
+      negative_handle = negative_cache_->Lookup(key);
+      if (negative_handle != nullptr) {
+        const uint64_t proven_seq = reinterpret_cast<uint64_t>(
+            negative_cache_->Value(negative_handle));
+        negative_cache_->Release(negative_handle);
+        if (snapshot >= proven_seq &&
+            negative_stamps_.LastWrite(key) <= proven_seq) {
+          if (slot >= 0) {
+            read_state_slots_[slot].store(nullptr, std::memory_order_seq_cst);
+          }
+          return Status::NotFound(Slice());
         }
       }
-      if (status.ok()) {
-        status = WriteBatchInternal::InsertInto(write_batch, mem_);
+    }
+    LookupKey lkey(key, snapshot);
+    SequenceNumber entry_seq = 0;
+    GetPerfContext()->memtable_probes++;
+    GetGlobalPerfCounters()->memtable_lookups.fetch_add(
+        1, std::memory_order_relaxed);
+    bool done = state->mem->Get(lkey, value, &s, &entry_seq);
+    for (size_t i = 0; !done && i < state->imms.size(); i++) {
+      GetPerfContext()->memtable_probes++;
+      done = state->imms[i]->Get(lkey, value, &s, &entry_seq);
+    }
+    if (done) {
+      GetGlobalPerfCounters()->memtable_hits.fetch_add(
+          1, std::memory_order_relaxed);
+    }
+    Version::GetStats stats;
+    bool have_stat_update = false;
+    bool is_blob = false;
+    if (!done) {
+      s = state->version->Get(options, lkey, value, &stats, &entry_seq,
+                              &is_blob);
+      have_stat_update = true;
+    }
+    if (s.ok() && is_blob) {
+      std::string handle;
+      handle.swap(*value);
+      s = ReadBlobValue(handle, value);
+    }
+    if (s.ok()) {
+      SequenceNumber tombstone_seq =
+          state->mem->MaxRangeTombstoneSeq(key, snapshot);
+      for (size_t i = 0; i < state->imms.size(); i++) {
+        const SequenceNumber t =
+            state->imms[i]->MaxRangeTombstoneSeq(key, snapshot);
+        if (t > tombstone_seq) tombstone_seq = t;
       }
-      mutex_.Lock();
-      if (sync_error) {
-        // The state of the log file is indeterminate: the log record we
-        // just added may or may not show up when the DB is re-opened.
-        // So we force the DB into a mode where all future writes fail.
-        RecordBackgroundError(status);
+      if (tombstone_seq > entry_seq) {
+        s = Status::NotFound(Slice());
       }
     }
-    if (write_batch == tmp_batch_) tmp_batch_->Clear();
-
-    versions_->SetLastSequence(last_sequence);
-  }
-
-  while (true) {
-    Writer* ready = writers_.front();
-    writers_.pop_front();
-    if (ready != &w) {
-      ready->status = status;
-      ready->done = true;
-      ready->cv.Signal();
+    // Only wasted block reads need the stat update (and the mutex).
+    if (have_stat_update && stats.num_charged > 0) {
+      MutexLock l(&mutex_);
+      if (state->version->UpdateStats(stats)) {
+        MaybeScheduleCompaction();
+      }
+    }
+    if (negative_cache_ != nullptr && s.IsNotFound()) {
+      // Remember the proven absence.  The write stamps, not this
+      // entry, are the invalidation authority, so racing writers are
+      // harmless.
+      negative_cache_->Release(negative_cache_->Insert(
+          key, reinterpret_cast<void*>(static_cast<uintptr_t>(snapshot)),
+          key.size() + 16, &NopNegativeDeleter));
     }
-    if (ready == last_writer) break;
+    read_state_slots_[slot].store(nullptr, std::memory_order_seq_cst);
+    return s;
   }
 
-  // Notify new head of write queue
-  if (!writers_.empty()) {
-    writers_.front()->cv.Signal();
+  Status s;
+  MutexLock l(&mutex_);
+  // The slow path reads under the mutex; refresh the sequence unless
+  // an explicit snapshot pins it.
+  const SequenceNumber locked_snapshot =
+      (options.snapshot != nullptr) ? snapshot : versions_->LastSequence();
+
+  MemTable* mem = mem_;
+  std::vector<MemTable*> imms;  // Newest first
+  for (size_t i = imms_.size(); i > 0; i--) {
+    imms.push_back(imms_[i - 1].mem);
   }
+  Version* current = versions_->current();
+  mem->Ref();
+  for (size_t i = 0; i < imms.size(); i++) imms[i]->Ref();
+  current->Ref();
 
-  return status;
-}
+  bool have_stat_update = false;
+  Version::GetStats stats;
 
-// REQUIRES: Writer list must be non-empty
-// REQUIRES: First writer must have a non-null batch
-WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
+  // Unlock while reading from files and memtables
+  {
+    mutex_.Unlock();
+    // First look in the memtable, then in the immutable memtables
+    // (newest first).
+    LookupKey lkey(key, locked_snapshot);
+    SequenceNumber entry_seq = 0;
+    GetPerfContext()->memtable_probes++;
+    bool done = mem->Get(lkey, value, &s, &entry_seq);
+    for (size_t i = 0; !done && i < imms.size(); i++) {
+      GetPerfContext()->memtable_probes++;
+      done = imms[i]->Get(lkey, value, &s, &entry_seq);
+    }
+    bool is_blob = false;
+    if (!done) {
+      s = current->Get(options, lkey, value, &stats, &entry_seq, &is_blob);
+      have_stat_update = true;
+    }
+    if (s.ok() && is_blob) {
+      std::string handle;
+      handle.swap(*value);
+      s = ReadBlobValue(handle, value);
+    }
+    if (s.ok()) {
+      // A newer range tombstone hides the entry.
+      SequenceNumber tombstone_seq = mem->MaxRangeTombstoneSeq(key, locked_snapshot);
+      for (size_t i = 0; i < imms.size(); i++) {
+        const SequenceNumber t = imms[i]->MaxRangeTombstoneSeq(key, locked_snapshot);
+        if (t > tombstone_seq) tombstone_seq = t;
+      }
+      if (tombstone_seq > entry_seq) {
+        s = Status::NotFound(Slice());
+      }
+    }
+    mutex_.Lock();
+  }
+
+  if (have_stat_update && current->UpdateStats(stats)) {
+    MaybeScheduleCompaction();
+  }
+  mem->Unref();
+  for (size_t i = 0; i < imms.size(); i++) imms[i]->Unref();
+  current->Unref();
+  return s;
+}
+
+std::vector<Status> DBImpl::MultiGet(const ReadOptions& options,
+                                     const std::vector<Slice>& keys,
+                                     std::vector<std::string>* values) {
+  values->clear();
+  values->resize(keys.size());
+  std::vector<Status> statuses(keys.size());
+
+  if (options_.merge_operator != nullptr) {
+    for (size_t i = 0; i < keys.size(); i++) {
+      statuses[i] = GetWithMerge(options, keys[i], &(*values)[i]);
+    }
+    return statuses;
+  }
+
+  mutex_.Lock();
+  SequenceNumber snapshot;
+  if (options.snapshot != nullptr) {
+    snapshot =
+        static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
+  } else {
+    snapshot = versions_->LastSequence();
+  }
+
+  MemTable* mem = mem_;
+  std::vector<MemTable*> imms;  // Newest first
+  for (size_t i = imms_.size(); i > 0; i--) {
+    imms.push_back(imms_[i - 1].mem);
+  }
+  Version* current = versions_->current();
+  mem->Ref();
+  for (size_t i = 0; i < imms.size(); i++) imms[i]->Ref();
+  current->Ref();
+  mutex_.Unlock();
+
+  // Probe keys in sorted order so that lookups for neighbouring keys
+  // hit the same files, filter blocks and cached data blocks.
+  std::vector<size_t> order(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    order[i] = i;
+  }
+  const Comparator* const ucmp = user_comparator();
+  std::sort(order.begin(), order.end(), [&keys, ucmp](size_t a, size_t b) {
+    return ucmp->Compare(keys[a], keys[b]) < 0;
+  });
+
+  bool have_stat_update = false;
+  Version::GetStats stats;
+  for (size_t i = 0; i < order.size(); i++) {
+    const size_t idx = order[i];
+    Status& s = statuses[idx];
+    std::string* value = &(*values)[idx];
+    LookupKey lkey(keys[idx], snapshot);
+    SequenceNumber entry_seq = 0;
+    bool done = mem->Get(lkey, value, &s, &entry_seq);
+    for (size_t j = 0; !done && j < imms.size(); j++) {
+      done = imms[j]->Get(lkey, value, &s, &entry_seq);
+    }
+    bool is_blob = false;
+    if (!done) {
+      Version::GetStats key_stats;
+      s = current->Get(options, lkey, value, &key_stats, &entry_seq, &is_blob);
+      if (!have_stat_update) {
+        // Charge at most one seek per batch so a scan-like MultiGet
+        // does not look like many wasted seeks to the same file.
+        stats = key_stats;
+        have_stat_update = true;
+      }
+    }
+    if (s.ok() && is_blob) {
+      std::string handle;
+      handle.swap(*value);
+      s = ReadBlobValue(handle, value);
+    }
+    if (s.ok()) {
+      // A newer range tombstone hides the entry.
+      SequenceNumber tombstone_seq =
+          mem->MaxRangeTombstoneSeq(keys[idx], snapshot);
+      for (size_t j = 0; j < imms.size(); j++) {
+        const SequenceNumber t =
+            imms[j]->MaxRangeTombstoneSeq(keys[idx], snapshot);
+        if (t > tombstone_seq) tombstone_seq = t;
+      }
+      if (tombstone_seq > entry_seq) {
+        s = Status::NotFound(Slice());
+      }
+    }
+  }
+
+  mutex_.Lock();
+  if (have_stat_update && current->UpdateStats(stats)) {
+    MaybeScheduleCompaction();
+  }
+  mem->Unref();
+  for (size_t i = 0; i < imms.size(); i++) imms[i]->Unref();
+  current->Unref();
+  mutex_.Unlock();
+  return statuses;
+}
+
+Iterator* DBImpl::NewIterator(const ReadOptions& options) {
+  SequenceNumber latest_snapshot;
+  uint32_t seed;
+  std::vector<MemTable::RangeTombstone> range_tombstones;
+  Version* version = nullptr;
+  Iterator* iter = NewInternalIterator(options, &latest_snapshot, &seed,
+                                       &range_tombstones, &version);
+  Iterator* db_iter = NewDBIterator(
+      this, user_comparator(), iter,
+      (options.snapshot != nullptr
+           ? static_cast<const SnapshotImpl*>(options.snapshot)
+                 ->sequence_number()
+           : latest_snapshot),
+      seed, std::move(range_tombstones),
+      options.prefix_same_as_start ? options_.prefix_length : 0,
+      options_.merge_operator, options.iterate_upper_bound,
+      options.release_passed_files, options.key_only);
+  if (options.release_passed_files) {
+    MutexLock l(&mutex_);
+    RegisterScanCursor(db_iter, version);
+  }
+  return db_iter;
+}
+
+void DBImpl::RegisterScanCursor(const void* handle, Version* version) {
   mutex_.AssertHeld();
-  assert(!writers_.empty());
-  Writer* first = writers_.front();
-  WriteBatch* result = first->batch;
-  assert(result != nullptr);
+  ScanCursor cursor;
+  cursor.version = version;
+  scan_cursors_[handle] = cursor;
+}
 
-  size_t size = WriteBatchInternal::ByteSize(first->batch);
+void DBImpl::UpdateScanCursor(const void* handle, const Slice& user_key) {
+  MutexLock l(&mutex_);
+  std::map<const void*, ScanCursor>::iterator it = scan_cursors_.find(handle);
+  if (it != scan_cursors_.end()) {
+    it->second.user_key.assign(user_key.data(), user_key.size());
+    it->second.started = true;
+  }
+}
 
-  // Allow the group to grow up to a maximum size, but if the
-  // original write is small, limit the growth so we do not slow
-  // down the small write too much.
-  size_t max_size = 1 << 20;
-  if (size <= (128 << 10)) {
-    max_size = size + (128 << 10);
+void DBImpl::UnregisterScanCursor(const void* handle) {
+  MutexLock l(&mutex_);
+  scan_cursors_.erase(handle);
+}
+
+SequenceNumber DBImpl::SmallestSnapshot() {
+  mutex_.AssertHeld();
+  SequenceNumber smallest = snapshots_.empty()
+                                ? versions_->LastSequence()
+                                : snapshots_.oldest()->sequence_number();
+  for (int i = 0; i < kSnapshotSlots; i++) {
+    const uint64_t v = snapshot_slots_[i].load(std::memory_order_acquire);
+    if (v != 0 && v - 1 < smallest) {
+      smallest = v - 1;
+    }
   }
+  return smallest;
+}
 
-  *last_writer = first;
-  std::deque<Writer*>::iterator iter = writers_.begin();
-  ++iter;  // Advance past "first"
-  for (; iter != writers_.end(); ++iter) {
-    Writer* w = *iter;
-    if (w->sync && !first->sync) {
-      // Do not include a sync write into a batch handled by a non-sync write.
-      break;
+void DBImpl::RecordReadSample(Slice key) {
+  MutexLock l(&mutex_);
+  if (versions_->current()->RecordReadSample(key)) {
+    MaybeScheduleCompaction();
+  }
+}
+
+namespace {
+
+// Shared bookkeeping for one NewParallelIterators() call: the common
+// snapshot is released when the last sub-iterator dies.
+struct ParallelScanShared {
+  DB* db;
+  const Snapshot* snapshot;
+  port::Mutex mu;
+  int refs;
+};
+
+// One sub-range [start, limit) of a parallel scan.  The limit is
+// enforced by the wrapped DBIter's upper bound (which points into this
+// object, hence the two-phase construction in NewParallelIterators);
+// the start is enforced here.
+class ParallelRangeIterator : public Iterator {
+ public:
+  ParallelRangeIterator(ParallelScanShared* shared, std::string start,
+                        std::string limit)
+      : shared_(shared),
+        start_(std::move(start)),
+        limit_(std::move(limit)),
+        limit_slice_(limit_),
+        inner_(nullptr) {}
+
+  ~ParallelRangeIterator() override {
+    delete inner_;
+    bool last;
+    {
+      MutexLock l(&shared_->mu);
+      last = (--shared_->refs == 0);
     }
+    if (last) {
+      shared_->db->ReleaseSnapshot(shared_->snapshot);
+      delete shared_;
+    }
+  }
 
-    if (w->batch != nullptr) {
-      size += WriteBatchInternal::ByteSize(w->batch);
-      if (size > max_size) {
-        // Do not make batch too big
-        break;
+  void SetInner(Iterator* inner) { inner_ = inner; }
+  const Slice* limit_slice() const {
+    return limit_.empty() ? nullptr : &limit_slice_;
+  }
+
+  bool Valid() const override { return inner_->Valid() && in_range_; }
+  void SeekToFirst() override {
+    if (start_.empty()) {
+      inner_->SeekToFirst();
+    } else {
+      inner_->Seek(Slice(start_));
+    }
+    in_range_ = true;
+  }
+  void SeekToLast() override {
+    // The upper bound positions the inner iterator for us.
+    inner_->SeekToLast();
+    CheckLowBound();
+  }
+  void Seek(const Slice& target) override {
+    if (!start_.empty() && target.compare(Slice(start_)) < 0) {
+      inner_->Seek(Slice(start_));
+    } else {
+      inner_->Seek(target);
+    }
+    in_range_ = true;
+  }
+  void Next() override {
+    assert(Valid());
+    inner_->Next();
+  }
+  void Prev() override {
+    assert(Valid());
+    inner_->Prev();
+    CheckLowBound();
+  }
+  Slice key() const override { return inner_->key(); }
+  Slice value() const override { return inner_->value(); }
+  Status status() const override { return inner_->status(); }
+
+ private:
+  void CheckLowBound() {
+    in_range_ = !inner_->Valid() || start_.empty() ||
+                inner_->key().compare(Slice(start_)) >= 0;
+  }
+
+  ParallelScanShared* const shared_;
+  const std::string start_;
+  const std::string limit_;
+  const Slice limit_slice_;
+  Iterator* inner_;
+  bool in_range_ = true;
+};
+
+}  // namespace
+
+Status DBImpl::NewParallelIterators(const ReadOptions& options,
+                                    const Slice* begin, const Slice* end,
+                                    int n,
+                                    std::vector<Iterator*>* iterators) {
+  iterators->clear();
+  if (n < 1) {
+    return Status::InvalidArgument("need at least one iterator");
+  }
+
+  // Pick split keys along file boundaries of the level carrying the
+  // most data in the range, weighting by file size so sub-ranges are
+  // roughly even.
+  std::vector<std::string> splits;
+  {
+    MutexLock l(&mutex_);
+    Version* current = versions_->current();
+    InternalKey ibegin, iend;
+    if (begin != nullptr) {
+      ibegin.SetFrom(ParsedInternalKey(*begin, kMaxSequenceNumber,
+                                       kValueTypeForSeek));
+    }
+    if (end != nullptr) {
+      iend.SetFrom(ParsedInternalKey(*end, kMaxSequenceNumber,
+                                     kValueTypeForSeek));
+    }
+    int best_level = -1;
+    uint64_t best_bytes = 0;
+    std::vector<FileMetaData*> best_files;
+    for (int level = 1; level < config::kNumLevels; level++) {
+      std::vector<FileMetaData*> files;
+      current->GetOverlappingInputs(level, begin != nullptr ? &ibegin : nullptr,
+                                    end != nullptr ? &iend : nullptr, &files);
+      uint64_t bytes = 0;
+      for (size_t i = 0; i < files.size(); i++) bytes += files[i]->file_size;
+      if (bytes > best_bytes) {
+        best_bytes = bytes;
+        best_level = level;
+        best_files.swap(files);
+      }
+    }
+    if (best_level >= 0 && best_files.size() > 1) {
+      const uint64_t stride = best_bytes / n;
+      uint64_t acc = 0, next_cut = stride;
+      for (size_t i = 0; i + 1 < best_files.size() &&
+                         splits.size() + 1 < static_cast<size_t>(n);
+           i++) {
+        acc += best_files[i]->file_size;
+        if (acc >= next_cut) {
+          splits.push_back(best_files[i]->largest.user_key().ToString());
+          // Make the bound exclusive-safe: the next range starts just
+          // past this file's largest key.
+          splits.back().push_back('\0');
+          next_cut = acc + stride;
+        }
       }
+    }
+  }
+
+  ParallelScanShared* shared = new ParallelScanShared;
+  shared->db = this;
+  shared->snapshot = GetSnapshot();
+  shared->refs = static_cast<int>(splits.size()) + 1;
+
+  ReadOptions sub_options = options;
+  sub_options.snapshot = shared->snapshot;
+  std::string range_start = begin != nullptr ? begin->ToString() : "";
+  for (size_t i = 0; i <= splits.size(); i++) {
+    std::string range_limit =
+        i < splits.size() ? splits[i]
+                          : (end != nullptr ? end->ToString() : "");
+    ParallelRangeIterator* wrapper = new ParallelRangeIterator(
+        shared, range_start, std::move(range_limit));
+    sub_options.iterate_upper_bound = wrapper->limit_slice();
+    wrapper->SetInner(NewIterator(sub_options));
+    iterators->push_back(wrapper);
+    if (i < splits.size()) {
+      range_start = splits[i];
+    }
+  }
+  return Status::OK();
+}
 
-      // Append to *result
-      if (result == first->batch) {
-        // Switch to temporary batch instead of disturbing caller's batch
-        result = tmp_batch_;
-        assert(WriteBatchInternal::Count(result) == 0);
-        WriteBatchInternal::Append(result, first->batch);
+namespace {
+// Shared state for the Warm() worker threads: each claims the next
+// overlapping file and scans its slice of the range with fill_cache.
+struct RangeWarmer {
+  TableCache* table_cache;
+  const InternalKeyComparator* icmp;
+  std::string begin_ikey, end_ikey;
+  std::vector<std::pair<uint64_t, uint64_t>> files;  // number, size
+  std::atomic<size_t> next;
+
+  port::Mutex mu;
+  port::CondVar cv;
+  int pending;
+
+  RangeWarmer() : next(0), cv(&mu), pending(0) {}
+
+  static void Work(void* arg) {
+    RangeWarmer* warmer = reinterpret_cast<RangeWarmer*>(arg);
+    ReadOptions options;  // fill_cache on
+    while (true) {
+      const size_t i = warmer->next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= warmer->files.size()) {
+        break;
+      }
+      Iterator* iter = warmer->table_cache->NewIterator(
+          options, warmer->files[i].first, warmer->files[i].second);
+      for (iter->Seek(Slice(warmer->begin_ikey));
+           iter->Valid() &&
+           warmer->icmp->Compare(iter->key(), Slice(warmer->end_ikey)) <= 0;
+           iter->Next()) {
       }
-      WriteBatchInternal::Append(result, w->batch);
+      delete iter;
     }
-    *last_writer = w;
+    warmer->mu.Lock();
+    warmer->pending--;
+    warmer->cv.SignalAll();
+    warmer->mu.Unlock();
   }
-  return result;
+};
+}  // namespace
+
+Status DBImpl::Warm(const Slice& begin, const Slice& end) {
+  RangeWarmer warmer;
+  warmer.table_cache = table_cache_;
+  warmer.icmp = &internal_comparator_;
+  AppendInternalKey(&warmer.begin_ikey,
+                    ParsedInternalKey(begin, kMaxSequenceNumber,
+                                      kValueTypeForSeek));
+  AppendInternalKey(&warmer.end_ikey, ParsedInternalKey(end, 0,
+                                                        kTypeDeletion));
+  {
+    MutexLock l(&mutex_);
+    Version* current = versions_->current();
+    InternalKey ibegin, iend;
+    ibegin.DecodeFrom(Slice(warmer.begin_ikey));
+    iend.DecodeFrom(Slice(warmer.end_ikey));
+    for (int level = 0; level < config::kNumLevels; level++) {
+      std::vector<FileMetaData*> overlap;
+      current->GetOverlappingInputs(level, &ibegin, &iend, &overlap);
+      for (size_t i = 0; i < overlap.size(); i++) {
+        warmer.files.emplace_back(overlap[i]->number, overlap[i]->file_size);
+      }
+    }
+  }
+  if (warmer.files.empty()) {
+    return Status::OK();
+  }
+  const int threads =
+      static_cast<int>(std::min<size_t>(4, warmer.files.size()));
+  warmer.pending = threads;
+  for (int i = 0; i < threads; i++) {
+    env_->StartThread(&RangeWarmer::Work, &warmer);
+  }
+  warmer.mu.Lock();
+  while (warmer.pending > 0) {
+    warmer.cv.Wait();
+  }
+  warmer.mu.Unlock();
+  Log(options_.info_log, "Warmed %d files for range",
+      static_cast<int>(warmer.files.size()));
+  return Status::OK();
 }
 
-// REQUIRES: mutex_ is held
-// REQUIRES: this thread is currently at the front of the writer queue
-Status DBImpl::MakeRoomForWrite(bool force) {
+const Snapshot* DBImpl::GetSnapshot() {
+  // Lock-free fast path: claim a slot with sequence 0 (maximally
+  // conservative for any concurrent compaction), then publish the real
+  // sequence.
+  for (int i = 0; i < kSnapshotSlots; i++) {
+    uint64_t expected = 0;
+    if (snapshot_slots_[i].compare_exchange_strong(
+            expected, 1, std::memory_order_acq_rel)) {
+      const SequenceNumber sequence = versions_->LastSequence();
+      snapshot_slots_[i].store(sequence + 1, std::memory_order_release);
+      SnapshotImpl* snapshot = new SnapshotImpl(sequence);
+      snapshot->set_slot(i);
+      return snapshot;
+    }
+  }
+  // All slots busy; fall back to the list.
+  MutexLock l(&mutex_);
+  return snapshots_.New(versions_->LastSequence());
+}
+
+void DBImpl::ReleaseSnapshot(const Snapshot* snapshot) {
+  const SnapshotImpl* impl = static_cast<const SnapshotImpl*>(snapshot);
+  if (impl->slot() >= 0) {
+    snapshot_slots_[impl->slot()].store(0, std::memory_order_release);
+    delete impl;
+    return;
+  }
+  MutexLock l(&mutex_);
+  snapshots_.Delete(impl);
+}
+
+// Convenience methods
+Status DBImpl::Put(const WriteOptions& o, const Slice& key, const Slice& val) {
+  if (options_.value_checksums || options_.memtable_compression) {
+    // Both re-encode the value inside MemTable::Add; pre-encoded spans
+    // bypass that, so take the classic path.
+    return DB::Put(o, key, val);
+  }
+  WriteBatch batch;
+  WriteBatchInternal::PutPreEncoded(&batch, key, val);
+  return Write(o, &batch);
+}
+
+Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
+  return DB::Delete(options, key);
+}
+
+Status DBImpl::Prepare(const WriteOptions& options, WriteBatch* updates,
+                       uint64_t* txn_id) {
+  if (updates == nullptr) {
+    return Status::InvalidArgument("null batch");
+  }
+  *txn_id = next_txn_id_.fetch_add(1, std::memory_order_relaxed);
+
+  // One record carrying the whole serialized batch; recovery (and the
+  // apply stage below, via MemTableInserter::Prepare) stages it in
+  // prepared_txns_ without touching the memtable.
+  WriteBatch wrapper;
+  std::string rep;
+  rep.push_back(
+      static_cast<char>(WriteBatchInternal::kPrepareRecordTag));
+  PutVarint64(&rep, *txn_id);
+  PutLengthPrefixedSlice(&rep, WriteBatchInternal::Contents(updates));
+  std::string full(12, '\0');
+  full.append(rep);
+  WriteBatchInternal::SetContents(&wrapper, full);
+  WriteBatchInternal::SetCount(&wrapper, 1);
+  return Write(options, &wrapper);
+}
+
+Status DBImpl::CommitPrepared(const WriteOptions& options, uint64_t txn_id) {
+  std::string contents;
+  if (!prepared_txns_.Get(txn_id, &contents)) {
+    return Status::InvalidArgument("unknown prepared transaction");
+  }
+  WriteBatch staged;
+  WriteBatchInternal::SetContents(&staged, contents);
+  const int count = WriteBatchInternal::Count(&staged);
+
+  WriteBatch wrapper;
+  std::string rep;
+  rep.push_back(static_cast<char>(WriteBatchInternal::kCommitRecordTag));
+  PutVarint64(&rep, txn_id);
+  PutVarint32(&rep, static_cast<uint32_t>(count));
+  std::string full(12, '\0');
+  full.append(rep);
+  WriteBatchInternal::SetContents(&wrapper, full);
+  WriteBatchInternal::SetCount(&wrapper, count);
+  return Write(options, &wrapper);
+}
+
+Status DBImpl::RollbackPrepared(const WriteOptions& options,
+                                uint64_t txn_id) {
+  WriteBatch wrapper;
+  std::string rep;
+  rep.push_back(static_cast<char>(WriteBatchInternal::kRollbackRecordTag));
+  PutVarint64(&rep, txn_id);
+  std::string full(12, '\0');
+  full.append(rep);
+  WriteBatchInternal::SetContents(&wrapper, full);
+  WriteBatchInternal::SetCount(&wrapper, 1);
+  return Write(options, &wrapper);
+}
+
+Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
+  if (read_only_) {
+    return Status::NotSupported("DB is open as a read-only secondary");
+  }
+  if (TracingActive() && updates != nullptr) {
+    TraceOperation("write", WriteBatchInternal::Contents(updates));
+  }
+  if (options_.enable_latency_stats) {
+    const uint64_t start = env_->NowMicros();
+    Status s = WriteInternal(options, updates);
+    write_latency_.Record(env_->NowMicros() - start);
+    return s;
+  }
+  return WriteInternal(options, updates);
+}
+
+Status DBImpl::WriteInternal(const WriteOptions& options,
+                             WriteBatch* updates) {
+  Writer w(&mutex_);
+  w.batch = updates;
+  w.sync = options.sync;
+  w.done = false;
+
+  MutexLock l(&mutex_);
+  writers_.push_back(&w);
+  while (!w.done && &w != writers_.front()) {
+    w.cv.Wait();
+  }
+  if (w.done) {
+    return w.status;
+  }
+  RunWriteGroup(&w);
+  return w.status;
+}
+
+void DBImpl::WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                        std::function<void(Status)> callback) {
+  Writer* w = new Writer(&mutex_);
+  w->batch = updates;
+  w->sync = options.sync;
+  w->done = false;
+  w->callback = std::move(callback);
+
+  MutexLock l(&mutex_);
+  writers_.push_back(w);
+  if (writers_.front() == w) {
+    // Nobody ahead of us will hand over the queue; start the drain.
+    WakeupWriterQueue();
+  }
+}
+
+void DBImpl::WakeupWriterQueue() {
   mutex_.AssertHeld();
   assert(!writers_.empty());
-  bool allow_delay = !force;
-  Status s;
-  while (true) {
-    if (!bg_error_.ok()) {
-      // Yield previous error
-      s = bg_error_;
-      break;
-    } else if (allow_delay && versions_->NumLevelFiles(0) >=
-                                  config::kL0_SlowdownWritesTrigger) {
-      // We are getting close to hitting a hard limit on the number of
-      // L0 files.  Rather than delaying a single write by several
-      // seconds when we hit the hard limit, start delaying each
-      // individual write by 1ms to reduce latency variance.  Also,
-      // this delay hands over some CPU to the compaction thread in
-      // case it is sharing the same core as the writer.
-      mutex_.Unlock();
-      env_->SleepForMicroseconds(1000);
-      allow_delay = false;  // Do not delay a single write more than once
-      mutex_.Lock();
-    } else if (!force &&
-               (mem_->ApproximateMemoryUsage() <= options_.write_buffer_size)) {
-      // There is room in current memtable
-      break;
-    } else if (imm_ != nullptr) {
-      // We have filled up the current memtable, but the previous
-      // one is still being compacted, so we wait.
-      Log(options_.info_log, "Current memtable full; waiting...\n");
-      background_work_finished_signal_.Wait();
-    } else if (versions_->NumLevelFiles(0) >= config::kL0_StopWritesTrigger) {
-      // There are too many level-0 files.
-      Log(options_.info_log, "Too many L0 files; waiting...\n");
-      background_work_finished_signal_.Wait();
-    } else {
+  Writer* front = writers_.front();
+  if (front->callback == nullptr) {
+    front->cv.Signal();
+  } else if (!async_writer_running_) {
+    // Asynchronous writers have no thread of their own.  Use a
+    // dedicated thread rather than Env::Schedule(): a write group can
+    // stall waiting for compactions, which run on the Schedule queue.
+    async_writer_running_ = true;
+    env_->StartThread(&DBImpl::AsyncWriteWork, this);
+  }
+}
+
+void DBImpl::AsyncWriteWork(void* db) {
+  reinterpret_cast<DBImpl*>(db)->ProcessAsyncWrites();
+}
+
+void DBImpl::ProcessAsyncWrites() {
+  MutexLock l(&mutex_);
+  while (!writers_.empty() && writers_.front()->callback != nullptr) {
+    RunWriteGroup(writers_.front());
+  }
+  async_writer_running_ = false;
+}
+
+void DBImpl::RunWriteGroup(Writer* leader) {
+  mutex_.AssertHeld();
+  assert(leader == writers_.front());
+
+  // May temporarily unlock and wait.
+  Status status = MakeRoomForWrite(leader->batch == nullptr);
+  if (last_allocated_sequence_ < versions_->LastSequence()) {
+    last_allocated_sequence_ = versions_->LastSequence();
+  }
+  Writer* last_writer = leader;
+  std::vector<Writer*> group;
+  if (status.ok() && leader->batch != nullptr) {
+    // nullptr batch is for compactions
+    std::vector<Writer*> members;
+    size_t group_bytes = 0;
+    BuildWriteGroup(&last_writer, &members, &group_bytes);
+    uint64_t total_count = 0;
+    for (size_t i = 0; i < members.size(); i++) {
+      total_count += WriteBatchInternal::Count(members[i]->batch);
+    }
+    const uint64_t first_sequence = last_allocated_sequence_ + 1;
+    const uint64_t last_sequence = first_sequence + total_count - 1;
+    last_allocated_sequence_ = last_sequence;
+
+    MemTable* mem = mem_;
+    mem->Ref();
+
+    // Stage 1: append to the log.  The leader is still at the front of
+    // writers_, making it the exclusive logger.  Rather than merging
+    // the group into one contiguous batch, emit a gather list -- a
+    // fresh batch header followed by every member's entries -- so the
+    // bytes go from each caller's batch straight into the log.
+    char group_header[WriteBatchInternal::kHeader];
+    EncodeFixed64(group_header, first_sequence);
+    EncodeFixed32(group_header + 8, static_cast<uint32_t>(total_count));
+    std::vector<Slice> pieces;
+    pieces.reserve(members.size() + 1);
+    pieces.push_back(Slice(group_header, WriteBatchInternal::kHeader));
+    for (size_t i = 0; i < members.size(); i++) {
+      const Slice rep = WriteBatchInternal::Contents(members[i]->batch);
+      pieces.push_back(
+          Slice(rep.data() + WriteBatchInternal::kHeader,
+                rep.size() - WriteBatchInternal::kHeader));
+    }
+    uint64_t my_epoch = 0;
+    const uint64_t log_start_micros = env_->NowMicros();
+    {
+      mutex_.Unlock();
+      status = log_->AddRecordV(pieces.data(), pieces.size());
+      mutex_.Lock();
+      my_epoch = ++log_appended_epoch_;
+      log_appended_sequence_ = last_sequence;
+    }
+
+    // Tune the group cap towards a ~2ms log stage: halve it when a
+    // full-sized group blew past the target (latency spike for the
+    // followers), grow gently while there is headroom.
+    {
+      const uint64_t log_micros = env_->NowMicros() - log_start_micros;
+      if (log_micros > 2000 && group_bytes >= group_size_limit_ / 2) {
+        group_size_limit_ =
+            std::max(group_size_limit_ / 2, static_cast<size_t>(128 << 10));
+      } else if (log_micros < 1000) {
+        group_size_limit_ = std::min(group_size_limit_ + group_size_limit_ / 16,
+                                     static_cast<size_t>(8 << 20));
+      }
+    }
+
+    // Hand the logging baton to the next group before syncing: its
+    // append lands in the file ahead of our fsync, so one fsync can
+    // cover several groups.
+    while (true) {
+      Writer* ready = writers_.front();
+      writers_.pop_front();
+      group.push_back(ready);
+      if (ready == last_writer) break;
+    }
+    if (!writers_.empty()) {
+      WakeupWriterQueue();
+    }
+
+    if (status.ok() && leader->sync) {
+      bool sync_error = false;
+      if (my_epoch > log_sync_requested_epoch_) {
+        log_sync_requested_epoch_ = my_epoch;
+      }
+      while (status.ok() && log_synced_epoch_ < my_epoch) {
+        if (!log_sync_in_progress_) {
+          // Become the syncer for every append made so far.
+          log_sync_in_progress_ = true;
+          const uint64_t target = log_appended_epoch_;
+          const uint64_t target_sequence = log_appended_sequence_;
+          WritableFile* logfile = logfile_;
+          mutex_.Unlock();
+          Status sync_status;
+          {
+            ScopedSpan sync_span("wal.sync", env_);
+            sync_status = logfile->Sync();
+          }
+          mutex_.Lock();
+          log_sync_in_progress_ = false;
+          if (sync_status.ok()) {
+            if (target > log_synced_epoch_) {
+              log_synced_epoch_ = target;
+            }
+            if (target_sequence > last_durable_sequence_) {
+              last_durable_sequence_ = target_sequence;
+            }
+          } else {
+            status = sync_status;
+            sync_error = true;
+          }
+          sync_done_signal_.SignalAll();
+        } else {
+          sync_done_signal_.Wait();
+        }
+      }
+      if (sync_error) {
+        // The state of the log file is indeterminate: the log record we
+        // just added may or may not show up when the DB is re-opened.
+        // So we force the DB into a mode where all future writes fail.
+        RecordBackgroundError(status);
+      }
+    }
+
+    // Stage 2: apply to the memtable.  Applies are serialized in
+    // sequence order so that LastSequence() never exposes a sequence
+    // whose entries are not yet readable.
+    while (versions_->LastSequence() != first_sequence - 1) {
+      apply_done_signal_.Wait();
+    }
+    if (status.ok()) {
+      mutex_.Unlock();
+      uint64_t sequence = first_sequence;
+      for (size_t i = 0; status.ok() && i < members.size(); i++) {
+        WriteBatch* batch = members[i]->batch;
+        WriteBatchInternal::SetSequence(batch, sequence);
+        sequence += WriteBatchInternal::Count(batch);
+        status = WriteBatchInternal::InsertInto(batch, mem, &prepared_txns_);
+      }
+      mutex_.Lock();
+    }
+    versions_->SetLastSequence(last_sequence);
+    apply_done_signal_.SignalAll();
+
+    mem->Unref();
+  } else {
+    while (true) {
+      Writer* ready = writers_.front();
+      writers_.pop_front();
+      group.push_back(ready);
+      if (ready == last_writer) break;
+    }
+    if (!writers_.empty()) {
+      WakeupWriterQueue();
+    }
+  }
+
+  // Complete the group: set statuses, wake synchronous writers, and
+  // collect asynchronous writers whose callbacks run without the lock.
+  std::vector<Writer*> async_done;
+  for (size_t i = 0; i < group.size(); i++) {
+    Writer* ready = group[i];
+    ready->status = status;
+    ready->done = true;
+    if (ready->callback != nullptr) {
+      async_done.push_back(ready);
+    } else if (ready != leader) {
+      ready->cv.Signal();
+    }
+  }
+  if (!async_done.empty()) {
+    mutex_.Unlock();
+    for (size_t i = 0; i < async_done.size(); i++) {
+      async_done[i]->callback(async_done[i]->status);
+      delete async_done[i];
+    }
+    mutex_.Lock();
+  }
+}
+
+// REQUIRES: Writer list must be non-empty
+// REQUIRES: First writer must have a non-null batch
+void DBImpl::BuildWriteGroup(Writer** last_writer,
+                             std::vector<Writer*>* members,
+                             size_t* total_bytes) {
+  mutex_.AssertHeld();
+  assert(!writers_.empty());
+  Writer* first = writers_.front();
+  assert(first->batch != nullptr);
+  members->push_back(first);
+
+  size_t size = WriteBatchInternal::ByteSize(first->batch);
+
+  // Allow the group to grow up to the adaptive cap, but if the
+  // original write is small, limit the growth so we do not slow
+  // down the small write too much.
+  size_t max_size = group_size_limit_;
+  if (size <= (128 << 10) && max_size > size + (128 << 10)) {
+    max_size = size + (128 << 10);
+  }
+
+  *last_writer = first;
+  std::deque<Writer*>::iterator iter = writers_.begin();
+  ++iter;  // Advance past "first"
+  for (; iter != writers_.end(); ++iter) {
+    Writer* w = *iter;
+    if (w->sync && !first->sync) {
+      // Do not include a sync write into a batch handled by a non-sync write.
+      break;
+    }
+
+    if (w->batch != nullptr) {
+      size += WriteBatchInternal::ByteSize(w->batch);
+      if (size > max_size) {
+        // Do not make batch too big
+        break;
+      }
+      members->push_back(w);
+    }
+    *last_writer = w;
+  }
+  *total_bytes = size;
+}
+
+// REQUIRES: mutex_ is held
+// REQUIRES: this thread is currently at the front of the writer queue
+Status DBImpl::MakeRoomForWrite(bool force) {
+  mutex_.AssertHeld();
+  assert(!writers_.empty());
+  bool allow_delay = !force;
+  Status s;
+  while (true) {
+    if (!bg_error_.ok()) {
+      // Yield previous error
+      s = bg_error_;
+      break;
+    } else if (allow_delay &&
+               versions_->NumLevelFiles(0) >= tuned_l0_slowdown_trigger_) {
+      // We are getting close to hitting a hard limit on the number of
+      // L0 files.  Rather than delaying a single write by several
+      // seconds when we hit the hard limit, delay each individual
+      // write in proportion to the compaction debt, so latency
+      // degrades smoothly instead of oscillating between no throttle
+      // and a full stall.  The delay also hands over some CPU to the
+      // compaction threads in case they share cores with the writer.
+      double debt =
+          static_cast<double>(versions_->NumLevelFiles(0) -
+                              tuned_l0_slowdown_trigger_) /
+          (tuned_l0_stop_trigger_ - tuned_l0_slowdown_trigger_);
+      const double score_debt = (versions_->CompactionScore() - 1.0) / 4.0;
+      if (score_debt > debt) {
+        debt = score_debt;
+      }
+      if (debt > 1.0) {
+        debt = 1.0;
+      }
+      // Quadratic ramp from 0.1ms just past the trigger up to 10ms
+      // when level 0 is about to hit the stop trigger.
+      const int delay_micros = 100 + static_cast<int>(9900 * debt * debt);
+      if (!options_.listeners.empty()) {
+        WriteStallInfo info;
+        info.cause = WriteStallInfo::kSlowdown;
+        NotifyListeners(options_, &mutex_, [&info](EventListener* listener) {
+          listener->OnWriteStall(info);
+        });
+      }
+      mutex_.Unlock();
+      env_->SleepForMicroseconds(delay_micros);
+      allow_delay = false;  // Do not delay a single write more than once
+      mutex_.Lock();
+      write_slowdown_micros_ += delay_micros;
+    } else if (!force &&
+               (mem_->ApproximateMemoryUsage() <= tuned_write_buffer_size_)) {
+      // There is room in current memtable
+      if (options_.adaptive_tuning) {
+        MaybeRetune();
+      }
+      if (options_.total_memory_budget != 0 && EnforceMemoryBudget()) {
+        // Over budget and pruning the caches was not enough; shed
+        // memory by retiring the current memtable early.
+        force = true;
+        continue;
+      }
+      break;
+    } else if (imms_.size() >=
+               static_cast<size_t>(options_.max_immutable_memtables)) {
+      if (options_.foreground_flush_fallback && !imms_.empty() &&
+          !imm_compacting_) {
+        // Steal the flush: the background threads are all busy, and
+        // this thread (the write leader) can clear the queue itself.
+        Log(options_.info_log, "Memtable queue full; foreground flush\n");
+        CompactMemTable();
+        background_work_finished_signal_.SignalAll();
+        continue;
+      }
+      // We have filled up the current memtable, and the immutable
+      // memtable queue is full, so we wait.
+      Log(options_.info_log, "Current memtable full; waiting...\n");
+      if (!options_.listeners.empty()) {
+        WriteStallInfo info;
+        info.cause = WriteStallInfo::kMemtablesFull;
+        NotifyListeners(options_, &mutex_, [&info](EventListener* listener) {
+          listener->OnWriteStall(info);
+        });
+      }
+      const uint64_t stall_start = env_->NowMicros();
+      background_work_finished_signal_.Wait();
+      write_stall_micros_ += env_->NowMicros() - stall_start;
+    } else if (versions_->NumLevelFiles(0) >= tuned_l0_stop_trigger_) {
+      // There are too many level-0 files.
+      Log(options_.info_log, "Too many L0 files; waiting...\n");
+      if (!options_.listeners.empty()) {
+        WriteStallInfo info;
+        info.cause = WriteStallInfo::kTooManyL0Files;
+        NotifyListeners(options_, &mutex_, [&info](EventListener* listener) {
+          listener->OnWriteStall(info);
+        });
+      }
+      const uint64_t stall_start = env_->NowMicros();
+      background_work_finished_signal_.Wait();
+      write_stall_micros_ += env_->NowMicros() - stall_start;
+    } else if (versions_->LastSequence() < last_allocated_sequence_) {
+      // An earlier batch group is still applying to mem_; it cannot be
+      // retired to the immutable queue until that apply is complete.
+      apply_done_signal_.Wait();
+    } else {
       // Attempt to switch to a new memtable and trigger compaction of old
       assert(versions_->PrevLogNumber() == 0);
-      uint64_t new_log_number = versions_->NewFileNumber();
+      uint64_t new_log_number;
       WritableFile* lfile = nullptr;
-      s = env_->NewWritableFile(LogFileName(dbname_, new_log_number), &lfile);
+      if (prepared_logfile_ != nullptr &&
+          prepared_logfile_number_ <= logfile_number_) {
+        // The segment was prepared against a logfile_number_ that a
+        // concurrent rotation has since passed (rotation briefly drops
+        // mutex_ to drain syncs); log numbers must only move forward.
+        delete prepared_logfile_;
+        env_->RemoveFile(LogFileName(dbname_, prepared_logfile_number_));
+        prepared_logfile_ = nullptr;
+      }
+      if (prepared_logfile_ != nullptr) {
+        // A background thread already created the next segment;
+        // rotation is just a pointer swap.
+        lfile = prepared_logfile_;
+        new_log_number = prepared_logfile_number_;
+        prepared_logfile_ = nullptr;
+      } else {
+        new_log_number = versions_->NewFileNumber();
+        s = NewLogSegment(new_log_number, PopRecycledLog(), &lfile);
+        if (!s.ok()) {
+          // Avoid chewing through file number space in a tight loop.
+          versions_->ReuseFileNumber(new_log_number);
+          break;
+        }
+      }
+
+      // Drain any coalesced syncs targeting the old log before closing
+      // it; sync writers must not acknowledge against a rotated file.
+      // Only *requested* syncs matter here: appends nobody asked to
+      // make durable must not force a foreground fsync per rotation.
+      while (log_sync_in_progress_) {
+        sync_done_signal_.Wait();
+      }
+      if (log_synced_epoch_ < log_sync_requested_epoch_) {
+        log_sync_in_progress_ = true;
+        const uint64_t target = log_appended_epoch_;
+        const uint64_t target_sequence = log_appended_sequence_;
+        WritableFile* old_logfile = logfile_;
+        mutex_.Unlock();
+        Status sync_status = old_logfile->Sync();
+        mutex_.Lock();
+        log_sync_in_progress_ = false;
+        if (sync_status.ok() && target > log_synced_epoch_) {
+          log_synced_epoch_ = target;
+          if (target_sequence > last_durable_sequence_) {
+            last_durable_sequence_ = target_sequence;
+          }
+        }
+        sync_done_signal_.SignalAll();
+        if (!sync_status.ok()) {
+          RecordBackgroundError(sync_status);
+        }
+      }
+
+      delete log_;
+
+      s = logfile_->Close();
+      if (!s.ok()) {
+        // We may have lost some data written to the previous log file.
+        // Switch to the new log file anyway, but record as a background
+        // error so we do not attempt any more writes.
+        //
+        // We could perhaps attempt to save the memtable corresponding
+        // to log file and suppress the error if that works, but that
+        // would add more complexity in a critical code path.
+        RecordBackgroundError(s);
+      }
+      delete logfile_;
+
+      ImmutableMemTable retired;
+      retired.mem = mem_;
+      retired.log_number = logfile_number_;  // Log backing the old memtable
+      logfile_ = lfile;
+      logfile_number_ = new_log_number;
+      prepared_txns_.SetLogHint(new_log_number);
+      log_ = NewLogWriter(options_, lfile, new_log_number);
+      imms_.push_back(retired);
+      has_imm_.store(true, std::memory_order_release);
+      mem_ = new MemTable(internal_comparator_, arena_pool_, options_.memtable_hash_index, options_.value_checksums, &negative_stamps_, options_.memtable_compression);
+      mem_->Ref();
+      RefreshReadState();
+      force = false;  // Do not force another compaction if have room
+      MaybePrepareLogFile();
+      MaybeScheduleCompaction();
+    }
+  }
+  return s;
+}
+
+void DBImpl::MaybeRetune() {
+  mutex_.AssertHeld();
+  const uint64_t now = env_->NowMicros();
+  if (last_retune_micros_ == 0) {
+    last_retune_micros_ = now;
+    retune_stall_baseline_ = write_stall_micros_ + write_slowdown_micros_;
+    return;
+  }
+  const uint64_t window = now - last_retune_micros_;
+  if (window < 10 * 1000 * 1000) {
+    return;  // Tune at most every 10 seconds
+  }
+  const uint64_t stalled =
+      write_stall_micros_ + write_slowdown_micros_ - retune_stall_baseline_;
+  last_retune_micros_ = now;
+  retune_stall_baseline_ = write_stall_micros_ + write_slowdown_micros_;
+
+  const size_t base_buffer = options_.write_buffer_size;
+  const int base_slowdown = options_.l0_slowdown_writes_trigger;
+  const int base_stop = options_.l0_stop_writes_trigger;
+  if (stalled > window / 100) {
+    // Writers lost more than 1% of the window to throttling: grow the
+    // headroom so flushes are bigger and level 0 absorbs more files.
+    const size_t new_buffer =
+        std::min(tuned_write_buffer_size_ + tuned_write_buffer_size_ / 2,
+                 8 * base_buffer);
+    const int new_slowdown =
+        std::min(tuned_l0_slowdown_trigger_ + 2, 2 * base_slowdown);
+    const int new_stop = std::min(tuned_l0_stop_trigger_ + 2, 2 * base_stop);
+    if (new_buffer != tuned_write_buffer_size_ ||
+        new_slowdown != tuned_l0_slowdown_trigger_) {
+      tuned_write_buffer_size_ = new_buffer;
+      tuned_l0_slowdown_trigger_ = new_slowdown;
+      tuned_l0_stop_trigger_ = new_stop;
+      Log(options_.info_log,
+          "Adaptive tuning up: write_buffer=%zu l0_slowdown=%d l0_stop=%d "
+          "(stalled %llu us)",
+          tuned_write_buffer_size_, tuned_l0_slowdown_trigger_,
+          tuned_l0_stop_trigger_, static_cast<unsigned long long>(stalled));
+    }
+  } else if (stalled == 0) {
+    // A calm window: decay toward the configured floor so a quiet
+    // workload is not stuck with crisis-sized memtables.
+    const size_t new_buffer =
+        std::max(tuned_write_buffer_size_ * 3 / 4, base_buffer);
+    const int new_slowdown =
+        std::max(tuned_l0_slowdown_trigger_ - 1, base_slowdown);
+    const int new_stop = std::max(tuned_l0_stop_trigger_ - 1, base_stop);
+    if (new_buffer != tuned_write_buffer_size_ ||
+        new_slowdown != tuned_l0_slowdown_trigger_) {
+      tuned_write_buffer_size_ = new_buffer;
+      tuned_l0_slowdown_trigger_ = new_slowdown;
+      tuned_l0_stop_trigger_ = new_stop;
+      Log(options_.info_log,
+          "Adaptive tuning down: write_buffer=%zu l0_slowdown=%d l0_stop=%d",
+          tuned_write_buffer_size_, tuned_l0_slowdown_trigger_,
+          tuned_l0_stop_trigger_);
+    }
+  }
+}
+
+Status DBImpl::SetOptions(
+    const std::map<std::string, std::string>& new_options) {
+  // Validate everything before changing anything.
+  std::map<std::string, uint64_t> parsed;
+  for (std::map<std::string, std::string>::const_iterator it =
+           new_options.begin();
+       it != new_options.end(); ++it) {
+    if (it->first != "write_buffer_size" && it->first != "max_file_size" &&
+        it->first != "l0_compaction_trigger" &&
+        it->first != "l0_slowdown_writes_trigger" &&
+        it->first != "l0_stop_writes_trigger") {
+      return Status::InvalidArgument("unknown option: " + it->first);
+    }
+    char* end = nullptr;
+    const unsigned long long value =
+        std::strtoull(it->second.c_str(), &end, 10);
+    if (end == it->second.c_str() || *end != '\0' || value == 0) {
+      return Status::InvalidArgument("bad value for " + it->first + ": " +
+                                     it->second);
+    }
+    parsed[it->first] = value;
+  }
+
+  MutexLock l(&mutex_);
+  for (std::map<std::string, uint64_t>::const_iterator it = parsed.begin();
+       it != parsed.end(); ++it) {
+    if (it->first == "write_buffer_size") {
+      options_.write_buffer_size = static_cast<size_t>(it->second);
+      tuned_write_buffer_size_ = options_.write_buffer_size;
+    } else if (it->first == "max_file_size") {
+      options_.max_file_size = static_cast<size_t>(it->second);
+    } else if (it->first == "l0_compaction_trigger") {
+      options_.l0_compaction_trigger = static_cast<int>(it->second);
+    } else if (it->first == "l0_slowdown_writes_trigger") {
+      options_.l0_slowdown_writes_trigger = static_cast<int>(it->second);
+      tuned_l0_slowdown_trigger_ = options_.l0_slowdown_writes_trigger;
+    } else if (it->first == "l0_stop_writes_trigger") {
+      options_.l0_stop_writes_trigger = static_cast<int>(it->second);
+      tuned_l0_stop_trigger_ = options_.l0_stop_writes_trigger;
+    }
+    Log(options_.info_log, "SetOptions: %s = %llu", it->first.c_str(),
+        static_cast<unsigned long long>(it->second));
+  }
+  return Status::OK();
+}
+
+uint64_t DBImpl::TrackedMemoryUsage() {
+  mutex_.AssertHeld();
+  uint64_t usage = 0;
+  if (mem_ != nullptr) {
+    usage += mem_->ApproximateMemoryUsage();
+  }
+  for (size_t i = 0; i < imms_.size(); i++) {
+    usage += imms_[i].mem->ApproximateMemoryUsage();
+  }
+  if (options_.block_cache != nullptr) {
+    usage += options_.block_cache->TotalCharge();
+  }
+  if (options_.compressed_block_cache != nullptr) {
+    usage += options_.compressed_block_cache->TotalCharge();
+  }
+  return usage;
+}
+
+bool DBImpl::EnforceMemoryBudget() {
+  mutex_.AssertHeld();
+  // The full accounting walks the caches' shards; do it at most every
+  // 100ms rather than on every write.
+  const uint64_t now = env_->NowMicros();
+  if (now < last_budget_check_micros_ + 100 * 1000) {
+    return false;
+  }
+  last_budget_check_micros_ = now;
+  const uint64_t budget = options_.total_memory_budget;
+  uint64_t usage = TrackedMemoryUsage();
+  if (usage <= budget) {
+    return false;
+  }
+
+  // Shed reclaimable memory first: unpinned cache entries.
+  mutex_.Unlock();
+  if (options_.block_cache != nullptr) {
+    options_.block_cache->Prune();
+  }
+  if (options_.compressed_block_cache != nullptr) {
+    options_.compressed_block_cache->Prune();
+  }
+  mutex_.Lock();
+
+  usage = TrackedMemoryUsage();
+  if (usage <= budget) {
+    return false;
+  }
+  // Still over: flush only if the active memtable is carrying enough
+  // data for a flush to matter, and the immutable queue has room.
+  const bool can_flush =
+      mem_ != nullptr &&
+      mem_->ApproximateMemoryUsage() > options_.write_buffer_size / 4 &&
+      imms_.size() <
+          static_cast<size_t>(options_.max_immutable_memtables);
+  if (can_flush) {
+    Log(options_.info_log,
+        "Memory budget exceeded (%llu > %llu); flushing memtable early",
+        static_cast<unsigned long long>(usage),
+        static_cast<unsigned long long>(budget));
+  }
+  return can_flush;
+}
+
+void DBImpl::BGWalSync(void* db) {
+  reinterpret_cast<DBImpl*>(db)->WalSyncWork();
+}
+
+void DBImpl::WalSyncWork() {
+  MutexLock l(&mutex_);
+  while (!shutting_down_.load(std::memory_order_acquire)) {
+    // Sleep out the interval in short hops so shutdown is prompt.
+    uint64_t remaining = options_.wal_sync_interval_micros;
+    while (remaining > 0 && !shutting_down_.load(std::memory_order_acquire)) {
+      const uint64_t hop = remaining < 100000 ? remaining : 100000;
+      mutex_.Unlock();
+      env_->SleepForMicroseconds(static_cast<int>(hop));
+      mutex_.Lock();
+      remaining -= hop;
+    }
+    if (shutting_down_.load(std::memory_order_acquire)) {
+      break;
+    }
+    if (log_synced_epoch_ >= log_appended_epoch_ || logfile_ == nullptr ||
+        log_sync_in_progress_) {
+      // Nothing new, or a sync writer / rotation already has the baton.
+      continue;
+    }
+    log_sync_in_progress_ = true;
+    const uint64_t target = log_appended_epoch_;
+    const uint64_t target_sequence = log_appended_sequence_;
+    WritableFile* logfile = logfile_;
+    mutex_.Unlock();
+    Status s = logfile->Sync();
+    mutex_.Lock();
+    log_sync_in_progress_ = false;
+    if (s.ok()) {
+      if (target > log_synced_epoch_) {
+        log_synced_epoch_ = target;
+      }
+      if (target_sequence > last_durable_sequence_) {
+        last_durable_sequence_ = target_sequence;
+      }
+    } else {
+      RecordBackgroundError(s);
+    }
+    sync_done_signal_.SignalAll();
+  }
+  wal_syncer_running_ = false;
+  background_work_finished_signal_.SignalAll();
+}
+
+// Pop a parked log file name for reuse, or the empty string.
+std::string DBImpl::PopRecycledLog() {
+  mutex_.AssertHeld();
+  if (recycled_log_pool_.empty()) {
+    return std::string();
+  }
+  std::string name = recycled_log_pool_.front();
+  recycled_log_pool_.pop_front();
+  return name;
+}
+
+// Create the log segment for "number", reusing the parked file
+// "recycled" (from PopRecycledLog()) when non-empty.  Does not touch
+// mutex_-guarded state, so callers may hold or not hold the mutex.
+Status DBImpl::NewLogSegment(uint64_t number, const std::string& recycled,
+                             WritableFile** file) {
+  const std::string fname = LogFileName(dbname_, number);
+  if (!recycled.empty()) {
+    Status s = env_->ReuseWritableFile(fname, dbname_ + "/" + recycled, file);
+    if (s.ok()) {
+      return s;
+    }
+    // Fall through to a fresh file; the pooled one is gone either way.
+  }
+  Status s = env_->NewWritableFile(fname, file);
+  if (s.ok() && options_.recycle_log_files > 0) {
+    (*file)->Preallocate(options_.write_buffer_size);
+  }
+  return s;
+}
+
+void DBImpl::MaybePrepareLogFile() {
+  mutex_.AssertHeld();
+  if (preparing_logfile_ || prepared_logfile_ != nullptr || read_only_ ||
+      shutting_down_.load(std::memory_order_acquire)) {
+    return;
+  }
+  preparing_logfile_ = true;
+  env_->StartThread(&DBImpl::BGPrepareLogFile, this);
+}
+
+void DBImpl::BGPrepareLogFile(void* db) {
+  reinterpret_cast<DBImpl*>(db)->PrepareLogFileWork();
+}
+
+void DBImpl::PrepareLogFileWork() {
+  mutex_.Lock();
+  const uint64_t number = versions_->NewFileNumber();
+  mutex_.Unlock();
+
+  mutex_.Lock();
+  const std::string recycled = PopRecycledLog();
+  mutex_.Unlock();
+
+  WritableFile* file = nullptr;
+  const std::string fname = LogFileName(dbname_, number);
+  Status s = NewLogSegment(number, recycled, &file);
+
+  mutex_.Lock();
+  if (s.ok() && !shutting_down_.load(std::memory_order_acquire) &&
+      number > logfile_number_) {
+    prepared_logfile_ = file;
+    prepared_logfile_number_ = number;
+  } else if (s.ok()) {
+    // Shutting down, or a rotation could not wait for us and created a
+    // newer segment synchronously (log numbers must only move forward).
+    delete file;
+    env_->RemoveFile(fname);
+  }
+  // Creation failures are not errors here: rotation simply falls back
+  // to creating the file synchronously and surfaces the failure there.
+  preparing_logfile_ = false;
+  background_work_finished_signal_.SignalAll();
+  mutex_.Unlock();
+}
+
+bool DBImpl::GetProperty(const Slice& property, std::string* value) {
+  value->clear();
+
+  MutexLock l(&mutex_);
+  Slice in = property;
+  Slice prefix("leveldb.");
+  if (!in.starts_with(prefix)) return false;
+  in.remove_prefix(prefix.size());
+
+  if (in.starts_with("num-files-at-level")) {
+    in.remove_prefix(strlen("num-files-at-level"));
+    uint64_t level;
+    bool ok = ConsumeDecimalNumber(&in, &level) && in.empty();
+    if (!ok || level >= config::kNumLevels) {
+      return false;
+    } else {
+      char buf[100];
+      std::snprintf(buf, sizeof(buf), "%d",
+                    versions_->NumLevelFiles(static_cast<int>(level)));
+      *value = buf;
+      return true;
+    }
+  } else if (in == "stats") {
+    char buf[200];
+    std::snprintf(buf, sizeof(buf),
+                  "                               Compactions\n"
+                  "Level  Files Size(MB) Time(sec) Read(MB) Write(MB)\n"
+                  "--------------------------------------------------\n");
+    value->append(buf);
+    for (int level = 0; level < config::kNumLevels; level++) {
+      int files = versions_->NumLevelFiles(level);
+      if (stats_[level].micros > 0 || files > 0) {
+        std::snprintf(buf, sizeof(buf), "%3d %8d %8.0f %9.0f %8.0f %9.0f\n",
+                      level, files, versions_->NumLevelBytes(level) / 1048576.0,
+                      stats_[level].micros / 1e6,
+                      stats_[level].bytes_read / 1048576.0,
+                      stats_[level].bytes_written / 1048576.0);
+        value->append(buf);
+      }
+    }
+    return true;
+  } else if (in == "io-stats") {
+    return GetEnvIOStats(env_, value);
+  } else if (in == "trace-spans") {
+    SpanRecorder::Global()->Dump(value);
+    return true;
+  } else if (in == "space-amp") {
+    // Estimate dead bytes from per-file properties plus key-range
+    // overlap between levels: entries in an upper level whose range
+    // overlaps a deeper level are assumed to shadow same-sized data
+    // below, and deletion markers are pure garbage plus whatever they
+    // hide.  A coarse model, but far better than assuming 2x.
+    Version* current = versions_->current();
+    current->Ref();
+    uint64_t total_bytes = 0;
+    uint64_t dead_bytes = 0;
+    char buf[200];
+    value->append("Level  Files    Bytes     Entries   Deletions  Overlap%\n");
+    std::vector<FileMetaData*> level_files[config::kNumLevels];
+    int bottom = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      current->GetOverlappingInputs(level, nullptr, nullptr,
+                                    &level_files[level]);
+      if (!level_files[level].empty()) bottom = level;
+    }
+    for (int level = 0; level < config::kNumLevels; level++) {
+      const std::vector<FileMetaData*>& files = level_files[level];
+      if (files.empty()) continue;
+      uint64_t bytes = 0, entries = 0, deletions = 0, raw = 0;
+      uint64_t overlapping_bytes = 0;
+      for (size_t i = 0; i < files.size(); i++) {
+        FileMetaData* f = files[i];
+        bytes += f->file_size;
+        TableProperties props;
+        mutex_.Unlock();
+        Status ps =
+            table_cache_->GetTableProperties(f->number, f->file_size, &props);
+        mutex_.Lock();
+        if (ps.ok()) {
+          entries += props.num_entries;
+          deletions += props.num_deletions;
+          raw += props.raw_key_bytes + props.raw_value_bytes;
+        }
+        // Does this file's range overlap anything deeper?
+        bool overlaps = false;
+        for (int deeper = level + 1;
+             !overlaps && deeper < config::kNumLevels; deeper++) {
+          std::vector<FileMetaData*> overlap;
+          current->GetOverlappingInputs(deeper, &f->smallest, &f->largest,
+                                        &overlap);
+          overlaps = !overlap.empty();
+        }
+        if (overlaps) overlapping_bytes += f->file_size;
+      }
+      total_bytes += bytes;
+      // Data in overlapping upper-level files shadows roughly its own
+      // size below; deletion markers additionally hide an entry of
+      // average size.
+      if (level < bottom) {
+        dead_bytes += overlapping_bytes;
+      }
+      if (entries > deletions && entries > 0) {
+        dead_bytes += deletions * (raw / entries);
+      }
+      std::snprintf(buf, sizeof(buf),
+                    "%-5d %6d %10llu %10llu %10llu %7.1f\n", level,
+                    static_cast<int>(files.size()),
+                    static_cast<unsigned long long>(bytes),
+                    static_cast<unsigned long long>(entries),
+                    static_cast<unsigned long long>(deletions),
+                    bytes > 0 ? 100.0 * overlapping_bytes / bytes : 0.0);
+      value->append(buf);
+    }
+    current->Unref();
+    if (dead_bytes > total_bytes) dead_bytes = total_bytes;
+    const uint64_t live = total_bytes - dead_bytes;
+    std::snprintf(buf, sizeof(buf),
+                  "total=%llu estimated-live=%llu estimated-space-amp=%.2f\n",
+                  static_cast<unsigned long long>(total_bytes),
+                  static_cast<unsigned long long>(live),
+                  live > 0 ? static_cast<double>(total_bytes) / live : 1.0);
+    value->append(buf);
+    return true;
+  } else if (in == "level-hits") {
+    uint64_t hits[config::kNumLevels];
+    uint64_t range_misses[config::kNumLevels];
+    versions_->GetLevelReadStats(hits, range_misses);
+    char buf[100];
+    std::snprintf(buf, sizeof(buf), "%-5s %12s %12s\n", "Level", "Hits",
+                  "RangeSkips");
+    value->append(buf);
+    for (int level = 0; level < config::kNumLevels; level++) {
+      std::snprintf(buf, sizeof(buf), "%-5d %12llu %12llu\n", level,
+                    static_cast<unsigned long long>(hits[level]),
+                    static_cast<unsigned long long>(range_misses[level]));
+      value->append(buf);
+    }
+    return true;
+  } else if (in == "sstables") {
+    *value = versions_->current()->DebugString();
+    return true;
+  } else if (in.starts_with("latency.")) {
+    in.remove_prefix(strlen("latency."));
+    if (!options_.enable_latency_stats) {
+      value->append("(latency stats disabled)\n");
+      return true;
+    }
+    if (in == "get") {
+      value->append(get_latency_.ToString());
+      return true;
+    } else if (in == "write") {
+      value->append(write_latency_.ToString());
+      return true;
+    } else if (in == "seek") {
+      value->append(seek_latency_.ToString());
+      return true;
+    }
+    return false;
+  } else if (in == "counters") {
+    value->append(GetGlobalPerfCounters()->ToString());
+    return true;
+  } else if (in == "manual-compaction") {
+    if (manual_compaction_ == nullptr) {
+      value->append("(idle)\n");
+    } else {
+      char buf[200];
+      std::snprintf(buf, sizeof(buf), "level %d, %s, resume at %s\n",
+                    manual_compaction_->level,
+                    manual_compaction_->done ? "done" : "in progress",
+                    manual_compaction_->begin != nullptr
+                        ? manual_compaction_->begin->DebugString().c_str()
+                        : "(start)");
+      value->append(buf);
+    }
+    return true;
+  } else if (in == "hotkeys") {
+    std::string report = options_.block_cache->FrequencyReport();
+    if (report.empty()) {
+      report = "(hot-key tracking disabled)\n";
+    }
+    value->append(report);
+    return true;
+  } else if (in == "manifest-file-size") {
+    char buf[50];
+    std::snprintf(buf, sizeof(buf), "%llu",
+                  static_cast<unsigned long long>(
+                      versions_->ManifestFileSize()));
+    value->append(buf);
+    return true;
+  } else if (in == "rate-limiter") {
+    if (options_.rate_limiter == nullptr) {
+      value->append("(none)");
+    } else {
+      char buf[100];
+      std::snprintf(
+          buf, sizeof(buf), "flush: %lld bytes, compaction: %lld bytes\n",
+          static_cast<long long>(
+              options_.rate_limiter->TotalBytesThrough(RateLimiter::kFlush)),
+          static_cast<long long>(options_.rate_limiter->TotalBytesThrough(
+              RateLimiter::kCompaction)));
+      value->append(buf);
+    }
+    return true;
+  } else if (in == "last-durable-sequence") {
+    char buf[50];
+    std::snprintf(buf, sizeof(buf), "%llu",
+                  static_cast<unsigned long long>(last_durable_sequence_));
+    value->append(buf);
+    return true;
+  } else if (in == "memory-usage") {
+    uint64_t mem_bytes = mem_ != nullptr ? mem_->ApproximateMemoryUsage() : 0;
+    uint64_t imm_bytes = 0;
+    for (size_t i = 0; i < imms_.size(); i++) {
+      imm_bytes += imms_[i].mem->ApproximateMemoryUsage();
+    }
+    const uint64_t block_cache_bytes =
+        options_.block_cache != nullptr ? options_.block_cache->TotalCharge()
+                                        : 0;
+    const uint64_t compressed_cache_bytes =
+        options_.compressed_block_cache != nullptr
+            ? options_.compressed_block_cache->TotalCharge()
+            : 0;
+    char buf[200];
+    std::snprintf(
+        buf, sizeof(buf),
+        "memtable=%llu immutable=%llu block-cache=%llu "
+        "compressed-cache=%llu total=%llu budget=%llu\n",
+        static_cast<unsigned long long>(mem_bytes),
+        static_cast<unsigned long long>(imm_bytes),
+        static_cast<unsigned long long>(block_cache_bytes),
+        static_cast<unsigned long long>(compressed_cache_bytes),
+        static_cast<unsigned long long>(mem_bytes + imm_bytes +
+                                        block_cache_bytes +
+                                        compressed_cache_bytes),
+        static_cast<unsigned long long>(options_.total_memory_budget));
+    value->append(buf);
+    return true;
+  } else if (in == "approximate-memory-usage") {
+    size_t total_usage = options_.block_cache->TotalCharge();
+    if (mem_) {
+      total_usage += mem_->ApproximateMemoryUsage();
+    }
+    for (size_t i = 0; i < imms_.size(); i++) {
+      total_usage += imms_[i].mem->ApproximateMemoryUsage();
+    }
+    char buf[50];
+    std::snprintf(buf, sizeof(buf), "%llu",
+                  static_cast<unsigned long long>(total_usage));
+    value->append(buf);
+    return true;
+  }
+
+  return false;
+}
+
+namespace {
+
+// Shared state for the WarmTableCache() worker threads.
+struct TableWarmer {
+  TableCache* table_cache;
+  Env* env;
+  const std::string* dbname;
+  std::vector<uint64_t> files;
+  std::atomic<size_t> next;
+
+  port::Mutex mu;
+  port::CondVar cv;
+  int pending;
+
+  TableWarmer() : next(0), cv(&mu), pending(0) {}
+
+  static void Work(void* arg) {
+    TableWarmer* warmer = reinterpret_cast<TableWarmer*>(arg);
+    while (true) {
+      const size_t i = warmer->next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= warmer->files.size()) {
+        break;
+      }
+      const uint64_t number = warmer->files[i];
+      uint64_t file_size;
+      if (warmer->env
+              ->GetFileSize(TableFileName(*warmer->dbname, number), &file_size)
+              .ok()) {
+        warmer->table_cache->WarmTable(number, file_size);
+      }
+    }
+    warmer->mu.Lock();
+    warmer->pending--;
+    warmer->cv.SignalAll();
+    warmer->mu.Unlock();
+  }
+};
+
+}  // namespace
+
+void DBImpl::WarmTableCache() {
+  TableWarmer warmer;
+  warmer.table_cache = table_cache_;
+  warmer.env = env_;
+  warmer.dbname = &dbname_;
+  {
+    MutexLock l(&mutex_);
+    std::set<uint64_t> live;
+    versions_->AddLiveFiles(&live);
+    warmer.files.assign(live.begin(), live.end());
+  }
+  if (warmer.files.empty()) {
+    return;
+  }
+
+  const int threads =
+      static_cast<int>(std::min<size_t>(8, warmer.files.size()));
+  warmer.pending = threads;
+  for (int i = 0; i < threads; i++) {
+    env_->StartThread(&TableWarmer::Work, &warmer);
+  }
+  warmer.mu.Lock();
+  while (warmer.pending > 0) {
+    warmer.cv.Wait();
+  }
+  warmer.mu.Unlock();
+  Log(options_.info_log, "Warmed table cache with %d files",
+      static_cast<int>(warmer.files.size()));
+}
+
+namespace {
+// ApplyToAll context for SaveCacheCensus: resolves block-cache keys
+// (cache id, offset) back to table file numbers.
+struct CacheCensus {
+  std::map<uint64_t, uint64_t> cache_id_to_file;
+  std::string encoded;  // varint (file, offset) pairs
+  size_t blocks = 0;
+
+  static void Visit(const Slice& key, void* value, void* arg) {
+    (void)value;
+    if (key.size() != 16) {
+      return;  // Not a block key (e.g. a table-cache entry).
+    }
+    CacheCensus* census = reinterpret_cast<CacheCensus*>(arg);
+    const uint64_t cache_id = DecodeFixed64(key.data());
+    const std::map<uint64_t, uint64_t>::const_iterator it =
+        census->cache_id_to_file.find(cache_id);
+    if (it == census->cache_id_to_file.end()) {
+      return;  // Block from another database sharing the cache.
+    }
+    PutVarint64(&census->encoded, it->second);
+    PutVarint64(&census->encoded, DecodeFixed64(key.data() + 8));
+    census->blocks++;
+  }
+};
+}  // namespace
+
+Status DBImpl::SaveCacheCensus() {
+  if (options_.block_cache == nullptr) {
+    return Status::NotSupported("no block cache configured");
+  }
+  CacheCensus census;
+  table_cache_->GetOpenTables(&census.cache_id_to_file);
+  options_.block_cache->ApplyToAll(&CacheCensus::Visit, &census);
+
+  const std::string fname = dbname_ + "/CACHE_CENSUS";
+  Status s = WriteStringToFile(env_, census.encoded, fname);
+  if (s.ok()) {
+    Log(options_.info_log, "Saved cache census: %d blocks",
+        static_cast<int>(census.blocks));
+  } else {
+    env_->RemoveFile(fname);
+  }
+  return s;
+}
+
+void DBImpl::LoadCacheCensus() {
+  const std::string fname = dbname_ + "/CACHE_CENSUS";
+  std::string contents;
+  if (!ReadFileToString(env_, fname, &contents).ok()) {
+    return;  // No census from a previous run; nothing to warm.
+  }
+
+  // Group the census by file so each table's index is walked once.
+  std::map<uint64_t, std::vector<uint64_t>> wanted;
+  Slice input(contents);
+  uint64_t file, offset;
+  while (GetVarint64(&input, &file) && GetVarint64(&input, &offset)) {
+    wanted[file].push_back(offset);
+  }
+
+  // The census may mention files that a compaction has since deleted.
+  std::set<uint64_t> live;
+  {
+    MutexLock l(&mutex_);
+    versions_->AddLiveFiles(&live);
+  }
+
+  size_t blocks = 0;
+  for (std::map<uint64_t, std::vector<uint64_t>>::iterator it = wanted.begin();
+       it != wanted.end(); ++it) {
+    if (live.count(it->first) == 0) {
+      continue;
+    }
+    uint64_t file_size;
+    if (!env_->GetFileSize(TableFileName(dbname_, it->first), &file_size)
+             .ok() &&
+        !env_->GetFileSize(SSTTableFileName(dbname_, it->first), &file_size)
+             .ok()) {
+      continue;
+    }
+    std::sort(it->second.begin(), it->second.end());
+    blocks += it->second.size();
+    table_cache_->WarmBlocks(it->first, file_size, it->second);
+  }
+  Log(options_.info_log, "Loaded cache census: %d blocks from %d files",
+      static_cast<int>(blocks), static_cast<int>(wanted.size()));
+}
+
+// Shared state for the BulkLoad() worker threads.  Chunks are built
+// into tables concurrently; results are installed in chunk order.
+struct BulkLoadWork {
+  DBImpl* db;
+  std::vector<std::pair<std::string, std::string>> entries;
+  uint64_t file_number;
+  size_t index;
+  FileMetaData meta;
+  Status status;
+  BulkLoadWork* next = nullptr;  // Retirement list
+};
+
+struct BulkLoadShared {
+  port::Mutex mu;
+  port::CondVar cv;
+  int active = 0;
+  BulkLoadShared() : cv(&mu) {}
+};
+
+void DBImpl::BulkLoadChunk(void* arg) {
+  BulkLoadWork* work = reinterpret_cast<BulkLoadWork*>(arg);
+  DBImpl* db = work->db;
+  const std::string fname = TableFileName(db->dbname_, work->file_number);
+  WritableFile* file = nullptr;
+  Status s = db->env_->NewWritableFile(fname, &file);
+  if (s.ok()) {
+    file->HintStreamingWrites(4 << 20);
+    Options build_options = db->options_;
+    build_options.compression =
+        db->CompressionForLevel(config::kNumLevels - 1);
+    build_options.block_size = db->BlockSizeForLevel(config::kNumLevels - 1);
+    TableBuilder builder(build_options, file);
+    std::string ikey;
+    for (size_t i = 0; i < work->entries.size(); i++) {
+      ikey.clear();
+      AppendInternalKey(&ikey, ParsedInternalKey(work->entries[i].first,
+                                                 0, kTypeValue));
+      builder.Add(Slice(ikey), Slice(work->entries[i].second));
+    }
+    s = builder.Finish();
+    if (s.ok()) {
+      work->meta.number = work->file_number;
+      work->meta.file_size = builder.FileSize();
+      ikey.clear();
+      AppendInternalKey(&ikey, ParsedInternalKey(work->entries.front().first,
+                                                 0, kTypeValue));
+      work->meta.smallest.DecodeFrom(Slice(ikey));
+      ikey.clear();
+      AppendInternalKey(&ikey, ParsedInternalKey(work->entries.back().first,
+                                                 0, kTypeValue));
+      work->meta.largest.DecodeFrom(Slice(ikey));
+    }
+    if (s.ok()) s = file->Sync();
+    if (s.ok()) s = file->Close();
+    delete file;
+    if (!s.ok()) {
+      db->env_->RemoveFile(fname);
+    }
+  }
+  work->status = s;
+}
+
+namespace {
+struct BulkWorkerArgs {
+  void (*fn)(void*);
+  void* arg;
+  BulkLoadShared* shared;
+};
+void BulkWorkerEntry(void* varg) {
+  BulkWorkerArgs* args = reinterpret_cast<BulkWorkerArgs*>(varg);
+  args->fn(args->arg);
+  args->shared->mu.Lock();
+  args->shared->active--;
+  args->shared->cv.SignalAll();
+  args->shared->mu.Unlock();
+  delete args;
+}
+}  // namespace
+
+Status DBImpl::BulkLoad(Iterator* input) {
+  if (read_only_) {
+    return Status::NotSupported("DB is open as a read-only secondary");
+  }
+  const int max_workers =
+      options_.max_subcompactions > 1 ? options_.max_subcompactions : 4;
+  BulkLoadShared shared;
+  std::vector<BulkLoadWork*> chunks;
+  Status s;
+
+  // Cut the stream into chunks and hand each to a builder thread.
+  input->SeekToFirst();
+  BulkLoadWork* current = nullptr;
+  size_t chunk_bytes = 0;
+  const Comparator* ucmp = user_comparator();
+  std::string last_key;
+  bool have_last_key = false;
+  while (s.ok() && input->Valid()) {
+    if (have_last_key && ucmp->Compare(input->key(), Slice(last_key)) <= 0) {
+      s = Status::InvalidArgument("bulk-load input is not strictly sorted");
+      break;
+    }
+    last_key.assign(input->key().data(), input->key().size());
+    have_last_key = true;
+    if (current == nullptr) {
+      current = new BulkLoadWork;
+      current->db = this;
+      current->index = chunks.size();
+      {
+        MutexLock l(&mutex_);
+        current->file_number = versions_->NewFileNumber();
+        pending_outputs_.insert(current->file_number);
+      }
+      chunk_bytes = 0;
+    }
+    current->entries.emplace_back(input->key().ToString(),
+                                  input->value().ToString());
+    chunk_bytes += input->key().size() + input->value().size();
+    input->Next();
+    if (chunk_bytes >= options_.max_file_size || !input->Valid()) {
+      chunks.push_back(current);
+      shared.mu.Lock();
+      while (shared.active >= max_workers) {
+        shared.cv.Wait();
+      }
+      shared.active++;
+      shared.mu.Unlock();
+      BulkWorkerArgs* args = new BulkWorkerArgs;
+      args->fn = &DBImpl::BulkLoadChunk;
+      args->arg = current;
+      args->shared = &shared;
+      env_->StartThread(&BulkWorkerEntry, args);
+      current = nullptr;
+    }
+  }
+  delete current;  // Unsubmitted partial chunk on error
+  if (s.ok()) {
+    s = input->status();
+  }
+
+  // Wait for the builders.
+  shared.mu.Lock();
+  while (shared.active > 0) {
+    shared.cv.Wait();
+  }
+  shared.mu.Unlock();
+
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (s.ok() && !chunks[i]->status.ok()) {
+      s = chunks[i]->status;
+    }
+  }
+
+  if (s.ok() && !chunks.empty()) {
+    MutexLock l(&mutex_);
+    Version* base = versions_->current();
+    VersionEdit edit;
+    for (size_t i = 0; i < chunks.size(); i++) {
+      FileMetaData* meta = &chunks[i]->meta;
+      // Deepest level where the file overlaps nothing; level 0
+      // tolerates overlap if everything else does.
+      const Slice smallest_user_key = meta->smallest.user_key();
+      const Slice largest_user_key = meta->largest.user_key();
+      int level = config::kNumLevels - 1;
+      while (level > 0 && base->OverlapInLevel(level, &smallest_user_key,
+                                               &largest_user_key)) {
+        level--;
+      }
+      edit.AddFile(level, meta->number, meta->file_size, meta->smallest,
+                   meta->largest);
+    }
+    s = InstallVersionEdit(&edit);
+    if (s.ok()) {
+      RefreshReadState();
+      // Loaded entries carry sequence zero; only proofs made after
+      // this point may trust a cached absence.
+      InvalidateNegativeCache(versions_->LastSequence() + 1);
+    }
+  }
+
+  {
+    MutexLock l(&mutex_);
+    for (size_t i = 0; i < chunks.size(); i++) {
+      pending_outputs_.erase(chunks[i]->file_number);
+    }
+  }
+  if (!s.ok()) {
+    for (size_t i = 0; i < chunks.size(); i++) {
+      env_->RemoveFile(TableFileName(dbname_, chunks[i]->file_number));
+    }
+  }
+  for (size_t i = 0; i < chunks.size(); i++) {
+    delete chunks[i];
+  }
+  Log(options_.info_log, "Bulk load: %d files, %s",
+      static_cast<int>(chunks.size()), s.ToString().c_str());
+  return s;
+}
+
+// Invalidate every cached absence proven before "min_valid_seq":
+// non-memtable installs (ingest, bulk load) bypass MemTable::Add and
+// its per-key stamps, so they must raise the global stamp instead.
+void DBImpl::InvalidateNegativeCache(uint64_t min_valid_seq) {
+  if (negative_cache_ == nullptr) {
+    return;
+  }
+  uint64_t current =
+      negative_stamps_.range_stamp.load(std::memory_order_relaxed);
+  while (current < min_valid_seq &&
+         !negative_stamps_.range_stamp.compare_exchange_weak(
+             current, min_valid_seq, std::memory_order_release)) {
+  }
+}
+
+Status DBImpl::IngestExternalFile(const std::string& file) {
+  if (read_only_) {
+    return Status::NotSupported("DB is open as a read-only secondary");
+  }
+  // Open the source file with the user comparator; the public
+  // TableBuilder stores raw user keys.
+  RandomAccessFile* src_file = nullptr;
+  uint64_t src_size = 0;
+  Status s = env_->GetFileSize(file, &src_size);
+  if (s.ok()) {
+    s = env_->NewRandomAccessFile(file, &src_file);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  Options src_options = options_;
+  src_options.comparator = user_comparator();
+  src_options.filter_policy = nullptr;
+  Table* table = nullptr;
+  s = Table::Open(src_options, src_file, src_size, &table);
+  if (!s.ok()) {
+    delete src_file;
+    return s;
+  }
+
+  // Flush buffered updates first.  Entries already in the memtable are
+  // older than the ingested data but would otherwise be consulted
+  // before it, and flushing now also guarantees any overlapping
+  // level-0 file has a smaller file number than the ingested table.
+  s = Write(WriteOptions(), nullptr);
+  if (s.ok()) {
+    MutexLock l(&mutex_);
+    while (!imms_.empty() && bg_error_.ok()) {
+      background_work_finished_signal_.Wait();
+    }
+    if (!imms_.empty()) {
+      s = bg_error_;
+    }
+  }
+  if (!s.ok()) {
+    delete table;
+    delete src_file;
+    return s;
+  }
+
+  // Allocate the output file number and the sequence number that
+  // stamps every ingested entry.
+  mutex_.Lock();
+  const uint64_t file_number = versions_->NewFileNumber();
+  pending_outputs_.insert(file_number);
+  if (last_allocated_sequence_ < versions_->LastSequence()) {
+    last_allocated_sequence_ = versions_->LastSequence();
+  }
+  const SequenceNumber sequence = ++last_allocated_sequence_;
+  mutex_.Unlock();
+
+  // Rewrite the entries as internal keys stamped with "sequence".
+  FileMetaData meta;
+  meta.number = file_number;
+  const std::string fname = TableFileName(dbname_, file_number);
+  WritableFile* outfile = nullptr;
+  s = env_->NewWritableFile(fname, &outfile);
+  if (s.ok()) {
+    TableBuilder* builder = new TableBuilder(options_, outfile);
+    Iterator* iter = table->NewIterator(ReadOptions());
+    bool first = true;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      InternalKey ikey(iter->key(), sequence, kTypeValue);
+      if (first) {
+        meta.smallest = ikey;
+        first = false;
+      }
+      meta.largest = ikey;
+      builder->Add(ikey.Encode(), iter->value());
+    }
+    s = iter->status();
+    delete iter;
+    if (s.ok() && builder->NumEntries() == 0) {
+      s = Status::InvalidArgument(file, "has no entries");
+    }
+    if (s.ok()) {
+      s = builder->Finish();
+      meta.file_size = builder->FileSize();
+    } else {
+      builder->Abandon();
+    }
+    delete builder;
+    if (s.ok()) {
+      s = outfile->Sync();
+    }
+    if (s.ok()) {
+      s = outfile->Close();
+    }
+    delete outfile;
+  }
+  delete table;
+  delete src_file;
+
+  mutex_.Lock();
+  // Publish the sequence number in allocation order, as the write
+  // pipeline does, even on failure, so later groups are not blocked.
+  while (versions_->LastSequence() != sequence - 1) {
+    apply_done_signal_.Wait();
+  }
+  versions_->SetLastSequence(sequence);
+  apply_done_signal_.SignalAll();
+
+  if (s.ok()) {
+    Version* base = versions_->current();
+    base->Ref();
+    const int level = base->PickLevelForMemTableOutput(
+        meta.smallest.user_key(), meta.largest.user_key());
+    base->Unref();
+    VersionEdit edit;
+    edit.AddFile(level, meta.number, meta.file_size, meta.smallest,
+                 meta.largest);
+    s = InstallVersionEdit(&edit);
+    if (s.ok()) {
+      // The ingested keys exist as of "sequence"; absences proven
+      // before it are no longer trustworthy.
+      InvalidateNegativeCache(sequence);
+      Log(options_.info_log, "Ingested %s as table #%llu at level %d",
+          file.c_str(), static_cast<unsigned long long>(meta.number), level);
+    }
+  }
+  pending_outputs_.erase(file_number);
+  mutex_.Unlock();
+
+  if (!s.ok()) {
+    env_->RemoveFile(fname);
+  }
+  return s;
+}
+
+Status DBImpl::ReplayLogsReadOnly(VersionSet* vset, MemTable* mem,
+                                  bool* retry) {
+  mutex_.AssertHeld();
+  *retry = false;
+
+  std::vector<std::string> filenames;
+  Status s = env_->GetChildren(dbname_, &filenames);
+  if (!s.ok()) {
+    return s;
+  }
+  const uint64_t min_log = vset->LogNumber();
+  const uint64_t prev_log = vset->PrevLogNumber();
+  std::vector<uint64_t> logs;
+  uint64_t number;
+  FileType type;
+  for (size_t i = 0; i < filenames.size(); i++) {
+    if (ParseFileName(filenames[i], &number, &type) && type == kLogFile &&
+        ((number >= min_log) || (number == prev_log))) {
+      logs.push_back(number);
+    }
+  }
+  std::sort(logs.begin(), logs.end());
+
+  // Any tail corruption (a record being appended by the primary) just
+  // ends the replay for this round.
+  struct IgnoreErrorReporter : public log::Reader::Reporter {
+    void Corruption(size_t bytes, const Status& s) override {}
+  };
+  IgnoreErrorReporter reporter;
+
+  SequenceNumber max_sequence = vset->LastSequence();
+  for (size_t i = 0; s.ok() && i < logs.size(); i++) {
+    const std::string fname = LogFileName(dbname_, logs[i]);
+    SequentialFile* file;
+    Status open_status = env_->NewSequentialFile(fname, &file);
+    if (!open_status.ok()) {
+      // The primary flushed and removed this log after we listed the
+      // directory; our manifest view is stale.  Start over.
+      *retry = true;
+      return Status::OK();
+    }
+    log::Reader reader(file, &reporter, true /*checksum*/, 0,
+                       static_cast<uint32_t>(logs[i]));
+    std::string scratch;
+    Slice record;
+    WriteBatch batch;
+    while (reader.ReadRecord(&record, &scratch)) {
+      if (record.size() < 12) {
+        continue;
+      }
+      WriteBatchInternal::SetContents(&batch, record);
+      const SequenceNumber last_seq = WriteBatchInternal::Sequence(&batch) +
+                                      WriteBatchInternal::Count(&batch) - 1;
+      s = WriteBatchInternal::InsertInto(&batch, mem, &prepared_txns_);
       if (!s.ok()) {
-        // Avoid chewing through file number space in a tight loop.
-        versions_->ReuseFileNumber(new_log_number);
         break;
       }
+      if (last_seq > max_sequence) {
+        max_sequence = last_seq;
+      }
+    }
+    delete file;
+  }
+  if (s.ok() && vset->LastSequence() < max_sequence) {
+    vset->SetLastSequence(max_sequence);
+  }
+  return s;
+}
 
-      delete log_;
+Status DBImpl::TryCatchUpWithPrimary() {
+  if (!read_only_) {
+    return Status::NotSupported("DB is not open as a secondary");
+  }
 
-      s = logfile_->Close();
+  MutexLock l(&mutex_);
+  Status s;
+  for (int attempt = 0; attempt < 3; attempt++) {
+    VersionSet* fresh = new VersionSet(dbname_, &options_, table_cache_,
+                                       &internal_comparator_);
+    bool save_manifest;  // Ignored; secondaries never write the manifest.
+    s = fresh->Recover(&save_manifest);
+    if (!s.ok()) {
+      delete fresh;
+      return s;
+    }
+    MemTable* mem = new MemTable(internal_comparator_, arena_pool_, options_.memtable_hash_index, options_.value_checksums, &negative_stamps_, options_.memtable_compression);
+    mem->Ref();
+    bool retry = false;
+    s = ReplayLogsReadOnly(fresh, mem, &retry);
+    if (!s.ok() || retry) {
+      mem->Unref();
+      delete fresh;
       if (!s.ok()) {
-        // We may have lost some data written to the previous log file.
-        // Switch to the new log file anyway, but record as a background
-        // error so we do not attempt any more writes.
-        //
-        // We could perhaps attempt to save the memtable corresponding
-        // to log file and suppress the error if that works, but that
-        // would add more complexity in a critical code path.
-        RecordBackgroundError(s);
+        return s;
       }
-      delete logfile_;
+      continue;  // A log vanished mid-replay; re-read the manifest.
+    }
 
-      logfile_ = lfile;
-      logfile_number_ = new_log_number;
-      log_ = new log::Writer(lfile);
-      imm_ = mem_;
-      has_imm_.store(true, std::memory_order_release);
-      mem_ = new MemTable(internal_comparator_);
-      mem_->Ref();
-      force = false;  // Do not force another compaction if have room
-      MaybeScheduleCompaction();
+    // Swap in the new state; readers holding references to the old
+    // memtable and versions keep their snapshot.
+    if (mem_ != nullptr) {
+      mem_->Unref();
     }
+    mem_ = mem;
+    retired_version_sets_.push_back(versions_);
+    versions_ = fresh;
+    RefreshReadState();
+    return Status::OK();
+  }
+  return Status::IOError(dbname_, "could not catch up with primary");
+}
+
+Status DB::OpenAsSecondary(const Options& options, const std::string& dbname,
+                           DB** dbptr) {
+  *dbptr = nullptr;
+
+  DBImpl* impl = new DBImpl(options, dbname, true /*read_only*/);
+  Status s = impl->TryCatchUpWithPrimary();
+  if (s.ok()) {
+    *dbptr = impl;
+  } else {
+    delete impl;
   }
   return s;
 }
 
-bool DBImpl::GetProperty(const Slice& property, std::string* value) {
-  value->clear();
+Status DBImpl::ExportSnapshot(const Snapshot* snapshot, WritableFile* file) {
+  // The iterator pins the snapshot's version; levels below zero
+  // contribute concatenating (non-merging) iterators, so the export
+  // streams at close to sequential disk speed.
+  ReadOptions read_options;
+  read_options.snapshot = snapshot;
+  read_options.fill_cache = false;
+  Iterator* iter = NewIterator(read_options);
+
+  Options export_options = options_;
+  export_options.comparator = user_comparator();
+  export_options.filter_policy = nullptr;
+  export_options.block_hash_index = false;
+  export_options.blob_value_threshold = 0;
+  TableBuilder builder(export_options, file);
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    builder.Add(iter->key(), iter->value());
+  }
+  Status s = iter->status();
+  delete iter;
+  if (s.ok()) {
+    s = builder.Finish();
+  } else {
+    builder.Abandon();
+  }
+  if (s.ok()) {
+    s = file->Flush();
+  }
+  return s;
+}
 
-  MutexLock l(&mutex_);
-  Slice in = property;
-  Slice prefix("leveldb.");
-  if (!in.starts_with(prefix)) return false;
-  in.remove_prefix(prefix.size());
+Status DBImpl::StartTrace(WritableFile* file) {
+  MutexLock l(&trace_mutex_);
+  if (trace_file_ != nullptr) {
+    return Status::InvalidArgument("trace already active");
+  }
+  trace_file_ = file;
+  tracing_.store(true, std::memory_order_release);
+  return Status::OK();
+}
 
-  if (in.starts_with("num-files-at-level")) {
-    in.remove_prefix(strlen("num-files-at-level"));
-    uint64_t level;
-    bool ok = ConsumeDecimalNumber(&in, &level) && in.empty();
-    if (!ok || level >= config::kNumLevels) {
-      return false;
-    } else {
-      char buf[100];
-      std::snprintf(buf, sizeof(buf), "%d",
-                    versions_->NumLevelFiles(static_cast<int>(level)));
-      *value = buf;
-      return true;
+Status DBImpl::EndTrace() {
+  MutexLock l(&trace_mutex_);
+  if (trace_file_ == nullptr) {
+    return Status::InvalidArgument("no trace active");
+  }
+  tracing_.store(false, std::memory_order_release);
+  Status s = trace_file_->Flush();
+  trace_file_ = nullptr;
+  return s;
+}
+
+void DBImpl::TraceOperation(const char* op, const Slice& payload) {
+  // Format: "<micros> <op> <hex payload>\n", one record per line.
+  std::string line = NumberToString(env_->NowMicros());
+  line.push_back(' ');
+  line.append(op);
+  line.push_back(' ');
+  static const char kHex[] = "0123456789abcdef";
+  for (size_t i = 0; i < payload.size(); i++) {
+    const unsigned char c = payload[i];
+    line.push_back(kHex[c >> 4]);
+    line.push_back(kHex[c & 0xf]);
+  }
+  line.push_back('\n');
+  MutexLock l(&trace_mutex_);
+  if (trace_file_ != nullptr) {
+    trace_file_->Append(line);
+  }
+}
+
+Status DBImpl::ReadBlobValue(const Slice& handle, std::string* value) {
+  Slice input = handle;
+  uint64_t file_number, offset, size;
+  if (!GetVarint64(&input, &file_number) || !GetVarint64(&input, &offset) ||
+      !GetVarint64(&input, &size)) {
+    return Status::Corruption("bad blob handle");
+  }
+  RandomAccessFile* file = nullptr;
+  Status s =
+      env_->NewRandomAccessFile(BlobFileName(dbname_, file_number), &file);
+  if (!s.ok()) {
+    return s;
+  }
+  value->resize(size);
+  Slice result;
+  s = file->Read(offset, size, &result, &(*value)[0]);
+  if (s.ok() && result.size() != size) {
+    s = Status::Corruption("truncated blob read");
+  }
+  if (s.ok() && result.data() != value->data()) {
+    value->assign(result.data(), result.size());
+  }
+  delete file;
+  return s;
+}
+
+Status DBImpl::GarbageCollectBlobs() {
+  if (options_.blob_value_threshold == 0) {
+    return Status::OK();
+  }
+
+  // Collect the blob files referenced by any live table entry.  The
+  // internal iterator pins the memtables and current version, so
+  // concurrent compactions cannot retire entries under the scan, and
+  // blob files created by in-flight flushes share their table's number
+  // which is protected by pending_outputs_.
+  std::set<uint64_t> referenced;
+  SequenceNumber ignored;
+  uint32_t ignored_seed;
+  Iterator* iter =
+      NewInternalIterator(ReadOptions(), &ignored, &ignored_seed, nullptr);
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    if (ParseInternalKey(iter->key(), &ikey) &&
+        ikey.type == kTypeBlobHandle) {
+      Slice input = iter->value();
+      uint64_t file_number;
+      if (GetVarint64(&input, &file_number)) {
+        referenced.insert(file_number);
+      }
     }
-  } else if (in == "stats") {
-    char buf[200];
-    std::snprintf(buf, sizeof(buf),
-                  "                               Compactions\n"
-                  "Level  Files Size(MB) Time(sec) Read(MB) Write(MB)\n"
-                  "--------------------------------------------------\n");
-    value->append(buf);
-    for (int level = 0; level < config::kNumLevels; level++) {
-      int files = versions_->NumLevelFiles(level);
-      if (stats_[level].micros > 0 || files > 0) {
-        std::snprintf(buf, sizeof(buf), "%3d %8d %8.0f %9.0f %8.0f %9.0f\n",
-                      level, files, versions_->NumLevelBytes(level) / 1048576.0,
-                      stats_[level].micros / 1e6,
-                      stats_[level].bytes_read / 1048576.0,
-                      stats_[level].bytes_written / 1048576.0);
-        value->append(buf);
+  }
+  Status s = iter->status();
+  delete iter;
+  if (!s.ok()) {
+    return s;
+  }
+
+  std::vector<std::string> filenames;
+  env_->GetChildren(dbname_, &filenames);
+  uint64_t number;
+  FileType type;
+  int removed = 0;
+  {
+    MutexLock l(&mutex_);
+    for (size_t i = 0; i < filenames.size(); i++) {
+      if (ParseFileName(filenames[i], &number, &type) && type == kBlobFile &&
+          referenced.count(number) == 0 &&
+          pending_outputs_.count(number) == 0) {
+        env_->RemoveFile(dbname_ + "/" + filenames[i]);
+        removed++;
       }
     }
-    return true;
-  } else if (in == "sstables") {
-    *value = versions_->current()->DebugString();
-    return true;
-  } else if (in == "approximate-memory-usage") {
-    size_t total_usage = options_.block_cache->TotalCharge();
-    if (mem_) {
-      total_usage += mem_->ApproximateMemoryUsage();
+  }
+  Log(options_.info_log, "Blob GC removed %d files (%d referenced)", removed,
+      static_cast<int>(referenced.size()));
+  return Status::OK();
+}
+
+Status DBImpl::CreateCheckpoint(const std::string& dir) {
+  Status s = env_->CreateDir(dir);
+  if (!s.ok()) {
+    return s;
+  }
+
+  // Freeze the manifest state: block version installs while we pin the
+  // current version and write its snapshot, so the snapshot and the
+  // linked files agree.
+  mutex_.Lock();
+  while (manifest_write_in_progress_) {
+    background_work_finished_signal_.Wait();
+  }
+  manifest_write_in_progress_ = true;
+  Version* version = versions_->current();
+  version->Ref();
+  // Unflushed memtables live in older logs; the checkpoint needs them
+  // all, and its manifest must not cut them off.
+  std::set<uint64_t> log_numbers;
+  for (size_t i = 0; i < imms_.size(); i++) {
+    log_numbers.insert(imms_[i].log_number);
+  }
+  log_numbers.insert(logfile_number_);
+  const uint64_t log_number = *log_numbers.begin();
+  const uint64_t last_sequence = versions_->LastSequence();
+  const uint64_t next_file = versions_->NewFileNumber();
+  std::set<uint64_t> files;
+  versions_->AddCurrentFiles(&files);
+
+  // Write a fresh manifest describing the pinned version.
+  const std::string manifest = DescriptorFileName(dir, 1);
+  WritableFile* file = nullptr;
+  s = env_->NewWritableFile(manifest, &file);
+  if (s.ok()) {
+    log::Writer manifest_log(file);
+    s = versions_->WriteSnapshot(&manifest_log);
+    if (s.ok()) {
+      VersionEdit edit;
+      edit.SetLogNumber(log_number);
+      edit.SetPrevLogNumber(0);
+      edit.SetNextFile(next_file);
+      edit.SetLastSequence(last_sequence);
+      std::string record;
+      edit.EncodeTo(&record);
+      s = manifest_log.AddRecord(record);
     }
-    if (imm_) {
-      total_usage += imm_->ApproximateMemoryUsage();
+    if (s.ok()) {
+      s = file->Sync();
     }
-    char buf[50];
-    std::snprintf(buf, sizeof(buf), "%llu",
-                  static_cast<unsigned long long>(total_usage));
-    value->append(buf);
-    return true;
+    if (s.ok()) {
+      s = file->Close();
+    }
+    delete file;
   }
 
-  return false;
+  // Copy (not link) the live logs while installs are still blocked, so
+  // a finishing flush cannot delete an older log out from under us.
+  // The primary keeps appending to the newest log; a concurrently
+  // appended partial record at the end is dropped by recovery as usual.
+  mutex_.Unlock();
+  for (std::set<uint64_t>::iterator it = log_numbers.begin();
+       s.ok() && it != log_numbers.end(); ++it) {
+    s = env_->CopyFile(LogFileName(dbname_, *it), LogFileName(dir, *it));
+  }
+  mutex_.Lock();
+  manifest_write_in_progress_ = false;
+  background_work_finished_signal_.SignalAll();
+  mutex_.Unlock();
+
+  // The pinned version keeps these tables alive while we link them.
+  for (std::set<uint64_t>::iterator it = files.begin();
+       s.ok() && it != files.end(); ++it) {
+    s = env_->LinkFile(TableFileName(dbname_, *it), TableFileName(dir, *it));
+  }
+  if (s.ok()) {
+    s = SetCurrentFile(env_, dir, 1);
+  }
+
+  mutex_.Lock();
+  version->Unref();
+  mutex_.Unlock();
+
+  if (s.ok()) {
+    Log(options_.info_log, "Checkpoint created in %s (%d tables)",
+        dir.c_str(), static_cast<int>(files.size()));
+  }
+  return s;
+}
+
+void DBImpl::GetStats(DBStats* stats) {
+  *stats = DBStats();
+  MutexLock l(&mutex_);
+  stats->levels.resize(config::kNumLevels);
+  for (int level = 0; level < config::kNumLevels; level++) {
+    DBStats::LevelStats* s = &stats->levels[level];
+    s->files = versions_->NumLevelFiles(level);
+    s->bytes = versions_->NumLevelBytes(level);
+    s->compaction_micros = stats_[level].micros;
+    s->bytes_read = stats_[level].bytes_read;
+    s->bytes_written = stats_[level].bytes_written;
+  }
+  stats->write_slowdown_micros = write_slowdown_micros_;
+  stats->write_stall_micros = write_stall_micros_;
 }
 
 void DBImpl::GetApproximateSizes(const Range* range, int n, uint64_t* sizes) {
@@ -1483,6 +5223,32 @@ void DBImpl::GetApproximateSizes(const Range* range, int n, uint64_t* sizes) {
   v->Unref();
 }
 
+void DBImpl::GetApproximateStats(const Range& range, RangeStats* stats) {
+  *stats = RangeStats();
+  stats->level_bytes.resize(config::kNumLevels, 0);
+
+  MutexLock l(&mutex_);
+  Version* v = versions_->current();
+  v->Ref();
+
+  InternalKey k1(range.start, kMaxSequenceNumber, kValueTypeForSeek);
+  InternalKey k2(range.limit, kMaxSequenceNumber, kValueTypeForSeek);
+  const uint64_t start = versions_->ApproximateOffsetOf(v, k1);
+  const uint64_t limit = versions_->ApproximateOffsetOf(v, k2);
+  stats->bytes = (limit >= start ? limit - start : 0);
+
+  for (int level = 0; level < config::kNumLevels; level++) {
+    std::vector<FileMetaData*> overlaps;
+    v->GetOverlappingInputs(level, &k1, &k2, &overlaps);
+    stats->files += static_cast<int>(overlaps.size());
+    for (size_t i = 0; i < overlaps.size(); i++) {
+      stats->level_bytes[level] += overlaps[i]->file_size;
+    }
+  }
+
+  v->Unref();
+}
+
 // Default implementations of convenience methods that subclasses of DB
 // can call if they wish
 Status DB::Put(const WriteOptions& opt, const Slice& key, const Slice& value) {
@@ -1497,6 +5263,119 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
   return Write(opt, &batch);
 }
 
+Status DB::Merge(const WriteOptions& opt, const Slice& key,
+                 const Slice& value) {
+  WriteBatch batch;
+  batch.Merge(key, value);
+  return Write(opt, &batch);
+}
+
+std::vector<Status> DB::MultiGet(const ReadOptions& options,
+                                 const std::vector<Slice>& keys,
+                                 std::vector<std::string>* values) {
+  values->clear();
+  values->resize(keys.size());
+  std::vector<Status> statuses(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    statuses[i] = Get(options, keys[i], &(*values)[i]);
+  }
+  return statuses;
+}
+
+void DB::WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                    std::function<void(Status)> callback) {
+  Status s = Write(options, updates);
+  if (callback != nullptr) {
+    callback(s);
+  }
+}
+
+Status DB::Get(const ReadOptions& options, const Slice& key,
+               PinnableSlice* value) {
+  Status s = Get(options, key, value->buffer());
+  if (s.ok()) {
+    value->PinBuffer();
+  }
+  return s;
+}
+
+void DB::GetApproximateStats(const Range& range, RangeStats* stats) {
+  *stats = RangeStats();
+  GetApproximateSizes(&range, 1, &stats->bytes);
+}
+
+void DB::GetStats(DBStats* stats) { *stats = DBStats(); }
+
+Status DB::Warm(const Slice& begin, const Slice& end) {
+  (void)begin;
+  (void)end;
+  return Status::NotSupported("Warm");
+}
+
+Status DB::NewParallelIterators(const ReadOptions& options, const Slice* begin,
+                                const Slice* end, int n,
+                                std::vector<Iterator*>* iterators) {
+  (void)options;
+  (void)begin;
+  (void)end;
+  (void)n;
+  (void)iterators;
+  return Status::NotSupported("NewParallelIterators");
+}
+
+Status DB::SetOptions(const std::map<std::string, std::string>& new_options) {
+  (void)new_options;
+  return Status::NotSupported("SetOptions");
+}
+
+Status DB::BulkLoad(Iterator* input) {
+  (void)input;
+  return Status::NotSupported("BulkLoad");
+}
+
+Status DB::IngestExternalFile(const std::string& file) {
+  return Status::NotSupported("IngestExternalFile not implemented");
+}
+
+Status DB::CreateCheckpoint(const std::string& dir) {
+  return Status::NotSupported("CreateCheckpoint not implemented");
+}
+
+Status DB::TryCatchUpWithPrimary() {
+  return Status::NotSupported("not a secondary instance");
+}
+
+Status DB::GarbageCollectBlobs() {
+  return Status::NotSupported("GarbageCollectBlobs not implemented");
+}
+
+Status DB::SaveCacheCensus() { return Status::NotSupported("SaveCacheCensus"); }
+
+Status DB::ExportSnapshot(const Snapshot* snapshot, WritableFile* file) {
+  return Status::NotSupported("ExportSnapshot not implemented");
+}
+
+Status DB::Prepare(const WriteOptions& options, WriteBatch* updates,
+                   uint64_t* txn_id) {
+  return Status::NotSupported("Prepare not implemented");
+}
+
+Status DB::CommitPrepared(const WriteOptions& options, uint64_t txn_id) {
+  return Status::NotSupported("CommitPrepared not implemented");
+}
+
+Status DB::RollbackPrepared(const WriteOptions& options, uint64_t txn_id) {
+  return Status::NotSupported("RollbackPrepared not implemented");
+}
+
+Status DB::StartTrace(WritableFile* file) {
+  return Status::NotSupported("StartTrace not implemented");
+}
+
+Status DB::EndTrace() {
+  return Status::NotSupported("EndTrace not implemented");
+}
+
 DB::~DB() = default;
 
 Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
@@ -1518,8 +5397,28 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
       edit.SetLogNumber(new_log_number);
       impl->logfile_ = lfile;
       impl->logfile_number_ = new_log_number;
-      impl->log_ = new log::Writer(lfile);
-      impl->mem_ = new MemTable(impl->internal_comparator_);
+      impl->prepared_txns_.SetLogHint(new_log_number);
+      impl->log_ = NewLogWriter(impl->options_, lfile, new_log_number);
+
+      // Re-log transactions that are still pending from recovery so
+      // their payloads live in the fresh log and the old logs can be
+      // retired.
+      std::map<uint64_t, std::string> pending;
+      impl->prepared_txns_.GetAll(&pending);
+      for (std::map<uint64_t, std::string>::iterator it = pending.begin();
+           s.ok() && it != pending.end(); ++it) {
+        std::string rep(12, '\0');
+        rep.push_back(
+            static_cast<char>(WriteBatchInternal::kPrepareRecordTag));
+        PutVarint64(&rep, it->first);
+        PutLengthPrefixedSlice(&rep, it->second);
+        WriteBatch wrapper;
+        WriteBatchInternal::SetContents(&wrapper, rep);
+        WriteBatchInternal::SetCount(&wrapper, 1);
+        s = impl->log_->AddRecord(WriteBatchInternal::Contents(&wrapper));
+        impl->prepared_txns_.Put(it->first, it->second);  // New log hint
+      }
+      impl->mem_ = new MemTable(impl->internal_comparator_, impl->arena_pool_, impl->options_.memtable_hash_index, impl->options_.value_checksums, &impl->negative_stamps_, impl->options_.memtable_compression);
       impl->mem_->Ref();
     }
   }
@@ -1531,10 +5430,21 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
   if (s.ok()) {
     impl->RemoveObsoleteFiles();
     impl->MaybeScheduleCompaction();
+    impl->RefreshReadState();
   }
   impl->mutex_.Unlock();
   if (s.ok()) {
     assert(impl->mem_ != nullptr);
+    if (options.warm_cache_on_open) {
+      impl->WarmTableCache();
+      impl->LoadCacheCensus();
+    }
+    if (options.wal_sync_interval_micros != 0) {
+      impl->mutex_.Lock();
+      impl->wal_syncer_running_ = true;
+      impl->mutex_.Unlock();
+      options.env->StartThread(&DBImpl::BGWalSync, impl);
+    }
     *dbptr = impl;
   } else {
     delete impl;
@@ -1544,6 +5454,8 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
 
 Snapshot::~Snapshot() = default;
 
+MergeOperator::~MergeOperator() = default;
+
 Status DestroyDB(const std::string& dbname, const Options& options) {
   Env* env = options.env;
   std::vector<std::string> filenames;
@@ -1570,6 +5482,8 @@ Status DestroyDB(const std::string& dbname, const Options& options) {
     }
     env->UnlockFile(lock);  // Ignore error since state is already gone
     env->RemoveFile(lockname);
+    env->RemoveFile(dbname + "/CLEAN_SHUTDOWN");  // Ignore if absent
+    env->RemoveFile(dbname + "/CACHE_CENSUS");    // Ignore if absent
     env->RemoveDir(dbname);  // Ignore error in case dir contains other files
   }
   return result;
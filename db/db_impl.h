@@ -7,16 +7,22 @@
 
 #include <atomic>
 #include <deque>
+#include <functional>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "db/dbformat.h"
 #include "db/log_writer.h"
+#include "db/memtable.h"
 #include "db/snapshot.h"
+#include "db/write_batch_internal.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
+#include "util/arena.h"
+#include "util/histogram.h"
 
 namespace leveldb {
 
@@ -28,7 +34,8 @@ class VersionSet;
 
 class DBImpl : public DB {
  public:
-  DBImpl(const Options& options, const std::string& dbname);
+  DBImpl(const Options& options, const std::string& dbname,
+         bool read_only = false);
 
   DBImpl(const DBImpl&) = delete;
   DBImpl& operator=(const DBImpl&) = delete;
@@ -40,13 +47,57 @@ class DBImpl : public DB {
              const Slice& value) override;
   Status Delete(const WriteOptions&, const Slice& key) override;
   Status Write(const WriteOptions& options, WriteBatch* updates) override;
+  void WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                  std::function<void(Status)> callback) override;
   Status Get(const ReadOptions& options, const Slice& key,
              std::string* value) override;
+  Status Get(const ReadOptions& options, const Slice& key,
+             PinnableSlice* value) override;
+  std::vector<Status> MultiGet(const ReadOptions& options,
+                               const std::vector<Slice>& keys,
+                               std::vector<std::string>* values) override;
   Iterator* NewIterator(const ReadOptions&) override;
+  Status IngestExternalFile(const std::string& file) override;
+  Status BulkLoad(Iterator* input) override;
+  Status CreateCheckpoint(const std::string& dir) override;
+  Status TryCatchUpWithPrimary() override;
+  Status Prepare(const WriteOptions& options, WriteBatch* updates,
+                 uint64_t* txn_id) override;
+  Status CommitPrepared(const WriteOptions& options, uint64_t txn_id) override;
+  Status RollbackPrepared(const WriteOptions& options,
+                          uint64_t txn_id) override;
+  Status GarbageCollectBlobs() override;
+  Status ExportSnapshot(const Snapshot* snapshot, WritableFile* file) override;
+  Status StartTrace(WritableFile* file) override;
+  Status EndTrace() override;
+
+  // Trace hooks (also used by DBIter for seeks).
+  bool TracingActive() const {
+    return tracing_.load(std::memory_order_acquire);
+  }
+  void TraceOperation(const char* op, const Slice& payload);
+
+  // Resolve a blob handle (written by BuildTable when
+  // Options::blob_value_threshold is set) into the stored value.  Used
+  // by the read paths, including DBIter.
+  Status ReadBlobValue(const Slice& handle, std::string* value);
+
+  // True when Options::value_checksums is in effect (used by DBIter).
+  bool value_checksums() const { return options_.value_checksums; }
+
+  // Scan-cursor registry for ReadOptions::release_passed_files: a
+  // forward iterator reports its position; RemoveObsoleteFiles() can
+  // then delete table files wholly behind every cursor of versions
+  // held only by such iterators.
+  void RegisterScanCursor(const void* handle, Version* version);
+  void UpdateScanCursor(const void* handle, const Slice& user_key);
+  void UnregisterScanCursor(const void* handle);
   const Snapshot* GetSnapshot() override;
   void ReleaseSnapshot(const Snapshot* snapshot) override;
   bool GetProperty(const Slice& property, std::string* value) override;
+  void GetStats(DBStats* stats) override;
   void GetApproximateSizes(const Range* range, int n, uint64_t* sizes) override;
+  void GetApproximateStats(const Range& range, RangeStats* stats) override;
   void CompactRange(const Slice* begin, const Slice* end) override;
 
   // Extra methods (for testing) that are not in the public DB interface
@@ -71,9 +122,15 @@ class DBImpl : public DB {
   // bytes.
   void RecordReadSample(Slice key);
 
+  // Latency-stats hooks used by DBIter (no-ops unless
+  // Options::enable_latency_stats is set).
+  bool LatencyStatsEnabled() const;
+  void RecordSeekLatency(uint64_t micros);
+
  private:
   friend class DB;
   struct CompactionState;
+  struct SubcompactionState;
   struct Writer;
 
   // Information for a manual compaction
@@ -101,9 +158,10 @@ class DBImpl : public DB {
     int64_t bytes_written;
   };
 
-  Iterator* NewInternalIterator(const ReadOptions&,
-                                SequenceNumber* latest_snapshot,
-                                uint32_t* seed);
+  Iterator* NewInternalIterator(
+      const ReadOptions&, SequenceNumber* latest_snapshot, uint32_t* seed,
+      std::vector<MemTable::RangeTombstone>* range_tombstones,
+      Version** version_out = nullptr);
 
   Status NewDB();
 
@@ -118,25 +176,142 @@ class DBImpl : public DB {
   // Delete any unneeded files and stale in-memory entries.
   void RemoveObsoleteFiles() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  // Compact the in-memory write buffer to disk.  Switches to a new
-  // log-file/memtable and writes a new descriptor iff successful.
-  // Errors are recorded in bg_error_.
+  // Write every queued immutable memtable to disk (merged into one
+  // table) and install a new descriptor iff successful.  Errors are
+  // recorded in bg_error_.
   void CompactMemTable() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Status RecoverLogFile(uint64_t log_number, bool last_log, bool* save_manifest,
                         VersionEdit* edit, SequenceNumber* max_sequence)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base)
+  // The produced file number is stored in *pending_number and remains
+  // in pending_outputs_; the caller erases it after installing the
+  // edit (or on failure), so a concurrent RemoveObsoleteFiles() cannot
+  // delete the file in the window before the install.
+  Status WriteLevel0Table(Iterator* iter, VersionEdit* edit, Version* base,
+                          uint64_t* pending_number)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // If the given memtables carry range tombstones, scan them plus
+  // *base for covered user keys and return a referenced memtable of
+  // point deletions at the tombstones' sequence numbers (to be merged
+  // into the flush); returns nullptr when there are no tombstones.
+  // Temporarily releases mutex_ for the scan.
+  MemTable* MaterializeRangeDeletions(const std::vector<MemTable*>& mems,
+                                      Version* base)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
-  WriteBatch* BuildBatchGroup(Writer** last_writer)
+  void BuildWriteGroup(Writer** last_writer, std::vector<Writer*>* members,
+                       size_t* total_bytes)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Run the batch group led by *leader (which must be at the front of
+  // writers_): log, apply, and complete every member of the group.
+  // Heap-allocated asynchronous writers are deleted after their
+  // callbacks run.
+  void RunWriteGroup(Writer* leader) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Wake whoever should process the new front of writers_: signal a
+  // blocked synchronous writer, or start the async drain thread.
+  void WakeupWriterQueue() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void ProcessAsyncWrites();
+  static void AsyncWriteWork(void* db);
+
+  // Pre-open every live table file in parallel; see
+  // Options::warm_cache_on_open.
+  void WarmTableCache();
+  void MaybePrepareLogFile() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Returns the memory charged against Options::total_memory_budget.
+  uint64_t TrackedMemoryUsage() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Enforce the soft budget; returns true if the caller (the write
+  // path) should rotate the memtable to shed memory via a flush.
+  bool EnforceMemoryBudget() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void MaybeRetune() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void InvalidateNegativeCache(uint64_t min_valid_seq);
+  static void BGPrepareLogFile(void* db);
+  void PrepareLogFileWork();
+  static void BGWalSync(void* db);
+  void WalSyncWork();
+  std::string PopRecycledLog() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  Status NewLogSegment(uint64_t number, const std::string& recycled,
+                       WritableFile** file);
+  static void BulkLoadChunk(void* arg);
+  static void BGDeleteObsolete(void* db);
+  void DeleteObsoleteWork();
+  static void VerifyOutputWork(void* arg);
+  void LoadCacheCensus();
+  Status SaveCacheCensus() override;
+  Status SetOptions(
+      const std::map<std::string, std::string>& new_options) override;
+  Status NewParallelIterators(const ReadOptions& options, const Slice* begin,
+                              const Slice* end, int n,
+                              std::vector<Iterator*>* iterators) override;
+  Status Warm(const Slice& begin, const Slice& end) override;
+
+  // Background checksum pass over compaction input files; see
+  // Options::async_verify_compaction_inputs.
+  struct VerifyJob;
+  static void VerifyInputWork(void* arg);
+
+  // Point lookup that resolves merge operands; used when
+  // Options::merge_operator is set.
+  Status GetWithMerge(const ReadOptions& options, const Slice& key,
+                      std::string* value);
+
+  // Bodies of Get()/Write(), split out so the public entry points can
+  // wrap them with latency recording.
+  Status GetInternal(const ReadOptions& options, const Slice& key,
+                     std::string* value);
+  Status WriteInternal(const WriteOptions& options, WriteBatch* updates);
+
+  // Replay the logs newer than vset's cutoff into *mem (read-only
+  // secondaries only).  Sets *retry if a log vanished mid-replay
+  // because the primary retired it; the caller should start over.
+  Status ReplayLogsReadOnly(VersionSet* vset, MemTable* mem, bool* retry)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   void RecordBackgroundError(const Status& s);
 
+  // Apply *edit via versions_->LogAndApply(), waiting first for any
+  // concurrent manifest write to finish (LogAndApply() releases mutex_
+  // while writing the descriptor and must not run concurrently).
+  Status InstallVersionEdit(VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Returns true if there is background work that could be started now
+  // (i.e. not already being handled by a running background thread).
+  bool HasSchedulableWork() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // An immutable bundle of the structures a read needs, each holding a
+  // reference.  Readers pin it through a lock-free slot instead of
+  // mutating refcounts under mutex_; replaced bundles are retired and
+  // reclaimed once no slot references them.
+  struct ReadState {
+    Version* version;
+    MemTable* mem;
+    std::vector<MemTable*> imms;  // Newest first
+  };
+
+  // Rebuild read_state_ from the current memtables/version; call after
+  // any structural change.  Also reclaims quiescent retired states.
+  void RefreshReadState() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void ReclaimRetiredReadStates() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Smallest sequence number that any live snapshot (slot-registered
+  // or listed) may observe; falls back to the current last sequence.
+  SequenceNumber SmallestSnapshot() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Periodic TTL sweep (see Options::ttl_seconds): removes aged-out
+  // table files whose key ranges have no deeper overlapping data.
+  void MaybeExpireFiles() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Periodic tombstone-density check (see
+  // Options::tombstone_compaction_ratio).
+  void MaybeScheduleTombstoneCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
   void BackgroundCall();
@@ -146,6 +321,13 @@ class DBImpl : public DB {
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Compact the key range assigned to *compact, reading from *input.
+  // Called without mutex_ held; *input is owned by the caller.  If
+  // allow_imm_flush is true the loop services pending imm_ flushes.
+  Status RunSubcompaction(CompactionState* compact, Iterator* input,
+                          bool allow_imm_flush);
+  static void SubcompactionWork(void* arg);
+
   Status OpenCompactionOutputFile(CompactionState* compact);
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
   Status InstallCompactionResults(CompactionState* compact)
@@ -155,13 +337,24 @@ class DBImpl : public DB {
     return internal_comparator_.user_comparator();
   }
 
+  // Compression type for table files written for the given level,
+  // honoring Options::compression_per_level.
+  CompressionType CompressionForLevel(int level) const;
+  size_t BlockSizeForLevel(int level) const;
+
   // Constant after construction
   Env* const env_;
   const InternalKeyComparator internal_comparator_;
   const InternalFilterPolicy internal_filter_policy_;
-  const Options options_;  // options_.comparator == &internal_comparator_
+  // Logically const, except that SetOptions() adjusts a few
+  // documented scalar knobs under mutex_.
+  Options options_;  // options_.comparator == &internal_comparator_
   const bool owns_info_log_;
   const bool owns_cache_;
+  // True for secondary instances opened by DB::OpenAsSecondary(): no
+  // database lock is held, mutations fail, and no background work or
+  // file deletion is ever scheduled.
+  const bool read_only_;
   const std::string dbname_;
 
   // table_cache_ provides its own synchronization
@@ -174,35 +367,171 @@ class DBImpl : public DB {
   port::Mutex mutex_;
   std::atomic<bool> shutting_down_;
   port::CondVar background_work_finished_signal_ GUARDED_BY(mutex_);
+  // A retired memtable together with the log file that backs its
+  // contents; logs older than log_number can be dropped once every
+  // earlier memtable (and this one) has been flushed.
+  struct ImmutableMemTable {
+    MemTable* mem;
+    uint64_t log_number;
+  };
+
   MemTable* mem_;
-  MemTable* imm_ GUARDED_BY(mutex_);  // Memtable being compacted
-  std::atomic<bool> has_imm_;         // So bg thread can detect non-null imm_
+  // Full memtables waiting to be flushed, oldest first.  Bounded by
+  // options_.max_immutable_memtables.
+  std::deque<ImmutableMemTable> imms_ GUARDED_BY(mutex_);
+  std::atomic<bool> has_imm_;  // So bg thread can detect pending flushes
   WritableFile* logfile_;
   uint64_t logfile_number_ GUARDED_BY(mutex_);
+  // Next WAL segment, created off the write path so log rotation in
+  // MakeRoomForWrite() is a pointer swap rather than a file-creation
+  // syscall under mutex_.
+  WritableFile* prepared_logfile_ GUARDED_BY(mutex_) = nullptr;
+  uint64_t prepared_logfile_number_ GUARDED_BY(mutex_) = 0;
+  bool preparing_logfile_ GUARDED_BY(mutex_) = false;
+  // Retired log files awaiting reuse (Options::recycle_log_files).
+  std::deque<std::string> recycled_log_pool_ GUARDED_BY(mutex_);
+  // Obsolete files awaiting the paced background deleter.
+  std::deque<std::string> obsolete_queue_ GUARDED_BY(mutex_);
+  bool obsolete_deleter_running_ GUARDED_BY(mutex_) = false;
+  int output_verifications_running_ GUARDED_BY(mutex_) = 0;
+  struct ScanCursor {
+    Version* version;
+    std::string user_key;
+    bool started = false;  // False until the first progress report
+  };
+  std::map<const void*, ScanCursor> scan_cursors_ GUARDED_BY(mutex_);
+  // Negative-lookup cache (Options::negative_cache_size): user key ->
+  // sequence at which absence was proven, validated on hit against
+  // negative_stamps_.
+  Cache* negative_cache_ = nullptr;
+  NegativeCacheStamps negative_stamps_;
+  uint64_t last_budget_check_micros_ GUARDED_BY(mutex_) = 0;
+
+  // Runtime-tuned copies of the write-buffer size and level-0 write
+  // thresholds; equal to the configured values unless
+  // Options::adaptive_tuning moves them (see MaybeRetune()).
+  size_t tuned_write_buffer_size_ GUARDED_BY(mutex_);
+  int tuned_l0_slowdown_trigger_ GUARDED_BY(mutex_);
+  int tuned_l0_stop_trigger_ GUARDED_BY(mutex_);
+  uint64_t last_retune_micros_ GUARDED_BY(mutex_) = 0;
+  uint64_t retune_stall_baseline_ GUARDED_BY(mutex_) = 0;
   log::Writer* log_;
   uint32_t seed_ GUARDED_BY(mutex_);  // For sampling.
 
   // Queue of writers.
   std::deque<Writer*> writers_ GUARDED_BY(mutex_);
-  WriteBatch* tmp_batch_ GUARDED_BY(mutex_);
+
+  // Write pipeline state.  Sequences in
+  // (versions_->LastSequence(), last_allocated_sequence_] have been
+  // assigned to batch groups whose memtable apply has not finished yet.
+  // apply_done_signal_ is broadcast each time a group becomes visible.
+  uint64_t last_allocated_sequence_ GUARDED_BY(mutex_);
+  port::CondVar apply_done_signal_ GUARDED_BY(mutex_);
+
+  // True while a thread started by WakeupWriterQueue() is draining
+  // asynchronous writers from the front of writers_.
+  bool async_writer_running_ GUARDED_BY(mutex_);
+
+  // Adaptive batch-group size cap (bytes), tuned from observed
+  // log-stage latency; see BuildWriteGroup()/RunWriteGroup().
+  size_t group_size_limit_ GUARDED_BY(mutex_);
+
+  // Log sync coalescing: each WAL append bumps log_appended_epoch_;
+  // one group at a time performs fdatasync and publishes
+  // log_synced_epoch_, covering every append made before it started,
+  // so concurrent sync writers share a single fsync.
+  uint64_t log_appended_epoch_ GUARDED_BY(mutex_);
+  uint64_t log_synced_epoch_ GUARDED_BY(mutex_);
+  bool log_sync_in_progress_ GUARDED_BY(mutex_);
+  // Sequence covered by the newest append / the last completed sync;
+  // the latter backs the "leveldb.last-durable-sequence" property.
+  uint64_t log_appended_sequence_ GUARDED_BY(mutex_) = 0;
+  // Highest epoch some writer actually asked to have synced
+  // (WriteOptions::sync).  Rotation drains only up to here, so a
+  // database that never requests durability never pays a foreground
+  // fsync at memtable switch.
+  uint64_t log_sync_requested_epoch_ GUARDED_BY(mutex_) = 0;
+  uint64_t last_durable_sequence_ GUARDED_BY(mutex_) = 0;
+  bool wal_syncer_running_ GUARDED_BY(mutex_) = false;
+  port::CondVar sync_done_signal_ GUARDED_BY(mutex_);
 
   SnapshotList snapshots_ GUARDED_BY(mutex_);
 
+  // Lock-free snapshot registration slots: 0 = free, otherwise the
+  // snapshot's sequence number + 1 (so a just-reserved slot reads as
+  // sequence 0, which is safely conservative for compaction).
+  // GetSnapshot() claims a slot with a CAS; the mutex-protected list
+  // is the overflow path.
+  enum { kSnapshotSlots = 64 };
+  std::atomic<uint64_t> snapshot_slots_[kSnapshotSlots];
+
+  // Lock-free read path state; see ReadState.
+  enum { kReadStateSlots = 64 };
+  std::atomic<ReadState*> read_state_;
+  std::atomic<ReadState*> read_state_slots_[kReadStateSlots];
+  std::vector<ReadState*> retired_read_states_ GUARDED_BY(mutex_);
+
   // Set of table files to protect from deletion because they are
   // part of ongoing compactions.
   std::set<uint64_t> pending_outputs_ GUARDED_BY(mutex_);
 
-  // Has a background compaction been scheduled or is running?
-  bool background_compaction_scheduled_ GUARDED_BY(mutex_);
+  // Number of background compactions scheduled or running.  Bounded by
+  // options_.max_background_compactions.
+  int background_compactions_scheduled_ GUARDED_BY(mutex_);
+
+  // Levels with a table compaction in progress.  A compaction over
+  // levels (n, n+1) inserts both; concurrent compactions may only run
+  // on disjoint level pairs.
+  std::set<int> levels_in_compaction_ GUARDED_BY(mutex_);
+
+  // True while a background thread is writing out imm_.
+  bool imm_compacting_ GUARDED_BY(mutex_);
+
+  // True while a thread is inside versions_->LogAndApply().
+  bool manifest_write_in_progress_ GUARDED_BY(mutex_);
 
   ManualCompaction* manual_compaction_ GUARDED_BY(mutex_);
 
-  VersionSet* const versions_ GUARDED_BY(mutex_);
+  VersionSet* versions_ GUARDED_BY(mutex_);
+
+  // Version sets replaced by TryCatchUpWithPrimary().  They may still
+  // be referenced by live iterators, so they are only deleted when the
+  // DB is closed.
+  std::vector<VersionSet*> retired_version_sets_ GUARDED_BY(mutex_);
+
+  // Slab pool shared by the memtables when
+  // options_.recycle_memtable_arena is set; null otherwise.
+  ArenaBlockPool* const arena_pool_;
 
   // Have we encountered a background error in paranoid mode?
   Status bg_error_ GUARDED_BY(mutex_);
 
   CompactionStats stats_[config::kNumLevels] GUARDED_BY(mutex_);
+
+  // Cumulative time writers spent delayed or stalled in
+  // MakeRoomForWrite(); see DBStats.
+  uint64_t write_slowdown_micros_ GUARDED_BY(mutex_);
+  uint64_t write_stall_micros_ GUARDED_BY(mutex_);
+
+  // Time of the last TTL sweep; see MaybeExpireFiles().
+  uint64_t last_ttl_check_micros_ GUARDED_BY(mutex_);
+
+  // Time of the last tombstone-density check.
+  uint64_t last_tombstone_check_micros_ GUARDED_BY(mutex_);
+
+  // Operation latency histograms; see Options::enable_latency_stats.
+  LatencyHistogram get_latency_;
+  LatencyHistogram write_latency_;
+  LatencyHistogram seek_latency_;
+
+  // Two-phase commit state; see DB::Prepare().
+  PreparedTransactions prepared_txns_;
+  std::atomic<uint64_t> next_txn_id_;
+
+  // Trace capture state; see StartTrace().
+  std::atomic<bool> tracing_;
+  port::Mutex trace_mutex_;
+  WritableFile* trace_file_ GUARDED_BY(trace_mutex_);
 };
 
 // Sanitize db options.  The caller should delete result.info_log if
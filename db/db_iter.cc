@@ -4,6 +4,11 @@
 
 #include "db/db_iter.h"
 
+#include "db/db_impl.h"
+#include "leveldb/merge_operator.h"
+#include "leveldb/perf_context.h"
+#include "util/object_pool.h"
+
 #include "db/db_impl.h"
 #include "db/dbformat.h"
 #include "db/filename.h"
@@ -46,28 +51,60 @@ class DBIter : public Iterator {
   enum Direction { kForward, kReverse };
 
   DBIter(DBImpl* db, const Comparator* cmp, Iterator* iter, SequenceNumber s,
-         uint32_t seed)
+         uint32_t seed, std::vector<MemTable::RangeTombstone> range_tombstones,
+         size_t prefix_length, const MergeOperator* merge_operator,
+         const Slice* upper_bound, bool release_passed_files, bool key_only)
       : db_(db),
         user_comparator_(cmp),
         iter_(iter),
         sequence_(s),
+        range_tombstones_(std::move(range_tombstones)),
+        upper_bound_(upper_bound),
+        prefix_length_(prefix_length),
+        prefix_active_(false),
+        merge_operator_(merge_operator),
+        merged_forward_(false),
         direction_(kForward),
         valid_(false),
+        release_passed_files_(release_passed_files),
+        key_only_(key_only),
+        value_checksums_(!key_only && db != nullptr &&
+                         db->value_checksums()),
         rnd_(seed),
         bytes_until_read_sampling_(RandomCompactionPeriod()) {}
 
   DBIter(const DBIter&) = delete;
   DBIter& operator=(const DBIter&) = delete;
 
-  ~DBIter() override { delete iter_; }
+  // Scans churn through these; recycle per thread.
+  static void* operator new(size_t size) { return PooledAllocate(size); }
+  static void operator delete(void* ptr, size_t size) {
+    PooledFree(ptr, size);
+  }
+
+  ~DBIter() override {
+    if (release_passed_files_) {
+      db_->UnregisterScanCursor(this);
+    }
+    delete iter_;
+  }
   bool Valid() const override { return valid_; }
   Slice key() const override {
     assert(valid_);
-    return (direction_ == kForward) ? ExtractUserKey(iter_->key()) : saved_key_;
+    return (direction_ == kForward && !merged_forward_)
+               ? ExtractUserKey(iter_->key())
+               : saved_key_;
   }
   Slice value() const override {
     assert(valid_);
-    return (direction_ == kForward) ? iter_->value() : saved_value_;
+    if (key_only_) return Slice();
+    if (merged_forward_) return merged_value_;
+    if (direction_ != kForward) return saved_value_;
+    Slice v = iter_->value();
+    if (value_checksums_ && v.size() >= 4) {
+      v = Slice(v.data(), v.size() - 4);  // Verified when positioned
+    }
+    return v;
   }
   Status status() const override {
     if (status_.ok()) {
@@ -88,6 +125,128 @@ class DBIter : public Iterator {
   void FindPrevUserEntry();
   bool ParseKey(ParsedInternalKey* key);
 
+  // Apply the merge operator to base (may be null) and operands
+  // (oldest first) into *result; records corruption on failure.
+  bool ApplyMerge(const Slice& key, const Slice* base,
+                  const std::vector<Slice>& operands, std::string* result) {
+    if (merge_operator_ == nullptr ||
+        !merge_operator_->Merge(key, base, operands, result)) {
+      status_ = Status::Corruption("merge operator missing or failed");
+      valid_ = false;
+      return false;
+    }
+    return true;
+  }
+
+  // Forward scan hit a merge record: collect the rest of the chain
+  // (operands until a base value, deletion, covering range tombstone
+  // or key end) and expose the combined result at this position.
+  void ResolveMergeForward(const Slice& user_key) {
+    SaveKey(user_key, &saved_key_);
+    std::vector<std::string> operands;  // Newest first
+    operands.push_back(iter_->value().ToString());
+    bool have_base = false;
+    std::string base;
+    iter_->Next();
+    while (iter_->Valid()) {
+      ParsedInternalKey ikey;
+      if (!ParseKey(&ikey)) {
+        return;  // status_ set
+      }
+      if (user_comparator_->Compare(ikey.user_key, saved_key_) != 0) {
+        break;
+      }
+      if (ikey.sequence > sequence_) {
+        iter_->Next();
+        continue;
+      }
+      if (RangeDeleted(ikey.user_key, ikey.sequence)) {
+        break;  // This and everything older is deleted
+      }
+      if (ikey.type == kTypeMerge) {
+        operands.push_back(iter_->value().ToString());
+        iter_->Next();
+        continue;
+      }
+      if (ikey.type == kTypeValue) {
+        have_base = true;
+        base.assign(iter_->value().data(), iter_->value().size());
+      } else if (ikey.type == kTypeBlobHandle) {
+        Status s = db_->ReadBlobValue(iter_->value(), &base);
+        if (!s.ok()) {
+          status_ = s;
+          valid_ = false;
+          return;
+        }
+        have_base = true;
+      }
+      break;  // Value or deletion terminates the chain
+    }
+    std::vector<Slice> slices;  // Oldest first
+    for (size_t i = operands.size(); i > 0; i--) {
+      slices.push_back(Slice(operands[i - 1]));
+    }
+    Slice base_slice(base);
+    merged_value_.clear();
+    if (ApplyMerge(saved_key_, have_base ? &base_slice : nullptr, slices,
+                   &merged_value_)) {
+      merged_forward_ = true;
+      valid_ = true;
+      CheckPrefixBound();
+    }
+  }
+
+  // Forward scan hit a blob handle: materialize the value and expose
+  // it at this position via the merged-value mechanism.
+  void ResolveBlobForward(const Slice& user_key) {
+    SaveKey(user_key, &saved_key_);
+    merged_value_.clear();
+    Status s = db_->ReadBlobValue(iter_->value(), &merged_value_);
+    if (!s.ok()) {
+      status_ = s;
+      valid_ = false;
+      return;
+    }
+    iter_->Next();  // Next()/Prev() treat the chain as consumed
+    merged_forward_ = true;
+    valid_ = true;
+  }
+
+  // Invalidate the iterator if it has moved past the bounding prefix
+  // or the caller's upper bound.
+  void CheckPrefixBound() {
+    if (!valid_) {
+      return;
+    }
+    const Slice user_key =
+        (direction_ == kForward && !merged_forward_)
+            ? ExtractUserKey(iter_->key())
+            : Slice(saved_key_);
+    if (prefix_active_ &&
+        (user_key.size() < prefix_.size() ||
+         memcmp(user_key.data(), prefix_.data(), prefix_.size()) != 0)) {
+      valid_ = false;
+    }
+    if (valid_ && upper_bound_ != nullptr &&
+        user_comparator_->Compare(user_key, *upper_bound_) >= 0) {
+      valid_ = false;
+    }
+  }
+
+  // True iff a range tombstone newer than "sequence" (but visible at
+  // this iterator's snapshot) covers user_key.
+  bool RangeDeleted(const Slice& user_key, SequenceNumber sequence) const {
+    for (size_t i = 0; i < range_tombstones_.size(); i++) {
+      const MemTable::RangeTombstone& t = range_tombstones_[i];
+      if (t.seq > sequence && t.seq <= sequence_ &&
+          user_comparator_->Compare(user_key, t.begin) >= 0 &&
+          user_comparator_->Compare(user_key, t.end) < 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   inline void SaveKey(const Slice& k, std::string* dst) {
     dst->assign(k.data(), k.size());
   }
@@ -108,6 +267,15 @@ class DBIter : public Iterator {
 
   DBImpl* db_;
   const Comparator* const user_comparator_;
+  const std::vector<MemTable::RangeTombstone> range_tombstones_;
+  const Slice* const upper_bound_;  // Forward iteration stops here
+  const size_t prefix_length_;  // Non-zero enables prefix-bounded seeks
+  bool prefix_active_;          // True after Seek() until direction change
+  std::string prefix_;          // The bounding prefix
+  const MergeOperator* const merge_operator_;
+  bool merged_forward_;       // Forward position is a resolved merge
+  std::string merged_value_;  // Its value
+  std::vector<std::string> prev_operands_;  // Reverse-scan merge operands
   Iterator* const iter_;
   SequenceNumber const sequence_;
   Status status_;
@@ -115,6 +283,10 @@ class DBIter : public Iterator {
   std::string saved_value_;  // == current raw value when direction_==kReverse
   Direction direction_;
   bool valid_;
+  const bool release_passed_files_;
+  const bool key_only_;
+  const bool value_checksums_;
+  uint32_t scan_progress_ops_ = 0;
   Random rnd_;
   size_t bytes_until_read_sampling_;
 };
@@ -141,6 +313,25 @@ inline bool DBIter::ParseKey(ParsedInternalKey* ikey) {
 void DBIter::Next() {
   assert(valid_);
 
+  if (release_passed_files_ && (++scan_progress_ops_ & 4095) == 0) {
+    // Report the cursor so files wholly behind it can be reclaimed.
+    db_->UpdateScanCursor(this, key());
+  }
+
+  if (merged_forward_) {
+    // iter_ already advanced past (part of) this key's entries while
+    // collecting the merge chain; skip whatever remains.
+    merged_forward_ = false;
+    if (!iter_->Valid()) {
+      valid_ = false;
+      saved_key_.clear();
+      return;
+    }
+    FindNextUserEntry(true, &saved_key_);
+    CheckPrefixBound();
+    return;
+  }
+
   if (direction_ == kReverse) {  // Switch directions?
     direction_ = kForward;
     // iter_ is pointing just before the entries for this->key(),
@@ -172,6 +363,7 @@ void DBIter::Next() {
   }
 
   FindNextUserEntry(true, &saved_key_);
+  CheckPrefixBound();
 }
 
 void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
@@ -181,23 +373,67 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
   do {
     ParsedInternalKey ikey;
     if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
-      switch (ikey.type) {
+      ValueType type = ikey.type;
+      if (type != kTypeDeletion && !range_tombstones_.empty() &&
+          RangeDeleted(ikey.user_key, ikey.sequence)) {
+        type = kTypeDeletion;
+      }
+      switch (type) {
         case kTypeDeletion:
           // Arrange to skip all upcoming entries for this key since
           // they are hidden by this deletion.
           SaveKey(ikey.user_key, skip);
           skipping = true;
           break;
+        case kTypeMerge:
+          if (skipping &&
+              user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
+            // Entry hidden
+          } else if (key_only_) {
+            // Existence is decided without touching the operands.
+            valid_ = true;
+            saved_key_.clear();
+            return;
+          } else {
+            ResolveMergeForward(ikey.user_key);
+            return;
+          }
+          break;
+        case kTypeBlobHandle:
+          if (skipping &&
+              user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
+            // Entry hidden
+          } else if (key_only_) {
+            // Do not fetch the blob; the key alone is wanted.
+            valid_ = true;
+            saved_key_.clear();
+            return;
+          } else {
+            ResolveBlobForward(ikey.user_key);
+            return;
+          }
+          break;
         case kTypeValue:
           if (skipping &&
               user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
             // Entry hidden
+            GetPerfContext()->internal_keys_skipped++;
           } else {
+            if (value_checksums_) {
+              Slice v = iter_->value();
+              if (!VerifyValueChecksum(ikey.user_key, &v)) {
+                status_ = Status::Corruption("value checksum mismatch");
+                valid_ = false;
+                return;
+              }
+            }
             valid_ = true;
             saved_key_.clear();
             return;
           }
           break;
+        default:
+          break;
       }
     }
     iter_->Next();
@@ -208,6 +444,30 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
 
 void DBIter::Prev() {
   assert(valid_);
+  prefix_active_ = false;
+
+  if (merged_forward_) {
+    // iter_ sits somewhere at or past this key's entries; back up to
+    // just before them so the reverse scanning code takes over.
+    merged_forward_ = false;
+    if (!iter_->Valid()) {
+      iter_->SeekToLast();
+    }
+    while (iter_->Valid() &&
+           user_comparator_->Compare(ExtractUserKey(iter_->key()),
+                                     saved_key_) >= 0) {
+      iter_->Prev();
+    }
+    direction_ = kReverse;
+    if (!iter_->Valid()) {
+      valid_ = false;
+      saved_key_.clear();
+      ClearSavedValue();
+      return;
+    }
+    FindPrevUserEntry();
+    return;
+  }
 
   if (direction_ == kForward) {  // Switch directions?
     // iter_ is pointing at the current entry.  Scan backwards until
@@ -236,6 +496,11 @@ void DBIter::Prev() {
 void DBIter::FindPrevUserEntry() {
   assert(direction_ == kReverse);
 
+  // Entries for a user key arrive oldest first in this direction, so
+  // merge operands are appended in oldest-first order and a newer
+  // value or deletion resets the pending chain.
+  bool have_base = false;
+  prev_operands_.clear();
   ValueType value_type = kTypeDeletion;
   if (iter_->Valid()) {
     do {
@@ -247,9 +512,25 @@ void DBIter::FindPrevUserEntry() {
           break;
         }
         value_type = ikey.type;
+        if (value_type != kTypeDeletion && !range_tombstones_.empty() &&
+            RangeDeleted(ikey.user_key, ikey.sequence)) {
+          value_type = kTypeDeletion;
+        }
         if (value_type == kTypeDeletion) {
           saved_key_.clear();
           ClearSavedValue();
+          have_base = false;
+          prev_operands_.clear();
+        } else if (value_type == kTypeMerge) {
+          if (user_comparator_->Compare(ExtractUserKey(iter_->key()),
+                                        saved_key_) != 0) {
+            // New key; any pending state belongs to an older key.
+            ClearSavedValue();
+            have_base = false;
+            prev_operands_.clear();
+          }
+          SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
+          prev_operands_.push_back(iter_->value().ToString());
         } else {
           Slice raw_value = iter_->value();
           if (saved_value_.capacity() > raw_value.size() + 1048576) {
@@ -257,13 +538,53 @@ void DBIter::FindPrevUserEntry() {
             swap(empty, saved_value_);
           }
           SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
-          saved_value_.assign(raw_value.data(), raw_value.size());
+          if (key_only_) {
+            // Keys only: remember that a value exists, nothing more.
+            ClearSavedValue();
+            value_type = kTypeValue;
+            have_base = true;
+            prev_operands_.clear();
+          } else if (value_type == kTypeBlobHandle) {
+            Status s = db_->ReadBlobValue(raw_value, &saved_value_);
+            if (!s.ok()) {
+              status_ = s;
+              valid_ = false;
+              return;
+            }
+            value_type = kTypeValue;
+          } else {
+            if (value_checksums_ &&
+                !VerifyValueChecksum(ExtractUserKey(iter_->key()),
+                                     &raw_value)) {
+              status_ = Status::Corruption("value checksum mismatch");
+              valid_ = false;
+              return;
+            }
+            saved_value_.assign(raw_value.data(), raw_value.size());
+          }
+          have_base = true;
+          prev_operands_.clear();
         }
       }
       iter_->Prev();
     } while (iter_->Valid());
   }
 
+  if (!prev_operands_.empty() && value_type != kTypeDeletion) {
+    std::vector<Slice> slices;
+    for (size_t i = 0; i < prev_operands_.size(); i++) {
+      slices.push_back(Slice(prev_operands_[i]));
+    }
+    Slice base_slice(saved_value_);
+    std::string merged;
+    if (!ApplyMerge(saved_key_, have_base ? &base_slice : nullptr, slices,
+                    &merged)) {
+      return;
+    }
+    saved_value_.swap(merged);
+    value_type = kTypeValue;
+  }
+
   if (value_type == kTypeDeletion) {
     // End
     valid_ = false;
@@ -276,8 +597,20 @@ void DBIter::FindPrevUserEntry() {
 }
 
 void DBIter::Seek(const Slice& target) {
+  if (db_ != nullptr && db_->TracingActive()) {
+    db_->TraceOperation("seek", target);
+  }
+  const uint64_t start_micros =
+      (db_ != nullptr && db_->LatencyStatsEnabled()) ? Env::Default()->NowMicros()
+                                                     : 0;
   direction_ = kForward;
   ClearSavedValue();
+  if (prefix_length_ != 0) {
+    prefix_.assign(target.data(),
+                   target.size() < prefix_length_ ? target.size()
+                                                  : prefix_length_);
+    prefix_active_ = true;
+  }
   saved_key_.clear();
   AppendInternalKey(&saved_key_,
                     ParsedInternalKey(target, sequence_, kValueTypeForSeek));
@@ -287,9 +620,15 @@ void DBIter::Seek(const Slice& target) {
   } else {
     valid_ = false;
   }
+  CheckPrefixBound();
+  if (start_micros != 0) {
+    db_->RecordSeekLatency(Env::Default()->NowMicros() - start_micros);
+  }
 }
 
 void DBIter::SeekToFirst() {
+  prefix_active_ = false;
+  merged_forward_ = false;
   direction_ = kForward;
   ClearSavedValue();
   iter_->SeekToFirst();
@@ -298,10 +637,12 @@ void DBIter::SeekToFirst() {
   } else {
     valid_ = false;
   }
+  CheckPrefixBound();
 }
 
 void DBIter::SeekToLast() {
   direction_ = kReverse;
+  prefix_active_ = false;
   ClearSavedValue();
   iter_->SeekToLast();
   FindPrevUserEntry();
@@ -309,10 +650,16 @@ void DBIter::SeekToLast() {
 
 }  // anonymous namespace
 
-Iterator* NewDBIterator(DBImpl* db, const Comparator* user_key_comparator,
-                        Iterator* internal_iter, SequenceNumber sequence,
-                        uint32_t seed) {
-  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed);
+Iterator* NewDBIterator(
+    DBImpl* db, const Comparator* user_key_comparator, Iterator* internal_iter,
+    SequenceNumber sequence, uint32_t seed,
+    std::vector<MemTable::RangeTombstone> range_tombstones,
+    size_t prefix_length, const MergeOperator* merge_operator,
+    const Slice* upper_bound, bool release_passed_files, bool key_only) {
+  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed,
+                    std::move(range_tombstones), prefix_length,
+                    merge_operator, upper_bound, release_passed_files,
+                    key_only);
 }
 
 }  // namespace leveldb
@@ -6,20 +6,35 @@
 #define STORAGE_LEVELDB_DB_DB_ITER_H_
 
 #include <cstdint>
+#include <vector>
 
 #include "db/dbformat.h"
+#include "db/memtable.h"
 #include "leveldb/db.h"
 
 namespace leveldb {
 
 class DBImpl;
+class MergeOperator;
 
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// into appropriate user keys.  Entries covered by one of the range
+// tombstones (with a newer sequence number <= "sequence") are hidden.
+// A non-zero "prefix_length" enables prefix-bounded forward iteration
+// (ReadOptions::prefix_same_as_start): after a Seek() the iterator
+// becomes invalid once it advances past the last key sharing the seek
+// target's prefix.
 Iterator* NewDBIterator(DBImpl* db, const Comparator* user_key_comparator,
                         Iterator* internal_iter, SequenceNumber sequence,
-                        uint32_t seed);
+                        uint32_t seed,
+                        std::vector<MemTable::RangeTombstone> range_tombstones =
+                            std::vector<MemTable::RangeTombstone>(),
+                        size_t prefix_length = 0,
+                        const MergeOperator* merge_operator = nullptr,
+                        const Slice* upper_bound = nullptr,
+                        bool release_passed_files = false,
+                        bool key_only = false);
 
 }  // namespace leveldb
 
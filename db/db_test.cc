@@ -17,6 +17,7 @@
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/table.h"
+#include "leveldb/table_builder.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
 #include "util/hash.h"
@@ -645,6 +646,105 @@ TEST_F(DBTest, GetFromVersions) {
   } while (ChangeOptions());
 }
 
+TEST_F(DBTest, MultiGet) {
+  do {
+    ASSERT_LEVELDB_OK(Put("a", "va"));
+    ASSERT_LEVELDB_OK(Put("c", "vc"));
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_LEVELDB_OK(Put("b", "vb"));
+
+    std::vector<Slice> keys = {"c", "missing", "a", "b"};
+    std::vector<std::string> values;
+    std::vector<Status> statuses = db_->MultiGet(ReadOptions(), keys, &values);
+    ASSERT_EQ(4, statuses.size());
+    ASSERT_EQ(4, values.size());
+    ASSERT_LEVELDB_OK(statuses[0]);
+    ASSERT_EQ("vc", values[0]);
+    ASSERT_TRUE(statuses[1].IsNotFound());
+    ASSERT_LEVELDB_OK(statuses[2]);
+    ASSERT_EQ("va", values[2]);
+    ASSERT_LEVELDB_OK(statuses[3]);
+    ASSERT_EQ("vb", values[3]);
+  } while (ChangeOptions());
+}
+
+TEST_F(DBTest, DeleteRange) {
+  do {
+    ASSERT_LEVELDB_OK(Put("a", "va"));
+    ASSERT_LEVELDB_OK(Put("b", "vb"));
+    ASSERT_LEVELDB_OK(Put("c", "vc"));
+    ASSERT_LEVELDB_OK(Put("d", "vd"));
+
+    WriteBatch batch;
+    batch.DeleteRange("b", "d");
+    ASSERT_LEVELDB_OK(db_->Write(WriteOptions(), &batch));
+    ASSERT_EQ("va", Get("a"));
+    ASSERT_EQ("NOT_FOUND", Get("b"));
+    ASSERT_EQ("NOT_FOUND", Get("c"));
+    ASSERT_EQ("vd", Get("d"));
+
+    // A write after the range deletion is visible again.
+    ASSERT_LEVELDB_OK(Put("b", "vb2"));
+    ASSERT_EQ("vb2", Get("b"));
+    ASSERT_EQ("NOT_FOUND", Get("c"));
+
+    // Deletions survive a flush (materialized as point tombstones).
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_EQ("vb2", Get("b"));
+    ASSERT_EQ("NOT_FOUND", Get("c"));
+    ASSERT_EQ("vd", Get("d"));
+  } while (ChangeOptions());
+}
+
+TEST_F(DBTest, IngestExternalFile) {
+  ASSERT_LEVELDB_OK(Put("b", "old"));
+
+  // Build an external table with the public TableBuilder.
+  const std::string fname = dbname_ + "/external.ldb";
+  WritableFile* file;
+  ASSERT_LEVELDB_OK(env_->NewWritableFile(fname, &file));
+  TableBuilder builder(Options(), file);
+  builder.Add("a", "va");
+  builder.Add("b", "vb");
+  builder.Add("c", "vc");
+  ASSERT_LEVELDB_OK(builder.Finish());
+  ASSERT_LEVELDB_OK(file->Close());
+  delete file;
+
+  ASSERT_LEVELDB_OK(db_->IngestExternalFile(fname));
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ("vb", Get("b"));  // Ingested value shadows the older Put
+  ASSERT_EQ("vc", Get("c"));
+}
+
+TEST_F(DBTest, WriteAsync) {
+  port::Mutex mu;
+  port::CondVar cv(&mu);
+  int pending = 2;
+  Status async_status[2];
+  WriteBatch batches[2];
+  batches[0].Put("a", "va");
+  batches[1].Put("b", "vb");
+  for (int i = 0; i < 2; i++) {
+    db_->WriteAsync(WriteOptions(), &batches[i], [&, i](Status s) {
+      mu.Lock();
+      async_status[i] = s;
+      pending--;
+      cv.SignalAll();
+      mu.Unlock();
+    });
+  }
+  mu.Lock();
+  while (pending > 0) {
+    cv.Wait();
+  }
+  mu.Unlock();
+  ASSERT_LEVELDB_OK(async_status[0]);
+  ASSERT_LEVELDB_OK(async_status[1]);
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ("vb", Get("b"));
+}
+
 TEST_F(DBTest, GetMemUsage) {
   do {
     ASSERT_LEVELDB_OK(Put("foo", "v1"));
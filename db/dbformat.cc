@@ -4,6 +4,8 @@
 
 #include "db/dbformat.h"
 
+#include <cstring>
+
 #include <cstdio>
 #include <sstream>
 
@@ -49,7 +51,35 @@ int InternalKeyComparator::Compare(const Slice& akey, const Slice& bkey) const {
   //    increasing user key (according to user-supplied comparator)
   //    decreasing sequence number
   //    decreasing type (though sequence# should be enough to disambiguate)
-  int r = user_comparator_->Compare(ExtractUserKey(akey), ExtractUserKey(bkey));
+  //
+  // The built-in bytewise comparator is by far the common case, and
+  // this function is the hottest in most profiles (every skiplist,
+  // block and merging-iterator probe lands here).  For bytewise keys,
+  // run fused over the raw internal key: one memcmp (vectorized by the
+  // C library) across the user bytes, a length tie-break, and a single
+  // 8-byte tag comparison -- no Slice construction, no virtual call.
+  if (user_is_bytewise_) {
+    const size_t a_user = akey.size() - 8;
+    const size_t b_user = bkey.size() - 8;
+    const size_t min_len = a_user < b_user ? a_user : b_user;
+    int r = std::memcmp(akey.data(), bkey.data(), min_len);
+    if (r != 0) {
+      return r < 0 ? -1 : +1;
+    }
+    if (a_user != b_user) {
+      return a_user < b_user ? -1 : +1;
+    }
+    // Equal user keys: larger (newer) tags sort first.
+    const uint64_t anum = DecodeFixed64(akey.data() + a_user);
+    const uint64_t bnum = DecodeFixed64(bkey.data() + b_user);
+    if (anum > bnum) {
+      return -1;
+    }
+    return anum < bnum ? +1 : 0;
+  }
+
+  int r = user_comparator_->Compare(ExtractUserKey(akey),
+                                    ExtractUserKey(bkey));
   if (r == 0) {
     const uint64_t anum = DecodeFixed64(akey.data() + akey.size() - 8);
     const uint64_t bnum = DecodeFixed64(bkey.data() + bkey.size() - 8);
@@ -96,6 +126,17 @@ void InternalKeyComparator::FindShortSuccessor(std::string* key) const {
   }
 }
 
+bool InternalKeyComparator::OrderPreservingPrefix(const Slice& key,
+                                                  uint32_t* prefix) const {
+  // Internal keys order by user key first, so a prefix of the user key
+  // preserves the order; ties (equal user-key prefixes) are "unknown",
+  // which also covers the descending sequence number component.
+  if (key.size() < 8) {
+    return false;
+  }
+  return user_comparator_->OrderPreservingPrefix(ExtractUserKey(key), prefix);
+}
+
 const char* InternalFilterPolicy::Name() const { return user_policy_->Name(); }
 
 void InternalFilterPolicy::CreateFilter(const Slice* keys, int n,
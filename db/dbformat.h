@@ -51,14 +51,30 @@ class InternalKey;
 // Value types encoded as the last component of internal keys.
 // DO NOT CHANGE THESE ENUM VALUES: they are embedded in the on-disk
 // data structures.
-enum ValueType { kTypeDeletion = 0x0, kTypeValue = 0x1 };
+// kTypeRangeDeletion only appears in WriteBatch records, the
+// write-ahead log and in-memory tombstone lists; it is materialized
+// into kTypeDeletion entries when the memtable is flushed, so table
+// files never contain it.
+// kTypeMerge entries carry merge operands (see
+// leveldb/merge_operator.h) and are combined with the underlying value
+// at read time.
+// kTypeBlobHandle entries store a (blob file, offset, size) handle in
+// place of a large value, which lives in a companion .blob file (see
+// Options::blob_value_threshold).
+enum ValueType {
+  kTypeDeletion = 0x0,
+  kTypeValue = 0x1,
+  kTypeRangeDeletion = 0x2,
+  kTypeMerge = 0x3,
+  kTypeBlobHandle = 0x4
+};
 // kValueTypeForSeek defines the ValueType that should be passed when
 // constructing a ParsedInternalKey object for seeking to a particular
 // sequence number (since we sort sequence numbers in decreasing order
 // and the value type is embedded as the low 8 bits in the sequence
 // number in internal keys, we need to use the highest-numbered
 // ValueType, not the lowest).
-static const ValueType kValueTypeForSeek = kTypeValue;
+static const ValueType kValueTypeForSeek = kTypeBlobHandle;
 
 typedef uint64_t SequenceNumber;
 
@@ -102,14 +118,21 @@ inline Slice ExtractUserKey(const Slice& internal_key) {
 class InternalKeyComparator : public Comparator {
  private:
   const Comparator* user_comparator_;
+  // True when user_comparator_ is the built-in bytewise comparator;
+  // lets the hot Compare() path use an inline byte comparison instead
+  // of a virtual call per comparison.
+  bool user_is_bytewise_;
 
  public:
-  explicit InternalKeyComparator(const Comparator* c) : user_comparator_(c) {}
+  explicit InternalKeyComparator(const Comparator* c)
+      : user_comparator_(c), user_is_bytewise_(c == BytewiseComparator()) {}
   const char* Name() const override;
   int Compare(const Slice& a, const Slice& b) const override;
   void FindShortestSeparator(std::string* start,
                              const Slice& limit) const override;
   void FindShortSuccessor(std::string* key) const override;
+  bool OrderPreservingPrefix(const Slice& key,
+                             uint32_t* prefix) const override;
 
   const Comparator* user_comparator() const { return user_comparator_; }
 
@@ -177,7 +200,7 @@ inline bool ParseInternalKey(const Slice& internal_key,
   result->sequence = num >> 8;
   result->type = static_cast<ValueType>(c);
   result->user_key = Slice(internal_key.data(), n - 8);
-  return (c <= static_cast<uint8_t>(kTypeValue));
+  return (c <= static_cast<uint8_t>(kTypeBlobHandle));
 }
 
 // A helper class useful for DBImpl::Get()
@@ -16,6 +16,7 @@
 #include "leveldb/options.h"
 #include "leveldb/status.h"
 #include "leveldb/table.h"
+#include "table/format.h"
 #include "leveldb/write_batch.h"
 #include "util/logging.h"
 
@@ -211,6 +212,94 @@ Status DumpTable(Env* env, const std::string& fname, WritableFile* dst) {
 
 }  // namespace
 
+Status DumpTableStats(Env* env, const std::string& fname, WritableFile* dst) {
+  uint64_t file_size;
+  Status s = env->GetFileSize(fname, &file_size);
+  if (!s.ok()) {
+    return s;
+  }
+  RandomAccessFile* file = nullptr;
+  s = env->NewRandomAccessFile(fname, &file);
+  if (!s.ok()) {
+    return s;
+  }
+  Table* table = nullptr;
+  Options options;  // Bytewise index ordering is fine for geometry
+  s = Table::Open(options, file, file_size, &table);
+  if (!s.ok()) {
+    delete file;
+    return s;
+  }
+
+  char buf[200];
+  std::snprintf(buf, sizeof(buf), "%s: %llu bytes\n", fname.c_str(),
+                static_cast<unsigned long long>(file_size));
+  dst->Append(buf);
+
+  const TableProperties& properties = table->GetProperties();
+  std::snprintf(buf, sizeof(buf),
+                "properties: entries=%llu deletions=%llu raw_key=%llu "
+                "raw_value=%llu\n",
+                static_cast<unsigned long long>(properties.num_entries),
+                static_cast<unsigned long long>(properties.num_deletions),
+                static_cast<unsigned long long>(properties.raw_key_bytes),
+                static_cast<unsigned long long>(properties.raw_value_bytes));
+  dst->Append(buf);
+
+  // Walk the index only: per-block stored sizes and sampled keys.
+  Iterator* index = table->IndexBlockIterator(ReadOptions());
+  uint64_t blocks = 0, stored_bytes = 0, min_block = ~0ull, max_block = 0;
+  std::string first_key, last_key;
+  for (index->SeekToFirst(); index->Valid(); index->Next()) {
+    Slice value = index->value();
+    BlockHandle handle;
+    if (handle.DecodeFrom(&value).ok()) {
+      blocks++;
+      stored_bytes += handle.size();
+      if (handle.size() < min_block) min_block = handle.size();
+      if (handle.size() > max_block) max_block = handle.size();
+    }
+    if (first_key.empty()) {
+      first_key = EscapeString(index->key());
+    }
+    last_key = EscapeString(index->key());
+    if (blocks % 16 == 1) {
+      std::string line = "  block ";
+      AppendNumberTo(&line, blocks);
+      line.append(" last-key ");
+      line.append(EscapeString(index->key()));
+      line.push_back('\n');
+      dst->Append(line);
+    }
+  }
+  s = index->status();
+  delete index;
+
+  if (blocks > 0) {
+    const uint64_t raw =
+        properties.raw_key_bytes + properties.raw_value_bytes;
+    std::snprintf(
+        buf, sizeof(buf),
+        "blocks: %llu, stored %llu bytes (avg %llu, min %llu, max %llu)%s",
+        static_cast<unsigned long long>(blocks),
+        static_cast<unsigned long long>(stored_bytes),
+        static_cast<unsigned long long>(stored_bytes / blocks),
+        static_cast<unsigned long long>(min_block),
+        static_cast<unsigned long long>(max_block), "\n");
+    dst->Append(buf);
+    if (raw > 0) {
+      std::snprintf(buf, sizeof(buf), "compression: %.1f%% of raw\n",
+                    100.0 * stored_bytes / raw);
+      dst->Append(buf);
+    }
+    dst->Append("range: " + first_key + " .. " + last_key + "\n");
+  }
+
+  delete table;
+  delete file;
+  return s;
+}
+
 Status DumpFile(Env* env, const std::string& fname, WritableFile* dst) {
   FileType ftype;
   if (!GuessType(fname, &ftype)) {
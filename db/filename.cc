@@ -30,6 +30,10 @@ std::string LogFileName(const std::string& dbname, uint64_t number) {
   return MakeFileName(dbname, number, "log");
 }
 
+std::string BlobFileName(const std::string& dbname, uint64_t number) {
+  return MakeFileName(dbname, number, "blob");
+}
+
 std::string TableFileName(const std::string& dbname, uint64_t number) {
   assert(number > 0);
   return MakeFileName(dbname, number, "ldb");
@@ -110,6 +114,8 @@ bool ParseFileName(const std::string& filename, uint64_t* number,
       *type = kLogFile;
     } else if (suffix == Slice(".sst") || suffix == Slice(".ldb")) {
       *type = kTableFile;
+    } else if (suffix == Slice(".blob")) {
+      *type = kBlobFile;
     } else if (suffix == Slice(".dbtmp")) {
       *type = kTempFile;
     } else {
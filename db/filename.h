@@ -25,7 +25,8 @@ enum FileType {
   kDescriptorFile,
   kCurrentFile,
   kTempFile,
-  kInfoLogFile  // Either the current one, or an old one
+  kInfoLogFile,  // Either the current one, or an old one
+  kBlobFile      // Companion blob-value file of a table file
 };
 
 // Return the name of the log file with the specified number
@@ -33,6 +34,11 @@ enum FileType {
 // "dbname".
 std::string LogFileName(const std::string& dbname, uint64_t number);
 
+// Return the name of the blob-value file with the specified number
+// in the db named by "dbname".  The result will be prefixed with
+// "dbname".
+std::string BlobFileName(const std::string& dbname, uint64_t number);
+
 // Return the name of the sstable with the specified number
 // in the db named by "dbname".  The result will be prefixed with
 // "dbname".
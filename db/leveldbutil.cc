@@ -22,6 +22,19 @@ class StdoutPrinter : public WritableFile {
   Status Sync() override { return Status::OK(); }
 };
 
+bool HandleStatsCommand(Env* env, char** files, int num) {
+  StdoutPrinter printer;
+  bool ok = true;
+  for (int i = 0; i < num; i++) {
+    Status s = DumpTableStats(env, files[i], &printer);
+    if (!s.ok()) {
+      std::fprintf(stderr, "%s\n", s.ToString().c_str());
+      ok = false;
+    }
+  }
+  return ok;
+}
+
 bool HandleDumpCommand(Env* env, char** files, int num) {
   StdoutPrinter printer;
   bool ok = true;
@@ -42,7 +55,8 @@ static void Usage() {
   std::fprintf(
       stderr,
       "Usage: leveldbutil command...\n"
-      "   dump files...         -- dump contents of specified files\n");
+      "   dump files...         -- dump contents of specified files\n"
+      "   stats tables...       -- summarize table files (index/meta only)\n");
 }
 
 int main(int argc, char** argv) {
@@ -55,6 +69,8 @@ int main(int argc, char** argv) {
     std::string command = argv[1];
     if (command == "dump") {
       ok = leveldb::HandleDumpCommand(env, argv + 2, argc - 2);
+    } else if (command == "stats") {
+      ok = leveldb::HandleStatsCommand(env, argv + 2, argc - 2);
     } else {
       Usage();
       ok = false;
@@ -20,15 +20,39 @@ enum RecordType {
   // For fragments
   kFirstType = 2,
   kMiddleType = 3,
-  kLastType = 4
+  kLastType = 4,
+
+  // Recyclable variants of the four types above, written to reused log
+  // files.  Their (longer) header carries the log number, letting the
+  // reader reject stale records left over from the file's previous
+  // life.
+  kRecyclableFullType = 5,
+  kRecyclableFirstType = 6,
+  kRecyclableMiddleType = 7,
+  kRecyclableLastType = 8
 };
-static const int kMaxRecordType = kLastType;
+static const int kMaxRecordType = kRecyclableLastType;
 
 static const int kBlockSize = 32768;
 
 // Header is checksum (4 bytes), length (2 bytes), type (1 byte).
 static const int kHeaderSize = 4 + 2 + 1;
 
+// Recyclable records additionally carry the log number (4 bytes).
+static const int kRecyclableHeaderSize = kHeaderSize + 4;
+
+// A v2 log file begins with an ordinary kFullType record whose payload
+// is this magic number (fixed32), the block size (fixed32) and a flags
+// byte.  log::Reader adopts the advertised parameters when it sees the
+// header; files without it are read with the classic format above.
+static const uint32_t kV2HeaderMagic = 0x326c6177;  // "wal2"
+static const int kV2HeaderPayloadSize = 4 + 4 + 1;
+
+// Flags stored in the v2 header.  When kV2FlagCompressed is set, every
+// subsequent record payload starts with one byte: 0 for raw contents,
+// 1 for snappy-compressed contents.
+static const unsigned char kV2FlagCompressed = 1;
+
 }  // namespace log
 }  // namespace leveldb
 
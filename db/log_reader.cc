@@ -5,8 +5,10 @@
 #include "db/log_reader.h"
 
 #include <cstdio>
+#include <cstring>
 
 #include "leveldb/env.h"
+#include "port/port.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
 
@@ -16,13 +18,19 @@ namespace log {
 Reader::Reporter::~Reporter() = default;
 
 Reader::Reader(SequentialFile* file, Reporter* reporter, bool checksum,
-               uint64_t initial_offset)
+               uint64_t initial_offset, uint32_t expected_log_number)
     : file_(file),
       reporter_(reporter),
       checksum_(checksum),
       backing_store_(new char[kBlockSize]),
       buffer_(),
+      expected_log_number_(expected_log_number),
+      saw_recyclable_(false),
+      last_header_size_(kHeaderSize),
       eof_(false),
+      block_size_(kBlockSize),
+      header_checked_(initial_offset > 0),
+      compressed_(false),
       last_record_offset_(0),
       end_of_buffer_offset_(0),
       initial_offset_(initial_offset),
@@ -54,6 +62,90 @@ bool Reader::SkipToInitialBlock() {
 }
 
 bool Reader::ReadRecord(Slice* record, std::string* scratch) {
+  while (ReadLogicalRecord(record, scratch)) {
+    if (!header_checked_) {
+      header_checked_ = true;
+      if (record->size() == kV2HeaderPayloadSize &&
+          DecodeFixed32(record->data()) == kV2HeaderMagic) {
+        const uint32_t block_size = DecodeFixed32(record->data() + 4);
+        compressed_ =
+            ((*record)[8] & static_cast<char>(kV2FlagCompressed)) != 0;
+        if (block_size != block_size_ && !AdoptBlockSize(block_size)) {
+          return false;
+        }
+        continue;  // The header is not a user record.
+      }
+    }
+    if (compressed_) {
+      if (record->empty()) {
+        ReportCorruption(0, "missing compression tag");
+        continue;
+      }
+      const char tag = (*record)[0];
+      record->remove_prefix(1);
+      if (tag == 1) {
+        size_t uncompressed_length;
+        if (!port::Snappy_GetUncompressedLength(record->data(), record->size(),
+                                                &uncompressed_length)) {
+          ReportCorruption(record->size(), "corrupted compressed record");
+          continue;
+        }
+        decompressed_.resize(uncompressed_length);
+        if (!port::Snappy_Uncompress(record->data(), record->size(),
+                                     &decompressed_[0])) {
+          ReportCorruption(record->size(), "corrupted compressed record");
+          continue;
+        }
+        *record = Slice(decompressed_);
+      } else if (tag != 0) {
+        ReportCorruption(record->size(), "unknown compression tag");
+        continue;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+bool Reader::AdoptBlockSize(uint32_t block_size) {
+  // Only larger multiples of kBlockSize can be adopted mid-stream: the
+  // data so far was read in kBlockSize chunks, so the extra bytes of
+  // the first (larger) block must be fetched to stay block aligned.
+  if (block_size < kBlockSize || block_size % kBlockSize != 0 ||
+      block_size > (1u << 26)) {
+    ReportCorruption(kV2HeaderPayloadSize, "implausible log block size");
+    return false;
+  }
+  char* new_store = new char[block_size];
+  const size_t have = buffer_.size();
+  std::memcpy(new_store, buffer_.data(), have);
+  if (!eof_) {
+    const size_t want = block_size - kBlockSize;
+    Slice extra;
+    Status status = file_->Read(want, &extra, new_store + have);
+    if (!status.ok()) {
+      delete[] new_store;
+      ReportDrop(want, status);
+      return false;
+    }
+    if (extra.data() != new_store + have) {
+      std::memmove(new_store + have, extra.data(), extra.size());
+    }
+    end_of_buffer_offset_ += extra.size();
+    if (extra.size() < want) {
+      eof_ = true;
+    }
+    buffer_ = Slice(new_store, have + extra.size());
+  } else {
+    buffer_ = Slice(new_store, have);
+  }
+  delete[] backing_store_;
+  backing_store_ = new_store;
+  block_size_ = block_size;
+  return true;
+}
+
+bool Reader::ReadLogicalRecord(Slice* record, std::string* scratch) {
   if (last_record_offset_ < initial_offset_) {
     if (!SkipToInitialBlock()) {
       return false;
@@ -74,8 +166,8 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch) {
     // ReadPhysicalRecord may have only had an empty trailer remaining in its
     // internal buffer. Calculate the offset of the next physical record now
     // that it has returned, properly accounting for its header size.
-    uint64_t physical_record_offset =
-        end_of_buffer_offset_ - buffer_.size() - kHeaderSize - fragment.size();
+    uint64_t physical_record_offset = end_of_buffer_offset_ - buffer_.size() -
+                                      last_header_size_ - fragment.size();
 
     if (resyncing_) {
       if (record_type == kMiddleType) {
@@ -192,14 +284,14 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result) {
       if (!eof_) {
         // Last read was a full read, so this is a trailer to skip
         buffer_.clear();
-        Status status = file_->Read(kBlockSize, &buffer_, backing_store_);
+        Status status = file_->Read(block_size_, &buffer_, backing_store_);
         end_of_buffer_offset_ += buffer_.size();
         if (!status.ok()) {
           buffer_.clear();
-          ReportDrop(kBlockSize, status);
+          ReportDrop(block_size_, status);
           eof_ = true;
           return kEof;
-        } else if (buffer_.size() < kBlockSize) {
+        } else if (buffer_.size() < block_size_) {
           eof_ = true;
         }
         continue;
@@ -217,9 +309,18 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result) {
     const char* header = buffer_.data();
     const uint32_t a = static_cast<uint32_t>(header[4]) & 0xff;
     const uint32_t b = static_cast<uint32_t>(header[5]) & 0xff;
-    const unsigned int type = header[6];
+    unsigned int type = header[6];
     const uint32_t length = a | (b << 8);
-    if (kHeaderSize + length > buffer_.size()) {
+    const bool recyclable =
+        (type >= kRecyclableFullType && type <= kRecyclableLastType);
+    const size_t header_size =
+        recyclable ? kRecyclableHeaderSize : kHeaderSize;
+    if (recyclable && buffer_.size() < kRecyclableHeaderSize) {
+      // Truncated recyclable header at the tail: writer died mid-write.
+      buffer_.clear();
+      return kEof;
+    }
+    if (header_size + length > buffer_.size()) {
       size_t drop_size = buffer_.size();
       buffer_.clear();
       if (!eof_) {
@@ -243,7 +344,10 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result) {
     // Check crc
     if (checksum_) {
       uint32_t expected_crc = crc32c::Unmask(DecodeFixed32(header));
-      uint32_t actual_crc = crc32c::Value(header + 6, 1 + length);
+      // The crc covers the type byte, the log number when present, and
+      // the payload -- all contiguous.
+      uint32_t actual_crc =
+          crc32c::Value(header + 6, header_size - 6 + length);
       if (actual_crc != expected_crc) {
         // Drop the rest of the buffer since "length" itself may have
         // been corrupted and if we trust it, we could find some
@@ -256,16 +360,36 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result) {
       }
     }
 
-    buffer_.remove_prefix(kHeaderSize + length);
+    if (recyclable) {
+      const uint32_t record_log_number = DecodeFixed32(header + 7);
+      if (expected_log_number_ != 0 &&
+          record_log_number != expected_log_number_) {
+        // A valid record from this file's previous life; everything
+        // from here on is stale.
+        buffer_.clear();
+        return kEof;
+      }
+      saw_recyclable_ = true;
+      // Map onto the classic type so callers need not care.
+      type -= (kRecyclableFullType - kFullType);
+    } else if (saw_recyclable_ && type >= kFullType && type <= kLastType) {
+      // Classic records after recyclable ones are stale leftovers from
+      // before the file was recycled.
+      buffer_.clear();
+      return kEof;
+    }
+
+    buffer_.remove_prefix(header_size + length);
+    last_header_size_ = header_size;
 
     // Skip physical record that started before initial_offset_
-    if (end_of_buffer_offset_ - buffer_.size() - kHeaderSize - length <
+    if (end_of_buffer_offset_ - buffer_.size() - header_size - length <
         initial_offset_) {
       result->clear();
       return kBadRecord;
     }
 
-    *result = Slice(header + kHeaderSize, length);
+    *result = Slice(header + header_size, length);
     return type;
   }
 }
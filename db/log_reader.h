@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_DB_LOG_READER_H_
 
 #include <cstdint>
+#include <string>
 
 #include "db/log_format.h"
 #include "leveldb/slice.h"
@@ -40,8 +41,13 @@ class Reader {
   //
   // The Reader will start reading at the first record located at physical
   // position >= initial_offset within the file.
+  // "expected_log_number" is used for recycled log files: recyclable
+  // records carrying a different log number -- and classic records
+  // following a recyclable one -- are stale leftovers from the file's
+  // previous life and terminate the read.  Pass 0 to accept anything
+  // (tools).
   Reader(SequentialFile* file, Reporter* reporter, bool checksum,
-         uint64_t initial_offset);
+         uint64_t initial_offset, uint32_t expected_log_number = 0);
 
   Reader(const Reader&) = delete;
   Reader& operator=(const Reader&) = delete;
@@ -77,6 +83,15 @@ class Reader {
   // Returns true on success. Handles reporting.
   bool SkipToInitialBlock();
 
+  // Read the next logical record without v2 header/compression
+  // handling; same contract as ReadRecord().
+  bool ReadLogicalRecord(Slice* record, std::string* scratch);
+
+  // Adopt the block size advertised by a v2 header, realigning the
+  // read buffer so subsequent reads stay block aligned.  Returns false
+  // (after reporting) if the size is implausible or the read fails.
+  bool AdoptBlockSize(uint32_t block_size);
+
   // Return type, or one of the preceding special values
   unsigned int ReadPhysicalRecord(Slice* result);
 
@@ -88,9 +103,21 @@ class Reader {
   SequentialFile* const file_;
   Reporter* const reporter_;
   bool const checksum_;
-  char* const backing_store_;
+  char* backing_store_;  // Reallocated if a v2 header grows the block size
   Slice buffer_;
-  bool eof_;  // Last Read() indicated EOF by returning < kBlockSize
+  uint32_t const expected_log_number_;
+  bool saw_recyclable_;
+  size_t last_header_size_;
+  bool eof_;  // Last Read() indicated EOF by returning < block_size_
+
+  // Physical block size; kBlockSize until a v2 header says otherwise.
+  size_t block_size_;
+  // True once the first record has been checked for a v2 header.
+  bool header_checked_;
+  // True if record payloads carry the v2 compression tag byte.
+  bool compressed_;
+  // Holds the decompressed contents of the last compressed record.
+  std::string decompressed_;
 
   // Offset of the last record returned by ReadRecord.
   uint64_t last_record_offset_;
@@ -54,6 +54,12 @@ class LogTest : public testing::Test {
     writer_ = new Writer(&dest_, dest_.contents_.size());
   }
 
+  void ReopenAsV2(size_t block_size, bool compress) {
+    delete writer_;
+    dest_.contents_.clear();
+    writer_ = new Writer(&dest_, block_size, compress);
+  }
+
   void Write(const std::string& msg) {
     ASSERT_TRUE(!reading_) << "Write() after starting to read";
     writer_->AddRecord(Slice(msg));
@@ -273,6 +279,30 @@ TEST_F(LogTest, ReadWrite) {
   ASSERT_EQ("EOF", Read());  // Make sure reads at eof work
 }
 
+TEST_F(LogTest, V2CompressedReadWrite) {
+  ReopenAsV2(kBlockSize, true);
+  Write("foo");
+  Write(std::string(100000, 'x'));  // Compressible and block spanning
+  Write("");
+  Write("bar");
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ(std::string(100000, 'x'), Read());
+  ASSERT_EQ("", Read());
+  ASSERT_EQ("bar", Read());
+  ASSERT_EQ("EOF", Read());
+}
+
+TEST_F(LogTest, V2LargerBlockSize) {
+  ReopenAsV2(4 * kBlockSize, false);
+  Write("foo");
+  Write(BigString("A", 200000));  // Spans several of the larger blocks
+  Write("bar");
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ(BigString("A", 200000), Read());
+  ASSERT_EQ("bar", Read());
+  ASSERT_EQ("EOF", Read());
+}
+
 TEST_F(LogTest, ManyBlocks) {
   for (int i = 0; i < 100000; i++) {
     Write(NumberString(i));
@@ -4,9 +4,13 @@
 
 #include "db/log_writer.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "leveldb/env.h"
+#include "port/port.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
 
@@ -20,18 +24,146 @@ static void InitTypeCrc(uint32_t* type_crc) {
   }
 }
 
-Writer::Writer(WritableFile* dest) : dest_(dest), block_offset_(0) {
+Writer::Writer(WritableFile* dest)
+    : dest_(dest),
+      block_offset_(0),
+      block_size_(kBlockSize),
+      compress_(false),
+      header_pending_(false) {
   InitTypeCrc(type_crc_);
 }
 
 Writer::Writer(WritableFile* dest, uint64_t dest_length)
-    : dest_(dest), block_offset_(dest_length % kBlockSize) {
+    : dest_(dest),
+      block_offset_(dest_length % kBlockSize),
+      block_size_(kBlockSize),
+      compress_(false),
+      header_pending_(false) {
+  InitTypeCrc(type_crc_);
+}
+
+Writer::Writer(WritableFile* dest, size_t block_size, bool compress)
+    : dest_(dest),
+      block_offset_(0),
+      block_size_(block_size),
+      compress_(compress),
+      header_pending_(true) {
+  assert(block_size >= kBlockSize && block_size % kBlockSize == 0);
   InitTypeCrc(type_crc_);
 }
 
 Writer::~Writer() = default;
 
 Status Writer::AddRecord(const Slice& slice) {
+  if (header_pending_) {
+    header_pending_ = false;
+    char header[kV2HeaderPayloadSize];
+    EncodeFixed32(header, kV2HeaderMagic);
+    EncodeFixed32(header + 4, static_cast<uint32_t>(block_size_));
+    header[8] = compress_ ? kV2FlagCompressed : 0;
+    Status s = EmitRecord(Slice(header, kV2HeaderPayloadSize));
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  if (compress_) {
+    // One tag byte, then either the snappy-compressed payload (tag 1)
+    // or the raw payload when compression does not help (tag 0).
+    std::string compressed;
+    std::string payload;
+    if (port::Snappy_Compress(slice.data(), slice.size(), &compressed) &&
+        compressed.size() < slice.size()) {
+      payload.push_back(1);
+      payload.append(compressed);
+    } else {
+      payload.push_back(0);
+      payload.append(slice.data(), slice.size());
+    }
+    return EmitRecord(Slice(payload));
+  }
+  return EmitRecord(slice);
+}
+
+Status Writer::AddRecordV(const Slice* slices, size_t count) {
+  if (compress_ || header_pending_) {
+    // Compression needs the whole payload in one piece anyway.
+    std::string assembled;
+    for (size_t i = 0; i < count; i++) {
+      assembled.append(slices[i].data(), slices[i].size());
+    }
+    return AddRecord(assembled);
+  }
+
+  size_t left = 0;
+  for (size_t i = 0; i < count; i++) {
+    left += slices[i].size();
+  }
+
+  // Cursor into the gather list.
+  size_t slice_index = 0;
+  size_t slice_offset = 0;
+
+  Status s;
+  bool begin = true;
+  std::vector<Slice> parts;
+  do {
+    const int leftover = static_cast<int>(block_size_) - block_offset_;
+    assert(leftover >= 0);
+    if (leftover < header_size()) {
+      if (leftover > 0) {
+        static_assert(kRecyclableHeaderSize == 11, "");
+        dest_->Append(
+            Slice("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", leftover));
+      }
+      block_offset_ = 0;
+    }
+    assert(static_cast<int>(block_size_) - block_offset_ - header_size() >= 0);
+
+    size_t avail = block_size_ - block_offset_ - header_size();
+    if (avail > 0xffff) {
+      // The header's length field is two bytes; a large v2 block takes
+      // several physical records.
+      avail = 0xffff;
+    }
+    const size_t fragment_length = (left < avail) ? left : avail;
+
+    RecordType type;
+    const bool end = (left == fragment_length);
+    if (begin && end) {
+      type = kFullType;
+    } else if (begin) {
+      type = kFirstType;
+    } else if (end) {
+      type = kLastType;
+    } else {
+      type = kMiddleType;
+    }
+
+    parts.clear();
+    size_t need = fragment_length;
+    while (need > 0) {
+      const Slice& current = slices[slice_index];
+      if (slice_offset == current.size()) {
+        slice_index++;
+        slice_offset = 0;
+        continue;
+      }
+      const size_t take = std::min(need, current.size() - slice_offset);
+      parts.push_back(Slice(current.data() + slice_offset, take));
+      slice_offset += take;
+      need -= take;
+    }
+
+    s = EmitPhysicalRecordV(type, parts.data(), parts.size(),
+                            fragment_length);
+    left -= fragment_length;
+    begin = false;
+  } while (s.ok() && left > 0);
+  return s;
+}
+
+Status Writer::EmitRecord(const Slice& slice) {
   const char* ptr = slice.data();
   size_t left = slice.size();
 
@@ -41,22 +173,28 @@ Status Writer::AddRecord(const Slice& slice) {
   Status s;
   bool begin = true;
   do {
-    const int leftover = kBlockSize - block_offset_;
+    const int leftover = static_cast<int>(block_size_) - block_offset_;
     assert(leftover >= 0);
-    if (leftover < kHeaderSize) {
+    if (leftover < header_size()) {
       // Switch to a new block
       if (leftover > 0) {
-        // Fill the trailer (literal below relies on kHeaderSize being 7)
-        static_assert(kHeaderSize == 7, "");
-        dest_->Append(Slice("\x00\x00\x00\x00\x00\x00", leftover));
+        // Fill the trailer (literal holds kRecyclableHeaderSize-1 zeros)
+        static_assert(kRecyclableHeaderSize == 11, "");
+        dest_->Append(
+            Slice("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", leftover));
       }
       block_offset_ = 0;
     }
 
-    // Invariant: we never leave < kHeaderSize bytes in a block.
-    assert(kBlockSize - block_offset_ - kHeaderSize >= 0);
+    // Invariant: we never leave < header_size() bytes in a block.
+    assert(static_cast<int>(block_size_) - block_offset_ - header_size() >= 0);
 
-    const size_t avail = kBlockSize - block_offset_ - kHeaderSize;
+    size_t avail = block_size_ - block_offset_ - header_size();
+    if (avail > 0xffff) {
+      // The header's length field is two bytes; a large v2 block takes
+      // several physical records.
+      avail = 0xffff;
+    }
     const size_t fragment_length = (left < avail) ? left : avail;
 
     RecordType type;
@@ -79,31 +217,79 @@ Status Writer::AddRecord(const Slice& slice) {
   return s;
 }
 
+Status Writer::EmitPhysicalRecordV(RecordType t, const Slice* parts,
+                                   size_t num_parts, size_t length) {
+  assert(length <= 0xffff);  // Must fit in two bytes
+  assert(block_offset_ + header_size() + static_cast<int>(length) <=
+         static_cast<int>(block_size_));
+
+  char buf[kRecyclableHeaderSize];
+  buf[4] = static_cast<char>(length & 0xff);
+  buf[5] = static_cast<char>(length >> 8);
+  if (recycle_log_number_ != 0) {
+    t = static_cast<RecordType>(t + (kRecyclableFullType - kFullType));
+    EncodeFixed32(buf + 7, recycle_log_number_);
+  }
+  buf[6] = static_cast<char>(t);
+
+  uint32_t crc = type_crc_[t];
+  if (recycle_log_number_ != 0) {
+    crc = crc32c::Extend(crc, buf + 7, 4);
+  }
+  for (size_t i = 0; i < num_parts; i++) {
+    crc = crc32c::Extend(crc, parts[i].data(), parts[i].size());
+  }
+  EncodeFixed32(buf, crc32c::Mask(crc));
+
+  // One gather append for the header and every payload piece.
+  std::vector<Slice> gather;
+  gather.reserve(num_parts + 1);
+  gather.push_back(Slice(buf, header_size()));
+  for (size_t i = 0; i < num_parts; i++) {
+    gather.push_back(parts[i]);
+  }
+  Status s = dest_->AppendV(gather.data(), gather.size());
+  if (s.ok()) {
+    s = dest_->Flush();
+  }
+  block_offset_ += header_size() + length;
+  return s;
+}
+
 Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr,
                                   size_t length) {
   assert(length <= 0xffff);  // Must fit in two bytes
-  assert(block_offset_ + kHeaderSize + length <= kBlockSize);
+  assert(block_offset_ + header_size() + static_cast<int>(length) <=
+         static_cast<int>(block_size_));
 
   // Format the header
-  char buf[kHeaderSize];
+  char buf[kRecyclableHeaderSize];
   buf[4] = static_cast<char>(length & 0xff);
   buf[5] = static_cast<char>(length >> 8);
+  if (recycle_log_number_ != 0) {
+    t = static_cast<RecordType>(t + (kRecyclableFullType - kFullType));
+    EncodeFixed32(buf + 7, recycle_log_number_);
+  }
   buf[6] = static_cast<char>(t);
 
   // Compute the crc of the record type and the payload.
-  uint32_t crc = crc32c::Extend(type_crc_[t], ptr, length);
+  uint32_t crc = type_crc_[t];
+  if (recycle_log_number_ != 0) {
+    crc = crc32c::Extend(crc, buf + 7, 4);
+  }
+  crc = crc32c::Extend(crc, ptr, length);
   crc = crc32c::Mask(crc);  // Adjust for storage
   EncodeFixed32(buf, crc);
 
   // Write the header and the payload
-  Status s = dest_->Append(Slice(buf, kHeaderSize));
+  Status s = dest_->Append(Slice(buf, header_size()));
   if (s.ok()) {
     s = dest_->Append(Slice(ptr, length));
     if (s.ok()) {
       s = dest_->Flush();
     }
   }
-  block_offset_ += kHeaderSize + length;
+  block_offset_ += header_size() + length;
   return s;
 }
 
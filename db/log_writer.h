@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_DB_LOG_WRITER_H_
 
 #include <cstdint>
+#include <string>
 
 #include "db/log_format.h"
 #include "leveldb/slice.h"
@@ -29,18 +30,52 @@ class Writer {
   // "*dest" must remain live while this Writer is in use.
   Writer(WritableFile* dest, uint64_t dest_length);
 
+  // Create a v2 writer that will append data to "*dest" using the
+  // given block size (a multiple of kBlockSize) and, if "compress" is
+  // true, snappy-compressing each record payload.  A header record
+  // advertising these parameters is emitted before the first record.
+  // "*dest" must be initially empty.
+  Writer(WritableFile* dest, size_t block_size, bool compress);
+
   Writer(const Writer&) = delete;
   Writer& operator=(const Writer&) = delete;
 
   ~Writer();
 
+  // Mark this writer as targeting a recycled log file: every record is
+  // emitted in the recyclable format carrying "log_number", so a
+  // reader can tell fresh records from stale bytes left over from the
+  // file's previous life.  Must be called before the first record.
+  void SetRecycleLogNumber(uint32_t log_number) {
+    recycle_log_number_ = log_number;
+  }
+
   Status AddRecord(const Slice& slice);
 
+  // Emit the concatenation of "slices" as one logical record, without
+  // first assembling it into a contiguous buffer: each physical
+  // record's payload is handed to the file as a gather list
+  // (WritableFile::AppendV).  Equivalent on disk to AddRecord() over
+  // the concatenated bytes.
+  Status AddRecordV(const Slice* slices, size_t count);
+
  private:
+  // Fragment "slice" into physical records and emit them.
+  Status EmitRecord(const Slice& slice);
   Status EmitPhysicalRecord(RecordType type, const char* ptr, size_t length);
+  Status EmitPhysicalRecordV(RecordType type, const Slice* parts,
+                             size_t num_parts, size_t length);
+
+  int header_size() const {
+    return recycle_log_number_ != 0 ? kRecyclableHeaderSize : kHeaderSize;
+  }
 
   WritableFile* dest_;
   int block_offset_;  // Current offset in block
+  uint32_t recycle_log_number_ = 0;
+  size_t block_size_;
+  bool compress_;        // Compress record payloads (v2 only)
+  bool header_pending_;  // v2 header record not yet written
 
   // crc32c values for all supported record types.  These are
   // pre-computed to reduce the overhead of computing the crc of the
@@ -8,6 +8,8 @@
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
 #include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
@@ -18,8 +20,127 @@ static Slice GetLengthPrefixedSlice(const char* data) {
   return Slice(p, len);
 }
 
-MemTable::MemTable(const InternalKeyComparator& comparator)
-    : comparator_(comparator), refs_(0), table_(comparator_, &arena_) {}
+MemTable::MemTable(const InternalKeyComparator& comparator,
+                   ArenaBlockPool* pool, bool hash_index,
+                   bool value_checksums, NegativeCacheStamps* negative_stamps,
+                   bool compress_values)
+    : comparator_(comparator),
+      refs_(0),
+      arena_(pool),
+      table_(comparator_, &arena_),
+      has_range_dels_(false),
+      use_hash_index_(hash_index),
+      value_checksums_(value_checksums),
+      negative_stamps_(negative_stamps),
+      compress_values_(compress_values),
+      hash_array_(nullptr),
+      hash_entries_(0) {}
+
+bool DecodeMemTableValue(Slice* v, std::string* scratch) {
+  if (v->empty()) {
+    return false;
+  }
+  const char tag = (*v)[0];
+  v->remove_prefix(1);
+  if (tag == 0) {
+    return true;
+  }
+  if (tag != 1) {
+    return false;
+  }
+  size_t length;
+  if (!port::Snappy_GetUncompressedLength(v->data(), v->size(), &length)) {
+    return false;
+  }
+  const size_t old_size = scratch->size();
+  scratch->resize(old_size + length);
+  if (!port::Snappy_Uncompress(v->data(), v->size(), &(*scratch)[old_size])) {
+    return false;
+  }
+  *v = Slice(scratch->data() + old_size, length);
+  return true;
+}
+
+void NegativeCacheStamps::Stamp(const Slice& user_key, uint64_t seq) {
+  std::atomic<uint64_t>& slot =
+      slots[Hash(user_key.data(), user_key.size(), 0x9e3779b9) % kSlots];
+  uint64_t current = slot.load(std::memory_order_relaxed);
+  while (current < seq &&
+         !slot.compare_exchange_weak(current, seq,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t NegativeCacheStamps::LastWrite(const Slice& user_key) const {
+  const uint64_t slot =
+      slots[Hash(user_key.data(), user_key.size(), 0x9e3779b9) % kSlots].load(
+          std::memory_order_acquire);
+  const uint64_t range = range_stamp.load(std::memory_order_acquire);
+  return slot > range ? slot : range;
+}
+
+MemTable::HashArray* MemTable::NewHashArray(size_t capacity) {
+  const size_t bytes =
+      sizeof(HashArray) + (capacity - 1) * sizeof(std::atomic<const char*>);
+  HashArray* array = reinterpret_cast<HashArray*>(
+      arena_.AllocateAligned(bytes));
+  array->capacity = capacity;
+  for (size_t i = 0; i < capacity; i++) {
+    array->slots[i].store(nullptr, std::memory_order_relaxed);
+  }
+  return array;
+}
+
+// Extract the user key of a skiplist entry.
+static Slice EntryUserKey(const char* entry) {
+  uint32_t key_length;
+  const char* key_ptr = GetVarint32Ptr(entry, entry + 5, &key_length);
+  return Slice(key_ptr, key_length - 8);
+}
+
+void MemTable::HashInsert(const char* entry) {
+  HashArray* array = hash_array_.load(std::memory_order_relaxed);
+  if (array == nullptr) {
+    array = NewHashArray(1 << 12);
+    hash_array_.store(array, std::memory_order_release);
+  } else if (hash_entries_ * 3 > array->capacity * 2) {
+    // Grow and republish; readers holding the old array still see a
+    // correct (if slightly stale) view, and both live in the arena.
+    HashArray* grown = NewHashArray(array->capacity * 2);
+    for (size_t i = 0; i < array->capacity; i++) {
+      const char* e = array->slots[i].load(std::memory_order_relaxed);
+      if (e != nullptr) {
+        const Slice user_key = EntryUserKey(e);
+        size_t j = Hash(user_key.data(), user_key.size(), 0) &
+                   (grown->capacity - 1);
+        while (grown->slots[j].load(std::memory_order_relaxed) != nullptr) {
+          j = (j + 1) & (grown->capacity - 1);
+        }
+        grown->slots[j].store(e, std::memory_order_relaxed);
+      }
+    }
+    hash_array_.store(grown, std::memory_order_release);
+    array = grown;
+  }
+
+  const Slice user_key = EntryUserKey(entry);
+  size_t i = Hash(user_key.data(), user_key.size(), 0) & (array->capacity - 1);
+  while (true) {
+    const char* existing = array->slots[i].load(std::memory_order_relaxed);
+    if (existing == nullptr) {
+      array->slots[i].store(entry, std::memory_order_release);
+      hash_entries_++;
+      return;
+    }
+    if (comparator_.comparator.user_comparator()->Compare(
+            EntryUserKey(existing), user_key) == 0) {
+      // Newer version of the same key replaces the old entry.
+      array->slots[i].store(entry, std::memory_order_release);
+      return;
+    }
+    i = (i + 1) & (array->capacity - 1);
+  }
+}
 
 MemTable::~MemTable() { assert(refs_ == 0); }
 
@@ -45,7 +166,8 @@ static const char* EncodeKey(std::string* scratch, const Slice& target) {
 
 class MemTableIterator : public Iterator {
  public:
-  explicit MemTableIterator(MemTable::Table* table) : iter_(table) {}
+  MemTableIterator(MemTable::Table* table, bool compressed_values)
+      : iter_(table), compressed_values_(compressed_values) {}
 
   MemTableIterator(const MemTableIterator&) = delete;
   MemTableIterator& operator=(const MemTableIterator&) = delete;
@@ -61,17 +183,61 @@ class MemTableIterator : public Iterator {
   Slice key() const override { return GetLengthPrefixedSlice(iter_.key()); }
   Slice value() const override {
     Slice key_slice = GetLengthPrefixedSlice(iter_.key());
-    return GetLengthPrefixedSlice(key_slice.data() + key_slice.size());
+    Slice v = GetLengthPrefixedSlice(key_slice.data() + key_slice.size());
+    if (compressed_values_) {
+      const uint64_t tag =
+          DecodeFixed64(key_slice.data() + key_slice.size() - 8);
+      if (static_cast<ValueType>(tag & 0xff) == kTypeValue) {
+        scratch_.clear();
+        if (!DecodeMemTableValue(&v, &scratch_)) {
+          v = Slice();  // Corrupt; surfaced by checksums downstream
+        }
+      }
+    }
+    return v;
   }
 
   Status status() const override { return Status::OK(); }
 
  private:
   MemTable::Table::Iterator iter_;
-  std::string tmp_;  // For passing to EncodeKey
+  const bool compressed_values_;
+  std::string tmp_;              // For passing to EncodeKey
+  mutable std::string scratch_;  // Decompressed value storage
 };
 
-Iterator* MemTable::NewIterator() { return new MemTableIterator(&table_); }
+Iterator* MemTable::NewIterator() {
+  return new MemTableIterator(&table_, compress_values_);
+}
+
+// Check the trailing crc32c of a checksummed value against the user
+// key and contents, and strip it from *v.  Returns false on mismatch.
+bool VerifyValueChecksum(const Slice& user_key, Slice* v) {
+  if (v->size() < 4) {
+    return false;
+  }
+  const size_t data_size = v->size() - 4;
+  uint32_t crc = crc32c::Value(user_key.data(), user_key.size());
+  crc = crc32c::Extend(crc, v->data(), data_size);
+  if (crc32c::Unmask(DecodeFixed32(v->data() + data_size)) != crc) {
+    return false;
+  }
+  *v = Slice(v->data(), data_size);
+  return true;
+}
+
+bool MemTable::KeyComparator::HasKeyPrefixes() const {
+  uint32_t unused;
+  return comparator.user_comparator()->OrderPreservingPrefix(Slice(), &unused);
+}
+
+bool MemTable::KeyComparator::KeyPrefix(const char* entry,
+                                        uint32_t* prefix) const {
+  uint32_t internal_key_length;
+  const char* p = GetVarint32Ptr(entry, entry + 5, &internal_key_length);
+  return comparator.user_comparator()->OrderPreservingPrefix(
+      Slice(p, internal_key_length - 8), prefix);
+}
 
 void MemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
                    const Slice& value) {
@@ -82,7 +248,25 @@ void MemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
   //  value_size   : varint32 of value.size()
   //  value bytes  : char[value.size()]
   size_t key_size = key.size();
-  size_t val_size = value.size();
+  // With memtable compression a kTypeValue value is stored with a tag
+  // byte and, when it helps, snappy-compressed contents.
+  Slice stored_value = value;
+  std::string compressed;
+  char value_tag = 0;
+  const bool tag_value = compress_values_ && type == kTypeValue;
+  if (tag_value && value.size() >= 64 &&
+      port::Snappy_Compress(value.data(), value.size(), &compressed) &&
+      compressed.size() < value.size()) {
+    stored_value = Slice(compressed);
+    value_tag = 1;
+  }
+  size_t val_size = stored_value.size() + (tag_value ? 1 : 0);
+  // With value checksums every stored value carries a trailing crc32c
+  // of key+value, verified on reads anywhere downstream.
+  const bool add_crc = value_checksums_ && type == kTypeValue;
+  if (add_crc) {
+    val_size += 4;
+  }
   size_t internal_key_size = key_size + 8;
   const size_t encoded_len = VarintLength(internal_key_size) +
                              internal_key_size + VarintLength(val_size) +
@@ -94,12 +278,158 @@ void MemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
   EncodeFixed64(p, (s << 8) | type);
   p += 8;
   p = EncodeVarint32(p, val_size);
-  std::memcpy(p, value.data(), val_size);
-  assert(p + val_size == buf + encoded_len);
-  table_.Insert(buf);
+  char* value_start = p;
+  if (tag_value) {
+    *value_start++ = value_tag;
+  }
+  std::memcpy(value_start, stored_value.data(), stored_value.size());
+  if (add_crc) {
+    uint32_t crc = crc32c::Value(key.data(), key.size());
+    crc = crc32c::Extend(crc, value.data(), value.size());
+    EncodeFixed32(value_start + stored_value.size(), crc32c::Mask(crc));
+  }
+  assert(value_start + stored_value.size() + (add_crc ? 4 : 0) ==
+         buf + encoded_len);
+  table_.InsertWithHint(buf, &insert_hint_);
+  if (use_hash_index_) {
+    HashInsert(buf);
+  }
+  if (negative_stamps_ != nullptr) {
+    negative_stamps_->Stamp(key, s);
+  }
+}
+
+void MemTable::AddSpan(const char* entry, size_t entry_size) {
+  char* buf = arena_.Allocate(entry_size);
+  std::memcpy(buf, entry, entry_size);
+  table_.InsertWithHint(buf, &insert_hint_);
+  if (use_hash_index_) {
+    HashInsert(buf);
+  }
+  if (negative_stamps_ != nullptr) {
+    uint32_t internal_key_length;
+    const char* p = GetVarint32Ptr(buf, buf + 5, &internal_key_length);
+    const uint64_t tag = DecodeFixed64(p + internal_key_length - 8);
+    negative_stamps_->Stamp(Slice(p, internal_key_length - 8), tag >> 8);
+  }
+}
+
+void MemTable::AddRange(SequenceNumber seq, const Slice& begin,
+                        const Slice& end) {
+  RangeTombstone tombstone;
+  tombstone.begin.assign(begin.data(), begin.size());
+  tombstone.end.assign(end.data(), end.size());
+  tombstone.seq = seq;
+  range_del_mutex_.Lock();
+  range_dels_.push_back(tombstone);
+  range_del_mutex_.Unlock();
+  has_range_dels_.store(true, std::memory_order_release);
+  if (negative_stamps_ != nullptr) {
+    uint64_t current = negative_stamps_->range_stamp.load(
+        std::memory_order_relaxed);
+    while (current < seq &&
+           !negative_stamps_->range_stamp.compare_exchange_weak(
+               current, seq, std::memory_order_release)) {
+    }
+  }
+}
+
+bool MemTable::HasRangeTombstones() const {
+  return has_range_dels_.load(std::memory_order_acquire);
+}
+
+SequenceNumber MemTable::MaxRangeTombstoneSeq(const Slice& user_key,
+                                              SequenceNumber snapshot) const {
+  if (!HasRangeTombstones()) {
+    return 0;
+  }
+  const Comparator* ucmp = comparator_.comparator.user_comparator();
+  SequenceNumber max_seq = 0;
+  range_del_mutex_.Lock();
+  for (size_t i = 0; i < range_dels_.size(); i++) {
+    const RangeTombstone& t = range_dels_[i];
+    if (t.seq <= snapshot && t.seq > max_seq &&
+        ucmp->Compare(user_key, t.begin) >= 0 &&
+        ucmp->Compare(user_key, t.end) < 0) {
+      max_seq = t.seq;
+    }
+  }
+  range_del_mutex_.Unlock();
+  return max_seq;
+}
+
+void MemTable::GetRangeTombstones(SequenceNumber snapshot,
+                                  std::vector<RangeTombstone>* out) const {
+  if (!HasRangeTombstones()) {
+    return;
+  }
+  range_del_mutex_.Lock();
+  for (size_t i = 0; i < range_dels_.size(); i++) {
+    if (range_dels_[i].seq <= snapshot) {
+      out->push_back(range_dels_[i]);
+    }
+  }
+  range_del_mutex_.Unlock();
 }
 
-bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
+bool MemTable::Get(const LookupKey& key, std::string* value, Status* s,
+                   SequenceNumber* seq) {
+  if (use_hash_index_) {
+    HashArray* array = hash_array_.load(std::memory_order_acquire);
+    if (array == nullptr) {
+      return false;  // Nothing has been added
+    }
+    const Slice user_key = key.user_key();
+    const SequenceNumber snapshot =
+        DecodeFixed64(key.internal_key().data() +
+                      key.internal_key().size() - 8) >>
+        8;
+    size_t i =
+        Hash(user_key.data(), user_key.size(), 0) & (array->capacity - 1);
+    while (true) {
+      const char* entry = array->slots[i].load(std::memory_order_acquire);
+      if (entry == nullptr) {
+        return false;  // Every added key is indexed, so this is a miss
+      }
+      uint32_t key_length;
+      const char* key_ptr = GetVarint32Ptr(entry, entry + 5, &key_length);
+      if (comparator_.comparator.user_comparator()->Compare(
+              Slice(key_ptr, key_length - 8), user_key) == 0) {
+        const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+        if ((tag >> 8) > snapshot) {
+          break;  // Newest version is past the snapshot; walk the list
+        }
+        if (seq != nullptr) {
+          *seq = tag >> 8;
+        }
+        switch (static_cast<ValueType>(tag & 0xff)) {
+          case kTypeValue: {
+            Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+            if (value_checksums_ &&
+                !VerifyValueChecksum(Slice(key_ptr, key_length - 8), &v)) {
+              *s = Status::Corruption("value checksum mismatch");
+              return true;
+            }
+            std::string scratch;
+            if (compress_values_ && !DecodeMemTableValue(&v, &scratch)) {
+              *s = Status::Corruption("corrupt compressed memtable value");
+              return true;
+            }
+            value->assign(v.data(), v.size());
+            return true;
+          }
+          case kTypeDeletion:
+            *s = Status::NotFound(Slice());
+            return true;
+          default:
+            break;  // Merge/blob entries take the ordered path
+        }
+        break;
+      }
+      i = (i + 1) & (array->capacity - 1);
+    }
+  }
+
   Slice memkey = key.memtable_key();
   Table::Iterator iter(&table_);
   iter.Seek(memkey.data());
@@ -120,9 +450,22 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
             Slice(key_ptr, key_length - 8), key.user_key()) == 0) {
       // Correct user key
       const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+      if (seq != nullptr) {
+        *seq = tag >> 8;
+      }
       switch (static_cast<ValueType>(tag & 0xff)) {
         case kTypeValue: {
           Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+          if (value_checksums_ &&
+              !VerifyValueChecksum(Slice(key_ptr, key_length - 8), &v)) {
+            *s = Status::Corruption("value checksum mismatch");
+            return true;
+          }
+          std::string scratch;
+          if (compress_values_ && !DecodeMemTableValue(&v, &scratch)) {
+            *s = Status::Corruption("corrupt compressed memtable value");
+            return true;
+          }
           value->assign(v.data(), v.size());
           return true;
         }
@@ -5,9 +5,12 @@
 #ifndef STORAGE_LEVELDB_DB_MEMTABLE_H_
 #define STORAGE_LEVELDB_DB_MEMTABLE_H_
 
+#include <atomic>
 #include <string>
+#include <vector>
 
 #include "db/dbformat.h"
+#include "port/port.h"
 #include "db/skiplist.h"
 #include "leveldb/db.h"
 #include "util/arena.h"
@@ -17,11 +20,50 @@ namespace leveldb {
 class InternalKeyComparator;
 class MemTableIterator;
 
+// Decode a possibly-compressed memtable value (first byte is the tag:
+// 0 raw, 1 snappy); appends the plain value to *scratch when
+// decompression is needed and points *v at the result.  Returns false
+// on corrupt compressed data.
+bool DecodeMemTableValue(Slice* v, std::string* scratch);
+
+// Check and strip the trailing crc32c of a checksummed value (see
+// Options::value_checksums).  Returns false on mismatch.
+bool VerifyValueChecksum(const Slice& user_key, Slice* v);
+
+// Per-key-hash write stamps backing the negative-lookup cache
+// (Options::negative_cache_size): every memtable insert records its
+// sequence under the key's hash slot, so a cached "absent" answer can
+// tell whether any later write might have created the key.
+struct NegativeCacheStamps {
+  static const size_t kSlots = 4096;
+  std::atomic<uint64_t> slots[kSlots];
+  std::atomic<uint64_t> range_stamp;  // Any range op bumps this
+
+  NegativeCacheStamps() : range_stamp(0) {
+    for (size_t i = 0; i < kSlots; i++) {
+      slots[i].store(0, std::memory_order_relaxed);
+    }
+  }
+  void Stamp(const Slice& user_key, uint64_t seq);
+  // Highest sequence that may have written "user_key".
+  uint64_t LastWrite(const Slice& user_key) const;
+};
+
 class MemTable {
  public:
   // MemTables are reference counted.  The initial reference count
   // is zero and the caller must call Ref() at least once.
-  explicit MemTable(const InternalKeyComparator& comparator);
+  // If "pool" is non-null the memtable's arena draws its blocks from
+  // it (see ArenaBlockPool); the pool must outlive the memtable.
+  // "hash_index" enables the auxiliary point-lookup index (see
+  // Options::memtable_hash_index).
+  // "value_checksums" makes Add() append a crc32c of key+value to
+  // every stored value and Get() verify it (Options::value_checksums).
+  explicit MemTable(const InternalKeyComparator& comparator,
+                    ArenaBlockPool* pool = nullptr, bool hash_index = false,
+                    bool value_checksums = false,
+                    NegativeCacheStamps* negative_stamps = nullptr,
+                    bool compress_values = false);
 
   MemTable(const MemTable&) = delete;
   MemTable& operator=(const MemTable&) = delete;
@@ -56,11 +98,49 @@ class MemTable {
   void Add(SequenceNumber seq, ValueType type, const Slice& key,
            const Slice& value);
 
+  // Add an entry already encoded in memtable layout (varint32 internal
+  // key length, internal key, varint32 value length, value) -- one
+  // arena copy, no re-encoding.  The tag must already be patched.
+  // REQUIRES: !RewritesValues() (the span carries the plain value).
+  void AddSpan(const char* entry, size_t entry_size);
+
+  // True when Add() re-encodes values (checksums or compression), so
+  // pre-encoded spans -- e.g. from a WAL written without either --
+  // must go through Add() instead of AddSpan().
+  bool RewritesValues() const { return value_checksums_ || compress_values_; }
+
+  // A range deletion: every key with begin <= key < end and a sequence
+  // number below seq is deleted.
+  struct RangeTombstone {
+    std::string begin;
+    std::string end;
+    SequenceNumber seq;
+  };
+
+  // Record a range deletion at the specified sequence number.  Range
+  // tombstones are kept separately from the skiplist and materialized
+  // into point deletions when the memtable is flushed.
+  void AddRange(SequenceNumber seq, const Slice& begin, const Slice& end);
+
+  // Return true iff AddRange() has been called on this memtable.
+  bool HasRangeTombstones() const;
+
+  // Return the largest tombstone sequence number <= snapshot covering
+  // user_key, or 0 if there is none.
+  SequenceNumber MaxRangeTombstoneSeq(const Slice& user_key,
+                                      SequenceNumber snapshot) const;
+
+  // Append the tombstones with sequence numbers <= snapshot to *out.
+  void GetRangeTombstones(SequenceNumber snapshot,
+                          std::vector<RangeTombstone>* out) const;
+
   // If memtable contains a value for key, store it in *value and return true.
   // If memtable contains a deletion for key, store a NotFound() error
   // in *status and return true.
-  // Else, return false.
-  bool Get(const LookupKey& key, std::string* value, Status* s);
+  // Else, return false.  If "seq" is non-null it receives the sequence
+  // number of the entry that decided the result.
+  bool Get(const LookupKey& key, std::string* value, Status* s,
+           SequenceNumber* seq = nullptr);
 
  private:
   friend class MemTableIterator;
@@ -70,6 +150,10 @@ class MemTable {
     const InternalKeyComparator comparator;
     explicit KeyComparator(const InternalKeyComparator& c) : comparator(c) {}
     int operator()(const char* a, const char* b) const;
+    // Order-preserving key prefixes for the skiplist's in-node fast
+    // path; available when the user comparator provides them.
+    bool HasKeyPrefixes() const;
+    bool KeyPrefix(const char* entry, uint32_t* prefix) const;
   };
 
   typedef SkipList<const char*, KeyComparator> Table;
@@ -80,6 +164,32 @@ class MemTable {
   int refs_;
   Arena arena_;
   Table table_;
+  // Splice reused across Add() calls; sorted batches then skip most of
+  // the skiplist descent.  Writer-only, like table_ inserts.
+  Table::InsertHint insert_hint_;
+
+  // Range tombstones; appended under range_del_mutex_ since reads run
+  // concurrently with the single writer.
+  mutable port::Mutex range_del_mutex_;
+  std::vector<RangeTombstone> range_dels_;
+  std::atomic<bool> has_range_dels_;
+
+  // Optional hash index: maps user-key hash to the newest skiplist
+  // entry for that key.  Arrays are arena-allocated, append-only and
+  // republished wholesale on growth, so readers never lock.
+  struct HashArray {
+    size_t capacity;  // Power of two
+    std::atomic<const char*> slots[1];
+  };
+  HashArray* NewHashArray(size_t capacity);
+  void HashInsert(const char* entry);
+
+  const bool use_hash_index_;
+  const bool value_checksums_;
+  NegativeCacheStamps* const negative_stamps_;
+  const bool compress_values_;
+  std::atomic<HashArray*> hash_array_;
+  size_t hash_entries_;  // Writer only
 };
 
 }  // namespace leveldb
@@ -24,6 +24,8 @@
 //   Store per-table metadata (smallest, largest, largest-seq#, ...)
 //   in the table's meta section to speed up ScanTable.
 
+#include <atomic>
+
 #include "db/builder.h"
 #include "db/db_impl.h"
 #include "db/dbformat.h"
@@ -37,6 +39,7 @@
 #include "leveldb/comparator.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
@@ -218,10 +221,49 @@ class Repairer {
     return status;
   }
 
+  // Scans run on a small pool of threads: each worker claims the next
+  // table number, scans it, and appends the result under
+  // repair_mutex_.  Progress is logged as tables complete.
+  static void ScanTableWork(void* arg) {
+    Repairer* repairer = reinterpret_cast<Repairer*>(arg);
+    while (true) {
+      const size_t i = repairer->next_table_.fetch_add(1);
+      if (i >= repairer->table_numbers_.size()) {
+        break;
+      }
+      repairer->ScanTable(repairer->table_numbers_[i]);
+      repairer->scan_mutex_.Lock();
+      repairer->scanned_++;
+      Log(repairer->options_.info_log, "Repair progress: %d/%d tables",
+          repairer->scanned_,
+          static_cast<int>(repairer->table_numbers_.size()));
+      repairer->scan_mutex_.Unlock();
+    }
+    repairer->scan_mutex_.Lock();
+    repairer->scan_workers_--;
+    repairer->scan_cv_.SignalAll();
+    repairer->scan_mutex_.Unlock();
+  }
+
   void ExtractMetaData() {
-    for (size_t i = 0; i < table_numbers_.size(); i++) {
-      ScanTable(table_numbers_[i]);
+    if (table_numbers_.empty()) {
+      return;
+    }
+    int workers = 4;
+    if (static_cast<size_t>(workers) > table_numbers_.size()) {
+      workers = static_cast<int>(table_numbers_.size());
+    }
+    next_table_.store(0);
+    scanned_ = 0;
+    scan_workers_ = workers;
+    for (int i = 0; i < workers; i++) {
+      env_->StartThread(&Repairer::ScanTableWork, this);
     }
+    scan_mutex_.Lock();
+    while (scan_workers_ > 0) {
+      scan_cv_.Wait();
+    }
+    scan_mutex_.Unlock();
   }
 
   Iterator* NewTableIterator(const FileMetaData& meta) {
@@ -285,6 +327,7 @@ class Repairer {
         (unsigned long long)t.meta.number, counter, status.ToString().c_str());
 
     if (status.ok()) {
+      MutexLock l(&scan_mutex_);
       tables_.push_back(t);
     } else {
       RepairTable(fname, t);  // RepairTable archives input file.
@@ -439,6 +482,13 @@ class Repairer {
   std::vector<uint64_t> table_numbers_;
   std::vector<uint64_t> logs_;
   std::vector<TableInfo> tables_;
+
+  // Parallel table-scan coordination; see ExtractMetaData().
+  std::atomic<size_t> next_table_{0};
+  port::Mutex scan_mutex_;
+  port::CondVar scan_cv_{&scan_mutex_};
+  int scan_workers_ = 0;
+  int scanned_ = 0;
   uint64_t next_file_number_;
 };
 }  // namespace
@@ -8,7 +8,10 @@
 // Thread safety
 // -------------
 //
-// Writes require external synchronization, most likely a mutex.
+// Writes require external synchronization, most likely a mutex,
+// unless all writers use InsertConcurrently(), which links nodes with
+// compare-and-swap and may be called from multiple threads at once.
+// Insert() and InsertConcurrently() must not be mixed concurrently.
 // Reads require a guarantee that the SkipList will not be destroyed
 // while the read is in progress.  Apart from that, reads progress
 // without any internal locking or synchronization.
@@ -31,6 +34,7 @@
 #include <cassert>
 #include <cstdlib>
 
+#include "port/port.h"
 #include "util/arena.h"
 #include "util/random.h"
 
@@ -50,9 +54,31 @@ class SkipList {
   SkipList(const SkipList&) = delete;
   SkipList& operator=(const SkipList&) = delete;
 
+  // Splice remembered between inserts; see InsertWithHint().
+  struct InsertHint {
+    InsertHint() : valid(false) {}
+    Node* prev[12];  // == kMaxHeight
+    bool valid;
+  };
+
   // Insert key into the list.
   // REQUIRES: nothing that compares equal to key is currently in the list.
-  void Insert(const Key& key);
+  void Insert(const Key& key) { InsertWithHint(key, nullptr); }
+
+  // Like Insert(), but reuses *hint (the splice of the previous
+  // insert) when the new key still belongs just after it, so sorted
+  // runs skip most of the repeated descent.  The hint is validated, so
+  // arbitrary (unsorted) keys remain correct, and it is updated for
+  // the next call.
+  void InsertWithHint(const Key& key, InsertHint* hint);
+
+  // Like Insert(), but safe to call from multiple threads concurrently.
+  // Nodes are linked into each level with compare-and-swap; only node
+  // allocation and height selection are serialized (the Arena and the
+  // random generator are not thread-safe).
+  // REQUIRES: nothing that compares equal to key is in the list or is
+  // being inserted concurrently.
+  void InsertConcurrently(const Key& key);
 
   // Returns true iff an entry that compares equal to key is in the list.
   bool Contains(const Key& key) const;
@@ -103,13 +129,31 @@ class SkipList {
     return max_height_.load(std::memory_order_relaxed);
   }
 
-  Node* NewNode(const Key& key, int height);
+  Node* NewNode(const Key& key, int height, uint32_t prefix);
   int RandomHeight();
   bool Equal(const Key& a, const Key& b) const { return (compare_(a, b) == 0); }
 
   // Return true if key is greater than the data stored in "n"
   bool KeyIsAfterNode(const Key& key, Node* n) const;
 
+  // Prefix-accelerated variant; only called when prefixes are enabled
+  // and "key_prefix" is key's order-preserving prefix.
+  bool KeyIsAfterNode(const Key& key, uint32_t key_prefix, Node* n) const {
+    if (n == nullptr) {
+      return false;
+    }
+    if (n->prefix != key_prefix) {
+      return n->prefix < key_prefix;
+    }
+    return compare_(n->key, key) < 0;
+  }
+
+  // Starting from "from" (whose key must be < key, or head_), advance
+  // along level "level" and return in *out_prev/*out_next the pair of
+  // adjacent nodes between which key belongs at that level.
+  void FindSpliceForLevel(const Key& key, Node* from, int level,
+                          Node** out_prev, Node** out_next) const;
+
   // Return the earliest node that comes at or after key.
   // Return nullptr if there is no such node.
   //
@@ -127,6 +171,7 @@ class SkipList {
 
   // Immutable after construction
   Comparator const compare_;
+  bool const use_prefixes_;
   Arena* const arena_;  // Arena used for allocations of nodes
 
   Node* const head_;
@@ -135,16 +180,24 @@ class SkipList {
   // values are ok.
   std::atomic<int> max_height_;  // Height of the entire list
 
-  // Read/written only by Insert().
+  // Read/written only by Insert().  InsertConcurrently() serializes its
+  // accesses (and its Arena allocations) with alloc_mutex_.
   Random rnd_;
+
+  port::Mutex alloc_mutex_;
 };
 
 // Implementation details follow
 template <typename Key, class Comparator>
 struct SkipList<Key, Comparator>::Node {
-  explicit Node(const Key& k) : key(k) {}
+  Node(const Key& k, uint32_t p) : key(k), prefix(p) {}
 
   Key const key;
+  // Order-preserving prefix of the key (see Comparator::KeyPrefix),
+  // co-located with the links so most comparisons during descent
+  // resolve from this node's own cache line instead of dereferencing
+  // the key.  Zero when the comparator has no such prefixes.
+  uint32_t const prefix;
 
   // Accessors/mutators for links.  Wrapped in methods so we can
   // add the appropriate barriers as necessary.
@@ -161,6 +214,15 @@ struct SkipList<Key, Comparator>::Node {
     next_[n].store(x, std::memory_order_release);
   }
 
+  // Atomically replace the link at level n with x iff it still equals
+  // "expected".  Uses a release store (as SetNext) on success.
+  bool CASNext(int n, Node* expected, Node* x) {
+    assert(n >= 0);
+    return next_[n].compare_exchange_strong(expected, x,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed);
+  }
+
   // No-barrier variants that can be safely used in a few locations.
   Node* NoBarrier_Next(int n) {
     assert(n >= 0);
@@ -178,10 +240,10 @@ struct SkipList<Key, Comparator>::Node {
 
 template <typename Key, class Comparator>
 typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::NewNode(
-    const Key& key, int height) {
+    const Key& key, int height, uint32_t prefix) {
   char* const node_memory = arena_->AllocateAligned(
       sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1));
-  return new (node_memory) Node(key);
+  return new (node_memory) Node(key, prefix);
 }
 
 template <typename Key, class Comparator>
@@ -259,11 +321,14 @@ template <typename Key, class Comparator>
 typename SkipList<Key, Comparator>::Node*
 SkipList<Key, Comparator>::FindGreaterOrEqual(const Key& key,
                                               Node** prev) const {
+  uint32_t key_prefix = 0;
+  const bool use_prefix = use_prefixes_ && compare_.KeyPrefix(key, &key_prefix);
   Node* x = head_;
   int level = GetMaxHeight() - 1;
   while (true) {
     Node* next = x->Next(level);
-    if (KeyIsAfterNode(key, next)) {
+    if (use_prefix ? KeyIsAfterNode(key, key_prefix, next)
+                   : KeyIsAfterNode(key, next)) {
       // Keep searching in this list
       x = next;
     } else {
@@ -323,7 +388,8 @@ template <typename Key, class Comparator>
 SkipList<Key, Comparator>::SkipList(Comparator cmp, Arena* arena)
     : compare_(cmp),
       arena_(arena),
-      head_(NewNode(0 /* any key will do */, kMaxHeight)),
+      use_prefixes_(cmp.HasKeyPrefixes()),
+      head_(NewNode(0 /* any key will do */, kMaxHeight, 0)),
       max_height_(1),
       rnd_(0xdeadbeef) {
   for (int i = 0; i < kMaxHeight; i++) {
@@ -332,11 +398,48 @@ SkipList<Key, Comparator>::SkipList(Comparator cmp, Arena* arena)
 }
 
 template <typename Key, class Comparator>
-void SkipList<Key, Comparator>::Insert(const Key& key) {
+void SkipList<Key, Comparator>::InsertWithHint(const Key& key,
+                                               InsertHint* hint) {
   // TODO(opt): We can use a barrier-free variant of FindGreaterOrEqual()
   // here since Insert() is externally synchronized.
-  Node* prev[kMaxHeight];
-  Node* x = FindGreaterOrEqual(key, prev);
+  Node* local_prev[kMaxHeight];
+  Node** prev = local_prev;
+  bool hint_usable = false;
+  if (hint != nullptr && hint->valid) {
+    // The hint is usable when the key belongs immediately after the
+    // remembered splice at the bottom level.
+    Node* p0 = hint->prev[0];
+    Node* n0 = p0->Next(0);
+    if ((p0 == head_ || KeyIsAfterNode(key, p0)) &&
+        (n0 == nullptr || !KeyIsAfterNode(key, n0))) {
+      hint_usable = true;
+      for (int i = 0; i < kMaxHeight; i++) {
+        // Advance each level's predecessor as far as possible; sorted
+        // inserts usually need zero or one step.
+        Node* p = hint->prev[i];
+        while (true) {
+          Node* next = p->Next(i);
+          if (KeyIsAfterNode(key, next)) {
+            p = next;
+          } else {
+            break;
+          }
+        }
+        prev[i] = p;
+      }
+    }
+  }
+  Node* x;
+  if (hint_usable) {
+    x = prev[0]->Next(0);
+  } else {
+    x = FindGreaterOrEqual(key, prev);
+    // FindGreaterOrEqual only fills levels below the current height;
+    // the rest start at the head (also keeps the stored hint sane).
+    for (int i = GetMaxHeight(); i < kMaxHeight; i++) {
+      prev[i] = head_;
+    }
+  }
 
   // Our data structure does not allow duplicate insertion
   assert(x == nullptr || !Equal(key, x->key));
@@ -356,13 +459,87 @@ void SkipList<Key, Comparator>::Insert(const Key& key) {
     max_height_.store(height, std::memory_order_relaxed);
   }
 
-  x = NewNode(key, height);
+  uint32_t key_prefix = 0;
+  if (use_prefixes_ && !compare_.KeyPrefix(key, &key_prefix)) {
+    key_prefix = 0;
+  }
+  x = NewNode(key, height, key_prefix);
   for (int i = 0; i < height; i++) {
     // NoBarrier_SetNext() suffices since we will add a barrier when
     // we publish a pointer to "x" in prev[i].
     x->NoBarrier_SetNext(i, prev[i]->NoBarrier_Next(i));
     prev[i]->SetNext(i, x);
   }
+
+  if (hint != nullptr) {
+    for (int i = 0; i < kMaxHeight; i++) {
+      hint->prev[i] = (i < height) ? x : prev[i];
+    }
+    hint->valid = true;
+  }
+}
+
+template <typename Key, class Comparator>
+void SkipList<Key, Comparator>::FindSpliceForLevel(const Key& key, Node* from,
+                                                   int level, Node** out_prev,
+                                                   Node** out_next) const {
+  Node* x = from;
+  while (true) {
+    Node* next = x->Next(level);
+    if (KeyIsAfterNode(key, next)) {
+      x = next;
+    } else {
+      *out_prev = x;
+      *out_next = next;
+      return;
+    }
+  }
+}
+
+template <typename Key, class Comparator>
+void SkipList<Key, Comparator>::InsertConcurrently(const Key& key) {
+  int height;
+  Node* x;
+  {
+    uint32_t key_prefix = 0;
+    if (use_prefixes_ && !compare_.KeyPrefix(key, &key_prefix)) {
+      key_prefix = 0;
+    }
+    alloc_mutex_.Lock();
+    height = RandomHeight();
+    x = NewNode(key, height, key_prefix);
+    alloc_mutex_.Unlock();
+  }
+
+  // Raise the list height first so that FindGreaterOrEqual() below
+  // fills in prev[] for every level we are about to link.
+  int max_height = max_height_.load(std::memory_order_relaxed);
+  while (height > max_height &&
+         !max_height_.compare_exchange_weak(max_height, height,
+                                            std::memory_order_relaxed)) {
+  }
+
+  Node* prev[kMaxHeight];
+  Node* next = FindGreaterOrEqual(key, prev);
+
+  // Our data structure does not allow duplicate insertion
+  assert(next == nullptr || !Equal(key, next->key));
+  (void)next;
+
+  for (int i = 0; i < height; i++) {
+    // prev[i]->key < key and nodes are never removed, so prev[i] stays
+    // a valid starting point for the level-i splice even if other
+    // threads link nodes after it; on CAS failure we rescan from it.
+    Node* p = prev[i];
+    while (true) {
+      Node* n;
+      FindSpliceForLevel(key, p, i, &p, &n);
+      x->NoBarrier_SetNext(i, n);
+      if (p->CASNext(i, n, x)) {
+        break;
+      }
+    }
+  }
 }
 
 template <typename Key, class Comparator>
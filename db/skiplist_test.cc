@@ -21,6 +21,12 @@ namespace leveldb {
 typedef uint64_t Key;
 
 struct Comparator {
+  bool HasKeyPrefixes() const { return false; }
+  bool KeyPrefix(const Key& key, uint32_t* prefix) const {
+    (void)key;
+    (void)prefix;
+    return false;
+  }
   int operator()(const Key& a, const Key& b) const {
     if (a < b) {
       return -1;
@@ -359,6 +365,71 @@ static void RunConcurrent(int run) {
   }
 }
 
+namespace {
+
+const int kConcurrentWriters = 4;
+
+struct ConcurrentInsertState {
+  SkipList<Key, Comparator>* list;
+  int stripe;  // This writer inserts keys == stripe mod kConcurrentWriters
+  int count;   // Number of keys to insert
+  port::Mutex* mu;
+  port::CondVar* cv;
+  int* pending;  // Guarded by *mu
+};
+
+void ConcurrentInserter(void* arg) {
+  ConcurrentInsertState* state =
+      reinterpret_cast<ConcurrentInsertState*>(arg);
+  for (int i = 0; i < state->count; i++) {
+    state->list->InsertConcurrently(static_cast<Key>(i) * kConcurrentWriters +
+                                    state->stripe);
+  }
+  state->mu->Lock();
+  --*state->pending;
+  state->cv->SignalAll();
+  state->mu->Unlock();
+}
+
+}  // namespace
+
+TEST(SkipTest, ConcurrentInsert) {
+  const int kWriters = kConcurrentWriters;
+  const int kPerWriter = 10000;
+  Arena arena;
+  Comparator cmp;
+  SkipList<Key, Comparator> list(cmp, &arena);
+
+  port::Mutex mu;
+  port::CondVar cv(&mu);
+  int pending = kWriters;
+  ConcurrentInsertState states[kWriters];
+  for (int i = 0; i < kWriters; i++) {
+    states[i].list = &list;
+    states[i].stripe = i;
+    states[i].count = kPerWriter;
+    states[i].mu = &mu;
+    states[i].cv = &cv;
+    states[i].pending = &pending;
+    Env::Default()->StartThread(ConcurrentInserter, &states[i]);
+  }
+  mu.Lock();
+  while (pending > 0) {
+    cv.Wait();
+  }
+  mu.Unlock();
+
+  // Every key must be present and iteration must be strictly ordered.
+  SkipList<Key, Comparator>::Iterator iter(&list);
+  iter.SeekToFirst();
+  for (Key expected = 0; expected < kWriters * kPerWriter; expected++) {
+    ASSERT_TRUE(iter.Valid());
+    ASSERT_EQ(expected, iter.key());
+    iter.Next();
+  }
+  ASSERT_TRUE(!iter.Valid());
+}
+
 TEST(SkipTest, Concurrent1) { RunConcurrent(1); }
 TEST(SkipTest, Concurrent2) { RunConcurrent(2); }
 TEST(SkipTest, Concurrent3) { RunConcurrent(3); }
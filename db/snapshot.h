@@ -5,6 +5,8 @@
 #ifndef STORAGE_LEVELDB_DB_SNAPSHOT_H_
 #define STORAGE_LEVELDB_DB_SNAPSHOT_H_
 
+#include <vector>
+
 #include "db/dbformat.h"
 #include "leveldb/db.h"
 
@@ -21,9 +23,16 @@ class SnapshotImpl : public Snapshot {
 
   SequenceNumber sequence_number() const { return sequence_number_; }
 
+  // Index of the lock-free registration slot this snapshot occupies,
+  // or -1 for snapshots tracked in the mutex-protected list.
+  int slot() const { return slot_; }
+  void set_slot(int slot) { slot_ = slot; }
+
  private:
   friend class SnapshotList;
 
+  int slot_ = -1;
+
   // SnapshotImpl is kept in a doubly-linked circular list. The SnapshotList
   // implementation operates on the next/previous fields directly.
   SnapshotImpl* prev_;
@@ -44,6 +53,13 @@ class SnapshotList {
   }
 
   bool empty() const { return head_.next_ == &head_; }
+
+  // Append every listed snapshot's sequence number to *out.
+  void AppendSequences(std::vector<SequenceNumber>* out) const {
+    for (SnapshotImpl* s = head_.next_; s != &head_; s = s->next_) {
+      out->push_back(s->sequence_number_);
+    }
+  }
   SnapshotImpl* oldest() const {
     assert(!empty());
     return head_.next_;
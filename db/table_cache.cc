@@ -7,7 +7,10 @@
 #include "db/filename.h"
 #include "leveldb/env.h"
 #include "leveldb/table.h"
+#include "table/format.h"
+#include "util/hedged_read.h"
 #include "util/coding.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
@@ -34,9 +37,87 @@ TableCache::TableCache(const std::string& dbname, const Options& options,
     : env_(options.env),
       dbname_(dbname),
       options_(options),
-      cache_(NewLRUCache(entries)) {}
+      cache_(entries < 0 ? nullptr : NewLRUCache(entries)) {}
 
-TableCache::~TableCache() { delete cache_; }
+TableCache::~TableCache() {
+  delete cache_;
+  for (int i = 0; i < kStripes; i++) {
+    for (std::unordered_map<uint64_t, PinnedTable>::iterator it =
+             open_tables_[i].begin();
+         it != open_tables_[i].end(); ++it) {
+      delete it->second.table;
+      delete it->second.file;
+    }
+  }
+}
+
+Status TableCache::OpenTable(uint64_t file_number, uint64_t file_size,
+                             RandomAccessFile** file, Table** table) {
+  *file = nullptr;
+  *table = nullptr;
+  std::string fname = TableFileName(dbname_, file_number);
+  Status s = options_.use_mmap_reads
+                 ? env_->NewMappedRandomAccessFile(fname, Env::kAccessRandom,
+                                                   file)
+                 : env_->NewRandomAccessFile(fname, file);
+  if (!s.ok()) {
+    std::string old_fname = SSTTableFileName(dbname_, file_number);
+    if (env_->NewRandomAccessFile(old_fname, file).ok()) {
+      s = Status::OK();
+    }
+  }
+  if (s.ok() && options_.hedged_read_threshold_micros != 0) {
+    *file = NewHedgedRandomAccessFile(*file,
+                                      options_.hedged_read_threshold_micros);
+  }
+  if (s.ok()) {
+    s = Table::Open(options_, *file, file_size, table);
+  }
+  if (!s.ok()) {
+    assert(*table == nullptr);
+    delete *file;
+    *file = nullptr;
+    // We do not cache error results so that if the error is transient,
+    // or somebody repairs the file, we recover automatically.
+  }
+  return s;
+}
+
+Status TableCache::FindTableUnbounded(uint64_t file_number, uint64_t file_size,
+                                      Table** table) {
+  const int stripe = file_number % kStripes;
+  {
+    MutexLock l(&stripe_mutex_[stripe]);
+    std::unordered_map<uint64_t, PinnedTable>::iterator it =
+        open_tables_[stripe].find(file_number);
+    if (it != open_tables_[stripe].end()) {
+      *table = it->second.table;
+      return Status::OK();
+    }
+  }
+  // Open outside the stripe lock so slow opens do not serialize reads
+  // of other files in the stripe.
+  RandomAccessFile* file;
+  Status s = OpenTable(file_number, file_size, &file, table);
+  if (!s.ok()) {
+    return s;
+  }
+  MutexLock l(&stripe_mutex_[stripe]);
+  std::unordered_map<uint64_t, PinnedTable>::iterator it =
+      open_tables_[stripe].find(file_number);
+  if (it != open_tables_[stripe].end()) {
+    // Lost the race; keep the first open.
+    delete *table;
+    delete file;
+    *table = it->second.table;
+    return Status::OK();
+  }
+  PinnedTable entry;
+  entry.file = file;
+  entry.table = *table;
+  open_tables_[stripe].insert(std::make_pair(file_number, entry));
+  return Status::OK();
+}
 
 Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
                              Cache::Handle** handle) {
@@ -46,26 +127,10 @@ Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
   Slice key(buf, sizeof(buf));
   *handle = cache_->Lookup(key);
   if (*handle == nullptr) {
-    std::string fname = TableFileName(dbname_, file_number);
     RandomAccessFile* file = nullptr;
     Table* table = nullptr;
-    s = env_->NewRandomAccessFile(fname, &file);
-    if (!s.ok()) {
-      std::string old_fname = SSTTableFileName(dbname_, file_number);
-      if (env_->NewRandomAccessFile(old_fname, &file).ok()) {
-        s = Status::OK();
-      }
-    }
+    s = OpenTable(file_number, file_size, &file, &table);
     if (s.ok()) {
-      s = Table::Open(options_, file, file_size, &table);
-    }
-
-    if (!s.ok()) {
-      assert(table == nullptr);
-      delete file;
-      // We do not cache error results so that if the error is transient,
-      // or somebody repairs the file, we recover automatically.
-    } else {
       TableAndFile* tf = new TableAndFile;
       tf->file = file;
       tf->table = table;
@@ -82,15 +147,25 @@ Iterator* TableCache::NewIterator(const ReadOptions& options,
     *tableptr = nullptr;
   }
 
+  Table* table = nullptr;
   Cache::Handle* handle = nullptr;
-  Status s = FindTable(file_number, file_size, &handle);
+  Status s;
+  if (cache_ == nullptr) {
+    s = FindTableUnbounded(file_number, file_size, &table);
+  } else {
+    s = FindTable(file_number, file_size, &handle);
+    if (s.ok()) {
+      table = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+    }
+  }
   if (!s.ok()) {
     return NewErrorIterator(s);
   }
 
-  Table* table = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
   Iterator* result = table->NewIterator(options);
-  result->RegisterCleanup(&UnrefEntry, cache_, handle);
+  if (handle != nullptr) {
+    result->RegisterCleanup(&UnrefEntry, cache_, handle);
+  }
   if (tableptr != nullptr) {
     *tableptr = table;
   }
@@ -100,18 +175,194 @@ Iterator* TableCache::NewIterator(const ReadOptions& options,
 Status TableCache::Get(const ReadOptions& options, uint64_t file_number,
                        uint64_t file_size, const Slice& k, void* arg,
                        void (*handle_result)(void*, const Slice&,
-                                             const Slice&)) {
+                                             const Slice&),
+                       Iterator** pinned_iter, bool* did_block_read) {
+  if (cache_ == nullptr) {
+    Table* t = nullptr;
+    Status s = FindTableUnbounded(file_number, file_size, &t);
+    if (s.ok()) {
+      s = t->InternalGet(options, k, arg, handle_result, pinned_iter,
+                         did_block_read);
+    }
+    return s;
+  }
   Cache::Handle* handle = nullptr;
   Status s = FindTable(file_number, file_size, &handle);
   if (s.ok()) {
     Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
-    s = t->InternalGet(options, k, arg, handle_result);
+    s = t->InternalGet(options, k, arg, handle_result, pinned_iter,
+                       did_block_read);
+    cache_->Release(handle);
+  }
+  return s;
+}
+
+Iterator* TableCache::NewIterator(const ReadOptions& options, FileMetaData* f,
+                                  Table** tableptr) {
+  if (cache_ == nullptr) {
+    Table* t = reinterpret_cast<Table*>(
+        f->cached_table.load(std::memory_order_acquire));
+    if (t == nullptr) {
+      Status s = FindTableUnbounded(f->number, f->file_size, &t);
+      if (!s.ok()) {
+        if (tableptr != nullptr) {
+          *tableptr = nullptr;
+        }
+        return NewErrorIterator(s);
+      }
+      f->cached_table.store(t, std::memory_order_release);
+    }
+    if (tableptr != nullptr) {
+      *tableptr = t;
+    }
+    // Pinned tables are owned by the cache; no cleanup to register.
+    return t->NewIterator(options);
+  }
+  return NewIterator(options, f->number, f->file_size, tableptr);
+}
+
+Status TableCache::Get(const ReadOptions& options, FileMetaData* f,
+                       const Slice& k, void* arg,
+                       void (*handle_result)(void*, const Slice&,
+                                             const Slice&),
+                       Iterator** pinned_iter, bool* did_block_read) {
+  if (cache_ == nullptr) {
+    // Permanently open tables have stable pointers; remember the
+    // table on the file so the next lookup skips even the striped
+    // map probe and goes straight to the pinned filter.
+    Table* t =
+        reinterpret_cast<Table*>(f->cached_table.load(std::memory_order_acquire));
+    if (t == nullptr) {
+      Status s = FindTableUnbounded(f->number, f->file_size, &t);
+      if (!s.ok()) {
+        return s;
+      }
+      f->cached_table.store(t, std::memory_order_release);
+    }
+    return t->InternalGet(options, k, arg, handle_result, pinned_iter,
+                          did_block_read);
+  }
+  return Get(options, f->number, f->file_size, k, arg, handle_result,
+             pinned_iter, did_block_read);
+}
+
+namespace {
+void CollectOpenTable(const Slice& key, void* value, void* arg) {
+  std::map<uint64_t, uint64_t>* out =
+      reinterpret_cast<std::map<uint64_t, uint64_t>*>(arg);
+  TableAndFile* tf = reinterpret_cast<TableAndFile*>(value);
+  (*out)[tf->table->CacheId()] = DecodeFixed64(key.data());
+}
+}  // namespace
+
+void TableCache::GetOpenTables(std::map<uint64_t, uint64_t>* cache_id_to_file) {
+  if (cache_ == nullptr) {
+    for (int stripe = 0; stripe < kStripes; stripe++) {
+      MutexLock l(&stripe_mutex_[stripe]);
+      for (std::unordered_map<uint64_t, PinnedTable>::iterator it =
+               open_tables_[stripe].begin();
+           it != open_tables_[stripe].end(); ++it) {
+        (*cache_id_to_file)[it->second.table->CacheId()] = it->first;
+      }
+    }
+    return;
+  }
+  cache_->ApplyToAll(&CollectOpenTable, cache_id_to_file);
+}
+
+Status TableCache::GetTableProperties(uint64_t file_number,
+                                      uint64_t file_size,
+                                      TableProperties* properties) {
+  if (cache_ == nullptr) {
+    Table* t = nullptr;
+    Status s = FindTableUnbounded(file_number, file_size, &t);
+    if (s.ok()) {
+      *properties = t->GetProperties();
+    }
+    return s;
+  }
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(file_number, file_size, &handle);
+  if (s.ok()) {
+    *properties =
+        reinterpret_cast<TableAndFile*>(cache_->Value(handle))
+            ->table->GetProperties();
+    cache_->Release(handle);
+  }
+  return s;
+}
+
+Status TableCache::WarmTable(uint64_t file_number, uint64_t file_size) {
+  if (cache_ == nullptr) {
+    Table* table = nullptr;
+    return FindTableUnbounded(file_number, file_size, &table);
+  }
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(file_number, file_size, &handle);
+  if (s.ok()) {
+    cache_->Release(handle);
+  }
+  return s;
+}
+
+Status TableCache::WarmBlocks(uint64_t file_number, uint64_t file_size,
+                              const std::vector<uint64_t>& offsets) {
+  Table* table = nullptr;
+  Cache::Handle* handle = nullptr;
+  Status s;
+  if (cache_ == nullptr) {
+    s = FindTableUnbounded(file_number, file_size, &table);
+  } else {
+    s = FindTable(file_number, file_size, &handle);
+    if (s.ok()) {
+      table = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+    }
+  }
+  if (!s.ok()) {
+    return s;
+  }
+
+  // Walk the index once; fault in every block whose offset the caller
+  // listed.  Both the index and "offsets" are in file order.
+  ReadOptions read_options;
+  Iterator* index = table->IndexBlockIterator(read_options);
+  size_t next = 0;
+  for (index->SeekToFirst(); index->Valid() && next < offsets.size();
+       index->Next()) {
+    Slice value = index->value();
+    BlockHandle block_handle;
+    if (!block_handle.DecodeFrom(&value).ok()) {
+      continue;
+    }
+    while (next < offsets.size() && offsets[next] < block_handle.offset()) {
+      next++;  // Offset no longer names a block (file was rewritten).
+    }
+    if (next < offsets.size() && offsets[next] == block_handle.offset()) {
+      delete Table::BlockReader(table, read_options, index->value());
+      next++;
+    }
+  }
+  s = index->status();
+  delete index;
+  if (handle != nullptr) {
     cache_->Release(handle);
   }
   return s;
 }
 
 void TableCache::Evict(uint64_t file_number) {
+  if (cache_ == nullptr) {
+    const int stripe = file_number % kStripes;
+    MutexLock l(&stripe_mutex_[stripe]);
+    std::unordered_map<uint64_t, PinnedTable>::iterator it =
+        open_tables_[stripe].find(file_number);
+    if (it != open_tables_[stripe].end()) {
+      delete it->second.table;
+      delete it->second.file;
+      open_tables_[stripe].erase(it);
+    }
+    return;
+  }
   char buf[sizeof(file_number)];
   EncodeFixed64(buf, file_number);
   cache_->Erase(Slice(buf, sizeof(buf)));
@@ -8,9 +8,13 @@
 #define STORAGE_LEVELDB_DB_TABLE_CACHE_H_
 
 #include <cstdint>
+#include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "db/dbformat.h"
+#include "db/version_edit.h"
 #include "leveldb/cache.h"
 #include "leveldb/table.h"
 #include "port/port.h"
@@ -21,6 +25,10 @@ class Env;
 
 class TableCache {
  public:
+  // A negative "entries" keeps every table handle permanently open in
+  // a striped hash map with no LRU accounting at all (the
+  // max_open_files = -1 mode); otherwise handles live in an LRU cache
+  // of the given capacity.
   TableCache(const std::string& dbname, const Options& options, int entries);
 
   TableCache(const TableCache&) = delete;
@@ -39,10 +47,45 @@ class TableCache {
                         uint64_t file_size, Table** tableptr = nullptr);
 
   // If a seek to internal key "k" in specified file finds an entry,
-  // call (*handle_result)(arg, found_key, found_value).
+  // call (*handle_result)(arg, found_key, found_value).  A non-null
+  // "pinned_iter" receives the positioned block iterator (caller
+  // owned) when an entry was found, keeping the value slice alive.
   Status Get(const ReadOptions& options, uint64_t file_number,
              uint64_t file_size, const Slice& k, void* arg,
-             void (*handle_result)(void*, const Slice&, const Slice&));
+             void (*handle_result)(void*, const Slice&, const Slice&),
+             Iterator** pinned_iter = nullptr,
+             bool* did_block_read = nullptr);
+
+  // Like NewIterator() above, but allowed to use and fill
+  // f->cached_table in pinned-open mode, so repeat iterator creation
+  // over a long-lived file is a single pointer load.
+  Iterator* NewIterator(const ReadOptions& options, FileMetaData* f,
+                        Table** tableptr = nullptr);
+
+  // Like Get(), but allowed to use and fill f->cached_table so repeat
+  // lookups skip the cache machinery entirely (pinned-open mode only).
+  Status Get(const ReadOptions& options, FileMetaData* f, const Slice& k,
+             void* arg,
+             void (*handle_result)(void*, const Slice&, const Slice&),
+             Iterator** pinned_iter = nullptr,
+             bool* did_block_read = nullptr);
+
+  // Map each open table's block-cache id to its file number.
+  void GetOpenTables(std::map<uint64_t, uint64_t>* cache_id_to_file);
+
+  // Fetch the table's properties block contents (zeros for tables
+  // without one).
+  Status GetTableProperties(uint64_t file_number, uint64_t file_size,
+                            TableProperties* properties);
+
+  // Open the specified file (index and filter blocks included) and
+  // leave the Table cached, without returning anything to the caller.
+  Status WarmTable(uint64_t file_number, uint64_t file_size);
+
+  // Re-read the data blocks at the given (sorted) offsets into the
+  // block cache.  Offsets not matching a block boundary are skipped.
+  Status WarmBlocks(uint64_t file_number, uint64_t file_size,
+                    const std::vector<uint64_t>& offsets);
 
   // Evict any entry for the specified file number
   void Evict(uint64_t file_number);
@@ -50,10 +93,26 @@ class TableCache {
  private:
   Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**);
 
+  // Open (or fetch) a permanently pinned table in unbounded mode.
+  Status FindTableUnbounded(uint64_t file_number, uint64_t file_size,
+                            Table** table);
+  Status OpenTable(uint64_t file_number, uint64_t file_size,
+                   RandomAccessFile** file, Table** table);
+
+  static const int kStripes = 16;
+
   Env* const env_;
   const std::string dbname_;
   const Options& options_;
-  Cache* cache_;
+  Cache* cache_;  // Null in unbounded mode
+
+  // Unbounded mode state: per-stripe maps of permanently open tables.
+  struct PinnedTable {
+    RandomAccessFile* file;
+    Table* table;
+  };
+  port::Mutex stripe_mutex_[kStripes];
+  std::unordered_map<uint64_t, PinnedTable> open_tables_[kStripes];
 };
 
 }  // namespace leveldb
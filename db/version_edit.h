@@ -5,6 +5,7 @@
 #ifndef STORAGE_LEVELDB_DB_VERSION_EDIT_H_
 #define STORAGE_LEVELDB_DB_VERSION_EDIT_H_
 
+#include <atomic>
 #include <set>
 #include <utility>
 #include <vector>
@@ -16,7 +17,31 @@ namespace leveldb {
 class VersionSet;
 
 struct FileMetaData {
-  FileMetaData() : refs(0), allowed_seeks(1 << 30), file_size(0) {}
+  FileMetaData() : refs(0), allowed_seeks(1 << 30), file_size(0) {
+    cached_table.store(nullptr, std::memory_order_relaxed);
+  }
+
+  // Copies do not inherit the cached table pointer: the copy is not
+  // the instance the table cache filled in.
+  FileMetaData(const FileMetaData& other)
+      : refs(other.refs),
+        allowed_seeks(other.allowed_seeks),
+        number(other.number),
+        file_size(other.file_size),
+        smallest(other.smallest),
+        largest(other.largest) {
+    cached_table.store(nullptr, std::memory_order_relaxed);
+  }
+  FileMetaData& operator=(const FileMetaData& other) {
+    refs = other.refs;
+    allowed_seeks = other.allowed_seeks;
+    number = other.number;
+    file_size = other.file_size;
+    smallest = other.smallest;
+    largest = other.largest;
+    cached_table.store(nullptr, std::memory_order_relaxed);
+    return *this;
+  }
 
   int refs;
   int allowed_seeks;  // Seeks allowed until compaction
@@ -24,6 +49,12 @@ struct FileMetaData {
   uint64_t file_size;    // File size in bytes
   InternalKey smallest;  // Smallest internal key served by table
   InternalKey largest;   // Largest internal key served by table
+
+  // Lazily cached Table* for this file, filled by TableCache when
+  // table handles are permanently open (max_open_files == -1, where
+  // Table pointers are stable for the file's lifetime).  Lets the read
+  // path go straight to the pinned filter with no cache lookup at all.
+  std::atomic<void*> cached_table;
 };
 
 class VersionEdit {
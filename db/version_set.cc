@@ -12,6 +12,7 @@
 #include "db/log_writer.h"
 #include "db/memtable.h"
 #include "db/table_cache.h"
+#include "leveldb/compaction_picker.h"
 #include "leveldb/env.h"
 #include "leveldb/table_builder.h"
 #include "table/merger.h"
@@ -21,6 +22,8 @@
 
 namespace leveldb {
 
+CompactionPicker::~CompactionPicker() = default;
+
 static size_t TargetFileSize(const Options* options) {
   return options->max_file_size;
 }
@@ -71,15 +74,17 @@ Version::~Version() {
   prev_->next_ = next_;
   next_->prev_ = prev_;
 
-  // Drop references to files
-  for (int level = 0; level < config::kNumLevels; level++) {
-    for (size_t i = 0; i < files_[level].size(); i++) {
-      FileMetaData* f = files_[level][i];
-      assert(f->refs > 0);
-      f->refs--;
-      if (f->refs <= 0) {
-        delete f;
-      }
+  // File references are dropped by ~LevelFiles when the last version
+  // sharing each level's list goes away.
+}
+
+Version::LevelFiles::~LevelFiles() {
+  for (size_t i = 0; i < files.size(); i++) {
+    FileMetaData* f = files[i];
+    assert(f->refs > 0);
+    f->refs--;
+    if (f->refs <= 0) {
+      delete f;
     }
   }
 }
@@ -104,6 +109,64 @@ int FindFile(const InternalKeyComparator& icmp,
   return right;
 }
 
+// Like FindFile(), but first narrows the search with an interpolation
+// probe over the contiguous fence array of order-preserving largest-key
+// prefixes; falls back to plain FindFile() when fences are unavailable.
+static int FindFileFenced(const InternalKeyComparator& icmp,
+                          const std::vector<FileMetaData*>& files,
+                          const std::vector<uint32_t>& fences,
+                          const Slice& key) {
+  uint32_t key_prefix;
+  if (fences.size() != files.size() ||
+      !icmp.OrderPreservingPrefix(key, &key_prefix)) {
+    return FindFile(icmp, files, key);
+  }
+
+  // Interpolation-guided lower bound: first fence >= key_prefix.
+  uint32_t lo = 0;
+  uint32_t hi = fences.size();
+  while (lo < hi) {
+    const uint32_t flo = fences[lo];
+    const uint32_t fhi = fences[hi - 1];
+    if (key_prefix <= flo) {
+      break;
+    }
+    if (key_prefix > fhi) {
+      lo = hi;
+      break;
+    }
+    uint32_t mid =
+        lo + static_cast<uint32_t>(
+                 static_cast<uint64_t>(key_prefix - flo) * (hi - 1 - lo) /
+                 (fhi - flo));
+    if (fences[mid] < key_prefix) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  // Files with a smaller fence cannot contain the key; within the run
+  // of equal fences the prefix is inconclusive, so finish with full
+  // comparisons there.
+  uint32_t run_end = lo;
+  while (run_end < fences.size() && fences[run_end] == key_prefix) {
+    run_end++;
+  }
+  uint32_t left = lo;
+  uint32_t right = run_end;
+  while (left < right) {
+    const uint32_t mid = (left + right) / 2;
+    if (icmp.InternalKeyComparator::Compare(files[mid]->largest.Encode(),
+                                            key) < 0) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left;
+}
+
 static bool AfterFile(const Comparator* ucmp, const Slice* user_key,
                       const FileMetaData* f) {
   // null user_key occurs before all keys and is therefore never after *f
@@ -157,8 +220,9 @@ bool SomeFileOverlapsRange(const InternalKeyComparator& icmp,
 
 // An internal iterator.  For a given version/level pair, yields
 // information about the files in the level.  For a given entry, key()
-// is the largest key that occurs in the file, and value() is an
-// 16-byte value containing the file number and file size, both
+// is the largest key that occurs in the file, and value() is a
+// 24-byte value containing the file number, file size and the
+// FileMetaData pointer (valid while the version is pinned), all
 // encoded using EncodeFixed64.
 class Version::LevelFileNumIterator : public Iterator {
  public:
@@ -194,6 +258,8 @@ class Version::LevelFileNumIterator : public Iterator {
     assert(Valid());
     EncodeFixed64(value_buf_, (*flist_)[index_]->number);
     EncodeFixed64(value_buf_ + 8, (*flist_)[index_]->file_size);
+    EncodeFixed64(value_buf_ + 16,
+                  reinterpret_cast<uint64_t>((*flist_)[index_]));
     return Slice(value_buf_, sizeof(value_buf_));
   }
   Status status() const override { return Status::OK(); }
@@ -203,20 +269,27 @@ class Version::LevelFileNumIterator : public Iterator {
   const std::vector<FileMetaData*>* const flist_;
   uint32_t index_;
 
-  // Backing store for value().  Holds the file number and size.
-  mutable char value_buf_[16];
+  // Backing store for value().  Holds file number, size and metadata
+  // pointer.
+  mutable char value_buf_[24];
 };
 
 static Iterator* GetFileIterator(void* arg, const ReadOptions& options,
                                  const Slice& file_value) {
   TableCache* cache = reinterpret_cast<TableCache*>(arg);
+  if (file_value.size() == 24) {
+    // The level iterator also hands us the FileMetaData, letting
+    // pinned-open mode skip the table-cache lookup entirely.
+    return cache->NewIterator(
+        options,
+        reinterpret_cast<FileMetaData*>(DecodeFixed64(file_value.data() + 16)));
+  }
   if (file_value.size() != 16) {
     return NewErrorIterator(
         Status::Corruption("FileReader invoked with unexpected value"));
-  } else {
-    return cache->NewIterator(options, DecodeFixed64(file_value.data()),
-                              DecodeFixed64(file_value.data() + 8));
   }
+  return cache->NewIterator(options, DecodeFixed64(file_value.data()),
+                            DecodeFixed64(file_value.data() + 8));
 }
 
 Iterator* Version::NewConcatenatingIterator(const ReadOptions& options,
@@ -230,8 +303,8 @@ void Version::AddIterators(const ReadOptions& options,
                            std::vector<Iterator*>* iters) {
   // Merge all level zero files together since they may overlap
   for (size_t i = 0; i < files_[0].size(); i++) {
-    iters->push_back(vset_->table_cache_->NewIterator(
-        options, files_[0][i]->number, files_[0][i]->file_size));
+    iters->push_back(
+        vset_->table_cache_->NewIterator(options, files_[0][i]));
   }
 
   // For levels > 0, we can use a concatenating iterator that sequentially
@@ -257,6 +330,11 @@ struct Saver {
   const Comparator* ucmp;
   Slice user_key;
   std::string* value;
+  SequenceNumber seq;  // Sequence number of the deciding entry
+  bool is_blob;        // True if *value holds a blob handle
+  bool pin;            // Leave the value in pinned_value, uncopied
+  bool verify_value_checksum;  // Options::value_checksums
+  Slice pinned_value;
 };
 }  // namespace
 static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
@@ -266,9 +344,24 @@ static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
     s->state = kCorrupt;
   } else {
     if (s->ucmp->Compare(parsed_key.user_key, s->user_key) == 0) {
-      s->state = (parsed_key.type == kTypeValue) ? kFound : kDeleted;
+      s->state = (parsed_key.type == kTypeValue ||
+                  parsed_key.type == kTypeBlobHandle)
+                     ? kFound
+                     : kDeleted;
+      s->seq = parsed_key.sequence;
+      s->is_blob = (parsed_key.type == kTypeBlobHandle);
       if (s->state == kFound) {
-        s->value->assign(v.data(), v.size());
+        Slice stored = v;
+        if (s->verify_value_checksum && parsed_key.type == kTypeValue &&
+            !VerifyValueChecksum(parsed_key.user_key, &stored)) {
+          s->state = kCorrupt;
+          return;
+        }
+        if (s->pin) {
+          s->pinned_value = stored;
+        } else {
+          s->value->assign(stored.data(), stored.size());
+        }
       }
     }
   }
@@ -278,18 +371,28 @@ static bool NewestFirst(FileMetaData* a, FileMetaData* b) {
   return a->number > b->number;
 }
 
+bool Version::LevelMayContain(const Comparator* ucmp, int level,
+                              const Slice& user_key) const {
+  return ucmp->Compare(user_key, Slice(level_smallest_[level])) >= 0 &&
+         ucmp->Compare(user_key, Slice(level_largest_[level])) <= 0;
+}
+
 void Version::ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
                                  bool (*func)(void*, int, FileMetaData*)) {
   const Comparator* ucmp = vset_->icmp_.user_comparator();
 
-  // Search level-0 in order from newest to oldest.
+  // Search level-0 in order from newest to oldest.  The level bounds
+  // reject the whole level with two comparisons when the key cannot be
+  // here at all.
   std::vector<FileMetaData*> tmp;
-  tmp.reserve(files_[0].size());
-  for (uint32_t i = 0; i < files_[0].size(); i++) {
-    FileMetaData* f = files_[0][i];
-    if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0 &&
-        ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
-      tmp.push_back(f);
+  if (!files_[0].empty() && LevelMayContain(ucmp, 0, user_key)) {
+    tmp.reserve(files_[0].size());
+    for (uint32_t i = 0; i < files_[0].size(); i++) {
+      FileMetaData* f = files_[0][i];
+      if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0 &&
+          ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
+        tmp.push_back(f);
+      }
     }
   }
   if (!tmp.empty()) {
@@ -305,9 +408,15 @@ void Version::ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
   for (int level = 1; level < config::kNumLevels; level++) {
     size_t num_files = files_[level].size();
     if (num_files == 0) continue;
+    if (!LevelMayContain(ucmp, level, user_key)) {
+      vset_->level_range_misses_[level].fetch_add(1,
+                                                  std::memory_order_relaxed);
+      continue;
+    }
 
     // Binary search to find earliest index whose largest key >= internal_key.
-    uint32_t index = FindFile(vset_->icmp_, files_[level], internal_key);
+    uint32_t index = static_cast<uint32_t>(FindFileFenced(
+        vset_->icmp_, files_[level], fence_largest_[level], internal_key));
     if (index < num_files) {
       FileMetaData* f = files_[level][index];
       if (ucmp->Compare(user_key, f->smallest.user_key()) < 0) {
@@ -322,15 +431,19 @@ void Version::ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
 }
 
 Status Version::Get(const ReadOptions& options, const LookupKey& k,
-                    std::string* value, GetStats* stats) {
+                    std::string* value, GetStats* stats,
+                    SequenceNumber* found_seq, bool* is_blob,
+                    Iterator** pinned_iter, Slice* pinned_value) {
   stats->seek_file = nullptr;
   stats->seek_file_level = -1;
+  stats->num_charged = 0;
 
   struct State {
     Saver saver;
     GetStats* stats;
     const ReadOptions* options;
     Slice ikey;
+    Iterator** pinned_iter;
     FileMetaData* last_file_read;
     int last_file_read_level;
 
@@ -341,23 +454,43 @@ Status Version::Get(const ReadOptions& options, const LookupKey& k,
     static bool Match(void* arg, int level, FileMetaData* f) {
       State* state = reinterpret_cast<State*>(arg);
 
-      if (state->stats->seek_file == nullptr &&
-          state->last_file_read != nullptr) {
-        // We have had more than one seek for this read.  Charge the 1st file.
-        state->stats->seek_file = state->last_file_read;
-        state->stats->seek_file_level = state->last_file_read_level;
-      }
-
       state->last_file_read = f;
       state->last_file_read_level = level;
 
-      state->s = state->vset->table_cache_->Get(*state->options, f->number,
-                                                f->file_size, state->ikey,
-                                                &state->saver, SaveValue);
+      Iterator* pinned = nullptr;
+      bool did_block_read = false;
+      state->s = state->vset->table_cache_->Get(
+          *state->options, f, state->ikey, &state->saver, SaveValue,
+          state->pinned_iter != nullptr ? &pinned : nullptr, &did_block_read);
+      if (state->saver.state == kNotFound &&
+          state->stats->num_charged < GetStats::kMaxCharged) {
+        // This probe found nothing: charge the file's read heat so
+        // repeatedly-wasteful files get compacted away.  The charge is
+        // deliberately unconditional -- cached blocks, filter-rejected
+        // probes and empty index seeks all count, as in stock leveldb,
+        // whose seek charge never depended on a block read either.
+        // Charging every probed file (up to kMaxCharged) rather than
+        // just the first is what spreads heat across an overlapping
+        // stack, which is exactly the shape seek compaction exists to
+        // fix.
+        state->stats->charged_files[state->stats->num_charged] = f;
+        state->stats->charged_levels[state->stats->num_charged] = level;
+        state->stats->num_charged++;
+      }
+      (void)did_block_read;
       if (!state->s.ok()) {
+        delete pinned;
         state->found = true;
         return false;
       }
+      if (pinned != nullptr) {
+        if (state->saver.state == kFound) {
+          delete *state->pinned_iter;  // From an earlier, shadowed file
+          *state->pinned_iter = pinned;
+        } else {
+          delete pinned;
+        }
+      }
       switch (state->saver.state) {
         case kNotFound:
           return true;  // Keep searching in other files
@@ -393,23 +526,60 @@ Status Version::Get(const ReadOptions& options, const LookupKey& k,
   state.saver.ucmp = vset_->icmp_.user_comparator();
   state.saver.user_key = k.user_key();
   state.saver.value = value;
+  state.saver.seq = 0;
+  state.saver.is_blob = false;
+  state.saver.pin = (pinned_iter != nullptr);
+  state.saver.verify_value_checksum = vset_->options_->value_checksums;
+  state.pinned_iter = pinned_iter;
+  if (pinned_iter != nullptr) {
+    *pinned_iter = nullptr;
+  }
 
   ForEachOverlapping(state.saver.user_key, state.ikey, &state, &State::Match);
 
+  if (state.found && state.s.ok() && state.saver.state == kFound) {
+    vset_->level_read_hits_[state.last_file_read_level].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  if (found_seq != nullptr) {
+    *found_seq = state.saver.seq;
+  }
+  if (is_blob != nullptr) {
+    *is_blob = state.saver.is_blob;
+  }
+  if (pinned_value != nullptr) {
+    *pinned_value = state.saver.pinned_value;
+  }
   return state.found ? state.s : Status::NotFound(Slice());
 }
 
 bool Version::UpdateStats(const GetStats& stats) {
+  // Bottom-level files cannot be seek-compacted (there is no level
+  // beneath them to merge into).
+  bool trigger = false;
   FileMetaData* f = stats.seek_file;
-  if (f != nullptr) {
+  if (f != nullptr && stats.seek_file_level + 1 < config::kNumLevels) {
     f->allowed_seeks--;
     if (f->allowed_seeks <= 0 && file_to_compact_ == nullptr) {
       file_to_compact_ = f;
       file_to_compact_level_ = stats.seek_file_level;
-      return true;
+      trigger = true;
     }
   }
-  return false;
+  for (int i = 0; i < stats.num_charged; i++) {
+    if (stats.charged_levels[i] + 1 >= config::kNumLevels) {
+      continue;
+    }
+    FileMetaData* charged = stats.charged_files[i];
+    charged->allowed_seeks--;
+    if (charged->allowed_seeks <= 0 && file_to_compact_ == nullptr) {
+      file_to_compact_ = charged;
+      file_to_compact_level_ = stats.charged_levels[i];
+      trigger = true;
+    }
+  }
+  return trigger;
 }
 
 bool Version::RecordReadSample(Slice internal_key) {
@@ -429,6 +599,7 @@ bool Version::RecordReadSample(Slice internal_key) {
         // Remember first match.
         state->stats.seek_file = f;
         state->stats.seek_file_level = level;
+        state->stats.num_charged = 0;
       }
       // We can stop iterating once we have a second match.
       return state->matches < 2;
@@ -469,6 +640,10 @@ bool Version::OverlapInLevel(int level, const Slice* smallest_user_key,
 
 int Version::PickLevelForMemTableOutput(const Slice& smallest_user_key,
                                         const Slice& largest_user_key) {
+  if (vset_->options_->compaction_style == kCompactionStyleUniversal) {
+    // Every sorted run lives in level 0.
+    return 0;
+  }
   int level = 0;
   if (!OverlapInLevel(0, &smallest_user_key, &largest_user_key)) {
     // Push to next level if there is no overlap in next level,
@@ -476,7 +651,11 @@ int Version::PickLevelForMemTableOutput(const Slice& smallest_user_key,
     InternalKey start(smallest_user_key, kMaxSequenceNumber, kValueTypeForSeek);
     InternalKey limit(largest_user_key, 0, static_cast<ValueType>(0));
     std::vector<FileMetaData*> overlaps;
-    while (level < config::kMaxMemCompactLevel) {
+    int max_level = vset_->options_->max_mem_compact_level;
+    if (max_level > config::kNumLevels - 1) {
+      max_level = config::kNumLevels - 1;
+    }
+    while (level < max_level) {
       if (OverlapInLevel(level + 1, &smallest_user_key, &largest_user_key)) {
         break;
       }
@@ -673,28 +852,39 @@ class VersionSet::Builder {
     BySmallestKey cmp;
     cmp.internal_comparator = &vset_->icmp_;
     for (int level = 0; level < config::kNumLevels; level++) {
+      // A level the edit does not touch shares the base version's
+      // list: applying an edit is O(files in changed levels), not
+      // O(all files).
+      const FileSet* added_files = levels_[level].added_files;
+      if (added_files->empty() && levels_[level].deleted_files.empty()) {
+        v->files_.Share(level, base_->files_);
+        continue;
+      }
+
       // Merge the set of added files with the set of pre-existing files.
       // Drop any deleted files.  Store the result in *v.
       const std::vector<FileMetaData*>& base_files = base_->files_[level];
       std::vector<FileMetaData*>::const_iterator base_iter = base_files.begin();
       std::vector<FileMetaData*>::const_iterator base_end = base_files.end();
-      const FileSet* added_files = levels_[level].added_files;
-      v->files_[level].reserve(base_files.size() + added_files->size());
+      std::shared_ptr<Version::LevelFiles> out =
+          std::make_shared<Version::LevelFiles>();
+      out->files.reserve(base_files.size() + added_files->size());
       for (const auto& added_file : *added_files) {
         // Add all smaller files listed in base_
         for (std::vector<FileMetaData*>::const_iterator bpos =
                  std::upper_bound(base_iter, base_end, added_file, cmp);
              base_iter != bpos; ++base_iter) {
-          MaybeAddFile(v, level, *base_iter);
+          MaybeAddFile(&out->files, level, *base_iter);
         }
 
-        MaybeAddFile(v, level, added_file);
+        MaybeAddFile(&out->files, level, added_file);
       }
 
       // Add remaining base files
       for (; base_iter != base_end; ++base_iter) {
-        MaybeAddFile(v, level, *base_iter);
+        MaybeAddFile(&out->files, level, *base_iter);
       }
+      v->files_.Reset(level, std::move(out));
 
 #ifndef NDEBUG
       // Make sure there is no overlap in levels > 0
@@ -714,11 +904,11 @@ class VersionSet::Builder {
     }
   }
 
-  void MaybeAddFile(Version* v, int level, FileMetaData* f) {
+  void MaybeAddFile(std::vector<FileMetaData*>* files, int level,
+                    FileMetaData* f) {
     if (levels_[level].deleted_files.count(f->number) > 0) {
       // File is deleted: do nothing
     } else {
-      std::vector<FileMetaData*>* files = &v->files_[level];
       if (level > 0 && !files->empty()) {
         // Must not overlap
         assert(vset_->icmp_.Compare((*files)[files->size() - 1]->largest,
@@ -745,8 +935,13 @@ VersionSet::VersionSet(const std::string& dbname, const Options* options,
       prev_log_number_(0),
       descriptor_file_(nullptr),
       descriptor_log_(nullptr),
+      descriptor_file_size_(0),
       dummy_versions_(this),
       current_(nullptr) {
+  for (int level = 0; level < config::kNumLevels; level++) {
+    level_read_hits_[level].store(0, std::memory_order_relaxed);
+    level_range_misses_[level].store(0, std::memory_order_relaxed);
+  }
   AppendVersion(new Version(this));
 }
 
@@ -797,11 +992,26 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
   }
   Finalize(v);
 
+  // Roll the manifest over once it has grown past the configured
+  // limit: the fresh descriptor starts with just a snapshot of the
+  // current state, bounding recovery time.
+  Status s;
+  if (descriptor_log_ != nullptr && options_->max_manifest_file_size > 0 &&
+      descriptor_file_size_ >= options_->max_manifest_file_size) {
+    delete descriptor_log_;
+    s = descriptor_file_->Close();
+    delete descriptor_file_;
+    descriptor_log_ = nullptr;
+    descriptor_file_ = nullptr;
+    manifest_file_number_ = NewFileNumber();
+    Log(options_->info_log, "Rolling over MANIFEST to #%llu",
+        static_cast<unsigned long long>(manifest_file_number_));
+  }
+
   // Initialize new descriptor log file if necessary by creating
   // a temporary file that contains a snapshot of the current version.
   std::string new_manifest_file;
-  Status s;
-  if (descriptor_log_ == nullptr) {
+  if (descriptor_log_ == nullptr && s.ok()) {
     // No reason to unlock *mu here since we only hit this path in the
     // first call to LogAndApply (when opening the database).
     assert(descriptor_file_ == nullptr);
@@ -809,6 +1019,7 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
     s = env_->NewWritableFile(new_manifest_file, &descriptor_file_);
     if (s.ok()) {
       descriptor_log_ = new log::Writer(descriptor_file_);
+      descriptor_file_size_ = 0;
       s = WriteSnapshot(descriptor_log_);
     }
   }
@@ -822,6 +1033,7 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
       std::string record;
       edit->EncodeTo(&record);
       s = descriptor_log_->AddRecord(record);
+      descriptor_file_size_ += record.size() + log::kHeaderSize;
       if (s.ok()) {
         s = descriptor_file_->Sync();
       }
@@ -1018,6 +1230,7 @@ bool VersionSet::ReuseManifest(const std::string& dscname,
 
   Log(options_->info_log, "Reusing MANIFEST %s\n", dscname.c_str());
   descriptor_log_ = new log::Writer(descriptor_file_, manifest_size);
+  descriptor_file_size_ = manifest_size;
   manifest_file_number_ = manifest_number;
   return true;
 }
@@ -1028,11 +1241,101 @@ void VersionSet::MarkFileNumberUsed(uint64_t number) {
   }
 }
 
+void Version::BuildFences(const InternalKeyComparator& icmp) {
+  const Comparator* ucmp = icmp.user_comparator();
+  for (int level = 0; level < config::kNumLevels; level++) {
+    level_smallest_[level].clear();
+    level_largest_[level].clear();
+    const std::vector<FileMetaData*>& files = files_[level];
+    if (files.empty()) {
+      continue;
+    }
+    if (level > 0) {
+      // Files are sorted and disjoint.
+      level_smallest_[level].assign(files.front()->smallest.user_key().data(),
+                                    files.front()->smallest.user_key().size());
+      level_largest_[level].assign(files.back()->largest.user_key().data(),
+                                   files.back()->largest.user_key().size());
+    } else {
+      Slice smallest = files[0]->smallest.user_key();
+      Slice largest = files[0]->largest.user_key();
+      for (size_t i = 1; i < files.size(); i++) {
+        if (ucmp->Compare(files[i]->smallest.user_key(), smallest) < 0) {
+          smallest = files[i]->smallest.user_key();
+        }
+        if (ucmp->Compare(files[i]->largest.user_key(), largest) > 0) {
+          largest = files[i]->largest.user_key();
+        }
+      }
+      level_smallest_[level].assign(smallest.data(), smallest.size());
+      level_largest_[level].assign(largest.data(), largest.size());
+    }
+  }
+  for (int level = 1; level < config::kNumLevels; level++) {
+    std::vector<uint32_t>& fences = fence_largest_[level];
+    fences.clear();
+    fences.reserve(files_[level].size());
+    for (size_t i = 0; i < files_[level].size(); i++) {
+      uint32_t prefix;
+      if (!icmp.OrderPreservingPrefix(files_[level][i]->largest.Encode(),
+                                      &prefix)) {
+        fences.clear();
+        break;
+      }
+      fences.push_back(prefix);
+    }
+  }
+}
+
 void VersionSet::Finalize(Version* v) {
+  v->BuildFences(icmp_);
+  if (options_->compaction_style == kCompactionStyleUniversal) {
+    v->compaction_level_ = 0;
+    v->compaction_score_ =
+        v->files_[0].size() /
+        static_cast<double>(options_->l0_compaction_trigger);
+    return;
+  }
   // Precomputed best level for next compaction
   int best_level = -1;
   double best_score = -1;
 
+  // With dynamic level sizing, anchor the size ladder at the deepest
+  // non-empty level so data is not pushed into high levels before the
+  // database is large enough to need them.
+  double dynamic_targets[config::kNumLevels];
+  bool use_dynamic = false;
+  if (options_->dynamic_level_bytes) {
+    int last_level = -1;
+    for (int level = config::kNumLevels - 1; level >= 1; level--) {
+      if (!v->files_[level].empty()) {
+        last_level = level;
+        break;
+      }
+    }
+    if (last_level > 0) {
+      use_dynamic = true;
+      double target = static_cast<double>(TotalFileSize(v->files_[last_level]));
+      if (target < 10. * 1048576.0) {
+        target = 10. * 1048576.0;
+      }
+      for (int level = last_level; level >= 1; level--) {
+        dynamic_targets[level] = target;
+        target /= 10.0;
+        if (target < 1048576.0) {
+          target = 1048576.0;  // Keep upper-level targets sane
+        }
+      }
+      for (int level = last_level + 1; level < config::kNumLevels; level++) {
+        // Deeper levels are empty; never score them for compaction.
+        dynamic_targets[level] = 1e18;
+      }
+    }
+  }
+
+  for (int level = 0; level < config::kNumLevels; level++) {
+    v->level_scores_[level] = 0;
+  }
   for (int level = 0; level < config::kNumLevels - 1; level++) {
     double score;
     if (level == 0) {
@@ -1048,14 +1351,16 @@ void VersionSet::Finalize(Version* v) {
       // setting, or very high compression ratios, or lots of
       // overwrites/deletions).
       score = v->files_[level].size() /
-              static_cast<double>(config::kL0_CompactionTrigger);
+              static_cast<double>(options_->l0_compaction_trigger);
     } else {
       // Compute the ratio of current size to size limit.
       const uint64_t level_bytes = TotalFileSize(v->files_[level]);
-      score =
-          static_cast<double>(level_bytes) / MaxBytesForLevel(options_, level);
+      score = static_cast<double>(level_bytes) /
+              (use_dynamic ? dynamic_targets[level]
+                           : MaxBytesForLevel(options_, level));
     }
 
+    v->level_scores_[level] = score;
     if (score > best_score) {
       best_level = level;
       best_score = score;
@@ -1064,6 +1369,67 @@ void VersionSet::Finalize(Version* v) {
 
   v->compaction_level_ = best_level;
   v->compaction_score_ = best_score;
+
+  // Look for a run of small adjacent files to coalesce when idle.
+  v->small_merge_level_ = -1;
+  if (options_->merge_small_files) {
+    const uint64_t small = options_->max_file_size / 4;
+    for (int level = 1;
+         v->small_merge_level_ < 0 && level < config::kNumLevels; level++) {
+      const std::vector<FileMetaData*>& files = v->files_[level];
+      size_t run_begin = 0, run_len = 0;
+      for (size_t i = 0; i <= files.size(); i++) {
+        if (i < files.size() && files[i]->file_size < small) {
+          if (run_len == 0) run_begin = i;
+          run_len++;
+          if (run_len == 16) {  // Bound one merge's width
+            break;
+          }
+        } else if (run_len >= 4) {
+          break;
+        } else {
+          run_len = 0;
+        }
+      }
+      if (run_len >= 4) {
+        v->small_merge_level_ = level;
+        v->small_merge_begin_ = run_begin;
+        v->small_merge_count_ = run_len;
+      }
+    }
+  }
+}
+
+// Consult Options::compaction_picker about the current version.
+// Returns true and fills *level / *file_index when it wants work done.
+bool VersionSet::PickerDecision(int* level, int* file_index) const {
+  CompactionPicker* picker = options_->compaction_picker;
+  assert(picker != nullptr);
+  std::vector<std::vector<CompactionFileInfo>> files(config::kNumLevels);
+  for (int l = 0; l < config::kNumLevels; l++) {
+    files[l].reserve(current_->files_[l].size());
+    for (size_t i = 0; i < current_->files_[l].size(); i++) {
+      const FileMetaData* f = current_->files_[l][i];
+      CompactionFileInfo info;
+      info.number = f->number;
+      info.file_size = f->file_size;
+      info.smallest_user_key = f->smallest.user_key();
+      info.largest_user_key = f->largest.user_key();
+      files[l].push_back(info);
+    }
+  }
+  *file_index = -1;
+  *level = picker->Pick(files, current_->level_scores_, config::kNumLevels,
+                        file_index);
+  if (*level < 0 || *level + 1 >= config::kNumLevels ||
+      current_->files_[*level].empty()) {
+    return false;
+  }
+  if (*file_index >= 0 &&
+      static_cast<size_t>(*file_index) >= current_->files_[*level].size()) {
+    *file_index = -1;  // Out of range; fall back to keyspace rotation
+  }
+  return true;
 }
 
 Status VersionSet::WriteSnapshot(log::Writer* log) {
@@ -1146,6 +1512,15 @@ uint64_t VersionSet::ApproximateOffsetOf(Version* v, const InternalKey& ikey) {
   return result;
 }
 
+void VersionSet::AddCurrentFiles(std::set<uint64_t>* files) {
+  for (int level = 0; level < config::kNumLevels; level++) {
+    const std::vector<FileMetaData*>& level_files = current_->files_[level];
+    for (size_t i = 0; i < level_files.size(); i++) {
+      files->insert(level_files[i]->number);
+    }
+  }
+}
+
 void VersionSet::AddLiveFiles(std::set<uint64_t>* live) {
   for (Version* v = dummy_versions_.next_; v != &dummy_versions_;
        v = v->next_) {
@@ -1158,6 +1533,48 @@ void VersionSet::AddLiveFiles(std::set<uint64_t>* live) {
   }
 }
 
+void VersionSet::AddLiveFilesExcept(
+    std::set<uint64_t>* live,
+    const std::vector<std::pair<Version*, std::string>>& cursors) {
+  const Comparator* ucmp = icmp_.user_comparator();
+  for (Version* v = dummy_versions_.next_; v != &dummy_versions_;
+       v = v->next_) {
+    // A version can shed passed files only when its every reference is
+    // a release-mode scan that has reported progress.
+    int cursor_refs = 0;
+    bool have_cursor = false;
+    Slice min_cursor;
+    for (size_t i = 0; i < cursors.size(); i++) {
+      if (cursors[i].first != v) {
+        continue;
+      }
+      cursor_refs++;
+      if (cursors[i].second.empty()) {
+        have_cursor = false;  // A scan with no progress pins everything
+        cursor_refs = -1;     // Never matches refs_
+        break;
+      }
+      Slice cursor(cursors[i].second);
+      if (!have_cursor || ucmp->Compare(cursor, min_cursor) < 0) {
+        min_cursor = cursor;
+        have_cursor = true;
+      }
+    }
+    const bool reclaim =
+        (v != current_) && have_cursor && cursor_refs == v->refs_;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      const std::vector<FileMetaData*>& files = v->files_[level];
+      for (size_t i = 0; i < files.size(); i++) {
+        if (reclaim &&
+            ucmp->Compare(files[i]->largest.user_key(), min_cursor) < 0) {
+          continue;  // Wholly behind every cursor on this version
+        }
+        live->insert(files[i]->number);
+      }
+    }
+  }
+}
+
 int64_t VersionSet::NumLevelBytes(int level) const {
   assert(level >= 0);
   assert(level < config::kNumLevels);
@@ -1216,11 +1633,68 @@ void VersionSet::GetRange2(const std::vector<FileMetaData*>& inputs1,
   GetRange(all, smallest, largest);
 }
 
+namespace {
+
+// Cleanup state for iterators over tables opened outside the cache
+// (direct I/O compaction inputs).
+struct DirectTableState {
+  RandomAccessFile* file;
+  Table* table;
+};
+
+void CleanupDirectTable(void* arg1, void* arg2) {
+  DirectTableState* state = reinterpret_cast<DirectTableState*>(arg1);
+  delete state->table;
+  delete state->file;
+  delete state;
+}
+
+}  // namespace
+
+Iterator* VersionSet::NewDirectTableIterator(const ReadOptions& options,
+                                             const FileMetaData* f) {
+  RandomAccessFile* file = nullptr;
+  Status s = env_->NewUnbufferedRandomAccessFile(
+      TableFileName(dbname_, f->number), &file);
+  Table* table = nullptr;
+  if (s.ok()) {
+    s = Table::Open(*options_, file, f->file_size, &table);
+  }
+  if (!s.ok()) {
+    delete file;
+    return NewErrorIterator(s);
+  }
+  Iterator* iter = table->NewIterator(options);
+  DirectTableState* state = new DirectTableState;
+  state->file = file;
+  state->table = table;
+  iter->RegisterCleanup(&CleanupDirectTable, state, nullptr);
+  return iter;
+}
+
 Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   ReadOptions options;
-  options.verify_checksums = options_->paranoid_checks;
+  // With async verification a background pass covers the inputs.
+  options.verify_checksums =
+      options_->paranoid_checks && !options_->async_verify_compaction_inputs;
   options.fill_cache = false;
 
+  if (options_->use_direct_io_for_compaction) {
+    // Open every input outside the table cache with direct I/O so the
+    // compaction's streaming reads stay out of the OS page cache.
+    const int space = c->inputs_[0].size() + c->inputs_[1].size();
+    Iterator** list = new Iterator*[space];
+    int num = 0;
+    for (int which = 0; which < 2; which++) {
+      for (size_t i = 0; i < c->inputs_[which].size(); i++) {
+        list[num++] = NewDirectTableIterator(options, c->inputs_[which][i]);
+      }
+    }
+    Iterator* result = NewMergingIterator(&icmp_, list, num);
+    delete[] list;
+    return result;
+  }
+
   // Level-0 files have to be merged together.  For other levels,
   // we will make a concatenating iterator per level.
   // TODO(opt): use concatenating iterator for level-0 if there is no overlap
@@ -1249,15 +1723,53 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   return result;
 }
 
+int VersionSet::PickCompactionLevel() const {
+  if (options_->compaction_style == kCompactionStyleUniversal) {
+    return (current_->compaction_score_ >= 1) ? 0 : -1;
+  }
+  if (current_->compaction_score_ >= 1) {
+    return current_->compaction_level_;
+  }
+  if (current_->file_to_compact_ != nullptr) {
+    return current_->file_to_compact_level_;
+  }
+  if (current_->small_merge_level_ >= 0) {
+    return current_->small_merge_level_;
+  }
+  return -1;
+}
+
 Compaction* VersionSet::PickCompaction() {
+  if (options_->compaction_style == kCompactionStyleUniversal) {
+    return PickCompactionUniversal();
+  }
+
   Compaction* c;
   int level;
 
-  // We prefer compactions triggered by too much data in a level over
-  // the compactions triggered by seeks.
-  const bool size_compaction = (current_->compaction_score_ >= 1);
-  const bool seek_compaction = (current_->file_to_compact_ != nullptr);
-  if (size_compaction) {
+  if (options_->compaction_picker != nullptr) {
+    int file_index;
+    if (!PickerDecision(&level, &file_index)) {
+      return nullptr;
+    }
+    c = new Compaction(options_, level);
+    if (file_index >= 0) {
+      c->inputs_[0].push_back(current_->files_[level][file_index]);
+    } else {
+      // Keyspace rotation, as in the default policy below.
+      for (size_t i = 0; i < current_->files_[level].size(); i++) {
+        FileMetaData* f = current_->files_[level][i];
+        if (compact_pointer_[level].empty() ||
+            icmp_.Compare(f->largest.Encode(), compact_pointer_[level]) > 0) {
+          c->inputs_[0].push_back(f);
+          break;
+        }
+      }
+      if (c->inputs_[0].empty()) {
+        c->inputs_[0].push_back(current_->files_[level][0]);
+      }
+    }
+  } else if (current_->compaction_score_ >= 1) {
     level = current_->compaction_level_;
     assert(level >= 0);
     assert(level + 1 < config::kNumLevels);
@@ -1276,10 +1788,25 @@ Compaction* VersionSet::PickCompaction() {
       // Wrap-around to the beginning of the key space
       c->inputs_[0].push_back(current_->files_[level][0]);
     }
-  } else if (seek_compaction) {
+  } else if (current_->file_to_compact_ != nullptr) {
     level = current_->file_to_compact_level_;
     c = new Compaction(options_, level);
     c->inputs_[0].push_back(current_->file_to_compact_);
+  } else if (current_->small_merge_level_ >= 0) {
+    // Nothing urgent: coalesce a run of small adjacent files in place.
+    // Same-level output, so deletion markers are kept (the machinery
+    // shared with universal compaction already enforces that).
+    level = current_->small_merge_level_;
+    c = new Compaction(options_, level);
+    c->output_level_ = level;
+    c->max_output_file_size_ = options_->max_file_size;
+    for (size_t i = 0; i < current_->small_merge_count_; i++) {
+      c->inputs_[0].push_back(
+          current_->files_[level][current_->small_merge_begin_ + i]);
+    }
+    c->input_version_ = current_;
+    c->input_version_->Ref();
+    return c;
   } else {
     return nullptr;
   }
@@ -1445,6 +1972,44 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
   c->edit_.SetCompactPointer(level, largest);
 }
 
+Compaction* VersionSet::PickCompactionUniversal() {
+  const std::vector<FileMetaData*>& files = current_->files_[0];
+  if (files.size() <
+      static_cast<size_t>(options_->l0_compaction_trigger)) {
+    return nullptr;
+  }
+
+  // Order the runs youngest first and take the longest prefix in which
+  // each older run is at most twice the size of everything younger, so
+  // similar-sized runs merge together and a huge old run is left alone
+  // until enough data accumulates in front of it.
+  std::vector<FileMetaData*> runs(files);
+  std::sort(runs.begin(), runs.end(), NewestFirst);
+  uint64_t sum = runs[0]->file_size;
+  size_t n = 1;
+  while (n < runs.size() && runs[n]->file_size <= 2 * sum) {
+    sum += runs[n]->file_size;
+    n++;
+  }
+  if (n < 2) {
+    // Sizes are too skewed; merge the two youngest runs anyway to
+    // bound the run count.
+    n = 2;
+  }
+
+  Compaction* c = new Compaction(options_, 0);
+  c->output_level_ = 0;
+  c->universal_full_ = (n == runs.size());
+  // A universal output is one run regardless of size.
+  c->max_output_file_size_ = ~static_cast<uint64_t>(0);
+  for (size_t i = 0; i < n; i++) {
+    c->inputs_[0].push_back(runs[i]);
+  }
+  c->input_version_ = current_;
+  c->input_version_->Ref();
+  return c;
+}
+
 Compaction* VersionSet::CompactRange(int level, const InternalKey* begin,
                                      const InternalKey* end) {
   std::vector<FileMetaData*> inputs;
@@ -1480,6 +2045,8 @@ Compaction* VersionSet::CompactRange(int level, const InternalKey* begin,
 
 Compaction::Compaction(const Options* options, int level)
     : level_(level),
+      output_level_(level + 1),
+      universal_full_(false),
       max_output_file_size_(MaxFileSizeForLevel(options, level)),
       input_version_(nullptr),
       grandparent_index_(0),
@@ -1501,7 +2068,8 @@ bool Compaction::IsTrivialMove() const {
   // Avoid a move if there is lots of overlapping grandparent data.
   // Otherwise, the move could create a parent file that will require
   // a very expensive merge later on.
-  return (num_input_files(0) == 1 && num_input_files(1) == 0 &&
+  return (output_level_ != level_ && num_input_files(0) == 1 &&
+          num_input_files(1) == 0 &&
           TotalFileSize(grandparents_) <=
               MaxGrandParentOverlapBytes(vset->options_));
 }
@@ -1515,6 +2083,12 @@ void Compaction::AddInputDeletions(VersionEdit* edit) {
 }
 
 bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
+  if (output_level_ == level_) {
+    // Universal compaction: runs outside this compaction may hold
+    // older entries for the key, so deletion markers can only be
+    // dropped when every run is being merged.
+    return universal_full_;
+  }
   // Maybe use binary search to find right entry instead of linear search?
   const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
   for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
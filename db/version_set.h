@@ -15,7 +15,9 @@
 #ifndef STORAGE_LEVELDB_DB_VERSION_SET_H_
 #define STORAGE_LEVELDB_DB_VERSION_SET_H_
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -60,8 +62,16 @@ bool SomeFileOverlapsRange(const InternalKeyComparator& icmp,
 class Version {
  public:
   struct GetStats {
+    // Set by the read-sampling path (RecordReadSample).
     FileMetaData* seek_file;
     int seek_file_level;
+
+    // Files whose data blocks were actually read without yielding the
+    // key -- genuinely wasted I/O.  UpdateStats() charges each one.
+    enum { kMaxCharged = 4 };
+    FileMetaData* charged_files[kMaxCharged];
+    int charged_levels[kMaxCharged];
+    int num_charged;
   };
 
   // Append to *iters a sequence of iterators that will
@@ -72,8 +82,15 @@ class Version {
   // Lookup the value for key.  If found, store it in *val and
   // return OK.  Else return a non-OK status.  Fills *stats.
   // REQUIRES: lock is not held
+  // If "found_seq" is non-null it receives the sequence number of the
+  // entry that decided the result.
+  // A non-null "pinned_iter" receives (on a found entry) the block
+  // iterator pinning the value, and *val is then left untouched; use
+  // pinned_value instead.
   Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
-             GetStats* stats);
+             GetStats* stats, SequenceNumber* found_seq = nullptr,
+             bool* is_blob = nullptr, Iterator** pinned_iter = nullptr,
+             Slice* pinned_value = nullptr);
 
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
@@ -111,6 +128,16 @@ class Version {
 
   int NumFiles(int level) const { return files_[level].size(); }
 
+  // Queue *f (which must belong to this version's "level") for the
+  // seek/heat compaction mechanism unless another file is queued.
+  // REQUIRES: lock is held
+  void MarkFileForCompaction(int level, FileMetaData* f) {
+    if (file_to_compact_ == nullptr && level + 1 < config::kNumLevels) {
+      file_to_compact_ = f;
+      file_to_compact_level_ = level;
+    }
+  }
+
   // Return a human readable string that describes this version's contents.
   std::string DebugString() const;
 
@@ -145,13 +172,63 @@ class Version {
   void ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
                           bool (*func)(void*, int, FileMetaData*));
 
+  // Build the per-level fence arrays used to accelerate file lookup;
+  // called once when the version is finalized.
+  void BuildFences(const InternalKeyComparator& icmp);
+
+  bool LevelMayContain(const Comparator* ucmp, int level,
+                       const Slice& user_key) const;
+
   VersionSet* vset_;  // VersionSet to which this Version belongs
   Version* next_;     // Next version in linked list
   Version* prev_;     // Previous version in linked list
   int refs_;          // Number of live refs to this version
 
+  // One level's file list, shared copy-on-write between versions: a
+  // list owns one reference on each of its files, released when the
+  // last sharing version drops the list.
+  struct LevelFiles {
+    std::vector<FileMetaData*> files;
+    ~LevelFiles();
+  };
+
+  // Per-level file lists.  Levels untouched by a VersionEdit share
+  // their list with the parent version, so applying an edit costs
+  // O(files in changed levels) instead of O(all files).
+  class FileLists {
+   public:
+    FileLists() {
+      for (int level = 0; level < config::kNumLevels; level++) {
+        levels_[level] = std::make_shared<LevelFiles>();
+      }
+    }
+    const std::vector<FileMetaData*>& operator[](int level) const {
+      return levels_[level]->files;
+    }
+    void Share(int level, const FileLists& other) {
+      levels_[level] = other.levels_[level];
+    }
+    void Reset(int level, std::shared_ptr<LevelFiles> files) {
+      levels_[level] = std::move(files);
+    }
+
+   private:
+    std::shared_ptr<LevelFiles> levels_[config::kNumLevels];
+  };
+
   // List of files per level
-  std::vector<FileMetaData*> files_[config::kNumLevels];
+  FileLists files_;
+
+  // Order-preserving prefixes of each file's largest key, laid out
+  // contiguously per level for cache-friendly interpolation search;
+  // empty when the comparator has no such prefixes.
+  std::vector<uint32_t> fence_largest_[config::kNumLevels];
+
+  // User-key range covered by each level, so Get() can reject whole
+  // levels with two comparisons before any per-file work.  Only valid
+  // when the level is non-empty.
+  std::string level_smallest_[config::kNumLevels];
+  std::string level_largest_[config::kNumLevels];
 
   // Next file to compact based on seek stats.
   FileMetaData* file_to_compact_;
@@ -162,6 +239,16 @@ class Version {
   // are initialized by Finalize().
   double compaction_score_;
   int compaction_level_;
+
+  // Fullness score of every level, for Options::compaction_picker.
+  double level_scores_[config::kNumLevels];
+
+  // Candidate run of small adjacent files for a same-level merge
+  // (Options::merge_small_files); level -1 when none.  Set by
+  // Finalize().
+  int small_merge_level_ = -1;
+  size_t small_merge_begin_ = 0;
+  size_t small_merge_count_ = 0;
 };
 
 class VersionSet {
@@ -190,6 +277,9 @@ class VersionSet {
   // Return the current manifest file number
   uint64_t ManifestFileNumber() const { return manifest_file_number_; }
 
+  // Approximate size of the current manifest file.
+  uint64_t ManifestFileSize() const { return descriptor_file_size_; }
+
   // Allocate and return a new file number
   uint64_t NewFileNumber() { return next_file_number_++; }
 
@@ -208,13 +298,16 @@ class VersionSet {
   // Return the combined file size of all files at the specified level.
   int64_t NumLevelBytes(int level) const;
 
-  // Return the last sequence number.
-  uint64_t LastSequence() const { return last_sequence_; }
+  // Return the last sequence number.  Safe to read without the DB
+  // mutex (used by lock-free snapshot acquisition).
+  uint64_t LastSequence() const {
+    return last_sequence_.load(std::memory_order_acquire);
+  }
 
   // Set the last sequence number to s.
   void SetLastSequence(uint64_t s) {
-    assert(s >= last_sequence_);
-    last_sequence_ = s;
+    assert(s >= last_sequence_.load(std::memory_order_relaxed));
+    last_sequence_.store(s, std::memory_order_release);
   }
 
   // Mark the specified file number as used.
@@ -223,16 +316,36 @@ class VersionSet {
   // Return the current log file number.
   uint64_t LogNumber() const { return log_number_; }
 
+  bool PickerDecision(int* level, int* file_index) const;
+
+  // Copy the per-level Get-hit and range-skip counters into the given
+  // arrays (each config::kNumLevels long).
+  void GetLevelReadStats(uint64_t* hits, uint64_t* range_misses) const {
+    for (int level = 0; level < config::kNumLevels; level++) {
+      hits[level] = level_read_hits_[level].load(std::memory_order_relaxed);
+      range_misses[level] =
+          level_range_misses_[level].load(std::memory_order_relaxed);
+    }
+  }
+
   // Return the log file number for the log file that is currently
   // being compacted, or zero if there is no such log file.
   uint64_t PrevLogNumber() const { return prev_log_number_; }
 
+  // Return the level that PickCompaction() would choose, or -1 if
+  // there is no compaction to be done.
+  int PickCompactionLevel() const;
+
   // Pick level and inputs for a new compaction.
   // Returns nullptr if there is no compaction to be done.
   // Otherwise returns a pointer to a heap-allocated object that
   // describes the compaction.  Caller should delete the result.
   Compaction* PickCompaction();
 
+  // Compaction picker for kCompactionStyleUniversal: merges the
+  // youngest run of similar-sized level-0 files back into level 0.
+  Compaction* PickCompactionUniversal();
+
   // Return a compaction object for compacting the range [begin,end] in
   // the specified level.  Returns nullptr if there is nothing in that
   // level that overlaps the specified range.  Caller should delete
@@ -248,16 +361,46 @@ class VersionSet {
   // The caller should delete the iterator when no longer needed.
   Iterator* MakeInputIterator(Compaction* c);
 
+  // Iterator over one table file opened outside the table cache with
+  // direct I/O; used for compaction inputs when
+  // Options::use_direct_io_for_compaction is set.
+  Iterator* NewDirectTableIterator(const ReadOptions& options,
+                                   const FileMetaData* f);
+
+  // Score of the most urgent pending size compaction (>= 1 means a
+  // compaction is needed); used to gauge compaction debt.
+  double CompactionScore() const { return current_->compaction_score_; }
+
   // Returns true iff some level needs a compaction.
   bool NeedsCompaction() const {
+    if (options_->compaction_picker != nullptr) {
+      int level, file_index;
+      return PickerDecision(&level, &file_index);
+    }
     Version* v = current_;
-    return (v->compaction_score_ >= 1) || (v->file_to_compact_ != nullptr);
+    return (v->compaction_score_ >= 1) || (v->file_to_compact_ != nullptr) ||
+           (v->small_merge_level_ >= 0);
   }
 
   // Add all files listed in any live version to *live.
   // May also mutate some internal state.
   void AddLiveFiles(std::set<uint64_t>* live);
 
+  // Like AddLiveFiles(), but omit files of non-current versions that
+  // are referenced only by registered release-mode scans ("cursors":
+  // version, minimum user key reached; an empty key pins everything)
+  // and lie wholly before every such cursor.
+  void AddLiveFilesExcept(
+      std::set<uint64_t>* live,
+      const std::vector<std::pair<Version*, std::string>>& cursors);
+
+  // Add the table files referenced by the current version to *files.
+  void AddCurrentFiles(std::set<uint64_t>* files);
+
+  // Append a VersionEdit describing a snapshot of the current version
+  // (comparator name, compact pointers and files) to *log.
+  Status WriteSnapshot(log::Writer* log);
+
   // Return the approximate offset in the database of the data for
   // "key" as of version "v".
   uint64_t ApproximateOffsetOf(Version* v, const InternalKey& key);
@@ -288,9 +431,6 @@ class VersionSet {
 
   void SetupOtherInputs(Compaction* c);
 
-  // Save current contents to *log
-  Status WriteSnapshot(log::Writer* log);
-
   void AppendVersion(Version* v);
 
   Env* const env_;
@@ -300,13 +440,19 @@ class VersionSet {
   const InternalKeyComparator icmp_;
   uint64_t next_file_number_;
   uint64_t manifest_file_number_;
-  uint64_t last_sequence_;
+  std::atomic<uint64_t> last_sequence_;
+
+  // Read-path statistics: per-level Get() hits, and levels rejected
+  // outright by the version's key-range bounds.  Updated lock-free.
+  std::atomic<uint64_t> level_read_hits_[config::kNumLevels];
+  std::atomic<uint64_t> level_range_misses_[config::kNumLevels];
   uint64_t log_number_;
   uint64_t prev_log_number_;  // 0 or backing store for memtable being compacted
 
   // Opened lazily
   WritableFile* descriptor_file_;
   log::Writer* descriptor_log_;
+  uint64_t descriptor_file_size_;  // Bytes written to the current manifest
   Version dummy_versions_;  // Head of circular doubly-linked list of versions.
   Version* current_;        // == dummy_versions_.prev_
 
@@ -321,9 +467,14 @@ class Compaction {
   ~Compaction();
 
   // Return the level that is being compacted.  Inputs from "level"
-  // and "level+1" will be merged to produce a set of "level+1" files.
+  // and "level+1" will be merged to produce a set of "output_level()"
+  // files (level+1, except for universal compactions, which write
+  // back into their own level).
   int level() const { return level_; }
 
+  // The level that receives this compaction's output files.
+  int output_level() const { return output_level_; }
+
   // Return the object that holds the edits to the descriptor done
   // by this compaction.
   VersionEdit* edit() { return &edit_; }
@@ -364,6 +515,10 @@ class Compaction {
   Compaction(const Options* options, int level);
 
   int level_;
+  int output_level_;
+  // True for a universal compaction covering every run; only then may
+  // deletion markers be dropped.
+  bool universal_full_;
   uint64_t max_output_file_size_;
   Version* input_version_;
   VersionEdit edit_;
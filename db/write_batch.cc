@@ -8,7 +8,8 @@
 //    data: record[count]
 // record :=
 //    kTypeValue varstring varstring         |
-//    kTypeDeletion varstring
+//    kTypeDeletion varstring                |
+//    kTypeRangeDeletion varstring varstring
 // varstring :=
 //    len: varint32
 //    data: uint8[len]
@@ -32,23 +33,69 @@ WriteBatch::~WriteBatch() = default;
 
 WriteBatch::Handler::~Handler() = default;
 
+void WriteBatch::Handler::DeleteRange(const Slice& begin, const Slice& end) {
+  // Ignored by default; see write_batch.h.
+  (void)begin;
+  (void)end;
+}
+
+void WriteBatch::Handler::Merge(const Slice& key, const Slice& value) {
+  // Ignored by default; see write_batch.h.
+  (void)key;
+  (void)value;
+}
+
+void WriteBatch::Handler::Prepare(uint64_t txn_id,
+                                  const Slice& batch_contents) {
+  (void)txn_id;
+  (void)batch_contents;
+}
+
+void WriteBatch::Handler::CommitPrepared(uint64_t txn_id, int count) {
+  (void)txn_id;
+  (void)count;
+}
+
+void WriteBatch::Handler::RollbackPrepared(uint64_t txn_id) { (void)txn_id; }
+
 void WriteBatch::Clear() {
   rep_.clear();
   rep_.resize(kHeader);
+  record_offsets_.clear();
 }
 
+void WriteBatch::Reserve(size_t bytes) { rep_.reserve(kHeader + bytes); }
+
 size_t WriteBatch::ApproximateSize() const { return rep_.size(); }
 
+void WriteBatch::Handler::PutPreEncoded(const char* entry, size_t entry_size,
+                                        const Slice& key, const Slice& value) {
+  (void)entry;
+  (void)entry_size;
+  Put(key, value);
+}
+
 Status WriteBatch::Iterate(Handler* handler) const {
   Slice input(rep_);
   if (input.size() < kHeader) {
     return Status::Corruption("malformed WriteBatch (too small)");
   }
 
+  // Batches built through the typed mutators know where every record
+  // starts, so the walk can jump straight to each record instead of
+  // depending on the previous record's parse.
+  const bool indexed =
+      record_offsets_.size() ==
+      static_cast<size_t>(WriteBatchInternal::Count(this));
+
   input.remove_prefix(kHeader);
   Slice key, value;
   int found = 0;
   while (!input.empty()) {
+    if (indexed) {
+      const size_t offset = record_offsets_[found];
+      input = Slice(rep_.data() + offset, rep_.size() - offset);
+    }
     found++;
     char tag = input[0];
     input.remove_prefix(1);
@@ -68,6 +115,68 @@ Status WriteBatch::Iterate(Handler* handler) const {
           return Status::Corruption("bad WriteBatch Delete");
         }
         break;
+      case kTypeRangeDeletion:
+        if (GetLengthPrefixedSlice(&input, &key) &&
+            GetLengthPrefixedSlice(&input, &value)) {
+          handler->DeleteRange(key, value);
+        } else {
+          return Status::Corruption("bad WriteBatch DeleteRange");
+        }
+        break;
+      case kTypeMerge:
+        if (GetLengthPrefixedSlice(&input, &key) &&
+            GetLengthPrefixedSlice(&input, &value)) {
+          handler->Merge(key, value);
+        } else {
+          return Status::Corruption("bad WriteBatch Merge");
+        }
+        break;
+      case WriteBatchInternal::kPreEncodedValueTag: {
+        const char* entry = input.data();
+        uint32_t internal_key_size;
+        if (GetVarint32(&input, &internal_key_size) &&
+            internal_key_size >= 8 && input.size() >= internal_key_size) {
+          key = Slice(input.data(), internal_key_size - 8);
+          input.remove_prefix(internal_key_size);
+          if (GetLengthPrefixedSlice(&input, &value)) {
+            handler->PutPreEncoded(entry, input.data() - entry, key, value);
+            break;
+          }
+        }
+        return Status::Corruption("bad WriteBatch pre-encoded Put");
+      }
+      case WriteBatchInternal::kPrepareRecordTag: {
+        uint64_t id;
+        if (GetVarint64(&input, &id) &&
+            GetLengthPrefixedSlice(&input, &value)) {
+          handler->Prepare(id, value);
+        } else {
+          return Status::Corruption("bad WriteBatch Prepare");
+        }
+        break;
+      }
+      case WriteBatchInternal::kCommitRecordTag: {
+        uint64_t id;
+        uint32_t op_count;
+        if (GetVarint64(&input, &id) && GetVarint32(&input, &op_count)) {
+          handler->CommitPrepared(id, static_cast<int>(op_count));
+          // The commit stands in for the prepared batch's operations
+          // in the outer batch's count.
+          found += static_cast<int>(op_count) - 1;
+        } else {
+          return Status::Corruption("bad WriteBatch Commit");
+        }
+        break;
+      }
+      case WriteBatchInternal::kRollbackRecordTag: {
+        uint64_t id;
+        if (GetVarint64(&input, &id)) {
+          handler->RollbackPrepared(id);
+        } else {
+          return Status::Corruption("bad WriteBatch Rollback");
+        }
+        break;
+      }
       default:
         return Status::Corruption("unknown WriteBatch tag");
     }
@@ -95,7 +204,22 @@ void WriteBatchInternal::SetSequence(WriteBatch* b, SequenceNumber seq) {
   EncodeFixed64(&b->rep_[0], seq);
 }
 
+void WriteBatchInternal::PutPreEncoded(WriteBatch* batch, const Slice& key,
+                                       const Slice& value) {
+  WriteBatchInternal::SetCount(batch, WriteBatchInternal::Count(batch) + 1);
+  batch->record_offsets_.push_back(batch->rep_.size());
+  batch->rep_.push_back(
+      static_cast<char>(WriteBatchInternal::kPreEncodedValueTag));
+  // Memtable entry layout, with a placeholder tag patched at insert.
+  PutVarint32(&batch->rep_, static_cast<uint32_t>(key.size() + 8));
+  batch->rep_.append(key.data(), key.size());
+  PutFixed64(&batch->rep_, kTypeValue);  // Sequence 0 placeholder
+  PutVarint32(&batch->rep_, static_cast<uint32_t>(value.size()));
+  batch->rep_.append(value.data(), value.size());
+}
+
 void WriteBatch::Put(const Slice& key, const Slice& value) {
+  record_offsets_.push_back(static_cast<uint32_t>(rep_.size()));
   WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
   rep_.push_back(static_cast<char>(kTypeValue));
   PutLengthPrefixedSlice(&rep_, key);
@@ -103,11 +227,28 @@ void WriteBatch::Put(const Slice& key, const Slice& value) {
 }
 
 void WriteBatch::Delete(const Slice& key) {
+  record_offsets_.push_back(static_cast<uint32_t>(rep_.size()));
   WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
   rep_.push_back(static_cast<char>(kTypeDeletion));
   PutLengthPrefixedSlice(&rep_, key);
 }
 
+void WriteBatch::DeleteRange(const Slice& begin, const Slice& end) {
+  record_offsets_.push_back(static_cast<uint32_t>(rep_.size()));
+  WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+  rep_.push_back(static_cast<char>(kTypeRangeDeletion));
+  PutLengthPrefixedSlice(&rep_, begin);
+  PutLengthPrefixedSlice(&rep_, end);
+}
+
+void WriteBatch::Merge(const Slice& key, const Slice& value) {
+  record_offsets_.push_back(static_cast<uint32_t>(rep_.size()));
+  WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+  rep_.push_back(static_cast<char>(kTypeMerge));
+  PutLengthPrefixedSlice(&rep_, key);
+  PutLengthPrefixedSlice(&rep_, value);
+}
+
 void WriteBatch::Append(const WriteBatch& source) {
   WriteBatchInternal::Append(this, &source);
 }
@@ -117,33 +258,112 @@ class MemTableInserter : public WriteBatch::Handler {
  public:
   SequenceNumber sequence_;
   MemTable* mem_;
+  PreparedTransactions* prepared_ = nullptr;
+  Status status_;
 
   void Put(const Slice& key, const Slice& value) override {
     mem_->Add(sequence_, kTypeValue, key, value);
     sequence_++;
   }
+  void PutPreEncoded(const char* entry, size_t entry_size, const Slice& key,
+                     const Slice& value) override {
+    if (mem_->RewritesValues()) {
+      // The destination memtable re-encodes values (checksums or
+      // compression) but the span carries the plain value -- a WAL
+      // written before the option changed, replayed after.  Take the
+      // re-encoding path.
+      Put(key, value);
+      return;
+    }
+    // Patch the sequence into the placeholder tag (the span lives in
+    // the batch rep, which InsertInto owns for the duration), then
+    // hand the whole entry to the memtable in one copy.
+    char* tag_pos = const_cast<char*>(key.data() + key.size());
+    EncodeFixed64(tag_pos, (sequence_ << 8) | kTypeValue);
+    mem_->AddSpan(entry, entry_size);
+    sequence_++;
+  }
   void Delete(const Slice& key) override {
     mem_->Add(sequence_, kTypeDeletion, key, Slice());
     sequence_++;
   }
+  void DeleteRange(const Slice& begin, const Slice& end) override {
+    mem_->AddRange(sequence_, begin, end);
+    sequence_++;
+  }
+  void Merge(const Slice& key, const Slice& value) override {
+    mem_->Add(sequence_, kTypeMerge, key, value);
+    sequence_++;
+  }
+  void Prepare(uint64_t txn_id, const Slice& batch_contents) override {
+    if (prepared_ != nullptr) {
+      prepared_->Put(txn_id, batch_contents);
+    }
+    sequence_++;  // A prepare record reserves one (unused) sequence
+  }
+  void CommitPrepared(uint64_t txn_id, int count) override {
+    std::string contents;
+    if (prepared_ == nullptr || !prepared_->Get(txn_id, &contents)) {
+      // Unknown transaction (e.g. rolled back and re-replayed);
+      // consume the sequences it would have used.
+      sequence_ += count;
+      return;
+    }
+    WriteBatch inner;
+    WriteBatchInternal::SetContents(&inner, contents);
+    WriteBatchInternal::SetSequence(&inner, sequence_);
+    Status s = WriteBatchInternal::InsertInto(&inner, mem_, prepared_);
+    if (!s.ok() && status_.ok()) {
+      status_ = s;
+    }
+    sequence_ += WriteBatchInternal::Count(&inner);
+    prepared_->Erase(txn_id);
+  }
+  void RollbackPrepared(uint64_t txn_id) override {
+    if (prepared_ != nullptr) {
+      prepared_->Erase(txn_id);
+    }
+    sequence_++;
+  }
 };
 }  // namespace
 
-Status WriteBatchInternal::InsertInto(const WriteBatch* b, MemTable* memtable) {
+Status WriteBatchInternal::InsertInto(const WriteBatch* b, MemTable* memtable,
+                                      PreparedTransactions* prepared) {
   MemTableInserter inserter;
   inserter.sequence_ = WriteBatchInternal::Sequence(b);
   inserter.mem_ = memtable;
-  return b->Iterate(&inserter);
+  inserter.prepared_ = prepared;
+  Status s = b->Iterate(&inserter);
+  if (s.ok()) {
+    s = inserter.status_;
+  }
+  return s;
 }
 
 void WriteBatchInternal::SetContents(WriteBatch* b, const Slice& contents) {
   assert(contents.size() >= kHeader);
   b->rep_.assign(contents.data(), contents.size());
+  b->record_offsets_.clear();  // Offsets are unknown for foreign bytes
 }
 
 void WriteBatchInternal::Append(WriteBatch* dst, const WriteBatch* src) {
   SetCount(dst, Count(dst) + Count(src));
   assert(src->rep_.size() >= kHeader);
+  const bool dst_indexed =
+      dst->record_offsets_.size() == static_cast<size_t>(Count(dst)) -
+                                         static_cast<size_t>(Count(src));
+  const bool src_indexed =
+      src->record_offsets_.size() == static_cast<size_t>(Count(src));
+  const size_t dst_size = dst->rep_.size();
+  if (dst_indexed && src_indexed) {
+    for (size_t i = 0; i < src->record_offsets_.size(); i++) {
+      dst->record_offsets_.push_back(static_cast<uint32_t>(
+          src->record_offsets_[i] - kHeader + dst_size));
+    }
+  } else {
+    dst->record_offsets_.clear();
+  }
   dst->rep_.append(src->rep_.data() + kHeader, src->rep_.size() - kHeader);
 }
 
@@ -5,17 +5,83 @@
 #ifndef STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 #define STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 
+#include <map>
+#include <string>
+
 #include "db/dbformat.h"
 #include "leveldb/write_batch.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
 class MemTable;
 
+// Thread-safe registry of prepared-but-uncommitted transactions,
+// shared by the live write path and log recovery (see DB::Prepare).
+// Values are full serialized WriteBatch contents.
+class PreparedTransactions {
+ public:
+  struct Entry {
+    std::string contents;
+    uint64_t log_number;  // Log holding the prepare record
+  };
+
+  // Log file that subsequent Put()s are staged against; updated by the
+  // DB whenever the active log changes (or a log is replayed).
+  void SetLogHint(uint64_t log_number) {
+    MutexLock l(&mutex_);
+    log_hint_ = log_number;
+  }
+  void Put(uint64_t id, const Slice& contents) {
+    MutexLock l(&mutex_);
+    Entry& entry = transactions_[id];
+    entry.contents.assign(contents.data(), contents.size());
+    entry.log_number = log_hint_;
+  }
+  bool Get(uint64_t id, std::string* contents) {
+    MutexLock l(&mutex_);
+    std::map<uint64_t, Entry>::iterator it = transactions_.find(id);
+    if (it == transactions_.end()) return false;
+    *contents = it->second.contents;
+    return true;
+  }
+  void Erase(uint64_t id) {
+    MutexLock l(&mutex_);
+    transactions_.erase(id);
+  }
+  // Oldest log still holding a pending prepare (the manifest's log
+  // cutoff must not advance past it), or ~0 when none are pending.
+  uint64_t OldestLogNumber() {
+    MutexLock l(&mutex_);
+    uint64_t oldest = ~static_cast<uint64_t>(0);
+    for (std::map<uint64_t, Entry>::iterator it = transactions_.begin();
+         it != transactions_.end(); ++it) {
+      if (it->second.log_number < oldest) oldest = it->second.log_number;
+    }
+    return oldest;
+  }
+  void GetAll(std::map<uint64_t, std::string>* out) {
+    MutexLock l(&mutex_);
+    for (std::map<uint64_t, Entry>::iterator it = transactions_.begin();
+         it != transactions_.end(); ++it) {
+      (*out)[it->first] = it->second.contents;
+    }
+  }
+
+ private:
+  port::Mutex mutex_;
+  uint64_t log_hint_ = 0;
+  std::map<uint64_t, Entry> transactions_;
+};
+
 // WriteBatchInternal provides static methods for manipulating a
 // WriteBatch that we don't want in the public WriteBatch interface.
 class WriteBatchInternal {
  public:
+  // Size of the sequence/count header at the front of every batch rep.
+  static constexpr size_t kHeader = 12;
+
   // Return the number of entries in the batch.
   static int Count(const WriteBatch* batch);
 
@@ -35,7 +101,25 @@ class WriteBatchInternal {
 
   static void SetContents(WriteBatch* batch, const Slice& contents);
 
-  static Status InsertInto(const WriteBatch* batch, MemTable* memtable);
+  // "prepared" (may be null) resolves two-phase commit records.
+  static Status InsertInto(const WriteBatch* batch, MemTable* memtable,
+                           PreparedTransactions* prepared = nullptr);
+
+  // Record-stream tags for two-phase commit, disjoint from ValueType.
+  enum {
+    kPrepareRecordTag = 0x50,  // 'P': varint64 id, length-prefixed batch
+    kCommitRecordTag = 0x43,   // 'C': varint64 id, varint32 count
+    kRollbackRecordTag = 0x52,  // 'R': varint64 id
+    // 'E': a Put stored verbatim in memtable entry layout (internal
+    // key with a zero-sequence placeholder tag, then the value), so
+    // InsertInto() can patch the sequence in place and hand the span
+    // to the memtable in one copy.
+    kPreEncodedValueTag = 0x45
+  };
+
+  // Append a Put in memtable-ready layout (see kPreEncodedValueTag).
+  static void PutPreEncoded(WriteBatch* batch, const Slice& key,
+                            const Slice& value);
 
   static void Append(WriteBatch* dst, const WriteBatch* src);
 };
@@ -4,6 +4,8 @@
 
 #include "helpers/memenv/memenv.h"
 
+#include <atomic>
+#include <cstdlib>
 #include <cstring>
 #include <limits>
 #include <map>
@@ -31,49 +33,43 @@ class FileState {
   FileState& operator=(const FileState&) = delete;
 
   // Increase the reference count.
-  void Ref() {
-    MutexLock lock(&refs_mutex_);
-    ++refs_;
-  }
+  void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
 
   // Decrease the reference count. Delete if this is the last reference.
   void Unref() {
-    bool do_delete = false;
-
-    {
-      MutexLock lock(&refs_mutex_);
-      --refs_;
-      assert(refs_ >= 0);
-      if (refs_ <= 0) {
-        do_delete = true;
-      }
-    }
-
-    if (do_delete) {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
       delete this;
     }
   }
 
-  uint64_t Size() const {
-    MutexLock lock(&blocks_mutex_);
-    return size_;
-  }
+  uint64_t Size() const { return size_.load(std::memory_order_acquire); }
 
   void Truncate() {
     MutexLock lock(&blocks_mutex_);
-    for (char*& block : blocks_) {
-      delete[] block;
+    BlockArray* blocks = block_array_.load(std::memory_order_relaxed);
+    if (blocks != nullptr) {
+      for (size_t i = 0; i < num_blocks_; i++) {
+        delete[] blocks->blocks[i];
+      }
     }
-    blocks_.clear();
-    size_ = 0;
+    num_blocks_ = 0;
+    size_.store(0, std::memory_order_release);
   }
 
+  // Reads are lock free: the block-pointer array is only ever grown by
+  // republication (never resized in place -- a deque's chunk map can
+  // reallocate under push_back, which a lock-free traversal must not
+  // see), and size_ publishes with release ordering after the entries
+  // behind it are written, so a reader that observes a size and then
+  // loads the array observes every block that size covers.  Reads that
+  // fit inside one block return a zero-copy Slice into the block
+  // itself; FileState outlives its readers via refcounting.
   Status Read(uint64_t offset, size_t n, Slice* result, char* scratch) const {
-    MutexLock lock(&blocks_mutex_);
-    if (offset > size_) {
+    const uint64_t size = size_.load(std::memory_order_acquire);
+    if (offset > size) {
       return Status::IOError("Offset greater than file size.");
     }
-    const uint64_t available = size_ - offset;
+    const uint64_t available = size - offset;
     if (n > available) {
       n = static_cast<size_t>(available);
     }
@@ -82,18 +78,29 @@ class FileState {
       return Status::OK();
     }
 
+    // Load the array after size_: the writer stores the array (and the
+    // block pointers) before its release store of size_, so this
+    // ordering guarantees the array covers the observed size.
+    const BlockArray* blocks = block_array_.load(std::memory_order_acquire);
+
     assert(offset / kBlockSize <= std::numeric_limits<size_t>::max());
     size_t block = static_cast<size_t>(offset / kBlockSize);
     size_t block_offset = offset % kBlockSize;
+
+    if (block_offset + n <= kBlockSize) {
+      // Entirely inside one block: no copy.
+      *result = Slice(blocks->blocks[block] + block_offset, n);
+      return Status::OK();
+    }
+
     size_t bytes_to_copy = n;
     char* dst = scratch;
-
     while (bytes_to_copy > 0) {
       size_t avail = kBlockSize - block_offset;
       if (avail > bytes_to_copy) {
         avail = bytes_to_copy;
       }
-      std::memcpy(dst, blocks_[block] + block_offset, avail);
+      std::memcpy(dst, blocks->blocks[block] + block_offset, avail);
 
       bytes_to_copy -= avail;
       dst += avail;
@@ -109,27 +116,32 @@ class FileState {
     const char* src = data.data();
     size_t src_len = data.size();
 
+    // Writers are externally synchronized per the WritableFile
+    // contract; the mutex only orders Append against Truncate.
     MutexLock lock(&blocks_mutex_);
+    uint64_t size = size_.load(std::memory_order_relaxed);
     while (src_len > 0) {
       size_t avail;
-      size_t offset = size_ % kBlockSize;
+      size_t offset = size % kBlockSize;
 
       if (offset != 0) {
         // There is some room in the last block.
         avail = kBlockSize - offset;
       } else {
         // No room in the last block; push new one.
-        blocks_.push_back(new char[kBlockSize]);
+        PushBlock(new char[kBlockSize]);
         avail = kBlockSize;
       }
 
       if (avail > src_len) {
         avail = src_len;
       }
-      std::memcpy(blocks_.back() + offset, src, avail);
+      BlockArray* blocks = block_array_.load(std::memory_order_relaxed);
+      std::memcpy(blocks->blocks[num_blocks_ - 1] + offset, src, avail);
       src_len -= avail;
       src += avail;
-      size_ += avail;
+      size += avail;
+      size_.store(size, std::memory_order_release);
     }
 
     return Status::OK();
@@ -138,15 +150,57 @@ class FileState {
  private:
   enum { kBlockSize = 8 * 1024 };
 
+  // The block-pointer array, grown by doubling and republished so a
+  // lock-free reader never traverses storage being resized.  Retired
+  // generations are kept until destruction; a reader may still be
+  // walking one.
+  struct BlockArray {
+    size_t capacity;
+    char* blocks[1];  // Really "capacity" entries
+  };
+
+  static BlockArray* NewBlockArray(size_t capacity) {
+    BlockArray* array = reinterpret_cast<BlockArray*>(std::malloc(
+        sizeof(BlockArray) + (capacity - 1) * sizeof(char*)));
+    array->capacity = capacity;
+    return array;
+  }
+
+  // Append one block pointer, republishing a doubled array when full.
+  void PushBlock(char* block) EXCLUSIVE_LOCKS_REQUIRED(blocks_mutex_) {
+    BlockArray* blocks = block_array_.load(std::memory_order_relaxed);
+    if (blocks == nullptr || num_blocks_ == blocks->capacity) {
+      const size_t capacity = blocks == nullptr ? 64 : blocks->capacity * 2;
+      BlockArray* grown = NewBlockArray(capacity);
+      for (size_t i = 0; i < num_blocks_; i++) {
+        grown->blocks[i] = blocks->blocks[i];
+      }
+      if (blocks != nullptr) {
+        retired_arrays_.push_back(blocks);
+      }
+      block_array_.store(grown, std::memory_order_release);
+      blocks = grown;
+    }
+    blocks->blocks[num_blocks_++] = block;
+  }
+
   // Private since only Unref() should be used to delete it.
-  ~FileState() { Truncate(); }
+  ~FileState() {
+    Truncate();
+    BlockArray* blocks = block_array_.load(std::memory_order_relaxed);
+    std::free(blocks);
+    for (size_t i = 0; i < retired_arrays_.size(); i++) {
+      std::free(retired_arrays_[i]);
+    }
+  }
 
-  port::Mutex refs_mutex_;
-  int refs_ GUARDED_BY(refs_mutex_);
+  std::atomic<int> refs_;
 
   mutable port::Mutex blocks_mutex_;
-  std::vector<char*> blocks_ GUARDED_BY(blocks_mutex_);
-  uint64_t size_ GUARDED_BY(blocks_mutex_);
+  std::atomic<BlockArray*> block_array_{nullptr};
+  size_t num_blocks_ GUARDED_BY(blocks_mutex_) = 0;
+  std::vector<BlockArray*> retired_arrays_ GUARDED_BY(blocks_mutex_);
+  std::atomic<uint64_t> size_;
 };
 
 class SequentialFileImpl : public SequentialFile {
@@ -97,6 +97,20 @@ LEVELDB_EXPORT char* leveldb_get(leveldb_t* db,
                                  const char* key, size_t keylen, size_t* vallen,
                                  char** errptr);
 
+/* Batched point lookups: one crossing for num_keys lookups.  For each
+   key i, values[i] receives a malloc'd buffer (or NULL when not found
+   or on error) and value_lens[i] its length; statuses[i] (if the array
+   is non-NULL) receives a malloc'd error message or NULL. */
+LEVELDB_EXPORT void leveldb_multiget(
+    leveldb_t* db, const leveldb_readoptions_t* options, size_t num_keys,
+    const char* const* keys, const size_t* key_lens, char** values,
+    size_t* value_lens, char** statuses);
+
+/* Append num_entries puts to the batch in one call. */
+LEVELDB_EXPORT void leveldb_writebatch_put_many(
+    leveldb_writebatch_t* b, size_t num_entries, const char* const* keys,
+    const size_t* key_lens, const char* const* vals, const size_t* val_lens);
+
 LEVELDB_EXPORT leveldb_iterator_t* leveldb_create_iterator(
     leveldb_t* db, const leveldb_readoptions_t* options);
 
@@ -137,6 +151,16 @@ LEVELDB_EXPORT void leveldb_iter_seek_to_last(leveldb_iterator_t*);
 LEVELDB_EXPORT void leveldb_iter_seek(leveldb_iterator_t*, const char* k,
                                       size_t klen);
 LEVELDB_EXPORT void leveldb_iter_next(leveldb_iterator_t*);
+
+/* Drain up to max_entries key/value pairs from the iterator into the
+   caller's buffer as [klen:4][key][vlen:4][value] records (little
+   endian lengths), advancing it past the consumed entries.  Returns
+   the number of entries encoded; *bytes_used receives the bytes
+   written.  Entries that would overflow buffer_len stay pending. */
+LEVELDB_EXPORT size_t leveldb_iter_next_many(leveldb_iterator_t*,
+                                             size_t max_entries, char* buffer,
+                                             size_t buffer_len,
+                                             size_t* bytes_used);
 LEVELDB_EXPORT void leveldb_iter_prev(leveldb_iterator_t*);
 LEVELDB_EXPORT const char* leveldb_iter_key(const leveldb_iterator_t*,
                                             size_t* klen);
@@ -19,6 +19,7 @@
 #define STORAGE_LEVELDB_INCLUDE_CACHE_H_
 
 #include <cstdint>
+#include <string>
 
 #include "leveldb/export.h"
 #include "leveldb/slice.h"
@@ -27,10 +28,51 @@ namespace leveldb {
 
 class LEVELDB_EXPORT Cache;
 
+// Supplies memory for cache handles and block buffers, so deployments
+// can substitute a pooled or size-classed allocator for the global
+// heap.  Implementations must be thread-safe.
+class LEVELDB_EXPORT CacheAllocator {
+ public:
+  CacheAllocator() = default;
+  CacheAllocator(const CacheAllocator&) = delete;
+  CacheAllocator& operator=(const CacheAllocator&) = delete;
+  virtual ~CacheAllocator();
+
+  virtual void* Allocate(size_t bytes) = 0;
+  virtual void Deallocate(void* ptr, size_t bytes) = 0;
+};
+
 // Create a new cache with a fixed size capacity.  This implementation
 // of Cache uses a least-recently-used eviction policy.
 LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity);
 
+// Like NewLRUCache(), but additionally maintains a small count-min
+// sketch of lookup frequencies when track_hot_keys is true: entries
+// whose estimated frequency crosses a hotness threshold are skipped by
+// eviction (so scans such as compactions cannot flush them out), and
+// FrequencyReport() summarizes the sketch.
+LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity, bool track_hot_keys);
+
+// Like NewLRUCache(), allocating every handle through *allocator
+// (which must outlive the cache).
+LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity, bool track_hot_keys,
+                                  CacheAllocator* allocator);
+
+// Create a new cache with a fixed size capacity that uses CLOCK
+// eviction.  Hits and releases avoid most locking, and the cache is
+// divided into more shards than the LRU cache, which makes it a better
+// fit for block caches shared by many reader threads.  Eviction order
+// only approximates recency.
+LEVELDB_EXPORT Cache* NewClockCache(size_t capacity);
+
+// Wrap *base (shared by several DBs) with a per-client byte quota:
+// charges are accounted against the quota, and inserts made while the
+// client is over budget enter at low eviction priority so an
+// over-quota tenant's blocks are evicted first rather than squeezing
+// out its neighbours.  Current usage is reported by TotalCharge().
+// *base must outlive the wrapper; the caller owns the wrapper.
+LEVELDB_EXPORT Cache* NewQuotaCache(Cache* base, size_t quota);
+
 class LEVELDB_EXPORT Cache {
  public:
   Cache() = default;
@@ -57,6 +99,19 @@ class LEVELDB_EXPORT Cache {
   virtual Handle* Insert(const Slice& key, void* value, size_t charge,
                          void (*deleter)(const Slice& key, void* value)) = 0;
 
+  // Relative importance of an entry; see the priority Insert()
+  // overload.
+  enum Priority { kHighPriority = 0, kLowPriority = 1 };
+
+  // Like Insert(), with an eviction priority.  Low-priority entries
+  // (e.g. data blocks touched once by a scan) enter at the cold end of
+  // the eviction order, so they are evicted before high-priority
+  // entries (index/filter/metadata blocks) unless they are referenced
+  // again.  The default implementation ignores the priority.
+  virtual Handle* Insert(const Slice& key, void* value, size_t charge,
+                         void (*deleter)(const Slice& key, void* value),
+                         Priority priority);
+
   // If the cache has no mapping for "key", returns nullptr.
   //
   // Else return a handle that corresponds to the mapping.  The caller
@@ -96,6 +151,16 @@ class LEVELDB_EXPORT Cache {
   // Return an estimate of the combined charges of all elements stored in the
   // cache.
   virtual size_t TotalCharge() const = 0;
+
+  // A short human-readable summary of access-frequency tracking, or
+  // the empty string when tracking is disabled (the default).
+  virtual std::string FrequencyReport() const;
+
+  // Invoke fn(key, value, arg) for every resident entry.  Entries may
+  // be inserted or evicted concurrently; the snapshot is best effort.
+  // The default implementation visits nothing.
+  virtual void ApplyToAll(void (*fn)(const Slice& key, void* value, void* arg),
+                          void* arg);
 };
 
 }  // namespace leveldb
@@ -0,0 +1,56 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Pluggable compaction selection.  The built-in policy (level fullness
+// scores, then read-heat) serves most workloads; a custom picker can
+// instead target tombstone density, file age, or per-tenant
+// amplification goals without forking the engine.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_COMPACTION_PICKER_H_
+#define STORAGE_LEVELDB_INCLUDE_COMPACTION_PICKER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+// A table file as seen by CompactionPicker::Pick().  The key slices
+// are valid only for the duration of the call.
+struct LEVELDB_EXPORT CompactionFileInfo {
+  uint64_t number;
+  uint64_t file_size;
+  Slice smallest_user_key;
+  Slice largest_user_key;
+};
+
+class LEVELDB_EXPORT CompactionPicker {
+ public:
+  virtual ~CompactionPicker();
+
+  // Decide what to compact next.  "files[level]" lists that level's
+  // files (sorted by key for levels > 0, newest first for level 0) and
+  // "scores[level]" is the built-in policy's fullness score for it
+  // (>= 1.0 means that level is due under the default policy).
+  //
+  // Return the level whose data should be compacted into the next
+  // level, or -1 for "nothing to do".  If a specific file should seed
+  // the compaction, store its index within the level in *file_index;
+  // leave it as -1 to let the engine rotate through the level's
+  // keyspace as the default policy does.  The engine still widens the
+  // chosen seed to a valid input set (overlapping level-0 files,
+  // boundary files, next-level overlaps), so any decision yields a
+  // correct compaction.
+  //
+  // Called with the database mutex held: implementations must not
+  // block or call back into the database.
+  virtual int Pick(const std::vector<std::vector<CompactionFileInfo>>& files,
+                   const double* scores, int num_levels, int* file_index) = 0;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_COMPACTION_PICKER_H_
@@ -5,6 +5,7 @@
 #ifndef STORAGE_LEVELDB_INCLUDE_COMPARATOR_H_
 #define STORAGE_LEVELDB_INCLUDE_COMPARATOR_H_
 
+#include <cstdint>
 #include <string>
 
 #include "leveldb/export.h"
@@ -52,6 +53,14 @@ class LEVELDB_EXPORT Comparator {
   // Simple comparator implementations may return with *key unchanged,
   // i.e., an implementation of this method that does nothing is correct.
   virtual void FindShortSuccessor(std::string* key) const = 0;
+
+  // If this comparator can summarize keys with an order-preserving
+  // 32-bit prefix -- i.e. prefix(a) < prefix(b) implies
+  // Compare(a, b) < 0, with equal prefixes meaning "unknown" -- store
+  // key's prefix in *prefix and return true.  Used to accelerate
+  // block seeks; comparators with no such prefix return false.
+  virtual bool OrderPreservingPrefix(const Slice& key,
+                                     uint32_t* prefix) const;
 };
 
 // Return a builtin comparator that uses lexicographic byte-wise
@@ -59,6 +68,17 @@ class LEVELDB_EXPORT Comparator {
 // must not be deleted.
 LEVELDB_EXPORT const Comparator* BytewiseComparator();
 
+// Return a comparator for keys of the form <user key><timestamp>,
+// where the trailing "timestamp_size" bytes are a big-endian encoded
+// timestamp: keys order by user key ascending (via *base), then by
+// timestamp DESCENDING, so Seek(key + encoded(ts)) lands on the newest
+// version written at or before ts -- an O(log n) time-travel read with
+// no long-lived snapshot pinning compaction cleanup (old versions are
+// ordinary older keys, reclaimed by DeleteRange or TTL when desired).
+// *base must outlive the result; the caller owns the result.
+LEVELDB_EXPORT const Comparator* NewTimestampSuffixedComparator(
+    const Comparator* base, size_t timestamp_size);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_INCLUDE_COMPARATOR_H_
@@ -6,7 +6,11 @@
 #define STORAGE_LEVELDB_INCLUDE_DB_H_
 
 #include <cstdint>
+#include <map>
 #include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
 
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
@@ -20,6 +24,7 @@ static const int kMinorVersion = 23;
 
 struct Options;
 struct ReadOptions;
+class WritableFile;
 struct WriteOptions;
 class WriteBatch;
 
@@ -40,6 +45,38 @@ struct LEVELDB_EXPORT Range {
   Slice limit;  // Not included in the range
 };
 
+// Machine-readable statistics filled in by DB::GetStats().  The
+// contents mirror the human-readable "leveldb.stats" property.
+struct LEVELDB_EXPORT DBStats {
+  struct LevelStats {
+    int files = 0;                  // Number of table files in the level
+    uint64_t bytes = 0;             // Total size of the level's files
+    uint64_t compaction_micros = 0;  // Time compacting into this level
+    uint64_t bytes_read = 0;        // Bytes read by those compactions
+    uint64_t bytes_written = 0;     // Bytes written by those compactions
+  };
+
+  // One entry per level.
+  std::vector<LevelStats> levels;
+
+  // Total time writers spent in the one-millisecond slowdown delay
+  // triggered by a nearly-full level 0.
+  uint64_t write_slowdown_micros = 0;
+
+  // Total time writers spent fully stalled waiting for a memtable
+  // flush or for level 0 to drain.
+  uint64_t write_stall_micros = 0;
+};
+
+// Approximate statistics about a key range; see
+// DB::GetApproximateStats().
+struct LEVELDB_EXPORT RangeStats {
+  uint64_t bytes = 0;  // File-system bytes attributable to the range
+  int files = 0;       // Table files overlapping the range
+  // Bytes of overlapping files per level.
+  std::vector<uint64_t> level_bytes;
+};
+
 // A DB is a persistent ordered map from keys to values.
 // A DB is safe for concurrent access from multiple threads without
 // any external synchronization.
@@ -53,6 +90,14 @@ class LEVELDB_EXPORT DB {
   static Status Open(const Options& options, const std::string& name,
                      DB** dbptr);
 
+  // Open the database read-only as a secondary instance, without
+  // taking the database lock, so it can run in a separate process
+  // alongside the writing primary.  The secondary serves reads from
+  // the state it last observed; call TryCatchUpWithPrimary() to
+  // observe newer writes.  All mutating operations fail.
+  static Status OpenAsSecondary(const Options& options,
+                                const std::string& name, DB** dbptr);
+
   DB() = default;
 
   DB(const DB&) = delete;
@@ -72,11 +117,29 @@ class LEVELDB_EXPORT DB {
   // Note: consider setting options.sync = true.
   virtual Status Delete(const WriteOptions& options, const Slice& key) = 0;
 
+  // Add a merge operand for "key" (see Options::merge_operator).
+  // The default implementation goes through Write().
+  virtual Status Merge(const WriteOptions& options, const Slice& key,
+                       const Slice& value);
+
   // Apply the specified updates to the database.
   // Returns OK on success, non-OK on failure.
   // Note: consider setting options.sync = true.
   virtual Status Write(const WriteOptions& options, WriteBatch* updates) = 0;
 
+  // Like Write(), but returns immediately and invokes "callback" with
+  // the write's status once the batch (grouped with other queued
+  // writes) has been logged, synced if requested, and applied.
+  //
+  // "*updates" must remain live until the callback is invoked, and all
+  // callbacks must have been invoked before the DB is deleted.  The
+  // callback runs on an internal thread and must not call back into
+  // the DB's write path.
+  //
+  // The default implementation performs a synchronous Write().
+  virtual void WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                          std::function<void(Status)> callback);
+
   // If the database contains an entry for "key" store the
   // corresponding value in *value and return OK.
   //
@@ -87,6 +150,24 @@ class LEVELDB_EXPORT DB {
   virtual Status Get(const ReadOptions& options, const Slice& key,
                      std::string* value) = 0;
 
+  // Like Get(), but avoids copying the value when possible: *value may
+  // end up referencing (and pinning) a cached block or an in-memory
+  // table until it is Reset or destroyed.  The default implementation
+  // copies.
+  virtual Status Get(const ReadOptions& options, const Slice& key,
+                     PinnableSlice* value);
+
+  // Look up a batch of keys.  Resizes *values to keys.size() and fills
+  // in values[i] for each keys[i] that is found; the returned vector
+  // holds the per-key statuses (NotFound for missing keys, as with
+  // Get()).  All keys are read from the same snapshot.
+  //
+  // The default implementation calls Get() once per key; DB
+  // implementations may override it to amortize per-lookup overhead.
+  virtual std::vector<Status> MultiGet(const ReadOptions& options,
+                                       const std::vector<Slice>& keys,
+                                       std::vector<std::string>* values);
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -123,6 +204,123 @@ class LEVELDB_EXPORT DB {
   //     bytes of memory in use by the DB.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
+  // Fill in *stats with per-level compaction statistics and write
+  // stall times.  The default implementation leaves *stats empty.
+  virtual void GetStats(DBStats* stats);
+
+  // Ingest the table file named by "file" (created with TableBuilder
+  // using this DB's comparator) directly into the tree, bypassing the
+  // write-ahead log and memtable.  All entries are stamped with a
+  // single newly allocated sequence number, so the ingested file
+  // behaves like an atomic batch of Put()s.  The source file is left
+  // untouched.
+  //
+  // REQUIRES: the file's keys are distinct.
+  //
+  // The default implementation returns Status::NotSupported.
+  virtual Status IngestExternalFile(const std::string& file);
+
+  // Bulk-load a sorted stream of fresh key/value pairs.  "input"
+  // yields user keys in strictly increasing order; the stream is cut
+  // into max_file_size chunks which are built into table files on
+  // several threads and installed with one manifest edit, each file at
+  // the deepest level where it overlaps nothing.  Intended for initial
+  // loads: keys must not already exist in the database (entries are
+  // stamped with sequence zero, so existing versions would shadow
+  // them).  The default implementation returns Status::NotSupported.
+  virtual Status BulkLoad(Iterator* input);
+
+  // Change a subset of options at runtime, without reopening.
+  // Supported keys: "write_buffer_size", "max_file_size",
+  // "l0_compaction_trigger", "l0_slowdown_writes_trigger",
+  // "l0_stop_writes_trigger".  Values are decimal.  New sizes apply
+  // from the next memtable rotation / compaction; unknown keys or
+  // unparsable values fail the whole call with InvalidArgument and
+  // change nothing.  The default implementation returns NotSupported.
+  virtual Status SetOptions(
+      const std::map<std::string, std::string>& new_options);
+
+  // Split [*begin, *end) -- nullptr meaning unbounded -- into up to
+  // "n" disjoint sub-ranges along table-file boundaries and return one
+  // iterator per sub-range, all reading from a single snapshot taken
+  // at the call.  Together the iterators cover the range exactly once,
+  // so embarrassingly parallel consumers can scan on n cores.  Each
+  // iterator is independent (one per thread) and must be deleted by
+  // the caller; fewer than n iterators are returned when the range has
+  // too few file boundaries to split further.  The default
+  // implementation returns NotSupported.
+  virtual Status NewParallelIterators(const ReadOptions& options,
+                                      const Slice* begin, const Slice* end,
+                                      int n,
+                                      std::vector<Iterator*>* iterators);
+
+  // Load the data (and, as a side effect of opening the tables, index
+  // and filter) blocks covering user keys in [begin, end] into the
+  // block cache, using a few background threads.  Programmatic warmup
+  // of a known-hot range after failover, instead of replaying
+  // synthetic traffic.  Returns after the range has been read.  The
+  // default implementation returns NotSupported.
+  virtual Status Warm(const Slice& begin, const Slice& end);
+
+  // Create a consistent, openable copy of the database in "dir" (which
+  // must not exist) without blocking reads or writes: table files are
+  // hard-linked where the file system allows it, and the MANIFEST and
+  // current WAL are written fresh.  The checkpoint reflects a
+  // point-in-time snapshot of the database.
+  //
+  // The default implementation returns Status::NotSupported.
+  virtual Status CreateCheckpoint(const std::string& dir);
+
+  // Stream every key/value pair visible at "snapshot" (or the current
+  // state if null), in sorted order, into *file in table-file format
+  // -- the result can be opened with Table::Open or fed back to
+  // IngestExternalFile().  The file is flushed but not closed.  The
+  // default implementation returns Status::NotSupported.
+  virtual Status ExportSnapshot(const Snapshot* snapshot, WritableFile* file);
+
+  // Write a census of the resident block-cache contents (file number
+  // and offset of each cached block belonging to this database) to a
+  // sidecar file in the database directory.  A later DB::Open with
+  // warm_cache_on_open set re-reads the listed blocks so the cache
+  // working set survives a planned restart.  Requires a block_cache;
+  // the default implementation returns Status::NotSupported.
+  virtual Status SaveCacheCensus();
+
+  // Two-phase commit: Prepare() durably logs *updates in the WAL
+  // without applying it and returns a transaction id; CommitPrepared()
+  // applies the prepared batch (logging only a small commit marker)
+  // and RollbackPrepared() discards it.  Prepared transactions survive
+  // crashes: recovery re-stages them and applies only those whose
+  // commit record made it to the log.  Defaults return NotSupported.
+  virtual Status Prepare(const WriteOptions& options, WriteBatch* updates,
+                         uint64_t* txn_id);
+  virtual Status CommitPrepared(const WriteOptions& options, uint64_t txn_id);
+  virtual Status RollbackPrepared(const WriteOptions& options,
+                                  uint64_t txn_id);
+
+  // Begin recording this DB's operations (Get, Write and iterator
+  // Seek) as timestamped records appended to *file, for later replay
+  // with the db_replay tool.  *file must stay live until EndTrace().
+  // The default implementation returns Status::NotSupported.
+  virtual Status StartTrace(WritableFile* file);
+
+  // Stop recording and flush the trace file.
+  virtual Status EndTrace();
+
+  // Delete blob-value files (see Options::blob_value_threshold) that
+  // are no longer referenced by any live table file.  Scans the live
+  // tables' entries, so this is meant to run occasionally in the
+  // background.  The default implementation returns
+  // Status::NotSupported.
+  virtual Status GarbageCollectBlobs();
+
+  // On a secondary instance (see OpenAsSecondary), advance to the
+  // primary's latest persistent state by re-reading the MANIFEST and
+  // replaying the tail of the write-ahead log.  Outstanding iterators
+  // keep their snapshot.  The default implementation returns
+  // Status::NotSupported.
+  virtual Status TryCatchUpWithPrimary();
+
   // For each i in [0,n-1], store in "sizes[i]", the approximate
   // file system space used by keys in "[range[i].start .. range[i].limit)".
   //
@@ -134,6 +332,14 @@ class LEVELDB_EXPORT DB {
   virtual void GetApproximateSizes(const Range* range, int n,
                                    uint64_t* sizes) = 0;
 
+  // Fill *stats with cheap, metadata-derived statistics about the
+  // range [range.start, range.limit): approximate byte usage, the
+  // number of overlapping table files, and a per-level byte breakdown.
+  // Computed purely from file metadata; no table contents are read.
+  // The default implementation only fills in bytes, via
+  // GetApproximateSizes().
+  virtual void GetApproximateStats(const Range& range, RangeStats* stats);
+
   // Compact the underlying storage for the key range [*begin,*end].
   // In particular, deleted and overwritten versions are discarded,
   // and the data is rearranged to reduce the cost of operations
@@ -20,6 +20,13 @@ namespace leveldb {
 //
 // Returns a non-OK result if fname does not name a leveldb storage
 // file, or if the file cannot be read.
+// Dump only a table file's statistics (properties, index geometry,
+// per-block compression, and a sampled set of boundary keys) to *dst,
+// reading just the index and meta blocks -- no data blocks are
+// decompressed.
+LEVELDB_EXPORT Status DumpTableStats(Env* env, const std::string& fname,
+                                     WritableFile* dst);
+
 LEVELDB_EXPORT Status DumpFile(Env* env, const std::string& fname,
                                WritableFile* dst);
 
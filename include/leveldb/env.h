@@ -95,6 +95,15 @@ class LEVELDB_EXPORT Env {
   virtual Status NewWritableFile(const std::string& fname,
                                  WritableFile** result) = 0;
 
+  // Rename the existing file "old_fname" to "fname" and open it for
+  // writing from the start WITHOUT truncating, so its allocated extents
+  // are reused.  Callers must be able to distinguish fresh data from
+  // the file's previous contents (see log recycling).  The default
+  // implementation renames and then truncates via NewWritableFile.
+  virtual Status ReuseWritableFile(const std::string& fname,
+                                   const std::string& old_fname,
+                                   WritableFile** result);
+
   // Create an object that either appends to an existing file, or
   // writes to a new file (if the file does not exist to begin with).
   // On success, stores a pointer to the new file in *result and
@@ -110,6 +119,29 @@ class LEVELDB_EXPORT Env {
   virtual Status NewAppendableFile(const std::string& fname,
                                    WritableFile** result);
 
+  // Expected access pattern for NewMappedRandomAccessFile().
+  enum AccessPattern { kAccessNormal, kAccessRandom, kAccessWillNeed };
+
+  // Like NewRandomAccessFile(), but prefers a memory-mapped
+  // implementation regardless of internal mmap budgets and applies the
+  // given access-pattern hint (madvise on posix).  Reads from the
+  // returned file reference the mapping directly, enabling zero-copy
+  // block access.  The default implementation falls back to
+  // NewRandomAccessFile().
+  virtual Status NewMappedRandomAccessFile(const std::string& fname,
+                                           AccessPattern pattern,
+                                           RandomAccessFile** result);
+
+  // Like NewRandomAccessFile()/NewWritableFile(), but hinting that the
+  // file will be streamed through once (e.g. by a compaction) and its
+  // pages should stay out of the OS page cache.  The posix Env opens
+  // these with O_DIRECT when the file system supports it; the default
+  // implementations fall back to the buffered variants.
+  virtual Status NewUnbufferedRandomAccessFile(const std::string& fname,
+                                               RandomAccessFile** result);
+  virtual Status NewUnbufferedWritableFile(const std::string& fname,
+                                           WritableFile** result);
+
   // Returns true iff the named file exists.
   virtual bool FileExists(const std::string& fname) = 0;
 
@@ -164,10 +196,30 @@ class LEVELDB_EXPORT Env {
   // Store the size of fname in *file_size.
   virtual Status GetFileSize(const std::string& fname, uint64_t* file_size) = 0;
 
+  // Store the last-modification time of fname, in seconds since the
+  // epoch, in *mtime.  The default implementation returns
+  // Status::NotSupported.
+  virtual Status GetFileModificationTime(const std::string& fname,
+                                         uint64_t* mtime);
+
   // Rename file src to target.
   virtual Status RenameFile(const std::string& src,
                             const std::string& target) = 0;
 
+  // Copy the contents of "src" to a new file "target", which must not
+  // already exist.
+  virtual Status CopyFile(const std::string& src, const std::string& target);
+
+  // Drop any OS page-cache pages backing the named file (best effort;
+  // posix_fadvise(DONTNEED) on posix).  The default implementation
+  // does nothing.
+  virtual void InvalidateCache(const std::string& fname);
+
+  // Make "target" refer to the same contents as "src" without copying
+  // if the file system supports it (e.g. a hard link).  The default
+  // implementation copies the bytes; "target" must not already exist.
+  virtual Status LinkFile(const std::string& src, const std::string& target);
+
   // Lock the specified file.  Used to prevent concurrent access to
   // the same db by multiple processes.  On failure, stores nullptr in
   // *lock and returns non-OK.
@@ -197,6 +249,32 @@ class LEVELDB_EXPORT Env {
   // serialized.
   virtual void Schedule(void (*function)(void* arg), void* arg) = 0;
 
+  // Priority lanes for Schedule(): higher-priority work (e.g. memtable
+  // flushes) is drained before lower-priority work (e.g. compactions,
+  // cache warmup).
+  enum SchedulePriority {
+    kScheduleHigh = 0,
+    kScheduleDefault = 1,
+    kScheduleLow = 2
+  };
+
+  // Like Schedule(), with a priority lane.  The default implementation
+  // ignores the priority.
+  virtual void Schedule(void (*function)(void* arg), void* arg,
+                        SchedulePriority priority);
+
+  // Set the number of threads servicing Schedule() work.  The default
+  // implementation ignores the request (single background thread).
+  virtual void SetBackgroundThreads(int n);
+
+  // Pin the calling thread to the given CPU (e.g. to keep background
+  // work and its allocations on one NUMA node).  Returns NotSupported
+  // by default.
+  virtual Status PinCurrentThread(int cpu);
+
+  // CPU the calling thread is currently running on, or -1 if unknown.
+  virtual int GetCurrentCpu();
+
   // Start a new thread, invoking "function(arg)" within the new thread.
   // When "function(arg)" returns, the thread will be destroyed.
   virtual void StartThread(void (*function)(void* arg), void* arg) = 0;
@@ -269,6 +347,28 @@ class LEVELDB_EXPORT RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
+
+  // One read in a ReadBatch() call; same contract as the Read()
+  // arguments of the same names.
+  struct ReadRequest {
+    uint64_t offset;
+    size_t n;
+    char* scratch;
+    Slice result;
+    Status status;
+  };
+
+  // Hint that [offset, offset+n) will be read soon; the default
+  // implementation does nothing.
+  virtual void Prefetch(uint64_t offset, size_t n) const;
+
+  // Read requests[0..count-1], filling in the result and status of
+  // each request.  The default implementation issues one Read() per
+  // request; implementations may override it to batch the reads into
+  // fewer system calls (e.g. one io_uring submission).
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void ReadBatch(ReadRequest* requests, size_t count) const;
 };
 
 // A file abstraction for sequential writing.  The implementation
@@ -278,12 +378,32 @@ class LEVELDB_EXPORT WritableFile {
  public:
   WritableFile() = default;
 
+  // Hint that the file will grow to roughly "size" bytes, so the file
+  // system can reserve extents up front (fallocate on Linux) instead
+  // of journaling an allocation per append.  Best effort; the default
+  // implementation does nothing.
+  virtual void Preallocate(uint64_t size);
+
   WritableFile(const WritableFile&) = delete;
   WritableFile& operator=(const WritableFile&) = delete;
 
   virtual ~WritableFile();
 
   virtual Status Append(const Slice& data) = 0;
+
+  // Hint that this file will receive a long sequential stream (e.g. a
+  // compaction output): implementations may grow their write buffer to
+  // "buffer_bytes" to cut syscalls and schedule incremental writeback
+  // so the final Sync() does not flush gigabytes at once.  Only
+  // effective before the first Append(); the default does nothing.
+  virtual void HintStreamingWrites(size_t buffer_bytes);
+
+  // Append the concatenation of "slices" as if by repeated Append()
+  // calls.  Implementations with gather-write support (writev) can
+  // avoid copying the pieces into an intermediate buffer; the default
+  // implementation just loops over Append().
+  virtual Status AppendV(const Slice* slices, size_t count);
+
   virtual Status Close() = 0;
   virtual Status Flush() = 0;
   virtual Status Sync() = 0;
@@ -329,6 +449,18 @@ LEVELDB_EXPORT Status WriteStringToFile(Env* env, const Slice& data,
 LEVELDB_EXPORT Status ReadFileToString(Env* env, const std::string& fname,
                                        std::string* data);
 
+// Returns an Env that forwards all calls to "base" (which must
+// outlive the result) while attributing file I/O -- operation counts,
+// bytes, latency histograms -- to the database file type being
+// accessed (WAL, table, manifest, blob).  Pass the result as
+// Options::env; the accumulated report is available through the
+// database's "leveldb.io-stats" property or GetEnvIOStats().
+LEVELDB_EXPORT Env* NewInstrumentedEnv(Env* base);
+
+// If "env" was created by NewInstrumentedEnv(), append its I/O report
+// to *report and return true; otherwise return false.
+LEVELDB_EXPORT bool GetEnvIOStats(Env* env, std::string* report);
+
 // An implementation of Env that forwards all calls to another Env.
 // May be useful to clients who wish to override just part of the
 // functionality of another Env.
@@ -349,12 +481,20 @@ class LEVELDB_EXPORT EnvWrapper : public Env {
                              RandomAccessFile** r) override {
     return target_->NewRandomAccessFile(f, r);
   }
+  Status NewMappedRandomAccessFile(const std::string& f, AccessPattern p,
+                                   RandomAccessFile** r) override {
+    return target_->NewMappedRandomAccessFile(f, p, r);
+  }
   Status NewWritableFile(const std::string& f, WritableFile** r) override {
     return target_->NewWritableFile(f, r);
   }
   Status NewAppendableFile(const std::string& f, WritableFile** r) override {
     return target_->NewAppendableFile(f, r);
   }
+  Status ReuseWritableFile(const std::string& f, const std::string& old_f,
+                           WritableFile** r) override {
+    return target_->ReuseWritableFile(f, old_f, r);
+  }
   bool FileExists(const std::string& f) override {
     return target_->FileExists(f);
   }
@@ -374,9 +514,29 @@ class LEVELDB_EXPORT EnvWrapper : public Env {
   Status GetFileSize(const std::string& f, uint64_t* s) override {
     return target_->GetFileSize(f, s);
   }
+  Status GetFileModificationTime(const std::string& f, uint64_t* m) override {
+    return target_->GetFileModificationTime(f, m);
+  }
   Status RenameFile(const std::string& s, const std::string& t) override {
     return target_->RenameFile(s, t);
   }
+  Status CopyFile(const std::string& s, const std::string& t) override {
+    return target_->CopyFile(s, t);
+  }
+  Status LinkFile(const std::string& s, const std::string& t) override {
+    return target_->LinkFile(s, t);
+  }
+  void InvalidateCache(const std::string& f) override {
+    target_->InvalidateCache(f);
+  }
+  Status NewUnbufferedRandomAccessFile(const std::string& f,
+                                       RandomAccessFile** r) override {
+    return target_->NewUnbufferedRandomAccessFile(f, r);
+  }
+  Status NewUnbufferedWritableFile(const std::string& f,
+                                   WritableFile** r) override {
+    return target_->NewUnbufferedWritableFile(f, r);
+  }
   Status LockFile(const std::string& f, FileLock** l) override {
     return target_->LockFile(f, l);
   }
@@ -384,6 +544,16 @@ class LEVELDB_EXPORT EnvWrapper : public Env {
   void Schedule(void (*f)(void*), void* a) override {
     return target_->Schedule(f, a);
   }
+  void Schedule(void (*f)(void*), void* a, SchedulePriority pri) override {
+    return target_->Schedule(f, a, pri);
+  }
+  void SetBackgroundThreads(int n) override {
+    target_->SetBackgroundThreads(n);
+  }
+  Status PinCurrentThread(int cpu) override {
+    return target_->PinCurrentThread(cpu);
+  }
+  int GetCurrentCpu() override { return target_->GetCurrentCpu(); }
   void StartThread(void (*f)(void*), void* a) override {
     return target_->StartThread(f, a);
   }
@@ -0,0 +1,60 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_EVENT_LISTENER_H_
+#define STORAGE_LEVELDB_INCLUDE_EVENT_LISTENER_H_
+
+#include <cstdint>
+
+#include "leveldb/export.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+struct LEVELDB_EXPORT FlushInfo {
+  int output_level = 0;       // Level the memtable was flushed to
+  uint64_t bytes_written = 0;  // Size of the produced table
+  uint64_t micros = 0;         // Wall time of the flush
+  Status status;
+};
+
+struct LEVELDB_EXPORT CompactionInfo {
+  int level = 0;         // Input level
+  int output_level = 0;  // Level that received the outputs
+  int input_files = 0;
+  int output_files = 0;
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+  uint64_t micros = 0;
+  Status status;
+};
+
+struct LEVELDB_EXPORT WriteStallInfo {
+  enum Cause {
+    kSlowdown,        // Level-0 proportional delay engaged
+    kMemtablesFull,   // All memtables full, waiting for a flush
+    kTooManyL0Files,  // Level-0 hit the stop trigger
+  };
+  Cause cause;
+};
+
+// Callbacks fired by the DB on background state changes, configured
+// via Options::listeners.  Callbacks run on internal threads without
+// the DB mutex held; they must be fast, must not throw, and must not
+// call back into the write path of the same DB.
+class LEVELDB_EXPORT EventListener {
+ public:
+  EventListener() = default;
+  EventListener(const EventListener&) = delete;
+  EventListener& operator=(const EventListener&) = delete;
+  virtual ~EventListener();
+
+  virtual void OnFlushCompleted(const FlushInfo& info) {}
+  virtual void OnCompactionCompleted(const CompactionInfo& info) {}
+  virtual void OnWriteStall(const WriteStallInfo& info) {}
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_EVENT_LISTENER_H_
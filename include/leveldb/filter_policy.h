@@ -67,6 +67,20 @@ class LEVELDB_EXPORT FilterPolicy {
 // trailing spaces in keys.
 LEVELDB_EXPORT const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
 
+// Return a new filter policy that uses an xor8 filter.  Compared with
+// NewBloomFilterPolicy(10) it spends slightly fewer bits per key for a
+// roughly 2.5x lower false positive rate, at the cost of a more
+// expensive (but still one-shot) filter construction.  Works with the
+// standard filter block partitioning unchanged.
+LEVELDB_EXPORT const FilterPolicy* NewXorFilterPolicy();
+
+// Return a bloom filter policy like NewBloomFilterPolicy(bits_per_key)
+// except that all probes for a key fall within one 64-byte cache line,
+// so a lookup costs at most one cache miss.  The false-positive rate
+// is slightly higher at equal bits per key.
+LEVELDB_EXPORT const FilterPolicy* NewBlockedBloomFilterPolicy(
+    int bits_per_key);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_INCLUDE_FILTER_POLICY_H_
@@ -0,0 +1,28 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_KEYSPACE_H_
+#define STORAGE_LEVELDB_INCLUDE_KEYSPACE_H_
+
+#include <string>
+
+#include "leveldb/db.h"
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+// Return a DB view that scopes every operation to the keyspace "name"
+// within *base: keys are transparently prefixed, iterators are bounded
+// to the keyspace, and properties/compactions forward to the base DB.
+// Any number of keyspaces share the base DB's write-ahead log, group
+// commit, caches and background compaction scheduling, so running many
+// tenants this way costs one fsync stream instead of one per tenant.
+//
+// "name" must not contain '\0'.  The view does not own *base; delete
+// all views before the base DB.  Views are as thread-safe as DB.
+LEVELDB_EXPORT DB* NewKeyspace(DB* base, const std::string& name);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_KEYSPACE_H_
@@ -0,0 +1,41 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_MERGE_OPERATOR_H_
+#define STORAGE_LEVELDB_INCLUDE_MERGE_OPERATOR_H_
+
+#include <string>
+#include <vector>
+
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+// Combines a stored value with operands written by WriteBatch::Merge()
+// (or DB::Merge()), so read-modify-write updates such as counters can
+// be expressed as a single write.  Implementations must be thread-safe
+// and must compute the same result regardless of how the operand list
+// was batched.
+class LEVELDB_EXPORT MergeOperator {
+ public:
+  MergeOperator() = default;
+  MergeOperator(const MergeOperator&) = delete;
+  MergeOperator& operator=(const MergeOperator&) = delete;
+  virtual ~MergeOperator();
+
+  // Name, checked for consistency like a comparator name.
+  virtual const char* Name() const = 0;
+
+  // Merge existing_value (null if the key had no value) with the
+  // operands, oldest first, storing the result in *result.  Returning
+  // false signals corruption and fails the read.
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const std::vector<Slice>& operands,
+                     std::string* result) const = 0;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_MERGE_OPERATOR_H_
@@ -6,16 +6,24 @@
 #define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
 
 #include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include "leveldb/export.h"
 
 namespace leveldb {
 
 class Cache;
+class CompactionPicker;
+class CacheAllocator;
 class Comparator;
 class Env;
+class EventListener;
 class FilterPolicy;
 class Logger;
+class MergeOperator;
+class RateLimiter;
+class Slice;
 class Snapshot;
 
 // DB contents are stored in a set of blocks, each of which holds a
@@ -28,6 +36,27 @@ enum CompressionType {
   kNoCompression = 0x0,
   kSnappyCompression = 0x1,
   kZstdCompression = 0x2,
+  kLZ4Compression = 0x3,
+};
+
+// Checksum algorithm protecting table blocks.
+enum ChecksumType {
+  // NOTE: stored in table footers; do not change existing values.
+  kCRC32c = 0x0,
+  kXXH64 = 0x1,  // Much faster to verify; low 32 bits are stored
+};
+
+// How table files are organized and merged.
+enum CompactionStyle {
+  // Classic leveled compaction: sorted levels of exponentially
+  // increasing size with low space and read amplification.
+  kCompactionStyleLevel = 0x0,
+  // Tiered ("universal") compaction: every flush and compaction output
+  // is a sorted run kept in level 0, and runs of similar size are
+  // merged together.  Write amplification drops substantially at the
+  // cost of space amplification and slower reads; suited to
+  // write-mostly workloads on endurance-limited storage.
+  kCompactionStyleUniversal = 0x1,
 };
 
 // Options to control the behavior of a database (passed to DB::Open)
@@ -46,6 +75,10 @@ struct LEVELDB_EXPORT Options {
   // comparator provided to previous open calls on the same DB.
   const Comparator* comparator;
 
+  // Listeners notified of flushes, compactions and write stalls; see
+  // leveldb/event_listener.h.  Not owned by the DB; must outlive it.
+  std::vector<EventListener*> listeners;
+
   // If true, the database will be created if it is missing.
   bool create_if_missing = false;
 
@@ -84,7 +117,10 @@ struct LEVELDB_EXPORT Options {
 
   // Number of open files that can be used by the DB.  You may need to
   // increase this if your database has a large working set (budget
-  // one open file per 2MB of working set).
+  // one open file per 2MB of working set).  -1 keeps every table file
+  // permanently open with no cache accounting at all, which removes
+  // table-handle lookups from the read path; only use it when the
+  // process's fd limit comfortably exceeds the table count.
   int max_open_files = 1000;
 
   // Control over blocks (user data is stored in a set of blocks, and
@@ -94,12 +130,48 @@ struct LEVELDB_EXPORT Options {
   // If null, leveldb will automatically create and use an 8MB internal cache.
   Cache* block_cache = nullptr;
 
+  // If true, table files are read through unbounded memory mappings
+  // with an madvise(MADV_RANDOM) hint instead of pread (bypassing the
+  // Env's internal mmap budget).  Uncompressed blocks are then served
+  // directly from the mapping with no copy and no block-cache entry.
+  // Best for tiers whose tables fit comfortably in memory.
+  bool use_mmap_reads = false;
+
+  // If non-null, data block buffers are allocated and freed through
+  // this allocator instead of the global heap (see
+  // leveldb/cache.h).  To pool cache handles too, pass the same
+  // allocator to the NewLRUCache() overload.
+  CacheAllocator* block_allocator = nullptr;
+
+  // If non-null, a second cache tier holding compressed block contents.
+  // It is consulted when block_cache misses, turning a disk read and
+  // decompress into just a decompress, and is populated whenever a
+  // compressed block is read from disk.  Because it stores compressed
+  // bytes it can be sized much larger than block_cache for the same
+  // memory.  Only used when block_cache is also in use.
+  Cache* compressed_block_cache = nullptr;
+
   // Approximate size of user data packed per block.  Note that the
   // block size specified here corresponds to uncompressed data.  The
   // actual size of the unit read from disk may be smaller if
   // compression is enabled.  This parameter can be changed dynamically.
   size_t block_size = 4 * 1024;
 
+  // If true, append a small hash index to each data block mapping key
+  // hashes to restart points, so point lookups jump directly to the
+  // right restart group instead of binary searching.  Costs about one
+  // byte per entry.  Tables written this way are NOT readable by older
+  // releases.
+  bool block_hash_index = false;
+
+  // If non-zero, the table index is split into partitions of roughly
+  // this many bytes with a small top-level index over them, so opening
+  // a huge table reads only the top index and lookups fault in just
+  // the touched partitions (via the block cache).  Tables written this
+  // way are NOT readable by older releases.  A few hundred KB of index
+  // per table is a reasonable threshold; 64KB partitions work well.
+  size_t index_partition_size = 0;
+
   // Number of keys between restart points for delta encoding of keys.
   // This parameter can be changed dynamically.  Most clients should
   // leave this parameter alone.
@@ -131,20 +203,327 @@ struct LEVELDB_EXPORT Options {
   // efficiently detect that and will switch to uncompressed mode.
   CompressionType compression = kSnappyCompression;
 
+  // Checksum used for table blocks written by this DB.  kXXH64 is
+  // fast enough to leave ReadOptions::verify_checksums on in
+  // production; the type is recorded in the table footer, so mixed
+  // databases read fine, but kXXH64 tables are NOT readable by older
+  // releases with verification enabled.
+  ChecksumType checksum = kCRC32c;
+
+  // Number of threads used to compress table blocks.  With a value
+  // above 1, block compression runs on background threads while the
+  // table builder keeps producing, and compressed blocks are written
+  // back in order; useful when a heavy codec (e.g. zstd) dominates
+  // compaction CPU.  Ignored (sequential compression) when a
+  // partitioned filter needs exact block offsets, i.e. when a
+  // filter_policy is set without whole_file_filters.
+  int compression_parallelism = 1;
+
   // Compression level for zstd.
   // Currently only the range [-5,22] is supported. Default is 1.
   int zstd_compression_level = 1;
 
+  // If non-empty, overrides "compression" with a per-level choice:
+  // entry i is used for table files written for level i, and the last
+  // entry applies to all deeper levels.  This allows e.g. LZ4 on the
+  // frequently rewritten upper levels and zstd on the cold bottom
+  // level.
+  std::vector<CompressionType> compression_per_level;
+
+  // If non-empty, overrides "block_size" with a per-level choice,
+  // indexed like compression_per_level.  Cold bottom levels that are
+  // mostly scanned can use much larger blocks (fewer index entries,
+  // better compression) while hot point-read levels stay small.  Each
+  // table records the block size it was built with in its properties
+  // block; readers are unaffected since blocks are self-describing.
+  std::vector<size_t> block_size_per_level;
+
+  // If true, memtable memory is carved from a pool of large
+  // (huge-page-sized, madvise(MADV_HUGEPAGE)d on Linux) slabs that are
+  // recycled from retiring memtables to their successors, avoiding the
+  // allocation spike at memtable switch and reducing TLB pressure for
+  // large write buffers.
+  bool recycle_memtable_arena = false;
+
+  // Roll the MANIFEST over to a fresh descriptor (containing just a
+  // snapshot of the current version) once it grows beyond this many
+  // bytes, bounding recovery time for long-running databases.  The
+  // current size is visible via the "leveldb.manifest-file-size"
+  // property.
+  //
+  // Default: 64MB.  Zero disables rollover.
+  size_t max_manifest_file_size = 64 * 1024 * 1024;
+
+  // If non-zero, values of at least this many bytes are separated
+  // into append-only companion .blob files when the memtable is
+  // flushed; table files then store small handles that pass through
+  // every compaction untouched, cutting write amplification for
+  // large-value workloads.  Dead blob space is reclaimed by
+  // DB::GarbageCollectBlobs().  Tables written this way are NOT
+  // readable by older releases.
+  size_t blob_value_threshold = 0;
+
+  // If non-null, enables WriteBatch::Merge()/DB::Merge() and is used
+  // to combine merge operands with stored values on reads.  Must stay
+  // consistent across opens of the same database.
+  const MergeOperator* merge_operator = nullptr;
+
+  // If positive, a periodic background check marks table files whose
+  // deletion-marker fraction (from the properties block) is at least
+  // this ratio for compaction, so heavily deleted ranges are reclaimed
+  // even when level sizes alone would never choose them.  E.g. 0.5
+  // compacts files that are half tombstones.  Bottom-level files are
+  // exempt (there is nothing beneath them to delete into).
+  double tombstone_compaction_ratio = 0.0;
+
+  // If true, the DB records Get/Write/iterator-Seek latencies in
+  // internal log-linear histograms, readable through the
+  // "leveldb.latency.get", "leveldb.latency.write" and
+  // "leveldb.latency.seek" properties.  When false (the default) no
+  // clocks are read on the operation paths.
+  bool enable_latency_stats = false;
+
+  // If non-zero, data older than this many seconds is dropped
+  // automatically.  Expiry works at table-file granularity: since
+  // table files are immutable, a file's age bounds the age of its
+  // newest entry, and aged-out files are removed by a periodic
+  // background sweep once no deeper level holds overlapping data (so
+  // removal cannot resurrect older versions).  Entries may therefore
+  // outlive the TTL by up to one compaction rewrite.
+  uint64_t ttl_seconds = 0;
+
+  // If non-null, caps the disk write bandwidth used by memtable
+  // flushes and compactions (see leveldb/rate_limiter.h).  May be
+  // shared between databases; not owned by the DB.
+  RateLimiter* rate_limiter = nullptr;
+
+  // If true, compaction inputs and outputs are read and written with
+  // direct I/O (O_DIRECT where supported), so streaming whole levels
+  // through a compaction no longer evicts the hot pages foreground
+  // reads depend on.  Falls back to buffered I/O on file systems
+  // without direct I/O support.
+  bool use_direct_io_for_compaction = false;
+
+  // Maximum level a freshly flushed memtable may be placed at when it
+  // overlaps nothing (default 2, the historical kMaxMemCompactLevel).
+  // Append-only workloads whose flushes never overlap existing data
+  // can raise this towards the bottom level and skip the intermediate
+  // compaction cascade entirely.
+  int max_mem_compact_level = 2;
+
+  // If true, per-level size targets are derived from the observed
+  // bottom-most level instead of the fixed 10MB-times-10-per-level
+  // ladder: the deepest non-empty level anchors the ladder and each
+  // level above targets a tenth of the one below.  Freshly loaded or
+  // shrunken databases then keep data in the lowest levels, cutting
+  // write amplification.
+  bool dynamic_level_bytes = false;
+
+  // If true (with paranoid_checks), compaction input checksums are
+  // verified by a low-priority background task running concurrently
+  // with the merge, instead of inline on the compaction thread.
+  // Corruption is still surfaced (as a background error), but after
+  // the merge has consumed the block rather than before.
+  bool async_verify_compaction_inputs = false;
+
+  // If true, every compaction output is verified off the compaction
+  // path by a low-priority task that re-reads sampled blocks (with
+  // checksums) and checks key ordering and bounds; the compaction's
+  // input files stay protected from deletion until the check passes.
+  // Replaces the synchronous open-only check on the critical path.
+  bool verify_compaction_output = false;
+
+  // If true, runs of small adjacent files within a level (each under
+  // a quarter of max_file_size, four or more in a row) are merged by a
+  // same-level compaction when no other compaction is pending.
+  // Seek-triggered and trivial-move compactions otherwise litter the
+  // deep levels with tiny files that inflate file counts and table
+  // cache pressure.  Off by default, like the other optional
+  // compaction behaviors: the merges rewrite ranges no read may ever
+  // touch, which surprises workloads that rely on untouched regions
+  // staying untouched.
+  bool merge_small_files = false;
+
+  // Compaction style; see CompactionStyle.
+  CompactionStyle compaction_style = kCompactionStyleLevel;
+
+  // If true, each memtable maintains an auxiliary open-addressing hash
+  // index from user keys to their newest entry, so exact-match Get()
+  // hits (and misses) in the memtable cost a hash probe instead of an
+  // ordered skiplist descent.  Adds roughly 8 bytes per entry.
+  bool memtable_hash_index = false;
+
+  // Maximum number of immutable (full, not yet flushed) memtables that
+  // may be queued in memory before writers stall.  Values above 1 let
+  // short ingest bursts absorb into RAM while a flush is behind, at
+  // the cost of up to (1 + this) * write_buffer_size of memory and
+  // proportionally longer recovery.
+  //
+  // Default: 1 (the historical single immutable memtable)
+  int max_immutable_memtables = 1;
+
+  // If true, a writer that fills the last memtable while every
+  // background thread is busy flushes the oldest immutable memtable
+  // itself instead of sleeping until a background thread frees up,
+  // trading one writer's latency for unblocking the whole write queue.
+  bool foreground_flush_fallback = false;
+
+  // Maximum number of concurrent background compactions.  Compactions
+  // are scheduled on Env threads and run concurrently only when they
+  // operate on disjoint pairs of levels, so raising this beyond the
+  // number of levels with pending work has no effect.  A memtable
+  // flush counts as one compaction.
+  //
+  // Default: 1 (the historical single background thread)
+  int max_background_compactions = 1;
+
+  // Maximum number of threads used to run a single large compaction.
+  // When greater than 1, a compaction whose inputs span several files
+  // in the next level is partitioned at file boundary keys and the
+  // partitions are compacted in parallel on Env threads, producing the
+  // same set of output files in one VersionEdit.
+  //
+  // Default: 1 (no splitting)
+  int max_subcompactions = 1;
+
+  // If true, write-ahead log records are snappy-compressed, roughly
+  // halving WAL bytes (and sync sizes) for compressible values.  Logs
+  // written this way are not readable by older releases.
+  bool wal_compression = false;
+
+  // If non-zero, the write-ahead log block size.  Rounded up to a
+  // multiple of the default 32KB.  Like wal_compression this produces
+  // logs that older releases cannot read.
+  size_t wal_block_size = 0;
+
   // EXPERIMENTAL: If true, append to existing MANIFEST and log files
   // when a database is opened.  This can significantly speed up open.
   //
   // Default: currently false, but may become true later.
+  // Ignored when wal_compression or wal_block_size is set.
   bool reuse_logs = false;
 
   // If non-null, use the specified filter policy to reduce disk reads.
   // Many applications will benefit from passing the result of
   // NewBloomFilterPolicy() here.
   const FilterPolicy* filter_policy = nullptr;
+
+  // If true, DB::Open pre-opens every live table file (reading its
+  // index and filter blocks) on a handful of threads before returning,
+  // so the first reads after a restart do not pay cold Table::Open
+  // costs one file at a time.  Open takes correspondingly longer.
+  bool warm_cache_on_open = false;
+
+  // Level-0 file-count thresholds, formerly compile-time constants:
+  // compaction starts at l0_compaction_trigger files, writes are
+  // throttled at l0_slowdown_writes_trigger and stopped at
+  // l0_stop_writes_trigger.
+  int l0_compaction_trigger = 4;
+  int l0_slowdown_writes_trigger = 8;
+  int l0_stop_writes_trigger = 12;
+
+  // If true, the destructor flushes the active and immutable
+  // memtables before closing, so the CLEAN_SHUTDOWN marker can always
+  // be written and the next open skips WAL replay entirely.  Off by
+  // default: the stock contract that unflushed data lives only in the
+  // WAL is load-bearing for recovery tooling (and tests); without the
+  // flush the marker is still written whenever nothing is buffered.
+  bool flush_on_close = false;
+
+  // If true, the DB adjusts its memtable size and the level-0
+  // slowdown/stop thresholds at runtime, within bounds (memtable up to
+  // 8x write_buffer_size, thresholds up to 2x their configured
+  // values), based on observed write stalls: sustained stalling grows
+  // the headroom, calm periods decay it back.  The configured values
+  // act as the floor.
+  bool adaptive_tuning = false;
+
+  // If non-null, overrides the built-in compaction selection policy
+  // (level fullness scores, then read-heat).  See
+  // leveldb/compaction_picker.h.  Not owned by the DB.  Universal
+  // compaction ignores it.
+  CompactionPicker* compaction_picker = nullptr;
+
+  // If true, values of at least 64 bytes are snappy-compressed inside
+  // the memtable (one tag byte per value; decompressed transparently
+  // on reads and at flush).  Highly-compressible workloads fit several
+  // times more data per memtable at the same RSS, producing fewer L0
+  // files.  Costs a compression on the write path and a decompression
+  // per memtable read of such a value.  Disabled automatically with
+  // value_checksums.  No effect when snappy is not available.
+  bool memtable_compression = false;
+
+  // If non-zero, a small LRU cache of recently-confirmed-absent user
+  // keys (capacity in bytes).  Workloads dominated by lookups of
+  // missing keys (dedup checks) answer repeats from the cache instead
+  // of probing filters across every level.  Writes invalidate by key
+  // hash, so a stale positive can never be reported absent.
+  size_t negative_cache_size = 0;
+
+  // If true, every stored value carries a crc32c of its key and
+  // contents, appended when the entry reaches the memtable and
+  // verified on every read -- catching bit flips introduced in the
+  // memtable, block cache or anywhere else the block checksum cannot
+  // see.  Costs 4 bytes per entry plus a crc per write and read.
+  // Incompatible with merge_operator and blob_value_threshold (both
+  // transform values); they disable it.
+  bool value_checksums = false;
+
+  // If non-zero, table-file reads that have not completed within this
+  // many microseconds are hedged: a second identical read is issued
+  // and the first completion wins.  Bounds p99.9 read latency on
+  // intermittently-stalling media at the cost of a thread hand-off per
+  // read.  Off by default.
+  uint64_t hedged_read_threshold_micros = 0;
+
+  // If non-zero, keep up to this many retired log files and reuse
+  // them (renamed, with records stamped with the new log number) for
+  // future segments instead of create+unlink cycles -- steadier fsync
+  // latency on filesystems with expensive metadata journaling.
+  // Ignored when wal_compression or wal_block_size is set.
+  int recycle_log_files = 0;
+
+  // If non-zero, a background thread fsyncs the write-ahead log every
+  // this many microseconds, bounding data loss on a crash without
+  // paying a sync per commit: writes can run with
+  // WriteOptions::sync == false and still be durable within one
+  // interval.  The sequence number covered by the last completed sync
+  // is exposed as the "leveldb.last-durable-sequence" property, so a
+  // replication layer can acknowledge exactly what is on disk.
+  uint64_t wal_sync_interval_micros = 0;
+
+  // If non-zero, a soft limit on the total memory the DB holds in
+  // memtables and the configured caches.  When the sum exceeds the
+  // budget the DB first prunes unpinned block-cache entries, then
+  // flushes memtables early.  Best effort: transient overshoot is
+  // possible, and memory not attributed to these components (open
+  // table metadata, iterators) is not counted.  See the
+  // "leveldb.memory-usage" property for the breakdown used.
+  size_t total_memory_budget = 0;
+
+  // If non-zero, keys share a fixed-length prefix (e.g. a 16-byte
+  // shard id) and the filter policy is fed key prefixes instead of
+  // whole keys.  Filters become much smaller and point lookups for
+  // absent prefixes skip data blocks entirely; lookups for a present
+  // prefix fall through to the block read as usual.  Also enables
+  // ReadOptions::prefix_same_as_start.  Keys shorter than this use the
+  // whole key.
+  size_t prefix_length = 0;
+
+  // If non-zero, the filter data of each table is cut into partitions
+  // of roughly this many bytes, each written as its own block and
+  // loaded on demand through a small in-table filter index -- so
+  // opening a table or probing one key no longer reads the whole
+  // (potentially tens of MB) filter.  Ignored with whole_file_filters.
+  size_t filter_partition_size = 0;
+
+  // If true, build a single filter covering all keys in each table file
+  // instead of one filter per 2KB of data.  The whole-file filter is
+  // loaded when the table is opened and pinned in memory, so a negative
+  // lookup probes exactly one filter and touches no data blocks.
+  // Tables remain readable by older releases.  Only meaningful when
+  // filter_policy is non-null.
+  bool whole_file_filters = false;
 };
 
 // Options that control read operations
@@ -157,6 +536,39 @@ struct LEVELDB_EXPORT ReadOptions {
   // Callers may wish to set this field to false for bulk scans.
   bool fill_cache = true;
 
+  // If non-null, forward iteration stops at (excludes) this user key:
+  // the iterator becomes invalid instead of advancing to or past it,
+  // so bounded range scans stop touching blocks beyond their end key.
+  // The slice must outlive the iterator.
+  const Slice* iterate_upper_bound = nullptr;
+
+  // If true, a forward scan periodically reports its position so that
+  // table files wholly behind the cursor -- and referenced only by
+  // this (and similar) iterators' pinned versions -- can be deleted
+  // before the iterator is closed.  Lets hours-long exports stop
+  // blocking space reclaim.  Reverse iteration over the released
+  // portion is unsupported and may fail with missing-file errors.
+  bool release_passed_files = false;
+
+  // If true, the iterator is used only for keys: value copies, blob
+  // resolution and merge resolution are skipped and value() returns an
+  // empty slice.  Existence and key order are unaffected.  Useful for
+  // key counting and existence scans.
+  bool key_only = false;
+
+  // If non-zero, sequential scans prefetch upcoming data blocks (via
+  // RandomAccessFile::Prefetch, posix_fadvise(WILLNEED) on posix)
+  // while the current block is being consumed, up to roughly this many
+  // bytes ahead, so block boundaries stop stalling on synchronous
+  // reads.
+  size_t readahead_size = 0;
+
+  // If true (and Options::prefix_length is non-zero), an iterator
+  // positioned with Seek() becomes invalid as soon as it moves forward
+  // past the last key sharing the seek target's prefix, instead of
+  // scanning into the next prefix.
+  bool prefix_same_as_start = false;
+
   // If "snapshot" is non-null, read as of the supplied snapshot
   // (which must belong to the DB that is being read and which must
   // not have been released).  If "snapshot" is null, use an implicit
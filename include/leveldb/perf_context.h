@@ -0,0 +1,51 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
+#define STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+// Per-thread counters attributing the cost of the operations issued by
+// the calling thread.  Counters accumulate until Reset(); a typical use
+// is Reset() before a request and ToString() after a slow one.
+struct LEVELDB_EXPORT PerfContext {
+  uint64_t block_cache_hits = 0;   // Data blocks served from the cache
+  uint64_t block_reads = 0;        // Data blocks read from disk
+  uint64_t block_read_bytes = 0;   // Bytes of those reads
+  uint64_t filter_useful = 0;      // Lookups a filter cut short
+  uint64_t memtable_probes = 0;    // Memtables consulted by Get
+  uint64_t internal_keys_skipped = 0;  // Hidden entries stepped over
+
+  void Reset() { *this = PerfContext(); }
+  std::string ToString() const;
+};
+
+// The calling thread's PerfContext.
+LEVELDB_EXPORT PerfContext* GetPerfContext();
+
+// Process-wide always-on counters, aggregated across threads with
+// relaxed atomics; cheap enough to leave enabled in production.
+struct LEVELDB_EXPORT GlobalPerfCounters {
+  std::atomic<uint64_t> block_cache_hits{0};
+  std::atomic<uint64_t> block_cache_misses{0};
+  std::atomic<uint64_t> filter_checked{0};
+  std::atomic<uint64_t> filter_useful{0};
+  std::atomic<uint64_t> memtable_lookups{0};
+  std::atomic<uint64_t> memtable_hits{0};
+
+  std::string ToString() const;
+};
+
+LEVELDB_EXPORT GlobalPerfCounters* GetGlobalPerfCounters();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
@@ -0,0 +1,42 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+
+#include <cstdint>
+
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+// Caps the disk bandwidth used by background work.  An instance may be
+// shared by several databases; implementations must be thread-safe.
+class LEVELDB_EXPORT RateLimiter {
+ public:
+  // Flushes and compactions are charged against separate budgets.
+  enum IOType { kFlush = 0, kCompaction = 1 };
+
+  RateLimiter() = default;
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+  virtual ~RateLimiter();
+
+  // Block the caller until writing "bytes" more bytes of the given
+  // type fits within the configured budget.
+  virtual void Request(int64_t bytes, IOType type) = 0;
+
+  // Total bytes granted so far for the given type.
+  virtual int64_t TotalBytesThrough(IOType type) const = 0;
+};
+
+// Create a token-bucket rate limiter with independent per-second
+// budgets for flushes and compactions.  A non-positive budget leaves
+// that type unthrottled.  The caller owns the result.
+LEVELDB_EXPORT RateLimiter* NewGenericRateLimiter(
+    int64_t flush_bytes_per_second, int64_t compaction_bytes_per_second);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
@@ -100,6 +100,69 @@ inline bool operator==(const Slice& x, const Slice& y) {
 
 inline bool operator!=(const Slice& x, const Slice& y) { return !(x == y); }
 
+// A Slice that may own a pin on the storage backing its data (e.g. a
+// cached block or a memtable), released when the PinnableSlice is
+// reset or destroyed.  Used by the zero-copy DB::Get() overload.
+class LEVELDB_EXPORT PinnableSlice {
+ public:
+  PinnableSlice() : cleanup_(nullptr), arg1_(nullptr), arg2_(nullptr) {}
+  PinnableSlice(const PinnableSlice&) = delete;
+  PinnableSlice& operator=(const PinnableSlice&) = delete;
+  ~PinnableSlice() { Reset(); }
+
+  const char* data() const { return slice_.data(); }
+  size_t size() const { return slice_.size(); }
+  const Slice& slice() const { return slice_; }
+  std::string ToString() const { return slice_.ToString(); }
+
+  // Point at external storage kept alive until Reset(); cleanup is
+  // invoked with (arg1, arg2) when the pin is dropped.
+  void PinSlice(const Slice& s, void (*cleanup)(void*, void*), void* arg1,
+                void* arg2) {
+    Reset();
+    slice_ = s;
+    cleanup_ = cleanup;
+    arg1_ = arg1;
+    arg2_ = arg2;
+  }
+
+  // Copy the data into an internal buffer (no external pin).
+  void PinSelf(const Slice& s) {
+    Reset();
+    buffer_.assign(s.data(), s.size());
+    slice_ = Slice(buffer_);
+  }
+
+  // Internal buffer for callers that build the value in place; call
+  // PinBuffer() afterwards to publish its contents.
+  std::string* buffer() { return &buffer_; }
+
+  // Publish the internal buffer as the value.
+  void PinBuffer() {
+    if (cleanup_ != nullptr) {
+      (*cleanup_)(arg1_, arg2_);
+      cleanup_ = nullptr;
+    }
+    slice_ = Slice(buffer_);
+  }
+
+  void Reset() {
+    if (cleanup_ != nullptr) {
+      (*cleanup_)(arg1_, arg2_);
+      cleanup_ = nullptr;
+    }
+    slice_ = Slice();
+    buffer_.clear();
+  }
+
+ private:
+  Slice slice_;
+  std::string buffer_;
+  void (*cleanup_)(void*, void*);
+  void* arg1_;
+  void* arg2_;
+};
+
 inline int Slice::compare(const Slice& b) const {
   const size_t min_len = (size_ < b.size_) ? size_ : b.size_;
   int r = memcmp(data_, b.data_, min_len);
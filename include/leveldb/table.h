@@ -23,6 +23,16 @@ class TableCache;
 // A Table is a sorted map from strings to strings.  Tables are
 // immutable and persistent.  A Table may be safely accessed from
 // multiple threads without external synchronization.
+// Summary statistics stored in a table's properties meta block; all
+// zero for tables written before the properties block existed.
+struct LEVELDB_EXPORT TableProperties {
+  uint64_t num_entries = 0;
+  uint64_t num_deletions = 0;     // Entries that are deletion markers
+  uint64_t raw_key_bytes = 0;     // Uncompressed key bytes
+  uint64_t raw_value_bytes = 0;   // Uncompressed value bytes
+  uint64_t block_size = 0;        // Options::block_size at build time
+};
+
 class LEVELDB_EXPORT Table {
  public:
   // Attempt to open the table that is stored in bytes [0..file_size)
@@ -58,22 +68,45 @@ class LEVELDB_EXPORT Table {
   // be close to the file length.
   uint64_t ApproximateOffsetOf(const Slice& key) const;
 
+  // Properties recorded when the table was built; zeros for tables
+  // from older releases.
+  const TableProperties& GetProperties() const;
+
+  // Id this table uses to partition the shared block cache's keyspace.
+  uint64_t CacheId() const;
+
+  // Iterator over the (last key, data block handle) index entries,
+  // composing partitioned indexes transparently.  Useful for
+  // metadata-only tooling.
+  Iterator* IndexBlockIterator(const ReadOptions& options) const;
+
  private:
   friend class TableCache;
   struct Rep;
 
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
+  bool KeyMayMatchFilter(uint64_t block_offset, const Slice& key) const;
+  static void PrefetchBlock(void* arg, const Slice& index_value);
+
+  // If "pinned_iter" is non-null and the lookup found an entry, the
+  // block iterator positioned at it is stored there (keeping the value
+  // slice alive) instead of being deleted; the caller owns it.
 
   explicit Table(Rep* rep) : rep_(rep) {}
 
   // Calls (*handle_result)(arg, ...) with the entry found after a call
   // to Seek(key).  May not make such a call if filter policy says
   // that key is not present.
+  // A non-null "did_block_read" is set to true iff a data block was
+  // actually read (i.e. the lookup got past the filter).
   Status InternalGet(const ReadOptions&, const Slice& key, void* arg,
                      void (*handle_result)(void* arg, const Slice& k,
-                                           const Slice& v));
+                                           const Slice& v),
+                     Iterator** pinned_iter = nullptr,
+                     bool* did_block_read = nullptr);
 
   void ReadMeta(const Footer& footer);
+  void ReadProperties(const Slice& handle_value);
   void ReadFilter(const Slice& filter_handle_value);
 
   Rep* const rep_;
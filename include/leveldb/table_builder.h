@@ -82,6 +82,12 @@ class LEVELDB_EXPORT TableBuilder {
  private:
   bool ok() const { return status().ok(); }
   void WriteBlock(BlockBuilder* block, BlockHandle* handle);
+  void AddIndexEntry(const Slice& key, const Slice& handle);
+  void CompressBlock(const Slice& raw, std::string* out,
+                     CompressionType* type);
+  static void CompressionWorker(void* arg);
+  void DrainCompressedBlocks(bool wait);
+  void StopCompressionWorkers();
   void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
 
   struct Rep;
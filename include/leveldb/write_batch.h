@@ -21,7 +21,9 @@
 #ifndef STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_H_
 #define STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_H_
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "leveldb/export.h"
 #include "leveldb/status.h"
@@ -37,6 +39,20 @@ class LEVELDB_EXPORT WriteBatch {
     virtual ~Handler();
     virtual void Put(const Slice& key, const Slice& value) = 0;
     virtual void Delete(const Slice& key) = 0;
+    // Handles DeleteRange(); the default implementation ignores range
+    // deletions so pre-existing handlers keep compiling.
+    virtual void DeleteRange(const Slice& begin, const Slice& end);
+    // Handles Merge(); the default implementation ignores merges.
+    virtual void Merge(const Slice& key, const Slice& value);
+    // A Put record stored in memtable-ready layout; "entry" spans the
+    // whole encoded record.  The default implementation forwards to
+    // Put().
+    virtual void PutPreEncoded(const char* entry, size_t entry_size,
+                               const Slice& key, const Slice& value);
+    // Two-phase commit records (see DB::Prepare); ignored by default.
+    virtual void Prepare(uint64_t txn_id, const Slice& batch_contents);
+    virtual void CommitPrepared(uint64_t txn_id, int count);
+    virtual void RollbackPrepared(uint64_t txn_id);
   };
 
   WriteBatch();
@@ -53,9 +69,19 @@ class LEVELDB_EXPORT WriteBatch {
   // If the database contains a mapping for "key", erase it.  Else do nothing.
   void Delete(const Slice& key);
 
+  // Erase every mapping with begin <= key < end, as one O(1) record.
+  void DeleteRange(const Slice& begin, const Slice& end);
+
+  // Add a merge operand for "key"; requires Options::merge_operator.
+  void Merge(const Slice& key, const Slice& value);
+
   // Clear all updates buffered in this batch.
   void Clear();
 
+  // Pre-allocate space for roughly "bytes" of batched records, so
+  // large batches grow without repeated reallocation and copying.
+  void Reserve(size_t bytes);
+
   // The size of the database changes caused by this batch.
   //
   // This number is tied to implementation details, and may change across
@@ -76,6 +102,12 @@ class LEVELDB_EXPORT WriteBatch {
   friend class WriteBatchInternal;
 
   std::string rep_;  // See comment in write_batch.cc for the format of rep_
+
+  // Byte offset of each record in rep_, maintained as records are
+  // appended so Iterate() can walk fixed offsets instead of re-parsing
+  // the stream.  Dropped (empty with records present) when the batch
+  // contents come from elsewhere, e.g. log replay via SetContents().
+  std::vector<uint32_t> record_offsets_;
 };
 
 }  // namespace leveldb
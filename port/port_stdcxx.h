@@ -32,6 +32,9 @@
 #define ZSTD_STATIC_LINKING_ONLY  // For ZSTD_compressionParameters.
 #include <zstd.h>
 #endif  // HAVE_ZSTD
+#if HAVE_LZ4
+#include <lz4.h>
+#endif  // HAVE_LZ4
 
 #include <cassert>
 #include <condition_variable>  // NOLINT
@@ -198,6 +201,76 @@ inline bool Zstd_Uncompress(const char* input, size_t length, char* output) {
 #endif  // HAVE_ZSTD
 }
 
+inline bool Lz4_Compress(const char* input, size_t length,
+                         std::string* output) {
+#if HAVE_LZ4
+  // The LZ4 block format does not record the uncompressed size, so a
+  // little-endian fixed32 prefix carries it.
+  if (length > LZ4_MAX_INPUT_SIZE) {
+    return false;
+  }
+  const int max_compressed = LZ4_compressBound(static_cast<int>(length));
+  output->resize(4 + static_cast<size_t>(max_compressed));
+  (*output)[0] = static_cast<char>(length & 0xff);
+  (*output)[1] = static_cast<char>((length >> 8) & 0xff);
+  (*output)[2] = static_cast<char>((length >> 16) & 0xff);
+  (*output)[3] = static_cast<char>((length >> 24) & 0xff);
+  const int outlen = LZ4_compress_default(
+      input, &(*output)[4], static_cast<int>(length), max_compressed);
+  if (outlen <= 0) {
+    return false;
+  }
+  output->resize(4 + static_cast<size_t>(outlen));
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)output;
+  return false;
+#endif  // HAVE_LZ4
+}
+
+inline bool Lz4_GetUncompressedLength(const char* input, size_t length,
+                                      size_t* result) {
+#if HAVE_LZ4
+  if (length < 4) {
+    return false;
+  }
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(input);
+  *result = (static_cast<size_t>(bytes[0])) |
+            (static_cast<size_t>(bytes[1]) << 8) |
+            (static_cast<size_t>(bytes[2]) << 16) |
+            (static_cast<size_t>(bytes[3]) << 24);
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)result;
+  return false;
+#endif  // HAVE_LZ4
+}
+
+inline bool Lz4_Uncompress(const char* input, size_t length, char* output) {
+#if HAVE_LZ4
+  size_t outlen;
+  if (!Lz4_GetUncompressedLength(input, length, &outlen)) {
+    return false;
+  }
+  const int decompressed =
+      LZ4_decompress_safe(input + 4, output, static_cast<int>(length - 4),
+                          static_cast<int>(outlen));
+  return decompressed >= 0 && static_cast<size_t>(decompressed) == outlen;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)output;
+  return false;
+#endif  // HAVE_LZ4
+}
+
 inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
   // Silence compiler warnings about unused arguments.
   (void)func;
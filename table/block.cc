@@ -8,26 +8,74 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <string>
+#include <utility>
 #include <vector>
 
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define LEVELDB_BLOCK_PREFIX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include <cstring>
+
+#include "leveldb/cache.h"
 #include "leveldb/comparator.h"
 #include "table/format.h"
 #include "util/coding.h"
+#include "util/hash.h"
 #include "util/logging.h"
 
 namespace leveldb {
 
 inline uint32_t Block::NumRestarts() const {
   assert(size_ >= sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  return DecodeFixed32(data_ + size_ - sizeof(uint32_t)) &
+         ~kBlockHashIndexFlag;
+}
+
+Slice BlockHashableKey(const Comparator* comparator, const Slice& key) {
+  if (key.size() >= 8 &&
+      strcmp(comparator->Name(), "leveldb.InternalKeyComparator") == 0) {
+    return Slice(key.data(), key.size() - 8);
+  }
+  return key;
 }
 
 Block::Block(const BlockContents& contents)
     : data_(contents.data.data()),
       size_(contents.data.size()),
-      owned_(contents.heap_allocated) {
+      allocated_size_(contents.allocated_size),
+      allocator_(contents.allocator),
+      hash_index_offset_(0),
+      num_hash_buckets_(0),
+      owned_(contents.heap_allocated),
+      restart_prefixes_(nullptr),
+      prefixes_unsupported_(false) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
+  } else if (DecodeFixed32(data_ + size_ - sizeof(uint32_t)) &
+             kBlockHashIndexFlag) {
+    // Trailer carries a hash index between the restarts and the end:
+    // buckets[num_buckets], num_buckets, num_restarts|flag.
+    if (size_ < 2 * sizeof(uint32_t)) {
+      size_ = 0;
+    } else {
+      const uint32_t num_buckets =
+          DecodeFixed32(data_ + size_ - 2 * sizeof(uint32_t));
+      const uint64_t tail = 2 * sizeof(uint32_t) +
+                            static_cast<uint64_t>(num_buckets) +
+                            static_cast<uint64_t>(NumRestarts()) *
+                                sizeof(uint32_t);
+      if (tail > size_) {
+        size_ = 0;
+      } else {
+        num_hash_buckets_ = num_buckets;
+        hash_index_offset_ = size_ - 2 * sizeof(uint32_t) - num_buckets;
+        restart_offset_ =
+            hash_index_offset_ - NumRestarts() * sizeof(uint32_t);
+      }
+    }
   } else {
     size_t max_restarts_allowed = (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
     if (NumRestarts() > max_restarts_allowed) {
@@ -40,8 +88,13 @@ Block::Block(const BlockContents& contents)
 }
 
 Block::~Block() {
+  delete[] restart_prefixes_.load(std::memory_order_relaxed);
   if (owned_) {
-    delete[] data_;
+    if (allocator_ != nullptr) {
+      allocator_->Deallocate(const_cast<char*>(data_), allocated_size_);
+    } else {
+      delete[] data_;
+    }
   }
 }
 
@@ -55,18 +108,8 @@ Block::~Block() {
 static inline const char* DecodeEntry(const char* p, const char* limit,
                                       uint32_t* shared, uint32_t* non_shared,
                                       uint32_t* value_length) {
-  if (limit - p < 3) return nullptr;
-  *shared = reinterpret_cast<const uint8_t*>(p)[0];
-  *non_shared = reinterpret_cast<const uint8_t*>(p)[1];
-  *value_length = reinterpret_cast<const uint8_t*>(p)[2];
-  if ((*shared | *non_shared | *value_length) < 128) {
-    // Fast path: all three values are encoded in one byte each
-    p += 3;
-  } else {
-    if ((p = GetVarint32Ptr(p, limit, shared)) == nullptr) return nullptr;
-    if ((p = GetVarint32Ptr(p, limit, non_shared)) == nullptr) return nullptr;
-    if ((p = GetVarint32Ptr(p, limit, value_length)) == nullptr) return nullptr;
-  }
+  p = GetVarint32TriplePtr(p, limit, shared, non_shared, value_length);
+  if (p == nullptr) return nullptr;
 
   if (static_cast<uint32_t>(limit - p) < (*non_shared + *value_length)) {
     return nullptr;
@@ -74,6 +117,64 @@ static inline const char* DecodeEntry(const char* p, const char* limit,
   return p;
 }
 
+const uint32_t* Block::RestartPrefixes(const Comparator* comparator) {
+  const uint32_t* prefixes = restart_prefixes_.load(std::memory_order_acquire);
+  if (prefixes != nullptr ||
+      prefixes_unsupported_.load(std::memory_order_relaxed)) {
+    return prefixes;
+  }
+  const uint32_t num_restarts = NumRestarts();
+  uint32_t* built = new uint32_t[num_restarts];
+  for (uint32_t i = 0; i < num_restarts; i++) {
+    const uint32_t offset =
+        DecodeFixed32(data_ + restart_offset_ + i * sizeof(uint32_t));
+    uint32_t shared, non_shared, value_length;
+    const char* key_ptr = DecodeEntry(data_ + offset, data_ + restart_offset_,
+                                      &shared, &non_shared, &value_length);
+    if (key_ptr == nullptr || shared != 0 ||
+        !comparator->OrderPreservingPrefix(Slice(key_ptr, non_shared),
+                                           &built[i])) {
+      delete[] built;
+      prefixes_unsupported_.store(true, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+  const uint32_t* expected = nullptr;
+  if (!restart_prefixes_.compare_exchange_strong(expected, built,
+                                                 std::memory_order_release,
+                                                 std::memory_order_acquire)) {
+    delete[] built;  // Another thread built the array first.
+    return expected;
+  }
+  return built;
+}
+
+// Return the index of the first entry in the sorted prefixes[0,n) that
+// is >= bound.
+static inline uint32_t PrefixLowerBound(const uint32_t* prefixes, uint32_t n,
+                                        uint32_t bound) {
+  uint32_t count = 0;
+  uint32_t i = 0;
+#if LEVELDB_BLOCK_PREFIX_SSE2
+  // Count entries < bound four lanes at a time; unsigned comparison is
+  // done as a signed comparison of bias-flipped values.
+  const __m128i bias = _mm_set1_epi32(static_cast<int32_t>(0x80000000u));
+  const __m128i bound_v =
+      _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(bound)), bias);
+  for (; i + 4 <= n; i += 4) {
+    __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(prefixes + i));
+    v = _mm_xor_si128(v, bias);
+    const int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, bound_v)));
+    count += static_cast<uint32_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+  }
+#endif
+  for (; i < n; i++) {
+    if (prefixes[i] < bound) count++;
+  }
+  return count;
+}
+
 class Block::Iter : public Iterator {
  private:
   const Comparator* const comparator_;
@@ -84,6 +185,16 @@ class Block::Iter : public Iterator {
   // current_ is offset in data_ of current entry.  >= restarts_ if !Valid
   uint32_t current_;
   uint32_t restart_index_;  // Index of restart block in which current_ falls
+  // Reverse-scan cache: (entry offset, full key) for the entries of
+  // restart group prev_cache_restart_; see Prev().
+  uint32_t prev_cache_restart_;
+  std::vector<std::pair<uint32_t, std::string>> prev_cache_;
+  // Order-preserving prefixes of the restart keys, owned by the Block;
+  // nullptr if unavailable.
+  const uint32_t* const restart_prefixes_;
+  // Hash index buckets, or nullptr; see kBlockHashIndexFlag.
+  const char* const hash_buckets_;
+  uint32_t const num_hash_buckets_;
   std::string key_;
   Slice value_;
   Status status_;
@@ -114,13 +225,18 @@ class Block::Iter : public Iterator {
 
  public:
   Iter(const Comparator* comparator, const char* data, uint32_t restarts,
-       uint32_t num_restarts)
+       uint32_t num_restarts, const uint32_t* restart_prefixes,
+       const char* hash_buckets, uint32_t num_hash_buckets)
       : comparator_(comparator),
         data_(data),
         restarts_(restarts),
         num_restarts_(num_restarts),
         current_(restarts_),
-        restart_index_(num_restarts_) {
+        restart_index_(num_restarts_),
+        prev_cache_restart_(num_restarts),
+        restart_prefixes_(restart_prefixes),
+        hash_buckets_(hash_buckets),
+        num_hash_buckets_(num_hash_buckets) {
     assert(num_restarts_ > 0);
   }
 
@@ -155,10 +271,49 @@ class Block::Iter : public Iterator {
       restart_index_--;
     }
 
-    SeekToRestartPoint(restart_index_);
-    do {
-      // Loop until end of current entry hits the start of original entry
-    } while (ParseNextKey() && NextEntryOffset() < original);
+    // Decode the whole restart group once and cache (offset, key) for
+    // each entry, so a backward walk pays one forward parse per group
+    // instead of one per step.  The entire group is cached -- and the
+    // cache is never trimmed -- so re-entering the group from a deeper
+    // position (Seek then Prev, or Next past a cached point) finds its
+    // predecessor too.
+    if (prev_cache_restart_ != restart_index_) {
+      prev_cache_restart_ = restart_index_;
+      prev_cache_.clear();
+      const uint32_t group_limit = (restart_index_ + 1 < num_restarts_)
+                                       ? GetRestartPoint(restart_index_ + 1)
+                                       : restarts_;
+      SeekToRestartPoint(restart_index_);
+      while (ParseNextKey() && current_ < group_limit) {
+        prev_cache_.emplace_back(current_, key_);
+      }
+      // The fill parse ran past the group's end; point back at the
+      // group we cached (and will position within below).
+      restart_index_ = prev_cache_restart_;
+    }
+    // Find the cached entry just before "original" without disturbing
+    // the cache.
+    size_t n = prev_cache_.size();
+    while (n > 0 && prev_cache_[n - 1].first >= original) {
+      n--;
+    }
+    if (n == 0) {
+      // No predecessor in this group (empty or short group); re-derive
+      // via reparse.
+      SeekToRestartPoint(restart_index_);
+      do {
+        // Loop until end of current entry hits the start of original entry
+      } while (ParseNextKey() && NextEntryOffset() < original);
+      return;
+    }
+    // Position directly on the cached predecessor.
+    current_ = prev_cache_[n - 1].first;
+    key_ = prev_cache_[n - 1].second;
+    const char* p = data_ + current_;
+    uint32_t shared, non_shared, value_length;
+    p = GetVarint32TriplePtr(p, data_ + restarts_, &shared, &non_shared,
+                             &value_length);
+    value_ = Slice(p + non_shared, value_length);
   }
 
   void Seek(const Slice& target) override {
@@ -184,6 +339,54 @@ class Block::Iter : public Iterator {
       }
     }
 
+    if (hash_buckets_ != nullptr) {
+      const Slice hashable = BlockHashableKey(comparator_, target);
+      const uint8_t bucket = static_cast<uint8_t>(
+          hash_buckets_[Hash(hashable.data(), hashable.size(),
+                             kBlockHashIndexSeed) %
+                        num_hash_buckets_]);
+      if (bucket != kBlockHashIndexNoEntry && bucket < num_restarts_) {
+        // The scan below is exact iff this restart's first key is
+        // <= target (everything before it is then < target); fall
+        // back to the binary search otherwise.
+        const uint32_t region_offset = GetRestartPoint(bucket);
+        uint32_t shared, non_shared, value_length;
+        const char* key_ptr =
+            DecodeEntry(data_ + region_offset, data_ + restarts_, &shared,
+                        &non_shared, &value_length);
+        if (key_ptr != nullptr && shared == 0 &&
+            Compare(Slice(key_ptr, non_shared), target) <= 0) {
+          SeekToRestartPoint(bucket);
+          while (true) {
+            if (!ParseNextKey()) {
+              return;
+            }
+            if (Compare(key_, target) >= 0) {
+              return;
+            }
+          }
+        }
+      }
+    }
+
+    uint32_t target_prefix;
+    if (restart_prefixes_ != nullptr &&
+        comparator_->OrderPreservingPrefix(target, &target_prefix)) {
+      // Narrow [left, right] to the run of restart keys whose prefix
+      // ties the target's; restarts outside it compare decisively.
+      const uint32_t lo =
+          PrefixLowerBound(restart_prefixes_, num_restarts_, target_prefix);
+      const uint32_t hi =
+          (target_prefix == 0xffffffffu)
+              ? num_restarts_
+              : PrefixLowerBound(restart_prefixes_, num_restarts_,
+                                 target_prefix + 1);
+      const uint32_t prefix_left = (lo > 0) ? lo - 1 : 0;
+      const uint32_t prefix_right = (hi > 0) ? hi - 1 : 0;
+      if (prefix_left > left) left = prefix_left;
+      if (prefix_right < right) right = prefix_right;
+    }
+
     while (left < right) {
       uint32_t mid = (left + right + 1) / 2;
       uint32_t region_offset = GetRestartPoint(mid);
@@ -285,7 +488,11 @@ Iterator* Block::NewIterator(const Comparator* comparator) {
   if (num_restarts == 0) {
     return NewEmptyIterator();
   } else {
-    return new Iter(comparator, data_, restart_offset_, num_restarts);
+    return new Iter(comparator, data_, restart_offset_, num_restarts,
+                    RestartPrefixes(comparator),
+                    num_hash_buckets_ != 0 ? data_ + hash_index_offset_
+                                           : nullptr,
+                    num_hash_buckets_);
   }
 }
 
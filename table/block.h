@@ -5,16 +5,34 @@
 #ifndef STORAGE_LEVELDB_TABLE_BLOCK_H_
 #define STORAGE_LEVELDB_TABLE_BLOCK_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 
 #include "leveldb/iterator.h"
+#include "leveldb/slice.h"
 
 namespace leveldb {
 
 struct BlockContents;
+class CacheAllocator;
 class Comparator;
 
+// Set in the on-disk num_restarts word when the block carries a hash
+// index (see Options::block_hash_index).  The index sits between the
+// restart array and the trailer:
+//     buckets: uint8[num_buckets]   (restart index, or 0xff for none)
+//     num_buckets: uint32
+//     num_restarts | kBlockHashIndexFlag: uint32
+static const uint32_t kBlockHashIndexFlag = 0x80000000u;
+static const uint8_t kBlockHashIndexNoEntry = 0xff;
+static const uint32_t kBlockHashIndexSeed = 0xbc9f1d34;
+
+// Portion of "key" hashed for the block hash index: internal-key
+// blocks exclude the sequence/type suffix so lookups at any snapshot
+// hash the same as the stored entries.
+Slice BlockHashableKey(const Comparator* comparator, const Slice& key);
+
 class Block {
  public:
   // Initialize the block with the specified contents.
@@ -33,10 +51,24 @@ class Block {
 
   uint32_t NumRestarts() const;
 
+  // Return the order-preserving prefixes of the restart-point keys
+  // (see Comparator::OrderPreservingPrefix), building them on first
+  // use, or nullptr if the comparator does not support prefixes.  The
+  // array lives as long as the block and is shared by its iterators.
+  const uint32_t* RestartPrefixes(const Comparator* comparator);
+
   const char* data_;
   size_t size_;
-  uint32_t restart_offset_;  // Offset in data_ of restart array
-  bool owned_;               // Block owns data_[]
+  size_t allocated_size_;            // Bytes to return to allocator_
+  CacheAllocator* const allocator_;  // Null for heap-owned data
+  uint32_t restart_offset_;     // Offset in data_ of restart array
+  uint32_t hash_index_offset_;  // Offset of hash buckets; 0 if absent
+  uint32_t num_hash_buckets_;   // 0 if no hash index
+  bool owned_;                  // Block owns data_[]
+
+  // Lazily built restart-key prefix array; see RestartPrefixes().
+  std::atomic<const uint32_t*> restart_prefixes_;
+  std::atomic<bool> prefixes_unsupported_;
 };
 
 }  // namespace leveldb
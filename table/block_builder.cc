@@ -33,12 +33,18 @@
 
 #include "leveldb/comparator.h"
 #include "leveldb/options.h"
+#include "table/block.h"
 #include "util/coding.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
 BlockBuilder::BlockBuilder(const Options* options)
-    : options_(options), restarts_(), counter_(0), finished_(false) {
+    : options_(options),
+      restarts_(),
+      hash_index_(options->block_hash_index),
+      counter_(0),
+      finished_(false) {
   assert(options->block_restart_interval >= 1);
   restarts_.push_back(0);  // First restart point is at offset 0
 }
@@ -47,6 +53,7 @@ void BlockBuilder::Reset() {
   buffer_.clear();
   restarts_.clear();
   restarts_.push_back(0);  // First restart point is at offset 0
+  hash_entries_.clear();
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
@@ -55,7 +62,9 @@ void BlockBuilder::Reset() {
 size_t BlockBuilder::CurrentSizeEstimate() const {
   return (buffer_.size() +                       // Raw data buffer
           restarts_.size() * sizeof(uint32_t) +  // Restart array
-          sizeof(uint32_t));                     // Restart array length
+          sizeof(uint32_t) +                     // Restart array length
+          (hash_index_ ? hash_entries_.size() + 2 * sizeof(uint32_t)
+                       : 0));                    // Hash index
 }
 
 Slice BlockBuilder::Finish() {
@@ -63,7 +72,26 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, restarts_.size());
+  if (hash_index_ && !hash_entries_.empty() &&
+      restarts_.size() < kBlockHashIndexNoEntry) {
+    // One bucket per entry keeps collisions (which only cost a longer
+    // linear scan) rare at about a byte of overhead per entry.
+    const uint32_t num_buckets = static_cast<uint32_t>(hash_entries_.size());
+    std::string buckets(num_buckets, static_cast<char>(kBlockHashIndexNoEntry));
+    for (size_t i = 0; i < hash_entries_.size(); i++) {
+      const uint32_t b = hash_entries_[i].first % num_buckets;
+      if (static_cast<uint8_t>(buckets[b]) == kBlockHashIndexNoEntry) {
+        // First writer wins, so a bucket always points at the earliest
+        // restart group of any key that hashes to it.
+        buckets[b] = static_cast<char>(hash_entries_[i].second);
+      }
+    }
+    buffer_.append(buckets);
+    PutFixed32(&buffer_, num_buckets);
+    PutFixed32(&buffer_, restarts_.size() | kBlockHashIndexFlag);
+  } else {
+    PutFixed32(&buffer_, restarts_.size());
+  }
   finished_ = true;
   return Slice(buffer_);
 }
@@ -88,6 +116,13 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
+  if (hash_index_) {
+    const Slice hashable = BlockHashableKey(options_->comparator, key);
+    hash_entries_.push_back(std::make_pair(
+        Hash(hashable.data(), hashable.size(), kBlockHashIndexSeed),
+        static_cast<uint32_t>(restarts_.size() - 1)));
+  }
+
   // Add "<shared><non_shared><value_size>" to buffer_
   PutVarint32(&buffer_, shared);
   PutVarint32(&buffer_, non_shared);
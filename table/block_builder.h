@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_TABLE_BLOCK_BUILDER_H_
 
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "leveldb/slice.h"
@@ -44,8 +45,12 @@ class BlockBuilder {
   const Options* options_;
   std::string buffer_;              // Destination buffer
   std::vector<uint32_t> restarts_;  // Restart points
-  int counter_;                     // Number of entries emitted since restart
-  bool finished_;                   // Has Finish() been called?
+  // Hash of each added key paired with the restart group of its first
+  // entry; used to build the optional block hash index.
+  std::vector<std::pair<uint32_t, uint32_t>> hash_entries_;
+  bool hash_index_;  // Build a hash index for this block?
+  int counter_;      // Number of entries emitted since restart
+  bool finished_;    // Has Finish() been called?
   std::string last_key_;
 };
 
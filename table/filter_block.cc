@@ -11,15 +11,12 @@ namespace leveldb {
 
 // See doc/table_format.md for an explanation of the filter block format.
 
-// Generate new filter every 2KB of data
-static const size_t kFilterBaseLg = 11;
-static const size_t kFilterBase = 1 << kFilterBaseLg;
-
-FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy)
-    : policy_(policy) {}
+FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy,
+                                       size_t base_lg)
+    : policy_(policy), base_lg_(base_lg) {}
 
 void FilterBlockBuilder::StartBlock(uint64_t block_offset) {
-  uint64_t filter_index = (block_offset / kFilterBase);
+  uint64_t filter_index = (block_offset >> base_lg_);
   assert(filter_index >= filter_offsets_.size());
   while (filter_index > filter_offsets_.size()) {
     GenerateFilter();
@@ -44,7 +41,8 @@ Slice FilterBlockBuilder::Finish() {
   }
 
   PutFixed32(&result_, array_offset);
-  result_.push_back(kFilterBaseLg);  // Save encoding parameter in result
+  result_.push_back(
+      static_cast<char>(base_lg_));  // Save encoding parameter in result
   return Slice(result_);
 }
 
@@ -21,6 +21,13 @@ namespace leveldb {
 
 class FilterPolicy;
 
+// A new filter is generated every (1 << base_lg) bytes of data-block
+// offset (see doc/table_format.md).  kDefaultFilterBaseLg yields one
+// filter per 2KB of data; kWholeFileFilterBaseLg exceeds the maximum
+// table file size so that a single filter covers every key in the file.
+static const size_t kDefaultFilterBaseLg = 11;
+static const size_t kWholeFileFilterBaseLg = 30;
+
 // A FilterBlockBuilder is used to construct all of the filters for a
 // particular Table.  It generates a single string which is stored as
 // a special block in the Table.
@@ -29,7 +36,8 @@ class FilterPolicy;
 //      (StartBlock AddKey*)* Finish
 class FilterBlockBuilder {
  public:
-  explicit FilterBlockBuilder(const FilterPolicy*);
+  explicit FilterBlockBuilder(const FilterPolicy*,
+                              size_t base_lg = kDefaultFilterBaseLg);
 
   FilterBlockBuilder(const FilterBlockBuilder&) = delete;
   FilterBlockBuilder& operator=(const FilterBlockBuilder&) = delete;
@@ -38,10 +46,15 @@ class FilterBlockBuilder {
   void AddKey(const Slice& key);
   Slice Finish();
 
+  // Bytes the filter block would currently occupy; used to decide
+  // partition cuts.
+  size_t CurrentSizeEstimate() const { return result_.size() + keys_.size(); }
+
  private:
   void GenerateFilter();
 
   const FilterPolicy* policy_;
+  const size_t base_lg_;         // Encoding parameter written to the block
   std::string keys_;             // Flattened key contents
   std::vector<size_t> start_;    // Starting index in keys_ of each key
   std::string result_;           // Filter data computed so far
@@ -60,7 +73,7 @@ class FilterBlockReader {
   const char* data_;    // Pointer to filter data (at block-start)
   const char* offset_;  // Pointer to beginning of offset array (at block-end)
   size_t num_;          // Number of entries in offset array
-  size_t base_lg_;      // Encoding parameter (see kFilterBaseLg in .cc file)
+  size_t base_lg_;      // Encoding parameter (see kDefaultFilterBaseLg above)
 };
 
 }  // namespace leveldb
@@ -119,4 +119,25 @@ TEST_F(FilterBlockTest, MultiChunk) {
   ASSERT_TRUE(!reader.KeyMayMatch(9000, "bar"));
 }
 
+TEST_F(FilterBlockTest, WholeFileFilter) {
+  FilterBlockBuilder builder(&policy_, kWholeFileFilterBaseLg);
+
+  // Keys added at widely separated block offsets all land in one filter.
+  builder.StartBlock(0);
+  builder.AddKey("foo");
+  builder.StartBlock(5000);
+  builder.AddKey("bar");
+  builder.StartBlock(900000);
+  builder.AddKey("box");
+
+  Slice block = builder.Finish();
+  FilterBlockReader reader(&policy_, block);
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
+  ASSERT_TRUE(reader.KeyMayMatch(5000, "bar"));
+  ASSERT_TRUE(reader.KeyMayMatch(900000, "box"));
+  ASSERT_TRUE(reader.KeyMayMatch(900000, "foo"));
+  ASSERT_TRUE(!reader.KeyMayMatch(0, "missing"));
+  ASSERT_TRUE(!reader.KeyMayMatch(900000, "other"));
+}
+
 }  // namespace leveldb
@@ -4,12 +4,17 @@
 
 #include "table/format.h"
 
+#include <cstring>
+
+#include "leveldb/cache.h"
 #include "leveldb/env.h"
 #include "leveldb/options.h"
+#include "leveldb/perf_context.h"
 #include "port/port.h"
 #include "table/block.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
@@ -33,7 +38,10 @@ void Footer::EncodeTo(std::string* dst) const {
   const size_t original_size = dst->size();
   metaindex_handle_.EncodeTo(dst);
   index_handle_.EncodeTo(dst);
-  dst->resize(2 * BlockHandle::kMaxEncodedLength);  // Padding
+  dst->resize(original_size + 2 * BlockHandle::kMaxEncodedLength);  // Padding
+  // The checksum type rides in the last padding byte; zero (the old
+  // padding value) decodes as kCRC32c.
+  (*dst)[dst->size() - 1] = static_cast<char>(checksum_type_);
   PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber & 0xffffffffu));
   PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber >> 32));
   assert(dst->size() == original_size + kEncodedLength);
@@ -54,6 +62,8 @@ Status Footer::DecodeFrom(Slice* input) {
     return Status::Corruption("not an sstable (bad magic number)");
   }
 
+  checksum_type_ = static_cast<uint8_t>(magic_ptr[-1]);
+
   Status result = metaindex_handle_.DecodeFrom(input);
   if (result.ok()) {
     result = index_handle_.DecodeFrom(input);
@@ -66,99 +76,252 @@ Status Footer::DecodeFrom(Slice* input) {
   return result;
 }
 
-Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
-                 const BlockHandle& handle, BlockContents* result) {
+static char* AllocateBuffer(CacheAllocator* allocator, size_t n) {
+  return allocator != nullptr ? static_cast<char*>(allocator->Allocate(n))
+                              : new char[n];
+}
+
+static void FreeBuffer(CacheAllocator* allocator, const char* ptr, size_t n) {
+  if (allocator != nullptr) {
+    allocator->Deallocate(const_cast<char*>(ptr), n);
+  } else {
+    delete[] ptr;
+  }
+}
+
+Status ReadRawBlock(RandomAccessFile* file, const ReadOptions& options,
+                    const BlockHandle& handle, BlockContents* result,
+                    char* type, uint8_t checksum_type,
+                    CacheAllocator* allocator) {
   result->data = Slice();
   result->cachable = false;
   result->heap_allocated = false;
+  result->allocator = allocator;
 
   // Read the block contents as well as the type/crc footer.
   // See table_builder.cc for the code that built this structure.
   size_t n = static_cast<size_t>(handle.size());
-  char* buf = new char[n + kBlockTrailerSize];
+  char* buf = AllocateBuffer(allocator, n + kBlockTrailerSize);
   Slice contents;
   Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
+  PerfContext* const perf_context = GetPerfContext();
+  perf_context->block_reads++;
+  perf_context->block_read_bytes += n + kBlockTrailerSize;
   if (!s.ok()) {
-    delete[] buf;
+    FreeBuffer(allocator, buf, n + kBlockTrailerSize);
     return s;
   }
   if (contents.size() != n + kBlockTrailerSize) {
-    delete[] buf;
+    FreeBuffer(allocator, buf, n + kBlockTrailerSize);
     return Status::Corruption("truncated block read");
   }
 
-  // Check the crc of the type and the block contents
+  // Check the checksum of the type and the block contents
   const char* data = contents.data();  // Pointer to where Read put the data
   if (options.verify_checksums) {
-    const uint32_t crc = crc32c::Unmask(DecodeFixed32(data + n + 1));
-    const uint32_t actual = crc32c::Value(data, n + 1);
-    if (actual != crc) {
-      delete[] buf;
+    const uint32_t stored = DecodeFixed32(data + n + 1);
+    bool match;
+    if (checksum_type == kXXH64) {
+      match = (stored == static_cast<uint32_t>(XXHash64(data, n + 1, 0)));
+    } else {
+      match = (crc32c::Unmask(stored) == crc32c::Value(data, n + 1));
+    }
+    if (!match) {
+      FreeBuffer(allocator, buf, n + kBlockTrailerSize);
       s = Status::Corruption("block checksum mismatch");
       return s;
     }
   }
 
-  switch (data[n]) {
-    case kNoCompression:
-      if (data != buf) {
-        // File implementation gave us pointer to some other data.
-        // Use it directly under the assumption that it will be live
-        // while the file is open.
-        delete[] buf;
-        result->data = Slice(data, n);
-        result->heap_allocated = false;
-        result->cachable = false;  // Do not double-cache
-      } else {
-        result->data = Slice(buf, n);
-        result->heap_allocated = true;
-        result->cachable = true;
-      }
+  *type = data[n];
+  if (data != buf) {
+    // File implementation gave us pointer to some other data.
+    // Use it directly under the assumption that it will be live
+    // while the file is open.
+    FreeBuffer(allocator, buf, n + kBlockTrailerSize);
+    result->data = Slice(data, n);
+    result->heap_allocated = false;
+    result->cachable = false;  // Do not double-cache
+  } else {
+    result->data = Slice(buf, n);
+    result->heap_allocated = true;
+    result->cachable = true;
+    result->allocated_size = n + kBlockTrailerSize;
+  }
+  return Status::OK();
+}
 
-      // Ok
-      break;
+Status DecodeBlock(const Slice& raw, char type, BlockContents* result,
+                   CacheAllocator* allocator) {
+  result->allocator = allocator;
+  switch (type) {
     case kSnappyCompression: {
       size_t ulength = 0;
-      if (!port::Snappy_GetUncompressedLength(data, n, &ulength)) {
-        delete[] buf;
+      if (!port::Snappy_GetUncompressedLength(raw.data(), raw.size(),
+                                              &ulength)) {
         return Status::Corruption("corrupted snappy compressed block length");
       }
-      char* ubuf = new char[ulength];
-      if (!port::Snappy_Uncompress(data, n, ubuf)) {
-        delete[] buf;
-        delete[] ubuf;
+      char* ubuf = AllocateBuffer(allocator, ulength);
+      if (!port::Snappy_Uncompress(raw.data(), raw.size(), ubuf)) {
+        FreeBuffer(allocator, ubuf, ulength);
         return Status::Corruption("corrupted snappy compressed block contents");
       }
-      delete[] buf;
       result->data = Slice(ubuf, ulength);
       result->heap_allocated = true;
       result->cachable = true;
+      result->allocated_size = ulength;
+      break;
+    }
+    case kLZ4Compression: {
+      size_t ulength = 0;
+      if (!port::Lz4_GetUncompressedLength(raw.data(), raw.size(),
+                                           &ulength)) {
+        return Status::Corruption("corrupted lz4 compressed block length");
+      }
+      char* ubuf = AllocateBuffer(allocator, ulength);
+      if (!port::Lz4_Uncompress(raw.data(), raw.size(), ubuf)) {
+        FreeBuffer(allocator, ubuf, ulength);
+        return Status::Corruption("corrupted lz4 compressed block contents");
+      }
+      result->data = Slice(ubuf, ulength);
+      result->heap_allocated = true;
+      result->cachable = true;
+      result->allocated_size = ulength;
       break;
     }
     case kZstdCompression: {
       size_t ulength = 0;
-      if (!port::Zstd_GetUncompressedLength(data, n, &ulength)) {
-        delete[] buf;
+      if (!port::Zstd_GetUncompressedLength(raw.data(), raw.size(),
+                                            &ulength)) {
         return Status::Corruption("corrupted zstd compressed block length");
       }
-      char* ubuf = new char[ulength];
-      if (!port::Zstd_Uncompress(data, n, ubuf)) {
-        delete[] buf;
-        delete[] ubuf;
+      char* ubuf = AllocateBuffer(allocator, ulength);
+      if (!port::Zstd_Uncompress(raw.data(), raw.size(), ubuf)) {
+        FreeBuffer(allocator, ubuf, ulength);
         return Status::Corruption("corrupted zstd compressed block contents");
       }
-      delete[] buf;
       result->data = Slice(ubuf, ulength);
       result->heap_allocated = true;
       result->cachable = true;
+      result->allocated_size = ulength;
       break;
     }
     default:
-      delete[] buf;
       return Status::Corruption("bad block type");
   }
-
   return Status::OK();
 }
 
+namespace {
+
+// Reusable per-thread buffer for the transient on-disk bytes of a
+// block read, so a cache miss costs one allocation (the decompressed
+// output, possibly cache-owned) instead of two.  Oversized requests
+// fall back to the allocating path rather than pinning huge buffers
+// in every thread.
+struct ReadScratch {
+  char* ptr = nullptr;
+  size_t size = 0;
+  ~ReadScratch() { delete[] ptr; }
+
+  static constexpr size_t kMaxScratch = 4 * 1024 * 1024;
+
+  char* Get(size_t n) {
+    if (n > kMaxScratch) {
+      return nullptr;
+    }
+    if (size < n) {
+      delete[] ptr;
+      size = (n + 4095) & ~static_cast<size_t>(4095);
+      ptr = new char[size];
+    }
+    return ptr;
+  }
+};
+
+char* GetReadScratch(size_t n) {
+  static thread_local ReadScratch scratch;
+  return scratch.Get(n);
+}
+
+}  // namespace
+
+Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
+                 const BlockHandle& handle, BlockContents* result,
+                 uint8_t checksum_type, CacheAllocator* allocator) {
+  const size_t n = static_cast<size_t>(handle.size());
+  char* scratch = GetReadScratch(n + kBlockTrailerSize);
+  if (scratch == nullptr) {
+    // Block too large for the per-thread scratch; take the allocating
+    // path.
+    char type;
+    BlockContents raw;
+    Status s = ReadRawBlock(file, options, handle, &raw, &type, checksum_type,
+                            allocator);
+    if (!s.ok()) {
+      return s;
+    }
+    if (type == kNoCompression) {
+      *result = raw;
+      return Status::OK();
+    }
+    s = DecodeBlock(raw.data, type, result, allocator);
+    if (raw.heap_allocated) {
+      FreeBuffer(allocator, raw.data.data(), raw.allocated_size);
+    }
+    return s;
+  }
+
+  Slice contents;
+  Status s =
+      file->Read(handle.offset(), n + kBlockTrailerSize, &contents, scratch);
+  PerfContext* const perf_context = GetPerfContext();
+  perf_context->block_reads++;
+  perf_context->block_read_bytes += n + kBlockTrailerSize;
+  if (!s.ok()) {
+    return s;
+  }
+  if (contents.size() != n + kBlockTrailerSize) {
+    return Status::Corruption("truncated block read");
+  }
+
+  const char* data = contents.data();
+  if (options.verify_checksums) {
+    const uint32_t stored = DecodeFixed32(data + n + 1);
+    bool match;
+    if (checksum_type == kXXH64) {
+      match = (stored == static_cast<uint32_t>(XXHash64(data, n + 1, 0)));
+    } else {
+      match = (crc32c::Unmask(stored) == crc32c::Value(data, n + 1));
+    }
+    if (!match) {
+      return Status::Corruption("block checksum mismatch");
+    }
+  }
+
+  const char type = data[n];
+  if (type == kNoCompression) {
+    if (data != scratch) {
+      // Memory-mapped file: use the mapping directly, as before.
+      result->data = Slice(data, n);
+      result->heap_allocated = false;
+      result->cachable = false;  // Do not double-cache
+      result->allocator = allocator;
+      result->allocated_size = 0;
+      return Status::OK();
+    }
+    // The stable copy is the only allocation for this miss.
+    char* buf = AllocateBuffer(allocator, n);
+    std::memcpy(buf, data, n);
+    result->data = Slice(buf, n);
+    result->heap_allocated = true;
+    result->cachable = true;
+    result->allocator = allocator;
+    result->allocated_size = n;
+    return Status::OK();
+  }
+  // Decompress straight from the scratch into the output buffer.
+  return DecodeBlock(Slice(data, n), type, result, allocator);
+}
+
 }  // namespace leveldb
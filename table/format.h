@@ -47,6 +47,12 @@ class BlockHandle {
 // end of every table file.
 class Footer {
  public:
+  // Checksum type protecting this table's blocks (a ChecksumType
+  // value).  Stored in a previously zero padding byte, so old tables
+  // read as kCRC32c and old readers ignore it.
+  uint8_t checksum_type() const { return checksum_type_; }
+  void set_checksum_type(uint8_t t) { checksum_type_ = t; }
+
   // Encoded length of a Footer.  Note that the serialization of a
   // Footer will always occupy exactly this many bytes.  It consists
   // of two block handles and a magic number.
@@ -68,6 +74,7 @@ class Footer {
  private:
   BlockHandle metaindex_handle_;
   BlockHandle index_handle_;
+  uint8_t checksum_type_ = 0;  // kCRC32c
 };
 
 // kTableMagicNumber was picked by running
@@ -78,16 +85,41 @@ static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
 // 1-byte type + 32-bit crc
 static const size_t kBlockTrailerSize = 5;
 
+class CacheAllocator;
+
 struct BlockContents {
   Slice data;           // Actual contents of data
   bool cachable;        // True iff data can be cached
   bool heap_allocated;  // True iff caller should delete[] data.data()
+  // When non-null and heap_allocated, data.data() came from this
+  // allocator and must be returned to it, quoting allocated_size
+  // (which may exceed data.size(), e.g. by the block trailer).
+  CacheAllocator* allocator = nullptr;
+  size_t allocated_size = 0;
 };
 
 // Read the block identified by "handle" from "file".  On failure
 // return non-OK.  On success fill *result and return OK.
 Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
-                 const BlockHandle& handle, BlockContents* result);
+                 const BlockHandle& handle, BlockContents* result,
+                 uint8_t checksum_type = 0,
+                 CacheAllocator* allocator = nullptr);
+
+// Read the block identified by "handle" from "file" without
+// decompressing it.  On success fills *result with the verbatim stored
+// bytes (checksum verified if requested) and *type with the
+// CompressionType byte from the block trailer.
+// "checksum_type" is the table's ChecksumType (from its footer).
+Status ReadRawBlock(RandomAccessFile* file, const ReadOptions& options,
+                    const BlockHandle& handle, BlockContents* result,
+                    char* type, uint8_t checksum_type = 0,
+                    CacheAllocator* allocator = nullptr);
+
+// Decompress a raw block read by ReadRawBlock().  "type" must be one
+// of the compressed CompressionType values; the caller retains
+// ownership of "raw".
+Status DecodeBlock(const Slice& raw, char type, BlockContents* result,
+                   CacheAllocator* allocator = nullptr);
 
 // Implementation details follow.  Clients should ignore,
 
@@ -4,9 +4,12 @@
 
 #include "table/merger.h"
 
+#include <vector>
+
 #include "leveldb/comparator.h"
 #include "leveldb/iterator.h"
 #include "table/iterator_wrapper.h"
+#include "util/object_pool.h"
 
 namespace leveldb {
 
@@ -18,6 +21,8 @@ class MergingIterator : public Iterator {
         children_(new IteratorWrapper[n]),
         n_(n),
         current_(nullptr),
+        winner_(-1),
+        tree_(n, -1),
         direction_(kForward) {
     for (int i = 0; i < n; i++) {
       children_[i].Set(children[i]);
@@ -26,6 +31,11 @@ class MergingIterator : public Iterator {
 
   ~MergingIterator() override { delete[] children_; }
 
+  static void* operator new(size_t size) { return PooledAllocate(size); }
+  static void operator delete(void* ptr, size_t size) {
+    PooledFree(ptr, size);
+  }
+
   bool Valid() const override { return (current_ != nullptr); }
 
   void SeekToFirst() override {
@@ -72,10 +82,18 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kForward;
+      current_->Next();
+      FindSmallest();
+      return;
     }
 
+    // Only the winner moved; replaying its path through the loser
+    // tree costs O(log n) comparisons instead of a full scan.
     current_->Next();
-    FindSmallest();
+    Replay(winner_);
+    current_ = (winner_ >= 0 && children_[winner_].Valid())
+                   ? &children_[winner_]
+                   : nullptr;
   }
 
   void Prev() override {
@@ -135,29 +153,65 @@ class MergingIterator : public Iterator {
   void FindSmallest();
   void FindLargest();
 
-  // We might want to use a heap in case there are lots of children.
-  // For now we use a simple array since we expect a very small number
-  // of children in leveldb.
+  // Returns true iff child "a" should win a tournament match against
+  // child "b": its key is smaller, with ties (and double-invalid
+  // matches) broken towards the lower index so the newest source wins.
+  bool Beats(int a, int b) const {
+    const bool a_valid = children_[a].Valid();
+    const bool b_valid = children_[b].Valid();
+    if (!b_valid) return true;
+    if (!a_valid) return false;
+    const int c = comparator_->Compare(children_[a].key(), children_[b].key());
+    if (c != 0) return c < 0;
+    return a < b;
+  }
+
+  // Rebuild the loser tree over all children; internal node "node" has
+  // children 2*node and 2*node+1, and leaf i lives at node n_ + i.
+  // Returns the winning child of the subtree.
+  int Build(int node) {
+    if (node >= n_) {
+      return node - n_;
+    }
+    const int left = Build(2 * node);
+    const int right = Build(2 * node + 1);
+    if (Beats(left, right)) {
+      tree_[node] = right;
+      return left;
+    }
+    tree_[node] = left;
+    return right;
+  }
+
+  // Replay the matches on leaf i's path to the root after its key
+  // changed.
+  void Replay(int i) {
+    int w = i;
+    for (int node = (i + n_) / 2; node >= 1; node /= 2) {
+      if (Beats(tree_[node], w)) {
+        const int loser = w;
+        w = tree_[node];
+        tree_[node] = loser;
+      }
+    }
+    winner_ = w;
+  }
+
+  // We use a tournament (loser) tree in the forward direction so that
+  // advancing costs O(log n) comparisons; reverse iteration is rare
+  // and keeps the simple linear scan.
   const Comparator* comparator_;
   IteratorWrapper* children_;
   int n_;
   IteratorWrapper* current_;
+  int winner_;             // Child index of the tree's winner, or -1
+  std::vector<int> tree_;  // tree_[1..n_-1] hold match losers
   Direction direction_;
 };
 
 void MergingIterator::FindSmallest() {
-  IteratorWrapper* smallest = nullptr;
-  for (int i = 0; i < n_; i++) {
-    IteratorWrapper* child = &children_[i];
-    if (child->Valid()) {
-      if (smallest == nullptr) {
-        smallest = child;
-      } else if (comparator_->Compare(child->key(), smallest->key()) < 0) {
-        smallest = child;
-      }
-    }
-  }
-  current_ = smallest;
+  winner_ = Build(1);
+  current_ = children_[winner_].Valid() ? &children_[winner_] : nullptr;
 }
 
 void MergingIterator::FindLargest() {
@@ -4,14 +4,21 @@
 
 #include "leveldb/table.h"
 
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <set>
+
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/perf_context.h"
 #include "table/block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
+#include "util/mutexlock.h"
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
 
@@ -22,8 +29,21 @@ struct Table::Rep {
     delete filter;
     delete[] filter_data;
     delete index_block;
+    delete filter_index;
+    for (std::map<uint64_t, LoadedFilterPartition>::iterator it =
+             filter_partitions.begin();
+         it != filter_partitions.end(); ++it) {
+      delete it->second.reader;
+      delete[] it->second.data;
+    }
   }
 
+  // A lazily-loaded filter partition (Options::filter_partition_size).
+  struct LoadedFilterPartition {
+    FilterBlockReader* reader;
+    const char* data;  // Owned when non-null
+  };
+
   Options options;
   Status status;
   RandomAccessFile* file;
@@ -33,6 +53,16 @@ struct Table::Rep {
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
   Block* index_block;
+  TableProperties properties;
+  // Index over filter partitions (null for monolithic filters), and
+  // the partitions loaded so far, keyed by partition handle offset.
+  Block* filter_index = nullptr;
+  port::Mutex filter_mutex;
+  std::map<uint64_t, LoadedFilterPartition> filter_partitions;
+  uint8_t checksum_type;  // ChecksumType from the footer
+  // True if index_block is a top-level index over partition blocks
+  // (see Options::index_partition_size).
+  bool index_partitioned;
 };
 
 Status Table::Open(const Options& options, RandomAccessFile* file,
@@ -58,7 +88,8 @@ Status Table::Open(const Options& options, RandomAccessFile* file,
   if (options.paranoid_checks) {
     opt.verify_checksums = true;
   }
-  s = ReadBlock(file, opt, footer.index_handle(), &index_block_contents);
+  s = ReadBlock(file, opt, footer.index_handle(), &index_block_contents,
+                footer.checksum_type());
 
   if (s.ok()) {
     // We've successfully read the footer and the index block: we're
@@ -72,6 +103,8 @@ Status Table::Open(const Options& options, RandomAccessFile* file,
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
     rep->filter_data = nullptr;
     rep->filter = nullptr;
+    rep->index_partitioned = false;
+    rep->checksum_type = footer.checksum_type();
     *table = new Table(rep);
     (*table)->ReadMeta(footer);
   }
@@ -80,10 +113,6 @@ Status Table::Open(const Options& options, RandomAccessFile* file,
 }
 
 void Table::ReadMeta(const Footer& footer) {
-  if (rep_->options.filter_policy == nullptr) {
-    return;  // Do not need any metadata
-  }
-
   // TODO(sanjay): Skip this if footer.metaindex_handle() size indicates
   // it is an empty block.
   ReadOptions opt;
@@ -91,23 +120,174 @@ void Table::ReadMeta(const Footer& footer) {
     opt.verify_checksums = true;
   }
   BlockContents contents;
-  if (!ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents).ok()) {
+  if (!ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents,
+                 rep_->checksum_type)
+           .ok()) {
     // Do not propagate errors since meta info is not needed for operation
     return;
   }
   Block* meta = new Block(contents);
 
-  Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
-  key.append(rep_->options.filter_policy->Name());
-  iter->Seek(key);
-  if (iter->Valid() && iter->key() == Slice(key)) {
-    ReadFilter(iter->value());
+  if (rep_->options.filter_policy != nullptr) {
+    Iterator* iter = meta->NewIterator(BytewiseComparator());
+    std::string key = "filter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    if (iter->Valid() && iter->key() == Slice(key)) {
+      ReadFilter(iter->value());
+    } else {
+      // Partitioned filter: load only the small partition index now;
+      // partitions are fetched on first probe.
+      std::string index_key = "filterindex.";
+      index_key.append(rep_->options.filter_policy->Name());
+      iter->Seek(index_key);
+      if (iter->Valid() && iter->key() == Slice(index_key)) {
+        Slice v = iter->value();
+        BlockHandle handle;
+        ReadOptions opt;
+        if (rep_->options.paranoid_checks) {
+          opt.verify_checksums = true;
+        }
+        BlockContents contents;
+        if (handle.DecodeFrom(&v).ok() &&
+            ReadBlock(rep_->file, opt, handle, &contents,
+                      rep_->checksum_type)
+                .ok()) {
+          rep_->filter_index = new Block(contents);
+        }
+      }
+    }
+    delete iter;
+  }
+  {
+    Iterator* iter = meta->NewIterator(BytewiseComparator());
+    iter->Seek("leveldb.index-partitions");
+    if (iter->Valid() && iter->key() == Slice("leveldb.index-partitions")) {
+      rep_->index_partitioned = true;
+    }
+    iter->Seek("leveldb.properties");
+    if (iter->Valid() && iter->key() == Slice("leveldb.properties")) {
+      ReadProperties(iter->value());
+    }
+    delete iter;
   }
-  delete iter;
   delete meta;
 }
 
+void Table::ReadProperties(const Slice& handle_value) {
+  Slice v = handle_value;
+  BlockHandle handle;
+  if (!handle.DecodeFrom(&v).ok()) {
+    return;
+  }
+  ReadOptions opt;
+  if (rep_->options.paranoid_checks) {
+    opt.verify_checksums = true;
+  }
+  BlockContents contents;
+  if (!ReadBlock(rep_->file, opt, handle, &contents, rep_->checksum_type)
+           .ok()) {
+    return;
+  }
+  Block* properties = new Block(contents);
+  Iterator* iter = properties->NewIterator(BytewiseComparator());
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    Slice value = iter->value();
+    uint64_t number = 0;
+    if (!GetVarint64(&value, &number)) {
+      continue;
+    }
+    if (iter->key() == Slice("leveldb.num.entries")) {
+      rep_->properties.num_entries = number;
+    } else if (iter->key() == Slice("leveldb.num.deletions")) {
+      rep_->properties.num_deletions = number;
+    } else if (iter->key() == Slice("leveldb.raw.key.bytes")) {
+      rep_->properties.raw_key_bytes = number;
+    } else if (iter->key() == Slice("leveldb.raw.value.bytes")) {
+      rep_->properties.raw_value_bytes = number;
+    } else if (iter->key() == Slice("leveldb.block.size")) {
+      rep_->properties.block_size = number;
+    }
+  }
+  delete iter;
+  delete properties;
+}
+
+// Consult the table's filter (monolithic or partitioned) for whether
+// the data block at "block_offset" may contain "key".  Returns true
+// when there is no usable filter.
+bool Table::KeyMayMatchFilter(uint64_t block_offset, const Slice& key) const {
+  if (rep_->filter != nullptr) {
+    return rep_->filter->KeyMayMatch(block_offset, key);
+  }
+  if (rep_->filter_index == nullptr) {
+    return true;
+  }
+
+  // Find the partition covering this block offset.
+  char seek_key[8];
+  EncodeFixed64BE(seek_key, block_offset);
+  Iterator* iter = rep_->filter_index->NewIterator(BytewiseComparator());
+  iter->Seek(Slice(seek_key, sizeof(seek_key)));
+  if (!iter->Valid()) {
+    delete iter;
+    return true;
+  }
+  Slice value = iter->value();
+  BlockHandle handle;
+  uint64_t base_offset = 0;
+  const bool parsed =
+      handle.DecodeFrom(&value).ok() && GetVarint64(&value, &base_offset);
+  delete iter;
+  if (!parsed) {
+    return true;
+  }
+
+  FilterBlockReader* reader = nullptr;
+  {
+    MutexLock l(&rep_->filter_mutex);
+    std::map<uint64_t, Rep::LoadedFilterPartition>::iterator it =
+        rep_->filter_partitions.find(handle.offset());
+    if (it != rep_->filter_partitions.end()) {
+      reader = it->second.reader;
+    }
+  }
+  if (reader == nullptr) {
+    ReadOptions opt;
+    if (rep_->options.paranoid_checks) {
+      opt.verify_checksums = true;
+    }
+    BlockContents block;
+    if (!ReadBlock(rep_->file, opt, handle, &block, rep_->checksum_type)
+             .ok()) {
+      return true;
+    }
+    Rep::LoadedFilterPartition partition;
+    partition.data = block.heap_allocated ? block.data.data() : nullptr;
+    partition.reader =
+        new FilterBlockReader(rep_->options.filter_policy, block.data);
+    MutexLock l(&rep_->filter_mutex);
+    std::map<uint64_t, Rep::LoadedFilterPartition>::iterator it =
+        rep_->filter_partitions.find(handle.offset());
+    if (it != rep_->filter_partitions.end()) {
+      // Another probe loaded it concurrently.
+      delete partition.reader;
+      delete[] partition.data;
+      reader = it->second.reader;
+    } else {
+      rep_->filter_partitions[handle.offset()] = partition;
+      reader = partition.reader;
+    }
+  }
+  return reader->KeyMayMatch(block_offset - base_offset, key);
+}
+
+const TableProperties& Table::GetProperties() const {
+  return rep_->properties;
+}
+
+uint64_t Table::CacheId() const { return rep_->cache_id; }
+
 void Table::ReadFilter(const Slice& filter_handle_value) {
   Slice v = filter_handle_value;
   BlockHandle filter_handle;
@@ -122,7 +302,9 @@ void Table::ReadFilter(const Slice& filter_handle_value) {
     opt.verify_checksums = true;
   }
   BlockContents block;
-  if (!ReadBlock(rep_->file, opt, filter_handle, &block).ok()) {
+  if (!ReadBlock(rep_->file, opt, filter_handle, &block,
+                 rep_->checksum_type)
+           .ok()) {
     return;
   }
   if (block.heap_allocated) {
@@ -137,6 +319,10 @@ static void DeleteBlock(void* arg, void* ignored) {
   delete reinterpret_cast<Block*>(arg);
 }
 
+static void DeleteCachedCompressedBlock(const Slice& key, void* value) {
+  delete reinterpret_cast<std::string*>(value);
+}
+
 static void DeleteCachedBlock(const Slice& key, void* value) {
   Block* block = reinterpret_cast<Block*>(value);
   delete block;
@@ -148,6 +334,56 @@ static void ReleaseBlock(void* arg, void* h) {
   cache->Release(handle);
 }
 
+// Coordination for concurrent cache misses on the same block: the
+// first thread to miss loads it, later threads wait and then re-probe
+// the cache instead of each reading and decompressing the same bytes.
+// Striped by block key hash; a collision merely serializes two
+// unrelated loads.
+namespace {
+
+struct BlockLoadStripe {
+  port::Mutex mu;
+  port::CondVar cv;
+  std::set<uint64_t> in_flight;
+  BlockLoadStripe() : cv(&mu) {}
+};
+
+constexpr int kBlockLoadStripes = 64;
+
+BlockLoadStripe* GetBlockLoadStripe(uint64_t key) {
+  static BlockLoadStripe stripes[kBlockLoadStripes];
+  return &stripes[key % kBlockLoadStripes];
+}
+
+// Claims the load of "key" in the constructor (waiting out any load
+// already in flight) and releases it in the destructor.
+class BlockLoadGuard {
+ public:
+  explicit BlockLoadGuard(uint64_t key)
+      : stripe_(GetBlockLoadStripe(key)), key_(key) {
+    MutexLock l(&stripe_->mu);
+    while (stripe_->in_flight.count(key_) != 0) {
+      stripe_->cv.Wait();
+    }
+    stripe_->in_flight.insert(key_);
+  }
+
+  ~BlockLoadGuard() {
+    MutexLock l(&stripe_->mu);
+    stripe_->in_flight.erase(key_);
+    stripe_->cv.SignalAll();
+  }
+
+  BlockLoadGuard(const BlockLoadGuard&) = delete;
+  BlockLoadGuard& operator=(const BlockLoadGuard&) = delete;
+
+ private:
+  BlockLoadStripe* const stripe_;
+  const uint64_t key_;
+};
+
+}  // namespace
+
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
 Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
@@ -156,6 +392,7 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
   Cache* block_cache = table->rep_->options.block_cache;
   Block* block = nullptr;
   Cache::Handle* cache_handle = nullptr;
+  std::unique_ptr<BlockLoadGuard> load_guard;
 
   BlockHandle handle;
   Slice input = index_value;
@@ -171,20 +408,88 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
       EncodeFixed64(cache_key_buffer + 8, handle.offset());
       Slice key(cache_key_buffer, sizeof(cache_key_buffer));
       cache_handle = block_cache->Lookup(key);
+      if (cache_handle == nullptr) {
+        // Miss: claim the load, then re-probe -- if another thread
+        // loaded the block while we waited for the claim, use its copy.
+        load_guard.reset(new BlockLoadGuard(
+            (static_cast<uint64_t>(table->rep_->cache_id) << 20) ^
+            handle.offset()));
+        cache_handle = block_cache->Lookup(key);
+      }
       if (cache_handle != nullptr) {
+        GetPerfContext()->block_cache_hits++;
+        GetGlobalPerfCounters()->block_cache_hits.fetch_add(
+            1, std::memory_order_relaxed);
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
       } else {
-        s = ReadBlock(table->rep_->file, options, handle, &contents);
-        if (s.ok()) {
+        GetGlobalPerfCounters()->block_cache_misses.fetch_add(
+            1, std::memory_order_relaxed);
+        // Try the compressed tier before going to disk.
+        Cache* compressed_cache =
+            table->rep_->options.compressed_block_cache;
+        bool have_contents = false;
+        if (compressed_cache != nullptr) {
+          Cache::Handle* compressed_handle = compressed_cache->Lookup(key);
+          if (compressed_handle != nullptr) {
+            const std::string* raw = reinterpret_cast<std::string*>(
+                compressed_cache->Value(compressed_handle));
+            // The stored value is the raw block bytes followed by the
+            // compression type byte.
+            have_contents =
+                DecodeBlock(Slice(raw->data(), raw->size() - 1),
+                            (*raw)[raw->size() - 1], &contents)
+                    .ok();
+            compressed_cache->Release(compressed_handle);
+          }
+        }
+        if (!have_contents && compressed_cache != nullptr) {
+          BlockContents raw;
+          char type;
+          s = ReadRawBlock(table->rep_->file, options, handle, &raw, &type,
+                           table->rep_->checksum_type,
+                           table->rep_->options.block_allocator);
+          if (s.ok()) {
+            if (type == kNoCompression) {
+              contents = raw;
+              have_contents = true;
+            } else {
+              s = DecodeBlock(raw.data, type, &contents,
+                              table->rep_->options.block_allocator);
+              have_contents = s.ok();
+              if (s.ok() && options.fill_cache) {
+                std::string* stored =
+                    new std::string(raw.data.data(), raw.data.size());
+                stored->push_back(type);
+                compressed_cache->Release(compressed_cache->Insert(
+                    key, stored, stored->size(),
+                    &DeleteCachedCompressedBlock));
+              }
+              if (raw.heap_allocated) {
+                delete[] raw.data.data();
+              }
+            }
+          }
+        } else if (!have_contents) {
+          s = ReadBlock(table->rep_->file, options, handle, &contents,
+                        table->rep_->checksum_type,
+                        table->rep_->options.block_allocator);
+          have_contents = s.ok();
+        }
+        if (have_contents) {
           block = new Block(contents);
           if (contents.cachable && options.fill_cache) {
-            cache_handle = block_cache->Insert(key, block, block->size(),
-                                               &DeleteCachedBlock);
+            // Data blocks are scan fodder; keep them below
+            // index/filter material in the eviction order.
+            cache_handle =
+                block_cache->Insert(key, block, block->size(),
+                                    &DeleteCachedBlock, Cache::kLowPriority);
           }
         }
       }
     } else {
-      s = ReadBlock(table->rep_->file, options, handle, &contents);
+      s = ReadBlock(table->rep_->file, options, handle, &contents,
+                    table->rep_->checksum_type,
+                    table->rep_->options.block_allocator);
       if (s.ok()) {
         block = new Block(contents);
       }
@@ -205,33 +510,89 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
   return iter;
 }
 
+// Iterator over (last key, data block handle) index entries; for a
+// partitioned index this composes the top index with the partition
+// blocks, reading partitions on demand through BlockReader.
+Iterator* Table::IndexBlockIterator(const ReadOptions& options) const {
+  Iterator* top = rep_->index_block->NewIterator(rep_->options.comparator);
+  if (!rep_->index_partitioned) {
+    return top;
+  }
+  return NewTwoLevelIterator(top, &Table::BlockReader,
+                             const_cast<Table*>(this), options);
+}
+
+// Read-ahead hook for sequential scans: hint the file region of the
+// next data block.
+void Table::PrefetchBlock(void* arg, const Slice& index_value) {
+  Table* table = reinterpret_cast<Table*>(arg);
+  BlockHandle handle;
+  Slice input = index_value;
+  if (handle.DecodeFrom(&input).ok()) {
+    table->rep_->file->Prefetch(handle.offset(),
+                                handle.size() + kBlockTrailerSize);
+  }
+}
+
 Iterator* Table::NewIterator(const ReadOptions& options) const {
-  return NewTwoLevelIterator(
-      rep_->index_block->NewIterator(rep_->options.comparator),
-      &Table::BlockReader, const_cast<Table*>(this), options);
+  return NewTwoLevelIterator(IndexBlockIterator(options), &Table::BlockReader,
+                             const_cast<Table*>(this), options,
+                             options.readahead_size != 0 ? &PrefetchBlock
+                                                         : nullptr);
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
                           void (*handle_result)(void*, const Slice&,
-                                                const Slice&)) {
+                                                const Slice&),
+                          Iterator** pinned_iter, bool* did_block_read) {
   Status s;
-  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* iiter = IndexBlockIterator(options);
   iiter->Seek(k);
   if (iiter->Valid()) {
     Slice handle_value = iiter->value();
-    FilterBlockReader* filter = rep_->filter;
+    const bool have_filter =
+        rep_->filter != nullptr || rep_->filter_index != nullptr;
     BlockHandle handle;
-    if (filter != nullptr && handle.DecodeFrom(&handle_value).ok() &&
-        !filter->KeyMayMatch(handle.offset(), k)) {
+    // With Options::prefix_length the filter holds key prefixes, so
+    // probe with the correspondingly shortened key.
+    if (have_filter) {
+      GetGlobalPerfCounters()->filter_checked.fetch_add(
+          1, std::memory_order_relaxed);
+    }
+    Slice filter_key = k;
+    std::string prefix_storage;
+    const size_t prefix_length = rep_->options.prefix_length;
+    if (have_filter && prefix_length != 0 && k.size() >= 8 &&
+        k.size() - 8 > prefix_length) {
+      prefix_storage.assign(k.data(), prefix_length);
+      prefix_storage.append(k.data() + k.size() - 8, 8);
+      filter_key = Slice(prefix_storage);
+    }
+    if (have_filter && handle.DecodeFrom(&handle_value).ok() &&
+        !KeyMayMatchFilter(handle.offset(), filter_key)) {
+      GetPerfContext()->filter_useful++;
+      GetGlobalPerfCounters()->filter_useful.fetch_add(
+          1, std::memory_order_relaxed);
       // Not found
     } else {
+      if (did_block_read != nullptr) {
+        *did_block_read = true;
+      }
       Iterator* block_iter = BlockReader(this, options, iiter->value());
       block_iter->Seek(k);
+      bool found = false;
       if (block_iter->Valid()) {
         (*handle_result)(arg, block_iter->key(), block_iter->value());
+        found = true;
       }
       s = block_iter->status();
-      delete block_iter;
+      if (found && pinned_iter != nullptr && s.ok()) {
+        // Hand the positioned iterator (and its block pin) to the
+        // caller so the value slice stays valid without a copy.
+        *pinned_iter = block_iter;
+      } else {
+        delete block_iter;
+      }
     }
   }
   if (s.ok()) {
@@ -242,8 +603,7 @@ Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
 }
 
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
-  Iterator* index_iter =
-      rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* index_iter = IndexBlockIterator(ReadOptions());
   index_iter->Seek(key);
   uint64_t result;
   if (index_iter->Valid()) {
@@ -4,7 +4,12 @@
 
 #include "leveldb/table_builder.h"
 
+#include <atomic>
 #include <cassert>
+#include <cstring>
+#include <deque>
+#include <utility>
+#include <vector>
 
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
@@ -15,6 +20,7 @@
 #include "table/format.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
@@ -30,9 +36,13 @@ struct TableBuilder::Rep {
         closed(false),
         filter_block(opt.filter_policy == nullptr
                          ? nullptr
-                         : new FilterBlockBuilder(opt.filter_policy)),
+                         : new FilterBlockBuilder(
+                               opt.filter_policy,
+                               opt.whole_file_filters ? kWholeFileFilterBaseLg
+                                                      : kDefaultFilterBaseLg)),
         pending_index_entry(false) {
     index_block_options.block_restart_interval = 1;
+    index_block_options.block_hash_index = false;
   }
 
   Options options;
@@ -42,6 +52,16 @@ struct TableBuilder::Rep {
   Status status;
   BlockBuilder data_block;
   BlockBuilder index_block;
+  // Completed filter partitions: (last data-block offset covered,
+  // partition handle, first data-block offset covered).
+  struct FilterPartition {
+    uint64_t last_offset;
+    BlockHandle handle;
+    uint64_t base_offset;
+  };
+  std::vector<FilterPartition> filter_partitions;
+  uint64_t filter_partition_base = 0;
+  uint64_t filter_last_block_offset = 0;
   std::string last_key;
   int64_t num_entries;
   bool closed;  // Either Finish() or Abandon() has been called.
@@ -60,13 +80,118 @@ struct TableBuilder::Rep {
   BlockHandle pending_handle;  // Handle to add to index block
 
   std::string compressed_output;
+
+  // Scratch space for prefix filter keys; see TableBuilder::Add().
+  std::string prefix_scratch;
+  std::string last_filter_prefix;
+
+  // With Options::index_partition_size the index entries are buffered
+  // here and carved into partition blocks in Finish().
+  std::vector<std::pair<std::string, std::string>> index_entries;
+
+  // Accumulated table properties, written as a meta block by Finish().
+  uint64_t num_deletions = 0;
+  uint64_t raw_key_bytes = 0;
+  uint64_t raw_value_bytes = 0;
+
+  // ----- Parallel block compression (compression_parallelism > 1) ---
+  // Data blocks are queued here at Flush() time, compressed
+  // out-of-order by worker threads, and written back to the file (and
+  // to the index) strictly in order by DrainCompressedBlocks().
+  struct CompressionJob {
+    std::string raw;
+    std::string separator;  // Index key; set by the Add() that follows
+    bool have_separator = false;
+    std::string compressed;
+    CompressionType type;
+    std::atomic<bool> done{false};
+  };
+  bool parallel_compression = false;
+  port::Mutex jobs_mutex;
+  port::CondVar jobs_cv{&jobs_mutex};
+  std::deque<CompressionJob*> jobs;  // Block order; front written first
+  size_t next_to_compress = 0;       // Index into jobs
+  int workers_running = 0;
+  bool shutdown_workers = false;
 };
 
+// True if this table stores internal keys (the DB write path); such
+// keys carry an 8-byte sequence/type trailer.
+static bool IsInternalKeyTable(const Options& options) {
+  return strcmp(options.comparator->Name(),
+                "leveldb.InternalKeyComparator") == 0;
+}
+
 TableBuilder::TableBuilder(const Options& options, WritableFile* file)
     : rep_(new Rep(options, file)) {
   if (rep_->filter_block != nullptr) {
     rep_->filter_block->StartBlock(0);
   }
+  // Partitioned filters need exact block offsets at Flush() time,
+  // which out-of-order compression cannot provide.
+  rep_->parallel_compression =
+      options.compression_parallelism > 1 &&
+      options.compression != kNoCompression &&
+      (options.filter_policy == nullptr || options.whole_file_filters);
+}
+
+// Worker loop: claim the next queued block, compress it, mark it done.
+void TableBuilder::CompressionWorker(void* arg) {
+  TableBuilder* builder = reinterpret_cast<TableBuilder*>(arg);
+  Rep* r = builder->rep_;
+  r->jobs_mutex.Lock();
+  while (true) {
+    while (r->next_to_compress == r->jobs.size() && !r->shutdown_workers) {
+      r->jobs_cv.Wait();
+    }
+    if (r->next_to_compress == r->jobs.size()) {
+      break;  // Shutting down and nothing left to claim
+    }
+    Rep::CompressionJob* job = r->jobs[r->next_to_compress++];
+    r->jobs_mutex.Unlock();
+    builder->CompressBlock(Slice(job->raw), &job->compressed, &job->type);
+    job->done.store(true, std::memory_order_release);
+    r->jobs_mutex.Lock();
+    r->jobs_cv.SignalAll();
+  }
+  r->workers_running--;
+  r->jobs_cv.SignalAll();
+  r->jobs_mutex.Unlock();
+}
+
+// Write back completed jobs from the front of the queue in order.
+// With "wait" set, blocks until every queued job has been written.
+void TableBuilder::DrainCompressedBlocks(bool wait) {
+  Rep* r = rep_;
+  r->jobs_mutex.Lock();
+  while (!r->jobs.empty()) {
+    Rep::CompressionJob* job = r->jobs.front();
+    if (!job->have_separator ||
+        !job->done.load(std::memory_order_acquire)) {
+      if (!wait) {
+        break;
+      }
+      assert(job->have_separator);  // Finish() sets the last separator
+      r->jobs_cv.Wait();
+      continue;
+    }
+    r->jobs.pop_front();
+    r->next_to_compress--;
+    r->jobs_mutex.Unlock();
+
+    BlockHandle handle;
+    WriteRawBlock(Slice(job->compressed), job->type, &handle);
+    std::string handle_encoding;
+    handle.EncodeTo(&handle_encoding);
+    AddIndexEntry(job->separator, handle_encoding);
+    if (ok()) {
+      r->status = r->file->Flush();
+    }
+    delete job;
+
+    r->jobs_mutex.Lock();
+  }
+  r->jobs_mutex.Unlock();
 }
 
 TableBuilder::~TableBuilder() {
@@ -102,18 +227,55 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
   if (r->pending_index_entry) {
     assert(r->data_block.empty());
     r->options.comparator->FindShortestSeparator(&r->last_key, key);
-    std::string handle_encoding;
-    r->pending_handle.EncodeTo(&handle_encoding);
-    r->index_block.Add(r->last_key, Slice(handle_encoding));
+    if (r->parallel_compression) {
+      r->jobs_mutex.Lock();
+      r->jobs.back()->separator = r->last_key;
+      r->jobs.back()->have_separator = true;
+      r->jobs_cv.SignalAll();
+      r->jobs_mutex.Unlock();
+    } else {
+      std::string handle_encoding;
+      r->pending_handle.EncodeTo(&handle_encoding);
+      AddIndexEntry(r->last_key, Slice(handle_encoding));
+    }
     r->pending_index_entry = false;
   }
 
   if (r->filter_block != nullptr) {
-    r->filter_block->AddKey(key);
+    const size_t prefix_length = r->options.prefix_length;
+    if (prefix_length == 0) {
+      r->filter_block->AddKey(key);
+    } else {
+      // Feed the filter key prefixes instead of whole keys.  Internal
+      // keys keep their 8-byte trailer so InternalFilterPolicy strips
+      // it back to the user-key prefix.
+      Slice prefix = key;
+      if (IsInternalKeyTable(r->options) && key.size() >= 8) {
+        if (key.size() - 8 > prefix_length) {
+          r->prefix_scratch.assign(key.data(), prefix_length);
+          r->prefix_scratch.append(key.data() + key.size() - 8, 8);
+          prefix = Slice(r->prefix_scratch);
+        }
+      } else if (key.size() > prefix_length) {
+        prefix = Slice(key.data(), prefix_length);
+      }
+      // Consecutive keys usually share a prefix; skip duplicates.
+      if (r->last_filter_prefix != prefix.ToString()) {
+        r->last_filter_prefix.assign(prefix.data(), prefix.size());
+        r->filter_block->AddKey(prefix);
+      }
+    }
   }
 
   r->last_key.assign(key.data(), key.size());
   r->num_entries++;
+  r->raw_key_bytes += key.size();
+  r->raw_value_bytes += value.size();
+  if (IsInternalKeyTable(r->options) && key.size() >= 8 &&
+      (static_cast<unsigned char>(key[key.size() - 8]) == 0x0)) {
+    // Internal-key trailer type byte 0x0 == kTypeDeletion.
+    r->num_deletions++;
+  }
   r->data_block.Add(key, value);
 
   const size_t estimated_block_size = r->data_block.CurrentSizeEstimate();
@@ -128,14 +290,95 @@ void TableBuilder::Flush() {
   if (!ok()) return;
   if (r->data_block.empty()) return;
   assert(!r->pending_index_entry);
+  if (r->parallel_compression) {
+    // Queue the block for a compression worker; it is written back in
+    // order by DrainCompressedBlocks() once its index separator is
+    // known.  (A whole-file filter does not depend on block offsets.)
+    Slice raw = r->data_block.Finish();
+    Rep::CompressionJob* job = new Rep::CompressionJob;
+    job->raw.assign(raw.data(), raw.size());
+    r->jobs_mutex.Lock();
+    r->jobs.push_back(job);
+    int max_workers = r->options.compression_parallelism;
+    if (max_workers > 4) max_workers = 4;
+    if (r->workers_running < max_workers && !r->shutdown_workers) {
+      r->workers_running++;
+      r->options.env->StartThread(&TableBuilder::CompressionWorker, this);
+    }
+    r->jobs_cv.SignalAll();
+    r->jobs_mutex.Unlock();
+    r->data_block.Reset();
+    r->pending_index_entry = true;
+    DrainCompressedBlocks(false);
+    return;
+  }
   WriteBlock(&r->data_block, &r->pending_handle);
   if (ok()) {
     r->pending_index_entry = true;
     r->status = r->file->Flush();
   }
   if (r->filter_block != nullptr) {
-    r->filter_block->StartBlock(r->offset);
+    const size_t partition_size = r->options.filter_partition_size;
+    if (partition_size != 0 && !r->options.whole_file_filters &&
+        r->filter_block->CurrentSizeEstimate() >= partition_size) {
+      // Cut a filter partition covering the data blocks seen so far.
+      Rep::FilterPartition partition;
+      partition.last_offset = r->filter_last_block_offset;
+      partition.base_offset = r->filter_partition_base;
+      WriteRawBlock(r->filter_block->Finish(), kNoCompression,
+                    &partition.handle);
+      r->filter_partitions.push_back(partition);
+      delete r->filter_block;
+      r->filter_block = new FilterBlockBuilder(
+          r->options.filter_policy, kDefaultFilterBaseLg);
+      r->filter_partition_base = r->offset;
+    }
+    r->filter_last_block_offset = r->offset;
+    r->filter_block->StartBlock(r->offset - r->filter_partition_base);
+  }
+}
+
+void TableBuilder::CompressBlock(const Slice& raw, std::string* out,
+                                 CompressionType* type) {
+  const Options& options = rep_->options;
+  *type = options.compression;
+  switch (*type) {
+    case kSnappyCompression:
+      if (port::Snappy_Compress(raw.data(), raw.size(), out) &&
+          out->size() < raw.size() - (raw.size() / 8u)) {
+        return;
+      }
+      break;
+    case kLZ4Compression:
+      if (port::Lz4_Compress(raw.data(), raw.size(), out) &&
+          out->size() < raw.size() - (raw.size() / 8u)) {
+        return;
+      }
+      break;
+    case kZstdCompression:
+      if (port::Zstd_Compress(options.zstd_compression_level, raw.data(),
+                              raw.size(), out) &&
+          out->size() < raw.size() - (raw.size() / 8u)) {
+        return;
+      }
+      break;
+    case kNoCompression:
+      break;
   }
+  // Unsupported codec or insufficient gain: store uncompressed.
+  out->assign(raw.data(), raw.size());
+  *type = kNoCompression;
+}
+
+void TableBuilder::StopCompressionWorkers() {
+  Rep* r = rep_;
+  r->jobs_mutex.Lock();
+  r->shutdown_workers = true;
+  r->jobs_cv.SignalAll();
+  while (r->workers_running > 0) {
+    r->jobs_cv.Wait();
+  }
+  r->jobs_mutex.Unlock();
 }
 
 void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
@@ -169,6 +412,20 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
       break;
     }
 
+    case kLZ4Compression: {
+      std::string* compressed = &r->compressed_output;
+      if (port::Lz4_Compress(raw.data(), raw.size(), compressed) &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        block_contents = *compressed;
+      } else {
+        // LZ4 not supported, or compressed less than 12.5%, so just
+        // store uncompressed form
+        block_contents = raw;
+        type = kNoCompression;
+      }
+      break;
+    }
+
     case kZstdCompression: {
       std::string* compressed = &r->compressed_output;
       if (port::Zstd_Compress(r->options.zstd_compression_level, raw.data(),
@@ -198,9 +455,19 @@ void TableBuilder::WriteRawBlock(const Slice& block_contents,
   if (r->status.ok()) {
     char trailer[kBlockTrailerSize];
     trailer[0] = type;
-    uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
-    crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
-    EncodeFixed32(trailer + 1, crc32c::Mask(crc));
+    if (r->options.checksum == kXXH64) {
+      // Checksum covers the contents followed by the type byte, same
+      // as the CRC path; low 32 bits are stored unmasked.
+      std::string buf(block_contents.data(), block_contents.size());
+      buf.push_back(type);
+      EncodeFixed32(trailer + 1,
+                    static_cast<uint32_t>(XXHash64(buf.data(), buf.size(), 0)));
+    } else {
+      uint32_t crc =
+          crc32c::Value(block_contents.data(), block_contents.size());
+      crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
+      EncodeFixed32(trailer + 1, crc32c::Mask(crc));
+    }
     r->status = r->file->Append(Slice(trailer, kBlockTrailerSize));
     if (r->status.ok()) {
       r->offset += block_contents.size() + kBlockTrailerSize;
@@ -208,6 +475,16 @@ void TableBuilder::WriteRawBlock(const Slice& block_contents,
   }
 }
 
+void TableBuilder::AddIndexEntry(const Slice& key, const Slice& handle) {
+  Rep* r = rep_;
+  if (r->options.index_partition_size != 0) {
+    r->index_entries.push_back(
+        std::make_pair(key.ToString(), handle.ToString()));
+  } else {
+    r->index_block.Add(key, handle);
+  }
+}
+
 Status TableBuilder::status() const { return rep_->status; }
 
 Status TableBuilder::Finish() {
@@ -216,24 +493,108 @@ Status TableBuilder::Finish() {
   assert(!r->closed);
   r->closed = true;
 
+  if (r->parallel_compression) {
+    if (r->pending_index_entry) {
+      r->options.comparator->FindShortSuccessor(&r->last_key);
+      r->jobs_mutex.Lock();
+      r->jobs.back()->separator = r->last_key;
+      r->jobs.back()->have_separator = true;
+      r->jobs_cv.SignalAll();
+      r->jobs_mutex.Unlock();
+      r->pending_index_entry = false;
+    }
+    DrainCompressedBlocks(true);
+    StopCompressionWorkers();
+  }
+
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
 
-  // Write filter block
+  // Write filter block (or the last partition plus the filter index)
+  BlockHandle filter_index_handle;
+  const bool partitioned_filter =
+      r->filter_block != nullptr && !r->filter_partitions.empty();
   if (ok() && r->filter_block != nullptr) {
-    WriteRawBlock(r->filter_block->Finish(), kNoCompression,
-                  &filter_block_handle);
+    if (partitioned_filter) {
+      Rep::FilterPartition partition;
+      partition.last_offset = r->filter_last_block_offset;
+      partition.base_offset = r->filter_partition_base;
+      WriteRawBlock(r->filter_block->Finish(), kNoCompression,
+                    &partition.handle);
+      r->filter_partitions.push_back(partition);
+
+      // Index over the partitions: big-endian last-offset keys map to
+      // the partition handle plus the base offset probes are rebased
+      // against.
+      BlockBuilder filter_index(&r->index_block_options);
+      for (size_t i = 0; ok() && i < r->filter_partitions.size(); i++) {
+        const Rep::FilterPartition& p = r->filter_partitions[i];
+        std::string key;
+        PutFixed64BE(&key, p.last_offset);
+        std::string value;
+        p.handle.EncodeTo(&value);
+        PutVarint64(&value, p.base_offset);
+        filter_index.Add(key, value);
+      }
+      WriteRawBlock(filter_index.Finish(), kNoCompression,
+                    &filter_index_handle);
+      filter_index.Reset();
+    } else {
+      WriteRawBlock(r->filter_block->Finish(), kNoCompression,
+                    &filter_block_handle);
+    }
+  }
+
+  // Write properties block
+  BlockHandle properties_block_handle;
+  if (ok()) {
+    BlockBuilder properties_block(&r->options);
+    std::string value;
+    // Keys must be added in sorted order.
+    PutVarint64(&value, r->options.block_size);
+    properties_block.Add("leveldb.block.size", value);
+    value.clear();
+    PutVarint64(&value, static_cast<uint64_t>(r->num_entries));
+    properties_block.Add("leveldb.num.entries", value);
+    value.clear();
+    PutVarint64(&value, r->num_deletions);
+    properties_block.Add("leveldb.num.deletions", value);
+    value.clear();
+    PutVarint64(&value, r->raw_key_bytes);
+    properties_block.Add("leveldb.raw.key.bytes", value);
+    value.clear();
+    PutVarint64(&value, r->raw_value_bytes);
+    properties_block.Add("leveldb.raw.value.bytes", value);
+    WriteBlock(&properties_block, &properties_block_handle);
   }
 
   // Write metaindex block
   if (ok()) {
     BlockBuilder meta_index_block(&r->options);
     if (r->filter_block != nullptr) {
-      // Add mapping from "filter.Name" to location of filter data
-      std::string key = "filter.";
-      key.append(r->options.filter_policy->Name());
+      if (partitioned_filter) {
+        // Maps "filterindex.Name" to the partition index block.
+        std::string key = "filterindex.";
+        key.append(r->options.filter_policy->Name());
+        std::string handle_encoding;
+        filter_index_handle.EncodeTo(&handle_encoding);
+        meta_index_block.Add(key, handle_encoding);
+      } else {
+        // Add mapping from "filter.Name" to location of filter data
+        std::string key = "filter.";
+        key.append(r->options.filter_policy->Name());
+        std::string handle_encoding;
+        filter_block_handle.EncodeTo(&handle_encoding);
+        meta_index_block.Add(key, handle_encoding);
+      }
+    }
+    if (r->options.index_partition_size != 0) {
+      // Marks the index block as a top-level index over partitions.
+      meta_index_block.Add("leveldb.index-partitions", "1");
+    }
+    {
       std::string handle_encoding;
-      filter_block_handle.EncodeTo(&handle_encoding);
-      meta_index_block.Add(key, handle_encoding);
+      properties_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add("leveldb.properties", handle_encoding);
     }
 
     // TODO(postrelease): Add stats and other meta blocks
@@ -246,15 +607,43 @@ Status TableBuilder::Finish() {
       r->options.comparator->FindShortSuccessor(&r->last_key);
       std::string handle_encoding;
       r->pending_handle.EncodeTo(&handle_encoding);
-      r->index_block.Add(r->last_key, Slice(handle_encoding));
+      AddIndexEntry(r->last_key, Slice(handle_encoding));
       r->pending_index_entry = false;
     }
-    WriteBlock(&r->index_block, &index_block_handle);
+    if (r->options.index_partition_size != 0) {
+      // Carve the collected entries into partitions and build the
+      // top-level index (last key of each partition -> its handle).
+      BlockBuilder partition(&r->index_block_options);
+      std::string top_key;
+      for (size_t i = 0; ok() && i < r->index_entries.size(); i++) {
+        partition.Add(r->index_entries[i].first, r->index_entries[i].second);
+        top_key = r->index_entries[i].first;
+        if (partition.CurrentSizeEstimate() >=
+            r->options.index_partition_size) {
+          BlockHandle partition_handle;
+          WriteBlock(&partition, &partition_handle);
+          std::string handle_encoding;
+          partition_handle.EncodeTo(&handle_encoding);
+          r->index_block.Add(top_key, handle_encoding);
+        }
+      }
+      if (ok() && !partition.empty()) {
+        BlockHandle partition_handle;
+        WriteBlock(&partition, &partition_handle);
+        std::string handle_encoding;
+        partition_handle.EncodeTo(&handle_encoding);
+        r->index_block.Add(top_key, handle_encoding);
+      }
+    }
+    if (ok()) {
+      WriteBlock(&r->index_block, &index_block_handle);
+    }
   }
 
   // Write footer
   if (ok()) {
     Footer footer;
+    footer.set_checksum_type(static_cast<uint8_t>(r->options.checksum));
     footer.set_metaindex_handle(metaindex_block_handle);
     footer.set_index_handle(index_block_handle);
     std::string footer_encoding;
@@ -271,6 +660,13 @@ void TableBuilder::Abandon() {
   Rep* r = rep_;
   assert(!r->closed);
   r->closed = true;
+  if (r->parallel_compression) {
+    StopCompressionWorkers();
+    for (size_t i = 0; i < r->jobs.size(); i++) {
+      delete r->jobs[i];
+    }
+    r->jobs.clear();
+  }
 }
 
 uint64_t TableBuilder::NumEntries() const { return rep_->num_entries; }
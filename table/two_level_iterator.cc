@@ -8,20 +8,28 @@
 #include "table/block.h"
 #include "table/format.h"
 #include "table/iterator_wrapper.h"
+#include "util/object_pool.h"
 
 namespace leveldb {
 
 namespace {
 
 typedef Iterator* (*BlockFunction)(void*, const ReadOptions&, const Slice&);
+typedef void (*PrefetchFunction)(void*, const Slice&);
 
 class TwoLevelIterator : public Iterator {
  public:
   TwoLevelIterator(Iterator* index_iter, BlockFunction block_function,
-                   void* arg, const ReadOptions& options);
+                   void* arg, const ReadOptions& options,
+                   PrefetchFunction prefetch_function);
 
   ~TwoLevelIterator() override;
 
+  static void* operator new(size_t size) { return PooledAllocate(size); }
+  static void operator delete(void* ptr, size_t size) {
+    PooledFree(ptr, size);
+  }
+
   void Seek(const Slice& target) override;
   void SeekToFirst() override;
   void SeekToLast() override;
@@ -56,8 +64,10 @@ class TwoLevelIterator : public Iterator {
   void SkipEmptyDataBlocksBackward();
   void SetDataIterator(Iterator* data_iter);
   void InitDataBlock();
+  void MaybePrefetchNextBlock();
 
   BlockFunction block_function_;
+  PrefetchFunction prefetch_function_;
   void* arg_;
   const ReadOptions options_;
   Status status_;
@@ -70,13 +80,28 @@ class TwoLevelIterator : public Iterator {
 
 TwoLevelIterator::TwoLevelIterator(Iterator* index_iter,
                                    BlockFunction block_function, void* arg,
-                                   const ReadOptions& options)
+                                   const ReadOptions& options,
+                                   PrefetchFunction prefetch_function)
     : block_function_(block_function),
+      prefetch_function_(prefetch_function),
       arg_(arg),
       options_(options),
       index_iter_(index_iter),
       data_iter_(nullptr) {}
 
+// Hint the block after the current one so sequential scans overlap the
+// next read with consuming this block.
+void TwoLevelIterator::MaybePrefetchNextBlock() {
+  if (prefetch_function_ == nullptr || !index_iter_.Valid()) {
+    return;
+  }
+  index_iter_.Next();
+  if (index_iter_.Valid()) {
+    (*prefetch_function_)(arg_, index_iter_.value());
+  }
+  index_iter_.Prev();
+}
+
 TwoLevelIterator::~TwoLevelIterator() = default;
 
 void TwoLevelIterator::Seek(const Slice& target) {
@@ -122,6 +147,7 @@ void TwoLevelIterator::SkipEmptyDataBlocksForward() {
     index_iter_.Next();
     InitDataBlock();
     if (data_iter_.iter() != nullptr) data_iter_.SeekToFirst();
+    MaybePrefetchNextBlock();
   }
 }
 
@@ -164,8 +190,10 @@ void TwoLevelIterator::InitDataBlock() {
 
 Iterator* NewTwoLevelIterator(Iterator* index_iter,
                               BlockFunction block_function, void* arg,
-                              const ReadOptions& options) {
-  return new TwoLevelIterator(index_iter, block_function, arg, options);
+                              const ReadOptions& options,
+                              PrefetchFunction prefetch_function) {
+  return new TwoLevelIterator(index_iter, block_function, arg, options,
+                              prefetch_function);
 }
 
 }  // namespace leveldb
@@ -20,11 +20,15 @@ struct ReadOptions;
 //
 // Uses a supplied function to convert an index_iter value into
 // an iterator over the contents of the corresponding block.
+// A non-null "prefetch_function" is invoked with the next index value
+// whenever a new data block is entered during forward iteration, so
+// implementations can issue read-ahead for the upcoming block.
 Iterator* NewTwoLevelIterator(
     Iterator* index_iter,
     Iterator* (*block_function)(void* arg, const ReadOptions& options,
                                 const Slice& index_value),
-    void* arg, const ReadOptions& options);
+    void* arg, const ReadOptions& options,
+    void (*prefetch_function)(void* arg, const Slice& index_value) = nullptr);
 
 }  // namespace leveldb
 
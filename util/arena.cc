@@ -4,21 +4,164 @@
 
 #include "util/arena.h"
 
+#include <cstdlib>
+
+#include "util/mutexlock.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
 namespace leveldb {
 
 static const int kBlockSize = 4096;
 
+ArenaBlockPool::ArenaBlockPool(size_t max_free_slabs)
+    : max_free_slabs_(max_free_slabs) {}
+
+ArenaBlockPool::~ArenaBlockPool() {
+  for (size_t i = 0; i < free_slabs_.size(); i++) {
+#if defined(__linux__)
+    std::free(free_slabs_[i]);
+#else
+    delete[] free_slabs_[i];
+#endif
+  }
+}
+
+char* ArenaBlockPool::Allocate() {
+  {
+    MutexLock l(&mutex_);
+    if (!free_slabs_.empty()) {
+      char* slab = free_slabs_.back();
+      free_slabs_.pop_back();
+      return slab;
+    }
+  }
+#if defined(__linux__)
+  // Align to the slab size so the region is eligible for a huge page.
+  void* slab = nullptr;
+  if (posix_memalign(&slab, kSlabSize, kSlabSize) != 0) {
+    return new char[kSlabSize];
+  }
+  madvise(slab, kSlabSize, MADV_HUGEPAGE);
+  return static_cast<char*>(slab);
+#else
+  return new char[kSlabSize];
+#endif
+}
+
+void ArenaBlockPool::Release(char* slab) {
+  {
+    MutexLock l(&mutex_);
+    if (free_slabs_.size() < max_free_slabs_) {
+      free_slabs_.push_back(slab);
+      return;
+    }
+  }
+#if defined(__linux__)
+  std::free(slab);
+#else
+  delete[] slab;
+#endif
+}
+
+namespace {
+// Arena ids start at 1 so a default-constructed thread cache (id 0)
+// never matches a live arena.
+std::atomic<uint64_t> next_arena_id{1};
+}  // namespace
+
 Arena::Arena()
-    : alloc_ptr_(nullptr), alloc_bytes_remaining_(0), memory_usage_(0) {}
+    : id_(next_arena_id.fetch_add(1, std::memory_order_relaxed)),
+      alloc_ptr_(nullptr),
+      alloc_bytes_remaining_(0),
+      pool_(nullptr),
+      memory_usage_(0) {}
+
+Arena::Arena(ArenaBlockPool* pool)
+    : id_(next_arena_id.fetch_add(1, std::memory_order_relaxed)),
+      alloc_ptr_(nullptr),
+      alloc_bytes_remaining_(0),
+      pool_(pool),
+      memory_usage_(0) {}
 
 Arena::~Arena() {
   for (size_t i = 0; i < blocks_.size(); i++) {
     delete[] blocks_[i];
   }
+  for (size_t i = 0; i < pooled_blocks_.size(); i++) {
+    pool_->Release(pooled_blocks_[i]);
+  }
+}
+
+// Refill the calling thread's buffer (or satisfy a large request
+// directly) under the shared-state mutex.  "align" is 1 for Allocate()
+// and the pointer alignment for AllocateAligned().
+char* Arena::AllocateSlow(size_t bytes, size_t align) {
+  ThreadCache* cache = GetThreadCache();
+  MutexLock l(&mutex_);
+
+  // Carve a fresh thread buffer.  Doubles per refill so a thread's
+  // first touches of a new arena stay cheap, but never grows past a
+  // small fraction of what the arena already holds: the current
+  // buffer's unused tail counts toward MemoryUsage(), and the
+  // documented bound is 10% overhead over bytes handed out.
+  if (cache->arena_id != id_ || cache->next_size == 0) {
+    cache->next_size = kMinTlabSize;
+  }
+  size_t want = cache->next_size;
+  const size_t usage_cap =
+      memory_usage_.load(std::memory_order_relaxed) / 32 + kMinTlabSize;
+  if (want > usage_cap) {
+    want = usage_cap;
+  }
+  if (bytes + align > want / 4) {
+    // Large relative to the buffer: serve from the shared state
+    // directly rather than burning most of a thread buffer (and
+    // abandoning its remainder) on it.  AllocateFallback hands out
+    // either a dedicated block or the start of a fresh one, both
+    // aligned.
+    (void)align;
+    return AllocateFallback(bytes);
+  }
+  if (cache->next_size * 2 <= kMaxTlabSize) {
+    cache->next_size *= 2;
+  }
+
+  if (pool_ != nullptr) {
+    // Slab-backed arena: carve the buffer out of the shared slab.
+    if (alloc_bytes_remaining_ < want) {
+      alloc_ptr_ = pool_->Allocate();
+      pooled_blocks_.push_back(alloc_ptr_);
+      memory_usage_.fetch_add(ArenaBlockPool::kSlabSize + sizeof(char*),
+                              std::memory_order_relaxed);
+      alloc_bytes_remaining_ = ArenaBlockPool::kSlabSize;
+    }
+    cache->ptr = alloc_ptr_;
+    alloc_ptr_ += want;
+    alloc_bytes_remaining_ -= want;
+  } else {
+    // Heap-backed arena: the buffer is its own block.
+    cache->ptr = AllocateNewBlock(want);
+  }
+  cache->arena_id = id_;
+  cache->remaining = want;
+
+  // Serve the request from the fresh buffer.
+  const size_t current_mod =
+      reinterpret_cast<uintptr_t>(cache->ptr) & (align - 1);
+  const size_t slop = (current_mod == 0 ? 0 : align - current_mod);
+  char* result = cache->ptr + slop;
+  cache->ptr += bytes + slop;
+  cache->remaining -= bytes + slop;
+  return result;
 }
 
 char* Arena::AllocateFallback(size_t bytes) {
-  if (bytes > kBlockSize / 4) {
+  const size_t block_size =
+      (pool_ != nullptr) ? ArenaBlockPool::kSlabSize : kBlockSize;
+  if (bytes > block_size / 4) {
     // Object is more than a quarter of our block size.  Allocate it separately
     // to avoid wasting too much space in leftover bytes.
     char* result = AllocateNewBlock(bytes);
@@ -26,8 +169,15 @@ char* Arena::AllocateFallback(size_t bytes) {
   }
 
   // We waste the remaining space in the current block.
-  alloc_ptr_ = AllocateNewBlock(kBlockSize);
-  alloc_bytes_remaining_ = kBlockSize;
+  if (pool_ != nullptr) {
+    alloc_ptr_ = pool_->Allocate();
+    pooled_blocks_.push_back(alloc_ptr_);
+    memory_usage_.fetch_add(block_size + sizeof(char*),
+                            std::memory_order_relaxed);
+  } else {
+    alloc_ptr_ = AllocateNewBlock(block_size);
+  }
+  alloc_bytes_remaining_ = block_size;
 
   char* result = alloc_ptr_;
   alloc_ptr_ += bytes;
@@ -39,18 +189,22 @@ char* Arena::AllocateAligned(size_t bytes) {
   const int align = (sizeof(void*) > 8) ? sizeof(void*) : 8;
   static_assert((align & (align - 1)) == 0,
                 "Pointer size should be a power of 2");
-  size_t current_mod = reinterpret_cast<uintptr_t>(alloc_ptr_) & (align - 1);
-  size_t slop = (current_mod == 0 ? 0 : align - current_mod);
-  size_t needed = bytes + slop;
+  ThreadCache* cache = GetThreadCache();
   char* result;
-  if (needed <= alloc_bytes_remaining_) {
-    result = alloc_ptr_ + slop;
-    alloc_ptr_ += needed;
-    alloc_bytes_remaining_ -= needed;
-  } else {
-    // AllocateFallback always returned aligned memory
-    result = AllocateFallback(bytes);
+  if (cache->arena_id == id_) {
+    size_t current_mod =
+        reinterpret_cast<uintptr_t>(cache->ptr) & (align - 1);
+    size_t slop = (current_mod == 0 ? 0 : align - current_mod);
+    size_t needed = bytes + slop;
+    if (needed <= cache->remaining) {
+      result = cache->ptr + slop;
+      cache->ptr += needed;
+      cache->remaining -= needed;
+      assert((reinterpret_cast<uintptr_t>(result) & (align - 1)) == 0);
+      return result;
+    }
   }
+  result = AllocateSlow(bytes, align);
   assert((reinterpret_cast<uintptr_t>(result) & (align - 1)) == 0);
   return result;
 }
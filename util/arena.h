@@ -11,12 +11,54 @@
 #include <cstdint>
 #include <vector>
 
+#include "port/port.h"
+
 namespace leveldb {
 
+// A thread-safe free list of large, uniformly sized slabs that arenas
+// draw their blocks from.  Slabs are recycled instead of freed when an
+// arena is destroyed, so a retiring memtable hands its memory to its
+// successor, and on Linux each slab is madvise(MADV_HUGEPAGE)d to cut
+// TLB pressure.
+class ArenaBlockPool {
+ public:
+  // Each slab covers one transparent huge page.
+  static const size_t kSlabSize = 2 * 1024 * 1024;
+
+  // Retain at most "max_free_slabs" idle slabs; excess is freed.
+  explicit ArenaBlockPool(size_t max_free_slabs);
+
+  ArenaBlockPool(const ArenaBlockPool&) = delete;
+  ArenaBlockPool& operator=(const ArenaBlockPool&) = delete;
+
+  ~ArenaBlockPool();
+
+  char* Allocate();
+  void Release(char* slab);
+
+ private:
+  port::Mutex mutex_;
+  std::vector<char*> free_slabs_;
+  const size_t max_free_slabs_;
+};
+
 class Arena {
  public:
   Arena();
 
+  // Per-thread allocation buffers make concurrent Allocate() calls
+  // thread-local bump pointers with no shared cache-line traffic.
+  // Buffers start small -- so tiny arenas (and their memory-usage
+  // accounting) keep fine granularity -- and double per refill up to
+  // the maximum.
+  static const size_t kMinTlabSize = 4 * 1024;
+  static const size_t kMaxTlabSize = 64 * 1024;
+
+  // An arena that takes its standard blocks from *pool (which must
+  // outlive the arena) and returns them on destruction.  Oversized
+  // allocations still use the heap.  A null pool behaves like Arena().
+  explicit Arena(ArenaBlockPool* pool);
+
   Arena(const Arena&) = delete;
   Arena& operator=(const Arena&) = delete;
 
@@ -35,8 +77,30 @@ class Arena {
   }
 
  private:
-  char* AllocateFallback(size_t bytes);
-  char* AllocateNewBlock(size_t block_bytes);
+  // One thread's private buffer.  A single slot per thread: switching
+  // between arenas abandons the old remainder, which is bounded by
+  // kTlabSize and only matters for pathological alternation.
+  struct ThreadCache {
+    uint64_t arena_id = 0;
+    char* ptr = nullptr;
+    size_t remaining = 0;
+    size_t next_size = 0;  // Next refill size for this arena
+  };
+  static ThreadCache* GetThreadCache() {
+    static thread_local ThreadCache cache;
+    return &cache;
+  }
+
+  char* AllocateSlow(size_t bytes, size_t align);
+  char* AllocateFallback(size_t bytes) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  char* AllocateNewBlock(size_t block_bytes) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Identifies this arena instance in thread caches; never reused.
+  const uint64_t id_;
+
+  // Guards the shared allocation state below against concurrent
+  // thread-buffer refills.
+  port::Mutex mutex_;
 
   // Allocation state
   char* alloc_ptr_;
@@ -45,6 +109,10 @@ class Arena {
   // Array of new[] allocated memory blocks
   std::vector<char*> blocks_;
 
+  // Slab source and the slabs to hand back; see ArenaBlockPool.
+  ArenaBlockPool* const pool_;
+  std::vector<char*> pooled_blocks_;
+
   // Total memory usage of the arena.
   //
   // TODO(costan): This member is accessed via atomics, but the others are
@@ -57,13 +125,14 @@ inline char* Arena::Allocate(size_t bytes) {
   // 0-byte allocations, so we disallow them here (we don't need
   // them for our internal use).
   assert(bytes > 0);
-  if (bytes <= alloc_bytes_remaining_) {
-    char* result = alloc_ptr_;
-    alloc_ptr_ += bytes;
-    alloc_bytes_remaining_ -= bytes;
+  ThreadCache* cache = GetThreadCache();
+  if (cache->arena_id == id_ && bytes <= cache->remaining) {
+    char* result = cache->ptr;
+    cache->ptr += bytes;
+    cache->remaining -= bytes;
     return result;
   }
-  return AllocateFallback(bytes);
+  return AllocateSlow(bytes, 1);
 }
 
 }  // namespace leveldb
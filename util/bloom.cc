@@ -83,10 +83,86 @@ class BloomFilterPolicy : public FilterPolicy {
   size_t bits_per_key_;
   size_t k_;
 };
+// Cache-local variant: every probe for a key lands in one 64-byte
+// block chosen by the upper hash bits, so a negative lookup costs one
+// cache miss instead of up to k.  Slightly worse false-positive rate
+// than the classic layout at equal bits per key.
+class BlockedBloomFilterPolicy : public FilterPolicy {
+ public:
+  static constexpr size_t kBlockBytes = 64;
+  static constexpr size_t kBlockBits = kBlockBytes * 8;
+
+  explicit BlockedBloomFilterPolicy(int bits_per_key)
+      : bits_per_key_(bits_per_key) {
+    k_ = static_cast<size_t>(bits_per_key * 0.69);  // 0.69 =~ ln(2)
+    if (k_ < 1) k_ = 1;
+    if (k_ > 30) k_ = 30;
+  }
+
+  const char* Name() const override {
+    return "leveldb.BuiltinBlockedBloomFilter";
+  }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    size_t bits = n * bits_per_key_;
+    if (bits < kBlockBits) bits = kBlockBits;
+    const size_t blocks = (bits + kBlockBits - 1) / kBlockBits;
+
+    const size_t init_size = dst->size();
+    dst->resize(init_size + blocks * kBlockBytes, 0);
+    dst->push_back(static_cast<char>(k_));
+    char* array = &(*dst)[init_size];
+    for (int i = 0; i < n; i++) {
+      uint32_t h = BloomHash(keys[i]);
+      char* block = array + (h % blocks) * kBlockBytes;
+      // Double-hash within the block; the block selector bits are
+      // independent of the in-block probe positions.
+      h = (h >> 13) | (h << 19);  // Rotate so fresh bits pick the probes
+      const uint32_t delta = (h >> 17) | (h << 15);
+      for (size_t j = 0; j < k_; j++) {
+        const uint32_t bitpos = h % kBlockBits;
+        block[bitpos / 8] |= (1 << (bitpos % 8));
+        h += delta;
+      }
+    }
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& bloom_filter) const override {
+    const size_t len = bloom_filter.size();
+    if (len < kBlockBytes + 1) return false;
+    if ((len - 1) % kBlockBytes != 0) return true;  // Not our layout
+
+    const char* array = bloom_filter.data();
+    const size_t blocks = (len - 1) / kBlockBytes;
+    const size_t k = array[len - 1];
+    if (k > 30) {
+      return true;  // Reserved for new encodings
+    }
+
+    uint32_t h = BloomHash(key);
+    const char* block = array + (h % blocks) * kBlockBytes;
+    h = (h >> 13) | (h << 19);
+    const uint32_t delta = (h >> 17) | (h << 15);
+    for (size_t j = 0; j < k; j++) {
+      const uint32_t bitpos = h % kBlockBits;
+      if ((block[bitpos / 8] & (1 << (bitpos % 8))) == 0) return false;
+      h += delta;
+    }
+    return true;
+  }
+
+ private:
+  size_t bits_per_key_;
+  size_t k_;
+};
 }  // namespace
 
 const FilterPolicy* NewBloomFilterPolicy(int bits_per_key) {
   return new BloomFilterPolicy(bits_per_key);
 }
 
+const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key) {
+  return new BlockedBloomFilterPolicy(bits_per_key);
+}
+
 }  // namespace leveldb
@@ -4,9 +4,12 @@
 
 #include "leveldb/cache.h"
 
+#include <atomic>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <new>
 
 #include "port/port.h"
 #include "port/thread_annotations.h"
@@ -17,6 +20,23 @@ namespace leveldb {
 
 Cache::~Cache() {}
 
+CacheAllocator::~CacheAllocator() = default;
+
+std::string Cache::FrequencyReport() const { return std::string(); }
+
+void Cache::ApplyToAll(void (*fn)(const Slice& key, void* value, void* arg),
+                       void* arg) {
+  (void)fn;
+  (void)arg;
+}
+
+Cache::Handle* Cache::Insert(const Slice& key, void* value, size_t charge,
+                             void (*deleter)(const Slice& key, void* value),
+                             Priority priority) {
+  (void)priority;
+  return Insert(key, value, charge, deleter);
+}
+
 namespace {
 
 // LRU cache implementation
@@ -38,6 +58,84 @@ namespace {
 // when they detect an element in the cache acquiring or losing its only
 // external reference.
 
+// Count-min sketch of lookup frequencies, updated lock-free on every
+// cache hit or miss.  Counters are periodically halved so hotness
+// reflects recent traffic; estimates are approximate by design.
+class FrequencySketch {
+ public:
+  // Entries at or above this estimated frequency are considered hot.
+  static const uint32_t kHotThreshold = 64;
+
+  FrequencySketch() : ops_(0) {
+    for (int r = 0; r < kRows; r++) {
+      for (int i = 0; i < kWidth; i++) {
+        counters_[r][i].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void Add(uint32_t hash) {
+    for (int r = 0; r < kRows; r++) {
+      counters_[r][Index(hash, r)].fetch_add(1, std::memory_order_relaxed);
+    }
+    if (ops_.fetch_add(1, std::memory_order_relaxed) == kAgingPeriod) {
+      ops_.store(0, std::memory_order_relaxed);
+      Age();
+    }
+  }
+
+  uint32_t Estimate(uint32_t hash) const {
+    uint32_t result = ~0u;
+    for (int r = 0; r < kRows; r++) {
+      const uint32_t c =
+          counters_[r][Index(hash, r)].load(std::memory_order_relaxed);
+      if (c < result) result = c;
+    }
+    return result;
+  }
+
+  std::string Report() const {
+    uint64_t total = 0;
+    int hot = 0;
+    for (int i = 0; i < kWidth; i++) {
+      const uint32_t c = counters_[0][i].load(std::memory_order_relaxed);
+      total += c;
+      if (c >= kHotThreshold) hot++;
+    }
+    char buf[120];
+    std::snprintf(buf, sizeof(buf),
+                  "sketch: ~%llu recent lookups, %d/%d hot buckets "
+                  "(threshold %u)\n",
+                  static_cast<unsigned long long>(total), hot, kWidth,
+                  kHotThreshold);
+    return std::string(buf);
+  }
+
+ private:
+  static const int kRows = 4;
+  static const int kWidth = 2048;  // Power of two
+  static const uint32_t kAgingPeriod = 1 << 17;
+
+  static int Index(uint32_t hash, int row) {
+    // Cheap per-row remixing of the precomputed key hash.
+    uint32_t h = hash * (0x9e3779b9u + 2 * row + 1);
+    return (h >> 16) & (kWidth - 1);
+  }
+
+  void Age() {
+    // Best effort: racing increments may be lost, which is fine.
+    for (int r = 0; r < kRows; r++) {
+      for (int i = 0; i < kWidth; i++) {
+        const uint32_t c = counters_[r][i].load(std::memory_order_relaxed);
+        counters_[r][i].store(c / 2, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::atomic<uint32_t> counters_[4][2048];
+  std::atomic<uint64_t> ops_;
+};
+
 // An entry is a variable length heap-allocated structure.  Entries
 // are kept in a circular doubly linked list ordered by access time.
 struct LRUHandle {
@@ -48,7 +146,8 @@ struct LRUHandle {
   LRUHandle* prev;
   size_t charge;  // TODO(opt): Only allow uint32_t?
   size_t key_length;
-  bool in_cache;     // Whether entry is in the cache.
+  bool in_cache;      // Whether entry is in the cache.
+  bool low_priority;  // Enters the eviction order at the cold end once
   uint32_t refs;     // References, including cache reference, if present.
   uint32_t hash;     // Hash of key(); used for fast sharding and comparisons
   char key_data[1];  // Beginning of key
@@ -65,86 +164,141 @@ struct LRUHandle {
 // We provide our own simple hash table since it removes a whole bunch
 // of porting hacks and is also faster than some of the built-in hash
 // table implementations in some of the compiler/runtime combinations
-// we have tested.  E.g., readrandom speeds up by ~5% over the g++
-// 4.4.3's builtin hashtable.
+// we have tested.
+//
+// The table is open addressing with linear probing and a one-byte tag
+// per slot, so a lookup usually touches one or two cache lines of tags
+// before a single handle pointer chase, instead of walking a chain of
+// separately allocated nodes.  Removals leave tombstones that are
+// recycled by inserts and cleaned up on resize.
+template <typename HandleType>
 class HandleTable {
  public:
-  HandleTable() : length_(0), elems_(0), list_(nullptr) { Resize(); }
-  ~HandleTable() { delete[] list_; }
-
-  LRUHandle* Lookup(const Slice& key, uint32_t hash) {
-    return *FindPointer(key, hash);
-  }
-
-  LRUHandle* Insert(LRUHandle* h) {
-    LRUHandle** ptr = FindPointer(h->key(), h->hash);
-    LRUHandle* old = *ptr;
-    h->next_hash = (old == nullptr ? nullptr : old->next_hash);
-    *ptr = h;
-    if (old == nullptr) {
-      ++elems_;
-      if (elems_ > length_) {
-        // Since each cache entry is fairly large, we aim for a small
-        // average linked list length (<= 1).
-        Resize();
+  HandleTable() : length_(0), elems_(0), used_(0), slots_(nullptr),
+                  tags_(nullptr) {
+    Resize(16);
+  }
+  ~HandleTable() {
+    delete[] slots_;
+    delete[] tags_;
+  }
+
+  HandleType* Lookup(const Slice& key, uint32_t hash) {
+    const uint8_t tag = TagFor(hash);
+    uint32_t i = hash & (length_ - 1);
+    while (true) {
+      HandleType* h = slots_[i];
+      if (h == nullptr && tags_[i] == kEmptyTag) {
+        return nullptr;
+      }
+      if (h != nullptr && tags_[i] == tag && h->hash == hash &&
+          key == h->key()) {
+        return h;
       }
+      i = (i + 1) & (length_ - 1);
     }
-    return old;
   }
 
-  LRUHandle* Remove(const Slice& key, uint32_t hash) {
-    LRUHandle** ptr = FindPointer(key, hash);
-    LRUHandle* result = *ptr;
-    if (result != nullptr) {
-      *ptr = result->next_hash;
-      --elems_;
+  HandleType* Insert(HandleType* h) {
+    const uint32_t hash = h->hash;
+    const uint8_t tag = TagFor(hash);
+    uint32_t i = hash & (length_ - 1);
+    uint32_t insert_at = length_;  // First reusable slot seen
+    while (true) {
+      HandleType* slot = slots_[i];
+      if (slot == nullptr) {
+        if (tags_[i] == kEmptyTag) {
+          // Key not present; place at the earliest reusable slot.
+          if (insert_at == length_) insert_at = i;
+          break;
+        }
+        // Tombstone: remember, keep probing for a match.
+        if (insert_at == length_) insert_at = i;
+      } else if (tags_[i] == tag && slot->hash == hash &&
+                 slot->key() == h->key()) {
+        // Replace in place.
+        slots_[i] = h;
+        return slot;
+      }
+      i = (i + 1) & (length_ - 1);
+    }
+    if (tags_[insert_at] == kEmptyTag) {
+      used_++;
+    }
+    slots_[insert_at] = h;
+    tags_[insert_at] = tag;
+    elems_++;
+    if (used_ * 10 > length_ * 7) {
+      Resize(elems_ * 10 > length_ * 5 ? length_ * 2 : length_);
+    }
+    return nullptr;
+  }
+
+  uint32_t Length() const { return elems_; }
+
+  HandleType* Remove(const Slice& key, uint32_t hash) {
+    const uint8_t tag = TagFor(hash);
+    uint32_t i = hash & (length_ - 1);
+    while (true) {
+      HandleType* h = slots_[i];
+      if (h == nullptr && tags_[i] == kEmptyTag) {
+        return nullptr;
+      }
+      if (h != nullptr && tags_[i] == tag && h->hash == hash &&
+          key == h->key()) {
+        slots_[i] = nullptr;
+        tags_[i] = kTombstoneTag;
+        elems_--;
+        return h;
+      }
+      i = (i + 1) & (length_ - 1);
     }
-    return result;
   }
 
  private:
-  // The table consists of an array of buckets where each bucket is
-  // a linked list of cache entries that hash into the bucket.
-  uint32_t length_;
-  uint32_t elems_;
-  LRUHandle** list_;
-
-  // Return a pointer to slot that points to a cache entry that
-  // matches key/hash.  If there is no such cache entry, return a
-  // pointer to the trailing slot in the corresponding linked list.
-  LRUHandle** FindPointer(const Slice& key, uint32_t hash) {
-    LRUHandle** ptr = &list_[hash & (length_ - 1)];
-    while (*ptr != nullptr && ((*ptr)->hash != hash || key != (*ptr)->key())) {
-      ptr = &(*ptr)->next_hash;
-    }
-    return ptr;
-  }
-
-  void Resize() {
-    uint32_t new_length = 4;
-    while (new_length < elems_) {
+  static const uint8_t kEmptyTag = 0;
+  static const uint8_t kTombstoneTag = 1;
+
+  static uint8_t TagFor(uint32_t hash) {
+    uint8_t tag = static_cast<uint8_t>(hash >> 24);
+    return tag < 2 ? static_cast<uint8_t>(tag + 2) : tag;
+  }
+
+  void Resize(uint32_t new_length) {
+    while (new_length < elems_ * 2) {
       new_length *= 2;
     }
-    LRUHandle** new_list = new LRUHandle*[new_length];
-    memset(new_list, 0, sizeof(new_list[0]) * new_length);
+    HandleType** new_slots = new HandleType*[new_length];
+    uint8_t* new_tags = new uint8_t[new_length];
+    memset(new_slots, 0, sizeof(new_slots[0]) * new_length);
+    memset(new_tags, kEmptyTag, new_length);
     uint32_t count = 0;
     for (uint32_t i = 0; i < length_; i++) {
-      LRUHandle* h = list_[i];
-      while (h != nullptr) {
-        LRUHandle* next = h->next_hash;
-        uint32_t hash = h->hash;
-        LRUHandle** ptr = &new_list[hash & (new_length - 1)];
-        h->next_hash = *ptr;
-        *ptr = h;
-        h = next;
-        count++;
+      HandleType* h = slots_[i];
+      if (h == nullptr) continue;
+      uint32_t j = h->hash & (new_length - 1);
+      while (new_slots[j] != nullptr) {
+        j = (j + 1) & (new_length - 1);
       }
+      new_slots[j] = h;
+      new_tags[j] = TagFor(h->hash);
+      count++;
     }
     assert(elems_ == count);
-    delete[] list_;
-    list_ = new_list;
+    (void)count;
+    delete[] slots_;
+    delete[] tags_;
+    slots_ = new_slots;
+    tags_ = new_tags;
     length_ = new_length;
+    used_ = elems_;
   }
+
+  uint32_t length_;  // Power of two
+  uint32_t elems_;   // Live entries
+  uint32_t used_;    // Live entries + tombstones
+  HandleType** slots_;
+  uint8_t* tags_;
 };
 
 // A single shard of sharded cache.
@@ -156,10 +310,17 @@ class LRUCache {
   // Separate from constructor so caller can easily make an array of LRUCache
   void SetCapacity(size_t capacity) { capacity_ = capacity; }
 
+  // Optional shared frequency sketch; hot entries dodge eviction.
+  void SetSketch(const FrequencySketch* sketch) { sketch_ = sketch; }
+
+  // Optional handle allocator (see CacheAllocator).
+  void SetAllocator(CacheAllocator* allocator) { allocator_ = allocator; }
+
   // Like Cache methods, but with an extra "hash" parameter.
   Cache::Handle* Insert(const Slice& key, uint32_t hash, void* value,
                         size_t charge,
-                        void (*deleter)(const Slice& key, void* value));
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Priority priority = Cache::kHighPriority);
   Cache::Handle* Lookup(const Slice& key, uint32_t hash);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
@@ -168,6 +329,15 @@ class LRUCache {
     MutexLock l(&mutex_);
     return usage_;
   }
+  void ApplyToAll(void (*fn)(const Slice&, void*, void*), void* arg) {
+    MutexLock l(&mutex_);
+    for (LRUHandle* e = lru_.next; e != &lru_; e = e->next) {
+      (*fn)(e->key(), e->value, arg);
+    }
+    for (LRUHandle* e = in_use_.next; e != &in_use_; e = e->next) {
+      (*fn)(e->key(), e->value, arg);
+    }
+  }
 
  private:
   void LRU_Remove(LRUHandle* e);
@@ -178,6 +348,8 @@ class LRUCache {
 
   // Initialized before use.
   size_t capacity_;
+  const FrequencySketch* sketch_ = nullptr;
+  CacheAllocator* allocator_ = nullptr;
 
   // mutex_ protects the following state.
   mutable port::Mutex mutex_;
@@ -192,7 +364,7 @@ class LRUCache {
   // Entries are in use by clients, and have refs >= 2 and in_cache==true.
   LRUHandle in_use_ GUARDED_BY(mutex_);
 
-  HandleTable table_ GUARDED_BY(mutex_);
+  HandleTable<LRUHandle> table_ GUARDED_BY(mutex_);
 };
 
 LRUCache::LRUCache() : capacity_(0), usage_(0) {
@@ -219,6 +391,11 @@ void LRUCache::Ref(LRUHandle* e) {
   if (e->refs == 1 && e->in_cache) {  // If on lru_ list, move to in_use_ list.
     LRU_Remove(e);
     LRU_Append(&in_use_, e);
+    // A lookup hit is a re-reference: promote the entry out of the
+    // probation (cold) segment, so only blocks touched more than once
+    // compete with the resident hot set.  A one-pass scan never
+    // re-references its blocks and cannot displace it.
+    e->low_priority = false;
   }
   e->refs++;
 }
@@ -229,11 +406,25 @@ void LRUCache::Unref(LRUHandle* e) {
   if (e->refs == 0) {  // Deallocate.
     assert(!e->in_cache);
     (*e->deleter)(e->key(), e->value);
-    free(e);
+    if (allocator_ != nullptr) {
+      allocator_->Deallocate(e, sizeof(LRUHandle) - 1 + e->key_length);
+    } else {
+      free(e);
+    }
   } else if (e->in_cache && e->refs == 1) {
-    // No longer in use; move to lru_ list.
+    // No longer in use; move to lru_ list.  A low-priority entry gets
+    // parked at the cold end the first time so an untouched scan block
+    // is the first eviction candidate; any later use promotes it.
     LRU_Remove(e);
-    LRU_Append(&lru_, e);
+    if (e->low_priority) {
+      e->low_priority = false;
+      e->next = lru_.next;
+      e->prev = &lru_;
+      e->next->prev = e;
+      e->prev->next = e;
+    } else {
+      LRU_Append(&lru_, e);
+    }
   }
 }
 
@@ -266,12 +457,14 @@ void LRUCache::Release(Cache::Handle* handle) {
 
 Cache::Handle* LRUCache::Insert(const Slice& key, uint32_t hash, void* value,
                                 size_t charge,
-                                void (*deleter)(const Slice& key,
-                                                void* value)) {
+                                void (*deleter)(const Slice& key, void* value),
+                                Cache::Priority priority) {
   MutexLock l(&mutex_);
 
-  LRUHandle* e =
-      reinterpret_cast<LRUHandle*>(malloc(sizeof(LRUHandle) - 1 + key.size()));
+  LRUHandle* e = reinterpret_cast<LRUHandle*>(
+      allocator_ != nullptr
+          ? allocator_->Allocate(sizeof(LRUHandle) - 1 + key.size())
+          : malloc(sizeof(LRUHandle) - 1 + key.size()));
   e->value = value;
   e->deleter = deleter;
   e->charge = charge;
@@ -284,6 +477,7 @@ Cache::Handle* LRUCache::Insert(const Slice& key, uint32_t hash, void* value,
   if (capacity_ > 0) {
     e->refs++;  // for the cache's reference.
     e->in_cache = true;
+    e->low_priority = (priority == Cache::kLowPriority);
     LRU_Append(&in_use_, e);
     usage_ += charge;
     FinishErase(table_.Insert(e));
@@ -291,9 +485,20 @@ Cache::Handle* LRUCache::Insert(const Slice& key, uint32_t hash, void* value,
     // next is read by key() in an assert, so it must be initialized
     e->next = nullptr;
   }
+  int hot_skips = 0;
   while (usage_ > capacity_ && lru_.next != &lru_) {
     LRUHandle* old = lru_.next;
     assert(old->refs == 1);
+    if (sketch_ != nullptr && hot_skips < 8 &&
+        sketch_->Estimate(old->hash) >= FrequencySketch::kHotThreshold) {
+      // Hot entry: recycle it to the young end instead of evicting, so
+      // scan-driven insertions (e.g. during compactions) cannot flush
+      // the working set.  Bounded so inserts always terminate.
+      LRU_Remove(old);
+      LRU_Append(&lru_, old);
+      hot_skips++;
+      continue;
+    }
     bool erased = FinishErase(table_.Remove(old->key(), old->hash));
     if (!erased) {  // to avoid unused variable when compiled NDEBUG
       assert(erased);
@@ -341,6 +546,7 @@ class ShardedLRUCache : public Cache {
   LRUCache shard_[kNumShards];
   port::Mutex id_mutex_;
   uint64_t last_id_;
+  FrequencySketch* sketch_;  // Null unless hot-key tracking is on
 
   static inline uint32_t HashSlice(const Slice& s) {
     return Hash(s.data(), s.size(), 0);
@@ -349,26 +555,49 @@ class ShardedLRUCache : public Cache {
   static uint32_t Shard(uint32_t hash) { return hash >> (32 - kNumShardBits); }
 
  public:
-  explicit ShardedLRUCache(size_t capacity) : last_id_(0) {
+  ShardedLRUCache(size_t capacity, bool track_hot_keys,
+                  CacheAllocator* allocator)
+      : last_id_(0),
+        sketch_(track_hot_keys ? new FrequencySketch : nullptr) {
     const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
     for (int s = 0; s < kNumShards; s++) {
       shard_[s].SetCapacity(per_shard);
+      shard_[s].SetSketch(sketch_);
+      shard_[s].SetAllocator(allocator);
     }
   }
-  ~ShardedLRUCache() override {}
+  ~ShardedLRUCache() override { delete sketch_; }
   Handle* Insert(const Slice& key, void* value, size_t charge,
                  void (*deleter)(const Slice& key, void* value)) override {
     const uint32_t hash = HashSlice(key);
     return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
   }
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value),
+                 Priority priority) override {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      priority);
+  }
   Handle* Lookup(const Slice& key) override {
     const uint32_t hash = HashSlice(key);
+    if (sketch_ != nullptr) {
+      sketch_->Add(hash);
+    }
     return shard_[Shard(hash)].Lookup(key, hash);
   }
   void Release(Handle* handle) override {
     LRUHandle* h = reinterpret_cast<LRUHandle*>(handle);
     shard_[Shard(h->hash)].Release(handle);
   }
+  std::string FrequencyReport() const override {
+    return sketch_ != nullptr ? sketch_->Report() : std::string();
+  }
+  void ApplyToAll(void (*fn)(const Slice&, void*, void*), void* arg) override {
+    for (int s = 0; s < kNumShards; s++) {
+      shard_[s].ApplyToAll(fn, arg);
+    }
+  }
   void Erase(const Slice& key) override {
     const uint32_t hash = HashSlice(key);
     shard_[Shard(hash)].Erase(key, hash);
@@ -394,8 +623,351 @@ class ShardedLRUCache : public Cache {
   }
 };
 
+// CLOCK cache implementation
+//
+// A CLOCK cache trades exact recency order for much shorter critical
+// sections: a hit only bumps an atomic reference count and sets an
+// atomic "recently used" bit, and Release() usually takes no lock at
+// all.  Eviction sweeps a clock hand around a circular ring, evicting
+// entries whose bit is clear and clearing the bit of entries it skips.
+// Combined with a larger shard count than ShardedLRUCache, this keeps
+// many concurrent readers off each other's mutexes.
+
+struct ClockHandle {
+  void* value;
+  void (*deleter)(const Slice&, void* value);
+  ClockHandle* next_hash;
+  ClockHandle* next;  // Circular clock ring links; guarded by shard mutex
+  ClockHandle* prev;
+  size_t charge;
+  size_t key_length;
+  bool in_cache;  // Whether entry is in the cache; guarded by shard mutex
+  std::atomic<uint32_t> refs;  // Includes cache reference, if present
+  std::atomic<bool> referenced;  // CLOCK bit; set on every hit
+  uint32_t hash;
+  char key_data[1];  // Beginning of key
+
+  Slice key() const {
+    assert(next != this);
+    return Slice(key_data, key_length);
+  }
+};
+
+// A single shard of the sharded clock cache.
+class ClockCacheShard {
+ public:
+  ClockCacheShard() : capacity_(0), usage_(0) {
+    ring_.next = &ring_;
+    ring_.prev = &ring_;
+    hand_ = &ring_;
+  }
+
+  ~ClockCacheShard() {
+    for (ClockHandle* e = ring_.next; e != &ring_;) {
+      ClockHandle* next = e->next;
+      assert(e->in_cache);
+      assert(e->refs.load(std::memory_order_relaxed) == 1);
+      e->in_cache = false;
+      Unref(e);
+      e = next;
+    }
+  }
+
+  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+
+  Cache::Handle* Insert(const Slice& key, uint32_t hash, void* value,
+                        size_t charge,
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Priority priority = Cache::kHighPriority) {
+    (void)priority;  // CLOCK has no strict recency order to bias
+    ClockHandle* e = reinterpret_cast<ClockHandle*>(
+        malloc(sizeof(ClockHandle) - 1 + key.size()));
+    e->value = value;
+    e->deleter = deleter;
+    e->charge = charge;
+    e->key_length = key.size();
+    e->hash = hash;
+    e->in_cache = false;
+    new (&e->refs) std::atomic<uint32_t>(1);  // for the returned handle.
+    new (&e->referenced) std::atomic<bool>(false);
+    std::memcpy(e->key_data, key.data(), key.size());
+
+    MutexLock l(&mutex_);
+    if (capacity_ > 0) {
+      e->refs.fetch_add(1, std::memory_order_relaxed);  // cache's reference.
+      e->in_cache = true;
+      usage_ += charge;
+      // Insert just behind the hand so new entries get a full sweep
+      // before they are eviction candidates.
+      e->next = hand_;
+      e->prev = hand_->prev;
+      e->prev->next = e;
+      e->next->prev = e;
+      FinishErase(table_.Insert(e));
+      EvictIfNeeded();
+    } else {  // don't cache. (capacity_==0 is supported and turns off caching.)
+      e->next = nullptr;
+    }
+    return reinterpret_cast<Cache::Handle*>(e);
+  }
+
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash) {
+    MutexLock l(&mutex_);
+    ClockHandle* e = table_.Lookup(key, hash);
+    if (e != nullptr) {
+      e->refs.fetch_add(1, std::memory_order_relaxed);
+      e->referenced.store(true, std::memory_order_relaxed);
+    }
+    return reinterpret_cast<Cache::Handle*>(e);
+  }
+
+  void Release(Cache::Handle* handle) {
+    // Lock-free: an entry still in the cache keeps refs >= 1, so only
+    // the final release of an already-erased entry frees it.
+    Unref(reinterpret_cast<ClockHandle*>(handle));
+  }
+
+  void Erase(const Slice& key, uint32_t hash) {
+    MutexLock l(&mutex_);
+    FinishErase(table_.Remove(key, hash));
+  }
+
+  void Prune() {
+    MutexLock l(&mutex_);
+    ClockHandle* e = ring_.next;
+    while (e != &ring_) {
+      ClockHandle* next = e->next;
+      if (e->refs.load(std::memory_order_relaxed) == 1) {
+        FinishErase(table_.Remove(e->key(), e->hash));
+      }
+      e = next;
+    }
+  }
+
+  size_t TotalCharge() const {
+    MutexLock l(&mutex_);
+    return usage_;
+  }
+
+ private:
+  static void Unref(ClockHandle* e) {
+    const uint32_t old_refs = e->refs.fetch_sub(1, std::memory_order_acq_rel);
+    assert(old_refs > 0);
+    if (old_refs == 1) {  // Deallocate.
+      assert(!e->in_cache);
+      (*e->deleter)(e->key(), e->value);
+      free(e);
+    }
+  }
+
+  // If e != nullptr, finish removing *e from the cache; it has already
+  // been removed from the hash table.
+  void FinishErase(ClockHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (e != nullptr) {
+      assert(e->in_cache);
+      if (hand_ == e) {
+        hand_ = e->next;
+      }
+      e->next->prev = e->prev;
+      e->prev->next = e->next;
+      e->in_cache = false;
+      usage_ -= e->charge;
+      Unref(e);
+    }
+  }
+
+  void EvictIfNeeded() EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    // Two full sweeps suffice: the first clears reference bits, the
+    // second evicts.  Entries held by clients are never evicted.
+    size_t max_steps = 2 * table_.Length() + 2;
+    while (usage_ > capacity_ && max_steps-- > 0) {
+      if (hand_ == &ring_) {  // Skip the dummy head.
+        hand_ = hand_->next;
+        if (hand_ == &ring_) break;  // Ring is empty.
+        continue;
+      }
+      ClockHandle* e = hand_;
+      hand_ = hand_->next;
+      if (e->refs.load(std::memory_order_relaxed) > 1) {
+        continue;  // In use by a client.
+      }
+      if (e->referenced.exchange(false, std::memory_order_relaxed)) {
+        continue;  // Recently used; give it another sweep.
+      }
+      FinishErase(table_.Remove(e->key(), e->hash));
+    }
+  }
+
+  // Initialized before use.
+  size_t capacity_;
+
+  // mutex_ protects the ring, the table and usage_.
+  mutable port::Mutex mutex_;
+  size_t usage_ GUARDED_BY(mutex_);
+
+  // Dummy head of the circular clock ring and the current hand.
+  ClockHandle ring_ GUARDED_BY(mutex_);
+  ClockHandle* hand_ GUARDED_BY(mutex_);
+
+  HandleTable<ClockHandle> table_ GUARDED_BY(mutex_);
+};
+
+static const int kNumClockShardBits = 6;
+static const int kNumClockShards = 1 << kNumClockShardBits;
+
+class ShardedClockCache : public Cache {
+ private:
+  ClockCacheShard shard_[kNumClockShards];
+  port::Mutex id_mutex_;
+  uint64_t last_id_;
+
+  static inline uint32_t HashSlice(const Slice& s) {
+    return Hash(s.data(), s.size(), 0);
+  }
+
+  static uint32_t Shard(uint32_t hash) {
+    return hash >> (32 - kNumClockShardBits);
+  }
+
+ public:
+  explicit ShardedClockCache(size_t capacity) : last_id_(0) {
+    const size_t per_shard = (capacity + (kNumClockShards - 1)) / kNumClockShards;
+    for (int s = 0; s < kNumClockShards; s++) {
+      shard_[s].SetCapacity(per_shard);
+    }
+  }
+  ~ShardedClockCache() override {}
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value)) override {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
+  }
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value),
+                 Priority priority) override {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      priority);
+  }
+  Handle* Lookup(const Slice& key) override {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Lookup(key, hash);
+  }
+  void Release(Handle* handle) override {
+    ClockHandle* h = reinterpret_cast<ClockHandle*>(handle);
+    shard_[Shard(h->hash)].Release(handle);
+  }
+  void Erase(const Slice& key) override {
+    const uint32_t hash = HashSlice(key);
+    shard_[Shard(hash)].Erase(key, hash);
+  }
+  void* Value(Handle* handle) override {
+    return reinterpret_cast<ClockHandle*>(handle)->value;
+  }
+  uint64_t NewId() override {
+    MutexLock l(&id_mutex_);
+    return ++(last_id_);
+  }
+  void Prune() override {
+    for (int s = 0; s < kNumClockShards; s++) {
+      shard_[s].Prune();
+    }
+  }
+  size_t TotalCharge() const override {
+    size_t total = 0;
+    for (int s = 0; s < kNumClockShards; s++) {
+      total += shard_[s].TotalCharge();
+    }
+    return total;
+  }
+};
+
 }  // end anonymous namespace
 
-Cache* NewLRUCache(size_t capacity) { return new ShardedLRUCache(capacity); }
+Cache* NewLRUCache(size_t capacity) {
+  return new ShardedLRUCache(capacity, false, nullptr);
+}
+
+Cache* NewLRUCache(size_t capacity, bool track_hot_keys) {
+  return new ShardedLRUCache(capacity, track_hot_keys, nullptr);
+}
+
+Cache* NewLRUCache(size_t capacity, bool track_hot_keys,
+                   CacheAllocator* allocator) {
+  return new ShardedLRUCache(capacity, track_hot_keys, allocator);
+}
+
+Cache* NewClockCache(size_t capacity) {
+  return new ShardedClockCache(capacity);
+}
+
+namespace {
+
+// Per-client view over a shared cache; see NewQuotaCache().
+class QuotaCache : public Cache {
+ public:
+  QuotaCache(Cache* base, size_t quota) : base_(base), quota_(quota) {
+    usage_.store(0, std::memory_order_relaxed);
+  }
+  ~QuotaCache() override {}
+
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value)) override {
+    return Insert(key, value, charge, deleter, kHighPriority);
+  }
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value),
+                 Priority priority) override {
+    // Track this client's resident bytes via a wrapping deleter.
+    Wrapper* wrapper = new Wrapper;
+    wrapper->cache = this;
+    wrapper->deleter = deleter;
+    wrapper->charge = charge;
+    wrapper->value = value;
+    const size_t usage =
+        usage_.fetch_add(charge, std::memory_order_relaxed) + charge;
+    if (usage > quota_) {
+      priority = kLowPriority;  // Over budget: first in line to evict
+    }
+    return base_->Insert(key, wrapper, charge, &WrappedDeleter, priority);
+  }
+  Handle* Lookup(const Slice& key) override { return base_->Lookup(key); }
+  void Release(Handle* handle) override { base_->Release(handle); }
+  void Erase(const Slice& key) override { base_->Erase(key); }
+  void* Value(Handle* handle) override {
+    return reinterpret_cast<Wrapper*>(base_->Value(handle))->value;
+  }
+  uint64_t NewId() override { return base_->NewId(); }
+  void Prune() override { base_->Prune(); }
+  size_t TotalCharge() const override {
+    return usage_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Wrapper {
+    QuotaCache* cache;
+    void (*deleter)(const Slice&, void*);
+    size_t charge;
+    void* value;
+  };
+
+  static void WrappedDeleter(const Slice& key, void* value) {
+    Wrapper* wrapper = reinterpret_cast<Wrapper*>(value);
+    wrapper->cache->usage_.fetch_sub(wrapper->charge,
+                                     std::memory_order_relaxed);
+    (*wrapper->deleter)(key, wrapper->value);
+    delete wrapper;
+  }
+
+  Cache* const base_;
+  const size_t quota_;
+  std::atomic<size_t> usage_;
+};
+
+}  // namespace
+
+Cache* NewQuotaCache(Cache* base, size_t quota) {
+  return new QuotaCache(base, quota);
+}
 
 }  // namespace leveldb
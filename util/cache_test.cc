@@ -221,4 +221,87 @@ TEST_F(CacheTest, ZeroSizeCache) {
   ASSERT_EQ(-1, Lookup(1));
 }
 
+// The clock cache shares the Cache interface; run the semantics that do
+// not depend on exact LRU ordering against it as well.
+class ClockCacheTest : public CacheTest {
+ public:
+  ClockCacheTest() {
+    delete cache_;
+    cache_ = NewClockCache(kCacheSize);
+  }
+};
+
+TEST_F(ClockCacheTest, HitAndMiss) {
+  ASSERT_EQ(-1, Lookup(100));
+
+  Insert(100, 101);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+
+  Insert(100, 102);
+  ASSERT_EQ(102, Lookup(100));
+
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(100, deleted_keys_[0]);
+  ASSERT_EQ(101, deleted_values_[0]);
+}
+
+TEST_F(ClockCacheTest, Erase) {
+  Erase(200);
+  ASSERT_EQ(0, deleted_keys_.size());
+
+  Insert(100, 101);
+  Erase(100);
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(100, deleted_keys_[0]);
+}
+
+TEST_F(ClockCacheTest, EntriesArePinned) {
+  Insert(100, 101);
+  Cache::Handle* h1 = cache_->Lookup(EncodeKey(100));
+  ASSERT_EQ(101, DecodeValue(cache_->Value(h1)));
+
+  Erase(100);
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(0, deleted_keys_.size());
+
+  cache_->Release(h1);
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(100, deleted_keys_[0]);
+}
+
+TEST_F(ClockCacheTest, EvictsWhenFull) {
+  // Inserting far more than the capacity must keep usage bounded
+  // without evicting pinned entries.
+  Cache::Handle* pinned = InsertAndReturnHandle(-1000, 1);
+  for (int i = 0; i < 10 * kCacheSize; i++) {
+    Insert(1000 + i, 2000 + i);
+  }
+  ASSERT_LE(cache_->TotalCharge(), kCacheSize + 64);  // one per shard slack
+  ASSERT_EQ(1, DecodeValue(cache_->Value(pinned)));
+  cache_->Release(pinned);
+}
+
+TEST_F(ClockCacheTest, Prune) {
+  Insert(1, 100);
+  Insert(2, 200);
+
+  Cache::Handle* handle = cache_->Lookup(EncodeKey(1));
+  ASSERT_TRUE(handle);
+  cache_->Prune();
+  cache_->Release(handle);
+
+  ASSERT_EQ(100, Lookup(1));
+  ASSERT_EQ(-1, Lookup(2));
+}
+
+TEST_F(ClockCacheTest, ZeroSizeCache) {
+  delete cache_;
+  cache_ = NewClockCache(0);
+
+  Insert(1, 100);
+  ASSERT_EQ(-1, Lookup(1));
+}
+
 }  // namespace leveldb
@@ -46,6 +46,27 @@ char* EncodeVarint32(char* dst, uint32_t v) {
   return reinterpret_cast<char*>(ptr);
 }
 
+void PutFixed32BE(std::string* dst, uint32_t value) {
+  char buf[sizeof(value)];
+  EncodeFixed32BE(buf, value);
+  dst->append(buf, sizeof(buf));
+}
+
+void PutFixed64BE(std::string* dst, uint64_t value) {
+  char buf[sizeof(value)];
+  EncodeFixed64BE(buf, value);
+  dst->append(buf, sizeof(buf));
+}
+
+void PutFixed64BEValues(std::string* dst, const uint64_t* values, size_t n) {
+  const size_t old_size = dst->size();
+  dst->resize(old_size + n * sizeof(uint64_t));
+  char* out = &(*dst)[old_size];
+  for (size_t i = 0; i < n; i++) {
+    EncodeFixed64BE(out + i * sizeof(uint64_t), values[i]);
+  }
+}
+
 void PutVarint32(std::string* dst, uint32_t v) {
   char buf[5];
   char* ptr = EncodeVarint32(buf, v);
@@ -23,6 +23,14 @@ namespace leveldb {
 void PutFixed32(std::string* dst, uint32_t value);
 void PutFixed64(std::string* dst, uint64_t value);
 void PutVarint32(std::string* dst, uint32_t value);
+// Big-endian fixed-width variants: the encoded bytes compare (memcmp /
+// bytewise) in the same order as the integers, so they can be used
+// directly as sortable key fields.
+void PutFixed32BE(std::string* dst, uint32_t value);
+void PutFixed64BE(std::string* dst, uint64_t value);
+// Append "n" big-endian 64-bit fields with a single resize -- the
+// common "pack several ids/timestamps into one sortable key" pattern.
+void PutFixed64BEValues(std::string* dst, const uint64_t* values, size_t n);
 void PutVarint64(std::string* dst, uint64_t value);
 void PutLengthPrefixedSlice(std::string* dst, const Slice& value);
 
@@ -61,6 +69,28 @@ inline void EncodeFixed32(char* dst, uint32_t value) {
   buffer[3] = static_cast<uint8_t>(value >> 24);
 }
 
+inline void EncodeFixed32BE(char* dst, uint32_t value) {
+  uint8_t* const buffer = reinterpret_cast<uint8_t*>(dst);
+  buffer[0] = static_cast<uint8_t>(value >> 24);
+  buffer[1] = static_cast<uint8_t>(value >> 16);
+  buffer[2] = static_cast<uint8_t>(value >> 8);
+  buffer[3] = static_cast<uint8_t>(value);
+}
+
+inline void EncodeFixed64BE(char* dst, uint64_t value) {
+  uint8_t* const buffer = reinterpret_cast<uint8_t*>(dst);
+
+  // Recent clang and gcc optimize this to a bswap + mov.
+  buffer[0] = static_cast<uint8_t>(value >> 56);
+  buffer[1] = static_cast<uint8_t>(value >> 48);
+  buffer[2] = static_cast<uint8_t>(value >> 40);
+  buffer[3] = static_cast<uint8_t>(value >> 32);
+  buffer[4] = static_cast<uint8_t>(value >> 24);
+  buffer[5] = static_cast<uint8_t>(value >> 16);
+  buffer[6] = static_cast<uint8_t>(value >> 8);
+  buffer[7] = static_cast<uint8_t>(value);
+}
+
 inline void EncodeFixed64(char* dst, uint64_t value) {
   uint8_t* const buffer = reinterpret_cast<uint8_t*>(dst);
 
@@ -88,6 +118,26 @@ inline uint32_t DecodeFixed32(const char* ptr) {
          (static_cast<uint32_t>(buffer[3]) << 24);
 }
 
+inline uint32_t DecodeFixed32BE(const char* ptr) {
+  const uint8_t* const buffer = reinterpret_cast<const uint8_t*>(ptr);
+  return (static_cast<uint32_t>(buffer[0]) << 24) |
+         (static_cast<uint32_t>(buffer[1]) << 16) |
+         (static_cast<uint32_t>(buffer[2]) << 8) |
+         static_cast<uint32_t>(buffer[3]);
+}
+
+inline uint64_t DecodeFixed64BE(const char* ptr) {
+  const uint8_t* const buffer = reinterpret_cast<const uint8_t*>(ptr);
+  return (static_cast<uint64_t>(buffer[0]) << 56) |
+         (static_cast<uint64_t>(buffer[1]) << 48) |
+         (static_cast<uint64_t>(buffer[2]) << 40) |
+         (static_cast<uint64_t>(buffer[3]) << 32) |
+         (static_cast<uint64_t>(buffer[4]) << 24) |
+         (static_cast<uint64_t>(buffer[5]) << 16) |
+         (static_cast<uint64_t>(buffer[6]) << 8) |
+         static_cast<uint64_t>(buffer[7]);
+}
+
 inline uint64_t DecodeFixed64(const char* ptr) {
   const uint8_t* const buffer = reinterpret_cast<const uint8_t*>(ptr);
 
@@ -117,6 +167,30 @@ inline const char* GetVarint32Ptr(const char* p, const char* limit,
   return GetVarint32PtrFallback(p, limit, value);
 }
 
+// Decode three consecutive varint32s starting at "p", as produced by
+// three PutVarint32() calls (e.g. a block entry's shared/non_shared/
+// value_length triple).  The common all-one-byte case is decided with
+// a single fused branch.  Returns nullptr on a malformed or truncated
+// encoding.
+inline const char* GetVarint32TriplePtr(const char* p, const char* limit,
+                                        uint32_t* v1, uint32_t* v2,
+                                        uint32_t* v3) {
+  if (limit - p >= 3) {
+    const uint8_t b0 = static_cast<uint8_t>(p[0]);
+    const uint8_t b1 = static_cast<uint8_t>(p[1]);
+    const uint8_t b2 = static_cast<uint8_t>(p[2]);
+    if (((b0 | b1 | b2) & 128) == 0) {
+      *v1 = b0;
+      *v2 = b1;
+      *v3 = b2;
+      return p + 3;
+    }
+  }
+  if ((p = GetVarint32Ptr(p, limit, v1)) == nullptr) return nullptr;
+  if ((p = GetVarint32Ptr(p, limit, v2)) == nullptr) return nullptr;
+  return GetVarint32Ptr(p, limit, v3);
+}
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_UTIL_CODING_H_
@@ -190,4 +190,40 @@ TEST(Coding, Strings) {
   ASSERT_EQ("", input.ToString());
 }
 
+TEST(Coding, Varint32Triple) {
+  std::string s;
+  std::vector<uint32_t> values;
+  for (uint32_t i = 0; i < 64; i++) {
+    // Mix of one-byte and multi-byte encodings.
+    const uint32_t a = i;
+    const uint32_t b = i * 1000;
+    const uint32_t c = i * 1000000;
+    values.push_back(a);
+    values.push_back(b);
+    values.push_back(c);
+    PutVarint32(&s, a);
+    PutVarint32(&s, b);
+    PutVarint32(&s, c);
+  }
+  const char* p = s.data();
+  const char* limit = p + s.size();
+  for (size_t i = 0; i < values.size(); i += 3) {
+    uint32_t a, b, c;
+    p = GetVarint32TriplePtr(p, limit, &a, &b, &c);
+    ASSERT_TRUE(p != nullptr);
+    ASSERT_EQ(values[i], a);
+    ASSERT_EQ(values[i + 1], b);
+    ASSERT_EQ(values[i + 2], c);
+  }
+  ASSERT_EQ(p, limit);
+
+  // Truncated input fails cleanly.
+  uint32_t a, b, c;
+  std::string t;
+  PutVarint32(&t, 1);
+  PutVarint32(&t, 1 << 20);
+  ASSERT_TRUE(GetVarint32TriplePtr(t.data(), t.data() + t.size(), &a, &b,
+                                   &c) == nullptr);
+}
+
 }  // namespace leveldb
@@ -17,6 +17,13 @@ namespace leveldb {
 
 Comparator::~Comparator() = default;
 
+bool Comparator::OrderPreservingPrefix(const Slice& key,
+                                       uint32_t* prefix) const {
+  (void)key;
+  (void)prefix;
+  return false;
+}
+
 namespace {
 class BytewiseComparatorImpl : public Comparator {
  public:
@@ -28,6 +35,22 @@ class BytewiseComparatorImpl : public Comparator {
     return a.compare(b);
   }
 
+  bool OrderPreservingPrefix(const Slice& key,
+                             uint32_t* prefix) const override {
+    // Big-endian packing of the first four bytes, zero padded.  A zero
+    // pad byte sorts before any key byte at the same position, which
+    // matches byte-wise ordering of a proper prefix.
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; i++) {
+      value <<= 8;
+      if (i < key.size()) {
+        value |= static_cast<unsigned char>(key[i]);
+      }
+    }
+    *prefix = value;
+    return true;
+  }
+
   void FindShortestSeparator(std::string* start,
                              const Slice& limit) const override {
     // Find length of common prefix
@@ -41,9 +64,13 @@ class BytewiseComparatorImpl : public Comparator {
     if (diff_index >= min_length) {
       // Do not shorten if one string is a prefix of the other
     } else {
-      uint8_t diff_byte = static_cast<uint8_t>((*start)[diff_index]);
+      const uint8_t diff_byte = static_cast<uint8_t>((*start)[diff_index]);
+      const uint8_t limit_byte = static_cast<uint8_t>(limit[diff_index]);
       if (diff_byte < static_cast<uint8_t>(0xff) &&
-          diff_byte + 1 < static_cast<uint8_t>(limit[diff_index])) {
+          (diff_byte + 1 < limit_byte ||
+           // Incrementing to exactly the limit's byte still separates
+           // when the limit continues past this position.
+           (diff_byte + 1 == limit_byte && limit.size() > diff_index + 1))) {
         (*start)[diff_index]++;
         start->resize(diff_index + 1);
         assert(Compare(*start, limit) < 0);
@@ -67,6 +94,58 @@ class BytewiseComparatorImpl : public Comparator {
 };
 }  // namespace
 
+namespace {
+
+class TimestampSuffixedComparator : public Comparator {
+ public:
+  TimestampSuffixedComparator(const Comparator* base, size_t timestamp_size)
+      : base_(base), timestamp_size_(timestamp_size) {}
+
+  const char* Name() const override {
+    return "leveldb.TimestampSuffixedComparator";
+  }
+
+  int Compare(const Slice& a, const Slice& b) const override {
+    const Slice user_a = StripTimestamp(a);
+    const Slice user_b = StripTimestamp(b);
+    const int r = base_->Compare(user_a, user_b);
+    if (r != 0) {
+      return r;
+    }
+    // Newer (larger) timestamps sort first.
+    return -Timestamp(a).compare(Timestamp(b));
+  }
+
+  void FindShortestSeparator(std::string* start,
+                             const Slice& limit) const override {
+    // Shortened keys would lose their timestamp suffix; keep as-is.
+    (void)start;
+    (void)limit;
+  }
+
+  void FindShortSuccessor(std::string* key) const override { (void)key; }
+
+ private:
+  Slice StripTimestamp(const Slice& key) const {
+    assert(key.size() >= timestamp_size_);
+    return Slice(key.data(), key.size() - timestamp_size_);
+  }
+  Slice Timestamp(const Slice& key) const {
+    assert(key.size() >= timestamp_size_);
+    return Slice(key.data() + key.size() - timestamp_size_, timestamp_size_);
+  }
+
+  const Comparator* const base_;
+  const size_t timestamp_size_;
+};
+
+}  // namespace
+
+const Comparator* NewTimestampSuffixedComparator(const Comparator* base,
+                                                 size_t timestamp_size) {
+  return new TimestampSuffixedComparator(base, timestamp_size);
+}
+
 const Comparator* BytewiseComparator() {
   static NoDestructor<BytewiseComparatorImpl> singleton;
   return singleton.get();
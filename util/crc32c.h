@@ -19,6 +19,11 @@ uint32_t Extend(uint32_t init_crc, const char* data, size_t n);
 // Return the crc32c of data[0,n-1]
 inline uint32_t Value(const char* data, size_t n) { return Extend(0, data, n); }
 
+// Return the crc32c of concat(A, B) given crc1 = crc32c(A),
+// crc2 = crc32c(B) and len2 = |B|.  Lets large buffers be checksummed
+// in independent chunks (possibly on several threads) and merged.
+uint32_t Combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
 static const uint32_t kMaskDelta = 0xa282ead8ul;
 
 // Return a masked representation of crc.
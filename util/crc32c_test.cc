@@ -52,5 +52,18 @@ TEST(CRC, Mask) {
   ASSERT_EQ(crc, Unmask(Unmask(Mask(Mask(crc)))));
 }
 
+TEST(CRC, Combine) {
+  char buf[1000];
+  for (int i = 0; i < 1000; i++) {
+    buf[i] = static_cast<char>(i * 11 + 3);
+  }
+  const uint32_t whole = Value(buf, 1000);
+  for (int split = 0; split <= 1000; split += 97) {
+    const uint32_t crc1 = Value(buf, split);
+    const uint32_t crc2 = Value(buf + split, 1000 - split);
+    ASSERT_EQ(whole, Combine(crc1, crc2, 1000 - split));
+  }
+}
+
 }  // namespace crc32c
 }  // namespace leveldb
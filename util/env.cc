@@ -22,16 +22,141 @@ Status Env::NewAppendableFile(const std::string& fname, WritableFile** result) {
   return Status::NotSupported("NewAppendableFile", fname);
 }
 
+Status Env::NewUnbufferedRandomAccessFile(const std::string& fname,
+                                          RandomAccessFile** result) {
+  return NewRandomAccessFile(fname, result);
+}
+
+Status Env::NewMappedRandomAccessFile(const std::string& fname,
+                                      AccessPattern pattern,
+                                      RandomAccessFile** result) {
+  (void)pattern;
+  return NewRandomAccessFile(fname, result);
+}
+
+Status Env::NewUnbufferedWritableFile(const std::string& fname,
+                                      WritableFile** result) {
+  return NewWritableFile(fname, result);
+}
+
 Status Env::RemoveDir(const std::string& dirname) { return DeleteDir(dirname); }
 Status Env::DeleteDir(const std::string& dirname) { return RemoveDir(dirname); }
 
 Status Env::RemoveFile(const std::string& fname) { return DeleteFile(fname); }
 Status Env::DeleteFile(const std::string& fname) { return RemoveFile(fname); }
 
+Status Env::LinkFile(const std::string& src, const std::string& target) {
+  return CopyFile(src, target);
+}
+
+void Env::Schedule(void (*function)(void* arg), void* arg,
+                   SchedulePriority priority) {
+  (void)priority;
+  Schedule(function, arg);
+}
+
+Status Env::GetFileModificationTime(const std::string& fname,
+                                    uint64_t* mtime) {
+  return Status::NotSupported("GetFileModificationTime", fname);
+}
+
+void Env::InvalidateCache(const std::string& fname) {
+  // Best effort only.
+  (void)fname;
+}
+
+Status Env::PinCurrentThread(int cpu) {
+  (void)cpu;
+  return Status::NotSupported("PinCurrentThread");
+}
+
+int Env::GetCurrentCpu() { return -1; }
+
+void Env::SetBackgroundThreads(int n) {
+  // Single background thread by default.
+  (void)n;
+}
+
+Status Env::CopyFile(const std::string& src, const std::string& target) {
+  if (FileExists(target)) {
+    return Status::IOError(target, "already exists");
+  }
+  SequentialFile* in;
+  Status s = NewSequentialFile(src, &in);
+  if (!s.ok()) {
+    return s;
+  }
+  WritableFile* out;
+  s = NewWritableFile(target, &out);
+  if (!s.ok()) {
+    delete in;
+    return s;
+  }
+  static const size_t kBufferSize = 65536;
+  char* buffer = new char[kBufferSize];
+  while (s.ok()) {
+    Slice chunk;
+    s = in->Read(kBufferSize, &chunk, buffer);
+    if (!s.ok() || chunk.empty()) {
+      break;
+    }
+    s = out->Append(chunk);
+  }
+  delete[] buffer;
+  if (s.ok()) {
+    s = out->Sync();
+  }
+  if (s.ok()) {
+    s = out->Close();
+  }
+  delete out;
+  delete in;
+  if (!s.ok()) {
+    RemoveFile(target);
+  }
+  return s;
+}
+
 SequentialFile::~SequentialFile() = default;
 
 RandomAccessFile::~RandomAccessFile() = default;
 
+void WritableFile::Preallocate(uint64_t size) { (void)size; }
+
+Status Env::ReuseWritableFile(const std::string& fname,
+                              const std::string& old_fname,
+                              WritableFile** result) {
+  Status s = RenameFile(old_fname, fname);
+  if (!s.ok()) {
+    return s;
+  }
+  return NewWritableFile(fname, result);
+}
+
+void WritableFile::HintStreamingWrites(size_t buffer_bytes) {
+  (void)buffer_bytes;
+}
+
+Status WritableFile::AppendV(const Slice* slices, size_t count) {
+  Status s;
+  for (size_t i = 0; s.ok() && i < count; i++) {
+    s = Append(slices[i]);
+  }
+  return s;
+}
+
+void RandomAccessFile::Prefetch(uint64_t offset, size_t n) const {
+  (void)offset;
+  (void)n;
+}
+
+void RandomAccessFile::ReadBatch(ReadRequest* requests, size_t count) const {
+  for (size_t i = 0; i < count; i++) {
+    requests[i].status = Read(requests[i].offset, requests[i].n,
+                              &requests[i].result, requests[i].scratch);
+  }
+}
+
 WritableFile::~WritableFile() = default;
 
 Logger::~Logger() = default;
@@ -0,0 +1,308 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// An Env wrapper that attributes file I/O to the database file type it
+// serves (WAL, table, manifest, ...), accumulating operation counts,
+// bytes and latency histograms per type.  Surfaced through the
+// "leveldb.io-stats" property.
+
+#include <atomic>
+#include <cstdio>
+#include <set>
+#include <string>
+
+#include "db/filename.h"
+#include "leveldb/env.h"
+#include "util/histogram.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+namespace {
+
+// Stats slot per file class.  "Other" catches unclassifiable names.
+enum IOClass { kIOWal, kIOTable, kIOManifest, kIOBlob, kIOOther, kNumIOClasses };
+
+const char* IOClassName(int c) {
+  switch (c) {
+    case kIOWal:
+      return "wal";
+    case kIOTable:
+      return "table";
+    case kIOManifest:
+      return "manifest";
+    case kIOBlob:
+      return "blob";
+    default:
+      return "other";
+  }
+}
+
+IOClass Classify(const std::string& fname) {
+  const size_t sep = fname.rfind('/');
+  const std::string basename =
+      sep == std::string::npos ? fname : fname.substr(sep + 1);
+  uint64_t number;
+  FileType type;
+  if (!ParseFileName(basename, &number, &type)) {
+    return kIOOther;
+  }
+  switch (type) {
+    case kLogFile:
+      return kIOWal;
+    case kTableFile:
+    case kTempFile:
+      return kIOTable;
+    case kDescriptorFile:
+    case kCurrentFile:
+      return kIOManifest;
+    case kBlobFile:
+      return kIOBlob;
+    default:
+      return kIOOther;
+  }
+}
+
+struct IOStats {
+  std::atomic<uint64_t> reads{0};
+  std::atomic<uint64_t> read_bytes{0};
+  std::atomic<uint64_t> writes{0};
+  std::atomic<uint64_t> write_bytes{0};
+  std::atomic<uint64_t> syncs{0};
+  LatencyHistogram read_latency;
+  LatencyHistogram write_latency;
+  LatencyHistogram sync_latency;
+};
+
+class InstrumentedEnv;
+
+// Live instrumented envs, so GetEnvIOStats() can identify one without
+// RTTI (the library builds with -fno-rtti).
+port::Mutex g_registry_mutex;
+std::set<InstrumentedEnv*>* GetRegistry() {
+  static std::set<InstrumentedEnv*> registry;
+  return &registry;
+}
+
+class InstrumentedEnv : public EnvWrapper {
+ public:
+  explicit InstrumentedEnv(Env* base) : EnvWrapper(base) {
+    MutexLock l(&g_registry_mutex);
+    GetRegistry()->insert(this);
+  }
+  ~InstrumentedEnv() override {
+    MutexLock l(&g_registry_mutex);
+    GetRegistry()->erase(this);
+  }
+
+  Status NewSequentialFile(const std::string& fname,
+                           SequentialFile** result) override;
+  Status NewRandomAccessFile(const std::string& fname,
+                             RandomAccessFile** result) override;
+  Status NewWritableFile(const std::string& fname,
+                         WritableFile** result) override;
+  Status NewAppendableFile(const std::string& fname,
+                           WritableFile** result) override;
+  Status ReuseWritableFile(const std::string& fname,
+                           const std::string& old_fname,
+                           WritableFile** result) override;
+
+  std::string Report() const {
+    std::string out;
+    char buf[200];
+    for (int c = 0; c < kNumIOClasses; c++) {
+      const IOStats& s = stats_[c];
+      const uint64_t reads = s.reads.load(std::memory_order_relaxed);
+      const uint64_t writes = s.writes.load(std::memory_order_relaxed);
+      const uint64_t syncs = s.syncs.load(std::memory_order_relaxed);
+      if (reads == 0 && writes == 0 && syncs == 0) {
+        continue;
+      }
+      std::snprintf(
+          buf, sizeof(buf),
+          "%-8s reads=%llu (%llu bytes) writes=%llu (%llu bytes) "
+          "syncs=%llu\n",
+          IOClassName(c), static_cast<unsigned long long>(reads),
+          static_cast<unsigned long long>(
+              s.read_bytes.load(std::memory_order_relaxed)),
+          static_cast<unsigned long long>(writes),
+          static_cast<unsigned long long>(
+              s.write_bytes.load(std::memory_order_relaxed)),
+          static_cast<unsigned long long>(syncs));
+      out.append(buf);
+      if (reads > 0) {
+        out.append("  read latency:  " + s.read_latency.ToString());
+      }
+      if (writes > 0) {
+        out.append("  write latency: " + s.write_latency.ToString());
+      }
+      if (syncs > 0) {
+        out.append("  sync latency:  " + s.sync_latency.ToString());
+      }
+    }
+    return out;
+  }
+
+  IOStats* stats(IOClass c) { return &stats_[c]; }
+
+ private:
+  IOStats stats_[kNumIOClasses];
+};
+
+class InstrumentedSequentialFile : public SequentialFile {
+ public:
+  InstrumentedSequentialFile(SequentialFile* file, IOStats* stats, Env* env)
+      : file_(file), stats_(stats), env_(env) {}
+  ~InstrumentedSequentialFile() override { delete file_; }
+
+  Status Read(size_t n, Slice* result, char* scratch) override {
+    const uint64_t start = env_->NowMicros();
+    Status s = file_->Read(n, result, scratch);
+    stats_->read_latency.Record(env_->NowMicros() - start);
+    stats_->reads.fetch_add(1, std::memory_order_relaxed);
+    stats_->read_bytes.fetch_add(result->size(), std::memory_order_relaxed);
+    return s;
+  }
+  Status Skip(uint64_t n) override { return file_->Skip(n); }
+
+ private:
+  SequentialFile* const file_;
+  IOStats* const stats_;
+  Env* const env_;
+};
+
+class InstrumentedRandomAccessFile : public RandomAccessFile {
+ public:
+  InstrumentedRandomAccessFile(RandomAccessFile* file, IOStats* stats,
+                               Env* env)
+      : file_(file), stats_(stats), env_(env) {}
+  ~InstrumentedRandomAccessFile() override { delete file_; }
+
+  Status Read(uint64_t offset, size_t n, Slice* result,
+              char* scratch) const override {
+    const uint64_t start = env_->NowMicros();
+    Status s = file_->Read(offset, n, result, scratch);
+    stats_->read_latency.Record(env_->NowMicros() - start);
+    stats_->reads.fetch_add(1, std::memory_order_relaxed);
+    stats_->read_bytes.fetch_add(result->size(), std::memory_order_relaxed);
+    return s;
+  }
+
+ private:
+  RandomAccessFile* const file_;
+  IOStats* const stats_;
+  Env* const env_;
+};
+
+class InstrumentedWritableFile : public WritableFile {
+ public:
+  InstrumentedWritableFile(WritableFile* file, IOStats* stats, Env* env)
+      : file_(file), stats_(stats), env_(env) {}
+  ~InstrumentedWritableFile() override { delete file_; }
+
+  Status Append(const Slice& data) override {
+    const uint64_t start = env_->NowMicros();
+    Status s = file_->Append(data);
+    stats_->write_latency.Record(env_->NowMicros() - start);
+    stats_->writes.fetch_add(1, std::memory_order_relaxed);
+    stats_->write_bytes.fetch_add(data.size(), std::memory_order_relaxed);
+    return s;
+  }
+  Status AppendV(const Slice* slices, size_t count) override {
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+      bytes += slices[i].size();
+    }
+    const uint64_t start = env_->NowMicros();
+    Status s = file_->AppendV(slices, count);
+    stats_->write_latency.Record(env_->NowMicros() - start);
+    stats_->writes.fetch_add(1, std::memory_order_relaxed);
+    stats_->write_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return s;
+  }
+  Status Close() override { return file_->Close(); }
+  Status Flush() override { return file_->Flush(); }
+  Status Sync() override {
+    const uint64_t start = env_->NowMicros();
+    Status s = file_->Sync();
+    stats_->sync_latency.Record(env_->NowMicros() - start);
+    stats_->syncs.fetch_add(1, std::memory_order_relaxed);
+    return s;
+  }
+  void Preallocate(uint64_t size) override { file_->Preallocate(size); }
+
+ private:
+  WritableFile* const file_;
+  IOStats* const stats_;
+  Env* const env_;
+};
+
+Status InstrumentedEnv::NewSequentialFile(const std::string& fname,
+                                          SequentialFile** result) {
+  Status s = target()->NewSequentialFile(fname, result);
+  if (s.ok()) {
+    *result = new InstrumentedSequentialFile(*result, stats(Classify(fname)),
+                                             target());
+  }
+  return s;
+}
+
+Status InstrumentedEnv::NewRandomAccessFile(const std::string& fname,
+                                            RandomAccessFile** result) {
+  Status s = target()->NewRandomAccessFile(fname, result);
+  if (s.ok()) {
+    *result = new InstrumentedRandomAccessFile(*result, stats(Classify(fname)),
+                                               target());
+  }
+  return s;
+}
+
+Status InstrumentedEnv::NewWritableFile(const std::string& fname,
+                                        WritableFile** result) {
+  Status s = target()->NewWritableFile(fname, result);
+  if (s.ok()) {
+    *result =
+        new InstrumentedWritableFile(*result, stats(Classify(fname)), target());
+  }
+  return s;
+}
+
+Status InstrumentedEnv::NewAppendableFile(const std::string& fname,
+                                          WritableFile** result) {
+  Status s = target()->NewAppendableFile(fname, result);
+  if (s.ok()) {
+    *result =
+        new InstrumentedWritableFile(*result, stats(Classify(fname)), target());
+  }
+  return s;
+}
+
+Status InstrumentedEnv::ReuseWritableFile(const std::string& fname,
+                                          const std::string& old_fname,
+                                          WritableFile** result) {
+  Status s = target()->ReuseWritableFile(fname, old_fname, result);
+  if (s.ok()) {
+    *result =
+        new InstrumentedWritableFile(*result, stats(Classify(fname)), target());
+  }
+  return s;
+}
+
+}  // namespace
+
+Env* NewInstrumentedEnv(Env* base) { return new InstrumentedEnv(base); }
+
+bool GetEnvIOStats(Env* env, std::string* report) {
+  InstrumentedEnv* instrumented = static_cast<InstrumentedEnv*>(env);
+  {
+    MutexLock l(&g_registry_mutex);
+    if (GetRegistry()->count(instrumented) == 0) {
+      return false;
+    }
+  }
+  report->append(instrumented->Report());
+  return true;
+}
+
+}  // namespace leveldb
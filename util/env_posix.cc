@@ -4,6 +4,9 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 #include <sys/mman.h>
 #ifndef __Fuchsia__
 #include <sys/resource.h>
@@ -11,6 +14,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <atomic>
@@ -27,6 +31,7 @@
 #include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "leveldb/env.h"
 #include "leveldb/slice.h"
@@ -36,6 +41,10 @@
 #include "util/env_posix_test_helper.h"
 #include "util/posix_logger.h"
 
+#if HAVE_LIBURING
+#include <liburing.h>
+#endif  // HAVE_LIBURING
+
 namespace leveldb {
 
 namespace {
@@ -58,6 +67,9 @@ constexpr const int kOpenBaseFlags = 0;
 
 constexpr const size_t kWritableFileBufferSize = 65536;
 
+// Maximum pieces handed to one writev() call.
+constexpr const int kMaxWritevCount = 64;
+
 Status PosixError(const std::string& context, int error_number) {
   if (error_number == ENOENT) {
     return Status::NotFound(context, std::strerror(error_number));
@@ -136,7 +148,12 @@ class Limiter {
 class PosixSequentialFile final : public SequentialFile {
  public:
   PosixSequentialFile(std::string filename, int fd)
-      : fd_(fd), filename_(std::move(filename)) {}
+      : fd_(fd), offset_(0), filename_(std::move(filename)) {
+#if defined(__linux__)
+    // Recovery and compaction stream these files once, front to back.
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  }
   ~PosixSequentialFile() override { close(fd_); }
 
   Status Read(size_t n, Slice* result, char* scratch) override {
@@ -150,6 +167,15 @@ class PosixSequentialFile final : public SequentialFile {
         status = PosixError(filename_, errno);
         break;
       }
+      offset_ += read_size;
+#if defined(__linux__)
+      if (static_cast<size_t>(read_size) == n) {
+        // Double buffering in the page cache: start the next chunk's
+        // read while the caller parses this one.
+        ::posix_fadvise(fd_, static_cast<off_t>(offset_),
+                        static_cast<off_t>(n), POSIX_FADV_WILLNEED);
+      }
+#endif
       *result = Slice(scratch, read_size);
       break;
     }
@@ -160,11 +186,13 @@ class PosixSequentialFile final : public SequentialFile {
     if (::lseek(fd_, n, SEEK_CUR) == static_cast<off_t>(-1)) {
       return PosixError(filename_, errno);
     }
+    offset_ += n;
     return Status::OK();
   }
 
  private:
   const int fd_;
+  uint64_t offset_;  // Current read position, for read-ahead hints
   const std::string filename_;
 };
 
@@ -223,6 +251,102 @@ class PosixRandomAccessFile final : public RandomAccessFile {
     return status;
   }
 
+  void Prefetch(uint64_t offset, size_t n) const override {
+#if defined(__linux__)
+    if (has_permanent_fd_) {
+      ::posix_fadvise(fd_, static_cast<off_t>(offset),
+                      static_cast<off_t>(n), POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)offset;
+    (void)n;
+#endif
+  }
+
+  void ReadBatch(ReadRequest* requests, size_t count) const override {
+    if (count == 0) {
+      return;
+    }
+    int fd = fd_;
+    if (!has_permanent_fd_) {
+      fd = ::open(filename_.c_str(), O_RDONLY | kOpenBaseFlags);
+      if (fd < 0) {
+        Status error = PosixError(filename_, errno);
+        for (size_t i = 0; i < count; i++) {
+          requests[i].status = error;
+          requests[i].result = Slice(requests[i].scratch, 0);
+        }
+        return;
+      }
+    }
+    assert(fd != -1);
+
+    std::vector<bool> done(count, false);
+#if HAVE_LIBURING
+    // Submit all reads in as few ring submissions as possible.  Any
+    // request the ring fails to complete falls back to pread() below.
+    struct io_uring ring;
+    const unsigned depth = static_cast<unsigned>(count < 256 ? count : 256);
+    if (::io_uring_queue_init(depth, &ring, 0) == 0) {
+      size_t next = 0;       // Next request to put in the submission queue
+      size_t completed = 0;  // Completions reaped so far
+      while (completed < count) {
+        bool submitted = false;
+        while (next < count) {
+          struct io_uring_sqe* sqe = ::io_uring_get_sqe(&ring);
+          if (sqe == nullptr) {
+            break;  // Submission queue full; reap completions first.
+          }
+          ::io_uring_prep_read(sqe, fd, requests[next].scratch,
+                               requests[next].n,
+                               static_cast<off_t>(requests[next].offset));
+          ::io_uring_sqe_set_data(sqe, &requests[next]);
+          next++;
+          submitted = true;
+        }
+        if (submitted && ::io_uring_submit(&ring) < 0) {
+          break;
+        }
+        struct io_uring_cqe* cqe = nullptr;
+        if (::io_uring_wait_cqe(&ring, &cqe) != 0 || cqe == nullptr) {
+          break;
+        }
+        ReadRequest* req =
+            static_cast<ReadRequest*>(::io_uring_cqe_get_data(cqe));
+        const int res = cqe->res;
+        ::io_uring_cqe_seen(&ring, cqe);
+        if (res < 0) {
+          req->status = PosixError(filename_, -res);
+          req->result = Slice(req->scratch, 0);
+        } else {
+          req->status = Status::OK();
+          req->result = Slice(req->scratch, res);
+        }
+        done[req - requests] = true;
+        completed++;
+      }
+      ::io_uring_queue_exit(&ring);
+    }
+#endif  // HAVE_LIBURING
+
+    for (size_t i = 0; i < count; i++) {
+      if (done[i]) {
+        continue;
+      }
+      const ssize_t read_size = ::pread(fd, requests[i].scratch, requests[i].n,
+                                        static_cast<off_t>(requests[i].offset));
+      requests[i].result =
+          Slice(requests[i].scratch, (read_size < 0) ? 0 : read_size);
+      requests[i].status =
+          (read_size < 0) ? PosixError(filename_, errno) : Status::OK();
+    }
+
+    if (!has_permanent_fd_) {
+      assert(fd != fd_);
+      ::close(fd);
+    }
+  }
+
  private:
   const bool has_permanent_fd_;  // If false, the file is opened on every read.
   const int fd_;                 // -1 if has_permanent_fd_ is false.
@@ -230,6 +354,170 @@ class PosixRandomAccessFile final : public RandomAccessFile {
   const std::string filename_;
 };
 
+#if defined(__linux__)
+
+// Alignment required by O_DIRECT for both buffers and file offsets.
+constexpr const size_t kDirectIOAlignment = 4096;
+
+// Random access reads with O_DIRECT: every read is widened to aligned
+// boundaries into an aligned bounce buffer and copied out, keeping the
+// data out of the OS page cache.
+class PosixDirectRandomAccessFile final : public RandomAccessFile {
+ public:
+  PosixDirectRandomAccessFile(std::string filename, int fd)
+      : fd_(fd), filename_(std::move(filename)) {}
+
+  ~PosixDirectRandomAccessFile() override { ::close(fd_); }
+
+  Status Read(uint64_t offset, size_t n, Slice* result,
+              char* scratch) const override {
+    const uint64_t aligned_offset = offset - (offset % kDirectIOAlignment);
+    const size_t slop = static_cast<size_t>(offset - aligned_offset);
+    const size_t aligned_size =
+        ((slop + n + kDirectIOAlignment - 1) / kDirectIOAlignment) *
+        kDirectIOAlignment;
+    void* buffer = nullptr;
+    if (::posix_memalign(&buffer, kDirectIOAlignment, aligned_size) != 0) {
+      return Status::IOError(filename_, "cannot allocate aligned buffer");
+    }
+    const ssize_t read_size =
+        ::pread(fd_, buffer, aligned_size, static_cast<off_t>(aligned_offset));
+    Status status;
+    if (read_size < 0) {
+      *result = Slice(scratch, 0);
+      status = PosixError(filename_, errno);
+    } else {
+      const size_t available =
+          (static_cast<size_t>(read_size) > slop)
+              ? static_cast<size_t>(read_size) - slop
+              : 0;
+      const size_t copy = available < n ? available : n;
+      std::memcpy(scratch, static_cast<char*>(buffer) + slop, copy);
+      *result = Slice(scratch, copy);
+    }
+    std::free(buffer);
+    return status;
+  }
+
+ private:
+  const int fd_;
+  const std::string filename_;
+};
+
+// Buffered writes on top of O_DIRECT.  Full aligned buffers are
+// written in place; Sync() and Close() write the zero-padded tail
+// block and ftruncate() the file back to its logical size, leaving the
+// tail rewritable by later appends.
+class PosixDirectWritableFile final : public WritableFile {
+ public:
+  PosixDirectWritableFile(std::string filename, int fd)
+      : fd_(fd),
+        pos_(0),
+        file_offset_(0),
+        buffer_(nullptr),
+        filename_(std::move(filename)) {
+    void* buffer = nullptr;
+    if (::posix_memalign(&buffer, kDirectIOAlignment, kBufferSize) == 0) {
+      buffer_ = static_cast<char*>(buffer);
+    }
+  }
+
+  ~PosixDirectWritableFile() override {
+    if (fd_ >= 0) {
+      Close();
+    }
+    std::free(buffer_);
+  }
+
+  Status Append(const Slice& data) override {
+    if (buffer_ == nullptr) {
+      return Status::IOError(filename_, "cannot allocate aligned buffer");
+    }
+    const char* ptr = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+      const size_t room = kBufferSize - pos_;
+      const size_t copy = left < room ? left : room;
+      std::memcpy(buffer_ + pos_, ptr, copy);
+      pos_ += copy;
+      ptr += copy;
+      left -= copy;
+      if (pos_ == kBufferSize) {
+        Status s = WriteBuffer(kBufferSize);
+        if (!s.ok()) {
+          return s;
+        }
+        file_offset_ += kBufferSize;
+        pos_ = 0;
+      }
+    }
+    return Status::OK();
+  }
+
+  Status Flush() override {
+    // Partial blocks cannot be written with O_DIRECT without padding;
+    // the data is made visible by Sync() and Close().
+    return Status::OK();
+  }
+
+  Status Sync() override {
+    Status s = WriteTail();
+    if (s.ok() && ::fdatasync(fd_) != 0) {
+      s = PosixError(filename_, errno);
+    }
+    return s;
+  }
+
+  Status Close() override {
+    Status s = WriteTail();
+    if (::close(fd_) != 0 && s.ok()) {
+      s = PosixError(filename_, errno);
+    }
+    fd_ = -1;
+    return s;
+  }
+
+ private:
+  static constexpr size_t kBufferSize = 256 * 1024;
+
+  // Write exactly n (aligned) bytes from buffer_ at file_offset_.
+  Status WriteBuffer(size_t n) {
+    const ssize_t written =
+        ::pwrite(fd_, buffer_, n, static_cast<off_t>(file_offset_));
+    if (written < 0 || static_cast<size_t>(written) != n) {
+      return PosixError(filename_, written < 0 ? errno : EIO);
+    }
+    return Status::OK();
+  }
+
+  // Write the buffered tail zero-padded to the alignment and truncate
+  // the file to its logical size.  Does not consume the tail, so later
+  // appends simply rewrite the padded block.
+  Status WriteTail() {
+    if (pos_ == 0) {
+      return Status::OK();
+    }
+    const size_t padded =
+        ((pos_ + kDirectIOAlignment - 1) / kDirectIOAlignment) *
+        kDirectIOAlignment;
+    std::memset(buffer_ + pos_, 0, padded - pos_);
+    Status s = WriteBuffer(padded);
+    if (s.ok() &&
+        ::ftruncate(fd_, static_cast<off_t>(file_offset_ + pos_)) != 0) {
+      s = PosixError(filename_, errno);
+    }
+    return s;
+  }
+
+  int fd_;
+  size_t pos_;           // Bytes buffered but not yet written
+  uint64_t file_offset_; // Aligned bytes already written
+  char* buffer_;
+  const std::string filename_;
+};
+
+#endif  // defined(__linux__)
+
 // Implements random read access in a file using mmap().
 //
 // Instances of this class are thread-safe, as required by the RandomAccessFile
@@ -253,7 +541,9 @@ class PosixMmapReadableFile final : public RandomAccessFile {
 
   ~PosixMmapReadableFile() override {
     ::munmap(static_cast<void*>(mmap_base_), length_);
-    mmap_limiter_->Release();
+    if (mmap_limiter_ != nullptr) {
+      mmap_limiter_->Release();
+    }
   }
 
   Status Read(uint64_t offset, size_t n, Slice* result,
@@ -276,9 +566,23 @@ class PosixMmapReadableFile final : public RandomAccessFile {
 
 class PosixWritableFile final : public WritableFile {
  public:
+  void Preallocate(uint64_t size) override {
+#if defined(__linux__)
+    // KEEP_SIZE so short files are not padded with zeros on close.
+    ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+#else
+    (void)size;
+#endif
+  }
+
   PosixWritableFile(std::string filename, int fd)
-      : pos_(0),
+      : buf_(new char[kWritableFileBufferSize]),
+        buf_size_(kWritableFileBufferSize),
+        pos_(0),
         fd_(fd),
+        streaming_(false),
+        dirty_since_writeback_(0),
+        writeback_offset_(0),
         is_manifest_(IsManifest(filename)),
         filename_(std::move(filename)),
         dirname_(Dirname(filename_)) {}
@@ -288,6 +592,22 @@ class PosixWritableFile final : public WritableFile {
       // Ignoring any potential errors
       Close();
     }
+    delete[] buf_;
+  }
+
+  void HintStreamingWrites(size_t buffer_bytes) override {
+    if (pos_ != 0) {
+      return;  // Too late; data is already staged in the small buffer
+    }
+    size_t want = buffer_bytes;
+    if (want < kWritableFileBufferSize) want = kWritableFileBufferSize;
+    if (want > (8u << 20)) want = 8u << 20;
+    if (want != buf_size_) {
+      delete[] buf_;
+      buf_ = new char[want];
+      buf_size_ = want;
+    }
+    streaming_ = true;
   }
 
   Status Append(const Slice& data) override {
@@ -295,7 +615,7 @@ class PosixWritableFile final : public WritableFile {
     const char* write_data = data.data();
 
     // Fit as much as possible into buffer.
-    size_t copy_size = std::min(write_size, kWritableFileBufferSize - pos_);
+    size_t copy_size = std::min(write_size, buf_size_ - pos_);
     std::memcpy(buf_ + pos_, write_data, copy_size);
     write_data += copy_size;
     write_size -= copy_size;
@@ -311,7 +631,7 @@ class PosixWritableFile final : public WritableFile {
     }
 
     // Small writes go to buffer, large writes are written directly.
-    if (write_size < kWritableFileBufferSize) {
+    if (write_size < buf_size_) {
       std::memcpy(buf_, write_data, write_size);
       pos_ = write_size;
       return Status::OK();
@@ -319,6 +639,74 @@ class PosixWritableFile final : public WritableFile {
     return WriteUnbuffered(write_data, write_size);
   }
 
+  Status AppendV(const Slice* slices, size_t count) override {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+      total += slices[i].size();
+    }
+
+    // Small gathers fit in the buffer like any other append.
+    if (total <= buf_size_ - pos_) {
+      for (size_t i = 0; i < count; i++) {
+        std::memcpy(buf_ + pos_, slices[i].data(), slices[i].size());
+        pos_ += slices[i].size();
+      }
+      return Status::OK();
+    }
+
+    // Drain the buffer, then one writev straight from the caller's
+    // pieces -- no copy into the 64KB buffer.
+    Status status = FlushBuffer();
+    if (!status.ok()) {
+      return status;
+    }
+    size_t index = 0;
+    while (index < count) {
+      struct ::iovec iov[kMaxWritevCount];
+      int iov_count = 0;
+      size_t bytes = 0;
+      while (index < count && iov_count < kMaxWritevCount) {
+        iov[iov_count].iov_base =
+            const_cast<char*>(slices[index].data());
+        iov[iov_count].iov_len = slices[index].size();
+        bytes += slices[index].size();
+        iov_count++;
+        index++;
+      }
+      size_t written = 0;
+      while (written < bytes) {
+        ssize_t result = ::writev(fd_, iov, iov_count);
+        if (result < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          return PosixError(filename_, errno);
+        }
+        written += static_cast<size_t>(result);
+        if (written < bytes) {
+          // Partial write: advance the gather list past what landed.
+          size_t skip = static_cast<size_t>(result);
+          int first = 0;
+          while (skip >= iov[first].iov_len) {
+            skip -= iov[first].iov_len;
+            first++;
+          }
+          iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + skip;
+          iov[first].iov_len -= skip;
+          if (first > 0) {
+            for (int i = first; i < iov_count; i++) {
+              iov[i - first] = iov[i];
+            }
+            iov_count -= first;
+          }
+          bytes -= written;
+          written = 0;
+        }
+      }
+    }
+    return Status::OK();
+  }
+
   Status Close() override {
     Status status = FlushBuffer();
     const int close_result = ::close(fd_);
@@ -358,6 +746,7 @@ class PosixWritableFile final : public WritableFile {
   }
 
   Status WriteUnbuffered(const char* data, size_t size) {
+    const size_t total = size;
     while (size > 0) {
       ssize_t write_result = ::write(fd_, data, size);
       if (write_result < 0) {
@@ -369,9 +758,32 @@ class PosixWritableFile final : public WritableFile {
       data += write_result;
       size -= write_result;
     }
+    MaybeScheduleWriteback(total);
     return Status::OK();
   }
 
+  // For streaming files, nudge dirty pages toward the device in the
+  // background every few megabytes so the final Sync() is not left to
+  // flush the entire file at once.
+  void MaybeScheduleWriteback(size_t just_written) {
+#if defined(__linux__)
+    if (!streaming_) {
+      return;
+    }
+    dirty_since_writeback_ += just_written;
+    if (dirty_since_writeback_ >= kWritebackChunk) {
+      ::sync_file_range(fd_, writeback_offset_, dirty_since_writeback_,
+                        SYNC_FILE_RANGE_WRITE);
+      writeback_offset_ += dirty_since_writeback_;
+      dirty_since_writeback_ = 0;
+    }
+#else
+    (void)just_written;
+#endif
+  }
+
+  static constexpr size_t kWritebackChunk = 4 * 1024 * 1024;
+
   Status SyncDirIfManifest() {
     Status status;
     if (!is_manifest_) {
@@ -455,9 +867,13 @@ class PosixWritableFile final : public WritableFile {
   }
 
   // buf_[0, pos_ - 1] contains data to be written to fd_.
-  char buf_[kWritableFileBufferSize];
+  char* buf_;
+  size_t buf_size_;
   size_t pos_;
   int fd_;
+  bool streaming_;
+  size_t dirty_since_writeback_;
+  uint64_t writeback_offset_;
 
   const bool is_manifest_;  // True if the file's name starts with MANIFEST.
   const std::string filename_;
@@ -583,6 +999,86 @@ class PosixEnv : public Env {
     return Status::OK();
   }
 
+  Status NewMappedRandomAccessFile(const std::string& filename,
+                                   AccessPattern pattern,
+                                   RandomAccessFile** result) override {
+    *result = nullptr;
+    int fd = ::open(filename.c_str(), O_RDONLY | kOpenBaseFlags);
+    if (fd < 0) {
+      return PosixError(filename, errno);
+    }
+    uint64_t file_size;
+    Status status = GetFileSize(filename, &file_size);
+    if (status.ok()) {
+      void* mmap_base =
+          ::mmap(/*addr=*/nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (mmap_base != MAP_FAILED) {
+        switch (pattern) {
+          case kAccessRandom:
+            ::madvise(mmap_base, file_size, MADV_RANDOM);
+            break;
+          case kAccessWillNeed:
+            ::madvise(mmap_base, file_size, MADV_WILLNEED);
+            break;
+          case kAccessNormal:
+            break;
+        }
+        // No limiter: the caller opted into unbounded mappings.
+        *result = new PosixMmapReadableFile(
+            filename, reinterpret_cast<char*>(mmap_base), file_size, nullptr);
+      } else {
+        status = PosixError(filename, errno);
+      }
+    }
+    ::close(fd);
+    return status;
+  }
+
+  Status NewUnbufferedRandomAccessFile(const std::string& filename,
+                                       RandomAccessFile** result) override {
+#if defined(__linux__)
+    int fd = ::open(filename.c_str(), O_RDONLY | O_DIRECT | kOpenBaseFlags);
+    if (fd >= 0) {
+      *result = new PosixDirectRandomAccessFile(filename, fd);
+      return Status::OK();
+    }
+    // O_DIRECT unsupported (e.g. tmpfs); fall back to buffered I/O.
+#endif  // defined(__linux__)
+    return NewRandomAccessFile(filename, result);
+  }
+
+  Status NewUnbufferedWritableFile(const std::string& filename,
+                                   WritableFile** result) override {
+#if defined(__linux__)
+    int fd = ::open(filename.c_str(),
+                    O_TRUNC | O_WRONLY | O_CREAT | O_DIRECT | kOpenBaseFlags,
+                    0644);
+    if (fd >= 0) {
+      *result = new PosixDirectWritableFile(filename, fd);
+      return Status::OK();
+    }
+    // O_DIRECT unsupported (e.g. tmpfs); fall back to buffered I/O.
+#endif  // defined(__linux__)
+    return NewWritableFile(filename, result);
+  }
+
+  Status ReuseWritableFile(const std::string& filename,
+                           const std::string& old_filename,
+                           WritableFile** result) override {
+    *result = nullptr;
+    if (::rename(old_filename.c_str(), filename.c_str()) != 0) {
+      return PosixError(old_filename, errno);
+    }
+    // Open without O_TRUNC: the old extents stay allocated and are
+    // overwritten in place from offset zero.
+    int fd = ::open(filename.c_str(), O_WRONLY | kOpenBaseFlags, 0644);
+    if (fd < 0) {
+      return PosixError(filename, errno);
+    }
+    *result = new PosixWritableFile(filename, fd);
+    return Status::OK();
+  }
+
   Status NewAppendableFile(const std::string& filename,
                            WritableFile** result) override {
     int fd = ::open(filename.c_str(),
@@ -646,6 +1142,17 @@ class PosixEnv : public Env {
     return Status::OK();
   }
 
+  Status GetFileModificationTime(const std::string& filename,
+                                 uint64_t* mtime) override {
+    struct ::stat file_stat;
+    if (::stat(filename.c_str(), &file_stat) != 0) {
+      *mtime = 0;
+      return PosixError(filename, errno);
+    }
+    *mtime = static_cast<uint64_t>(file_stat.st_mtime);
+    return Status::OK();
+  }
+
   Status RenameFile(const std::string& from, const std::string& to) override {
     if (std::rename(from.c_str(), to.c_str()) != 0) {
       return PosixError(from, errno);
@@ -653,6 +1160,52 @@ class PosixEnv : public Env {
     return Status::OK();
   }
 
+  Status PinCurrentThread(int cpu) override {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (::sched_setaffinity(0, sizeof(set), &set) != 0) {
+      return PosixError("sched_setaffinity", errno);
+    }
+    return Status::OK();
+#else
+    (void)cpu;
+    return Status::NotSupported("PinCurrentThread");
+#endif
+  }
+
+  int GetCurrentCpu() override {
+#if defined(__linux__)
+    return ::sched_getcpu();
+#else
+    return -1;
+#endif
+  }
+
+  void InvalidateCache(const std::string& filename) override {
+#if defined(__linux__)
+    int fd = ::open(filename.c_str(), O_RDONLY | kOpenBaseFlags);
+    if (fd >= 0) {
+      ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      ::close(fd);
+    }
+#else
+    (void)filename;
+#endif
+  }
+
+  Status LinkFile(const std::string& from, const std::string& to) override {
+    if (::link(from.c_str(), to.c_str()) != 0) {
+      if (errno == EXDEV || errno == EPERM || errno == ENOTSUP) {
+        // Cross-device or unsupported; fall back to copying.
+        return CopyFile(from, to);
+      }
+      return PosixError(from, errno);
+    }
+    return Status::OK();
+  }
+
   Status LockFile(const std::string& filename, FileLock** lock) override {
     *lock = nullptr;
 
@@ -690,6 +1243,9 @@ class PosixEnv : public Env {
 
   void Schedule(void (*background_work_function)(void* background_work_arg),
                 void* background_work_arg) override;
+  void Schedule(void (*background_work_function)(void* background_work_arg),
+                void* background_work_arg, SchedulePriority priority) override;
+  void SetBackgroundThreads(int n) override;
 
   void StartThread(void (*thread_main)(void* thread_main_arg),
                    void* thread_main_arg) override {
@@ -767,9 +1323,12 @@ class PosixEnv : public Env {
 
   port::Mutex background_work_mutex_;
   port::CondVar background_work_cv_ GUARDED_BY(background_work_mutex_);
-  bool started_background_thread_ GUARDED_BY(background_work_mutex_);
+  int background_threads_ GUARDED_BY(background_work_mutex_);  // Started
+  int background_threads_target_ GUARDED_BY(background_work_mutex_);
 
-  std::queue<BackgroundWorkItem> background_work_queue_
+  // One queue per SchedulePriority; workers drain the highest-priority
+  // non-empty lane first.
+  std::queue<BackgroundWorkItem> background_work_queue_[3]
       GUARDED_BY(background_work_mutex_);
 
   PosixLockTable locks_;  // Thread-safe.
@@ -807,28 +1366,52 @@ int MaxOpenFiles() {
 
 PosixEnv::PosixEnv()
     : background_work_cv_(&background_work_mutex_),
-      started_background_thread_(false),
+      background_threads_(0),
+      background_threads_target_(1),
       mmap_limiter_(MaxMmaps()),
       fd_limiter_(MaxOpenFiles()) {}
 
+void PosixEnv::SetBackgroundThreads(int n) {
+  background_work_mutex_.Lock();
+  if (n > background_threads_target_) {
+    background_threads_target_ = n;
+    // Threads already running stay; missing ones start with the next
+    // Schedule() call (or now, if work is pending).
+    while (background_threads_ < background_threads_target_ &&
+           (!background_work_queue_[0].empty() ||
+            !background_work_queue_[1].empty() ||
+            !background_work_queue_[2].empty())) {
+      background_threads_++;
+      std::thread background_thread(PosixEnv::BackgroundThreadEntryPoint, this);
+      background_thread.detach();
+    }
+  }
+  background_work_mutex_.Unlock();
+}
+
 void PosixEnv::Schedule(
     void (*background_work_function)(void* background_work_arg),
     void* background_work_arg) {
+  Schedule(background_work_function, background_work_arg, kScheduleDefault);
+}
+
+void PosixEnv::Schedule(
+    void (*background_work_function)(void* background_work_arg),
+    void* background_work_arg, SchedulePriority priority) {
   background_work_mutex_.Lock();
 
-  // Start the background thread, if we haven't done so already.
-  if (!started_background_thread_) {
-    started_background_thread_ = true;
+  // Start another pool thread if the pool is below its target size.
+  if (background_threads_ < background_threads_target_) {
+    background_threads_++;
     std::thread background_thread(PosixEnv::BackgroundThreadEntryPoint, this);
     background_thread.detach();
   }
 
-  // If the queue is empty, the background thread may be waiting for work.
-  if (background_work_queue_.empty()) {
-    background_work_cv_.Signal();
-  }
+  // A waiting worker may pick this item up.
+  background_work_cv_.Signal();
 
-  background_work_queue_.emplace(background_work_function, background_work_arg);
+  background_work_queue_[priority].emplace(background_work_function,
+                                           background_work_arg);
   background_work_mutex_.Unlock();
 }
 
@@ -836,15 +1419,27 @@ void PosixEnv::BackgroundThreadMain() {
   while (true) {
     background_work_mutex_.Lock();
 
-    // Wait until there is work to be done.
-    while (background_work_queue_.empty()) {
+    // Wait until there is work in some lane, then take the
+    // highest-priority item.
+    int lane;
+    while (true) {
+      lane = -1;
+      for (int i = 0; i < 3; i++) {
+        if (!background_work_queue_[i].empty()) {
+          lane = i;
+          break;
+        }
+      }
+      if (lane >= 0) {
+        break;
+      }
       background_work_cv_.Wait();
     }
 
-    assert(!background_work_queue_.empty());
-    auto background_work_function = background_work_queue_.front().function;
-    void* background_work_arg = background_work_queue_.front().arg;
-    background_work_queue_.pop();
+    auto background_work_function =
+        background_work_queue_[lane].front().function;
+    void* background_work_arg = background_work_queue_[lane].front().arg;
+    background_work_queue_[lane].pop();
 
     background_work_mutex_.Unlock();
     background_work_function(background_work_arg);
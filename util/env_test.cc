@@ -68,6 +68,44 @@ TEST_F(EnvTest, ReadWrite) {
   delete sequential_file;
 }
 
+TEST_F(EnvTest, ReadBatch) {
+  // Get file to use for testing.
+  std::string test_dir;
+  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file_name = test_dir + "/read_batch.txt";
+  WritableFile* writable_file;
+  ASSERT_LEVELDB_OK(env_->NewWritableFile(test_file_name, &writable_file));
+
+  std::string data;
+  for (int i = 0; i < 1000; i++) {
+    data.append(std::string(100, 'a' + (i % 26)));
+  }
+  ASSERT_LEVELDB_OK(writable_file->Append(data));
+  ASSERT_LEVELDB_OK(writable_file->Close());
+  delete writable_file;
+
+  RandomAccessFile* file;
+  ASSERT_LEVELDB_OK(env_->NewRandomAccessFile(test_file_name, &file));
+
+  // Issue scattered reads in one batch and check each result.
+  static const size_t kNumReads = 16;
+  char scratch[kNumReads][128];
+  RandomAccessFile::ReadRequest requests[kNumReads];
+  for (size_t i = 0; i < kNumReads; i++) {
+    requests[i].offset = (kNumReads - 1 - i) * 5000;
+    requests[i].n = 100;
+    requests[i].scratch = scratch[i];
+  }
+  file->ReadBatch(requests, kNumReads);
+  for (size_t i = 0; i < kNumReads; i++) {
+    ASSERT_LEVELDB_OK(requests[i].status);
+    ASSERT_EQ(100, requests[i].result.size());
+    ASSERT_EQ(data.substr(requests[i].offset, 100),
+              requests[i].result.ToString());
+  }
+  delete file;
+}
+
 TEST_F(EnvTest, RunImmediately) {
   struct RunState {
     port::Mutex mu;
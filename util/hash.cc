@@ -52,4 +52,93 @@ uint32_t Hash(const char* data, size_t n, uint32_t seed) {
   return h;
 }
 
+namespace {
+
+const uint64_t kXxhPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kXxhPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kXxhPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kXxhPrime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kXxhPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t XxhRotl(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t XxhRead64(const char* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t XxhRead32(const char* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t XxhRound(uint64_t acc, uint64_t input) {
+  acc += input * kXxhPrime2;
+  acc = XxhRotl(acc, 31);
+  return acc * kXxhPrime1;
+}
+
+inline uint64_t XxhMerge(uint64_t acc, uint64_t val) {
+  acc ^= XxhRound(0, val);
+  return acc * kXxhPrime1 + kXxhPrime4;
+}
+
+}  // namespace
+
+uint64_t XXHash64(const char* data, size_t n, uint64_t seed) {
+  const char* p = data;
+  const char* const end = data + n;
+  uint64_t h;
+
+  if (n >= 32) {
+    uint64_t v1 = seed + kXxhPrime1 + kXxhPrime2;
+    uint64_t v2 = seed + kXxhPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kXxhPrime1;
+    const char* const limit = end - 32;
+    do {
+      v1 = XxhRound(v1, XxhRead64(p));
+      v2 = XxhRound(v2, XxhRead64(p + 8));
+      v3 = XxhRound(v3, XxhRead64(p + 16));
+      v4 = XxhRound(v4, XxhRead64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = XxhRotl(v1, 1) + XxhRotl(v2, 7) + XxhRotl(v3, 12) + XxhRotl(v4, 18);
+    h = XxhMerge(h, v1);
+    h = XxhMerge(h, v2);
+    h = XxhMerge(h, v3);
+    h = XxhMerge(h, v4);
+  } else {
+    h = seed + kXxhPrime5;
+  }
+
+  h += static_cast<uint64_t>(n);
+  while (p + 8 <= end) {
+    h ^= XxhRound(0, XxhRead64(p));
+    h = XxhRotl(h, 27) * kXxhPrime1 + kXxhPrime4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(XxhRead32(p)) * kXxhPrime1;
+    h = XxhRotl(h, 23) * kXxhPrime2 + kXxhPrime3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= static_cast<uint64_t>(static_cast<unsigned char>(*p)) * kXxhPrime5;
+    h = XxhRotl(h, 11) * kXxhPrime1;
+    p++;
+  }
+
+  h ^= h >> 33;
+  h *= kXxhPrime2;
+  h ^= h >> 29;
+  h *= kXxhPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
 }  // namespace leveldb
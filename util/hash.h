@@ -14,6 +14,10 @@ namespace leveldb {
 
 uint32_t Hash(const char* data, size_t n, uint32_t seed);
 
+// 64-bit XXH64 hash; substantially faster than table-driven CRC for
+// large buffers.  Used for the optional kXXH64 block checksum type.
+uint64_t XXHash64(const char* data, size_t n, uint64_t seed);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_UTIL_HASH_H_
@@ -0,0 +1,159 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/hedged_read.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "leveldb/env.h"
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+#include "util/no_destructor.h"
+
+namespace leveldb {
+
+namespace {
+
+// A read handed to the helper pool.  Refcounted: the submitting thread
+// and the helper each hold one reference, so an abandoned (hedged-
+// over) job cleans itself up when the slow read finally returns.
+struct HedgeJob {
+  RandomAccessFile* file;
+  uint64_t offset;
+  size_t n;
+  char* buffer;  // Owned; the helper reads into this, never the
+                 // caller's scratch, so a hedge cannot race it.
+  Slice result;
+  Status status;
+
+  std::mutex mu;
+  std::condition_variable cv;
+  bool done = false;
+  bool abandoned = false;
+  int refs = 2;
+
+  ~HedgeJob() { delete[] buffer; }
+
+  void Unref() {
+    bool last;
+    {
+      std::lock_guard<std::mutex> l(mu);
+      last = (--refs == 0);
+    }
+    if (last) {
+      delete this;
+    }
+  }
+};
+
+// Shared helper threads serving every hedged file in the process.
+class HedgePool {
+ public:
+  static HedgePool* Instance() {
+    // Intentionally leaked: detached helper threads may still be
+    // blocked on the queue at process exit, so the pool (and its
+    // mutex/condvar) must outlive static destruction.
+    static NoDestructor<HedgePool> pool;
+    return pool.get();
+  }
+
+  void Submit(HedgeJob* job) {
+    std::lock_guard<std::mutex> l(mu_);
+    if (threads_ < kThreads) {
+      threads_++;
+      std::thread(&HedgePool::Work, this).detach();
+    }
+    queue_.push_back(job);
+    cv_.notify_one();
+  }
+
+ private:
+  static constexpr int kThreads = 2;
+
+  void Work() {
+    while (true) {
+      HedgeJob* job;
+      {
+        std::unique_lock<std::mutex> l(mu_);
+        cv_.wait(l, [this] { return !queue_.empty(); });
+        job = queue_.front();
+        queue_.pop_front();
+      }
+      job->status = job->file->Read(job->offset, job->n, &job->result,
+                                    job->buffer);
+      {
+        std::lock_guard<std::mutex> l(job->mu);
+        job->done = true;
+      }
+      job->cv.notify_all();
+      job->Unref();
+    }
+  }
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<HedgeJob*> queue_;
+  int threads_ = 0;
+};
+
+class HedgedRandomAccessFile : public RandomAccessFile {
+ public:
+  HedgedRandomAccessFile(RandomAccessFile* file, uint64_t threshold_micros)
+      : file_(file), threshold_micros_(threshold_micros) {}
+
+  ~HedgedRandomAccessFile() override { delete file_; }
+
+  Status Read(uint64_t offset, size_t n, Slice* result,
+              char* scratch) const override {
+    HedgeJob* job = new HedgeJob;
+    job->file = file_;
+    job->offset = offset;
+    job->n = n;
+    job->buffer = new char[n];
+    HedgePool::Instance()->Submit(job);
+
+    bool done;
+    {
+      std::unique_lock<std::mutex> l(job->mu);
+      done = job->cv.wait_for(l, std::chrono::microseconds(threshold_micros_),
+                              [job] { return job->done; });
+      if (!done) {
+        job->abandoned = true;
+      }
+    }
+    if (done) {
+      Status s = job->status;
+      if (s.ok()) {
+        std::memcpy(scratch, job->result.data(), job->result.size());
+        *result = Slice(scratch, job->result.size());
+      }
+      job->Unref();
+      return s;
+    }
+
+    // The first read is stuck; race it with a second attempt from this
+    // thread.  The slow helper read finishes into its own buffer and
+    // is discarded.
+    job->Unref();
+    return file_->Read(offset, n, result, scratch);
+  }
+
+ private:
+  RandomAccessFile* const file_;
+  const uint64_t threshold_micros_;
+};
+
+}  // namespace
+
+RandomAccessFile* NewHedgedRandomAccessFile(RandomAccessFile* file,
+                                            uint64_t threshold_micros) {
+  return new HedgedRandomAccessFile(file, threshold_micros);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,25 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_HEDGED_READ_H_
+#define STORAGE_LEVELDB_UTIL_HEDGED_READ_H_
+
+#include <cstdint>
+
+namespace leveldb {
+
+class RandomAccessFile;
+
+// Wrap "file" so that a read not completed within "threshold_micros"
+// is hedged: the calling thread issues a second identical read and the
+// first completion wins.  Bounds tail latency when the underlying
+// device intermittently stalls.  Takes ownership of "file"; every read
+// pays a hand-off to a shared helper thread plus one buffer copy, so
+// this is for degraded-media mitigation, not a fast path.
+RandomAccessFile* NewHedgedRandomAccessFile(RandomAccessFile* file,
+                                            uint64_t threshold_micros);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_HEDGED_READ_H_
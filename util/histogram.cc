@@ -269,4 +269,74 @@ std::string Histogram::ToString() const {
   return r;
 }
 
+void LatencyHistogram::Record(uint64_t micros) {
+  buckets_[BucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(micros, std::memory_order_relaxed);
+  uint64_t prev = max_.load(std::memory_order_relaxed);
+  while (micros > prev &&
+         !max_.compare_exchange_weak(prev, micros,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+int LatencyHistogram::BucketFor(uint64_t micros) {
+  if (micros < kSubBuckets) {
+    return static_cast<int>(micros);
+  }
+  // Index of the highest set bit determines the range; the next
+  // kSubBucketBits bits pick the linear sub-bucket.
+  int log2 = 63 - __builtin_clzll(micros);
+  int range = log2 - kSubBucketBits + 1;
+  if (range >= kRanges - 1) {
+    range = kRanges - 1;
+    return range * kSubBuckets + kSubBuckets - 1;
+  }
+  const int sub = static_cast<int>((micros >> (log2 - kSubBucketBits)) &
+                                   (kSubBuckets - 1));
+  return range * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int bucket) {
+  const int range = bucket / kSubBuckets;
+  const int sub = bucket % kSubBuckets;
+  if (range == 0) {
+    return sub + 1;
+  }
+  const int log2 = range + kSubBucketBits - 1;
+  return (static_cast<uint64_t>(kSubBuckets + sub + 1))
+         << (log2 - kSubBucketBits);
+}
+
+std::string LatencyHistogram::ToString() const {
+  const uint64_t count = count_.load(std::memory_order_relaxed);
+  const uint64_t sum = sum_.load(std::memory_order_relaxed);
+  char buf[200];
+  if (count == 0) {
+    return "count=0\n";
+  }
+  static const double kQuantiles[] = {0.50, 0.90, 0.99, 0.999};
+  uint64_t results[4] = {0, 0, 0, 0};
+  uint64_t seen = 0;
+  int q = 0;
+  for (int b = 0; b < kNumBuckets && q < 4; b++) {
+    seen += buckets_[b].load(std::memory_order_relaxed);
+    while (q < 4 && seen >= static_cast<uint64_t>(kQuantiles[q] * count)) {
+      results[q++] = BucketUpperBound(b);
+    }
+  }
+  std::snprintf(buf, sizeof(buf),
+                "count=%llu mean=%.1fus p50=%lluus p90=%lluus p99=%lluus "
+                "p999=%lluus max=%lluus\n",
+                static_cast<unsigned long long>(count),
+                static_cast<double>(sum) / count,
+                static_cast<unsigned long long>(results[0]),
+                static_cast<unsigned long long>(results[1]),
+                static_cast<unsigned long long>(results[2]),
+                static_cast<unsigned long long>(results[3]),
+                static_cast<unsigned long long>(
+                    max_.load(std::memory_order_relaxed)));
+  return std::string(buf);
+}
+
 }  // namespace leveldb
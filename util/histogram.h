@@ -5,6 +5,8 @@
 #ifndef STORAGE_LEVELDB_UTIL_HISTOGRAM_H_
 #define STORAGE_LEVELDB_UTIL_HISTOGRAM_H_
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 namespace leveldb {
@@ -20,11 +22,12 @@ class Histogram {
 
   std::string ToString() const;
 
+  double Median() const;
+  double Percentile(double p) const;
+
  private:
   enum { kNumBuckets = 154 };
 
-  double Median() const;
-  double Percentile(double p) const;
   double Average() const;
   double StandardDeviation() const;
 
@@ -39,6 +42,41 @@ class Histogram {
   double buckets_[kNumBuckets];
 };
 
+// Thread-safe log-linear (HDR-style) histogram of microsecond
+// latencies: power-of-two ranges each split into 16 linear
+// sub-buckets, giving ~6% relative precision with lock-free atomic
+// recording.  Used for the in-DB operation latency stats.
+class LatencyHistogram {
+ public:
+  LatencyHistogram() {
+    for (int i = 0; i < kNumBuckets; i++) {
+      buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  void Record(uint64_t micros);
+
+  // Multi-line human readable summary with count/mean/percentiles.
+  std::string ToString() const;
+
+ private:
+  static const int kSubBucketBits = 4;
+  static const int kSubBuckets = 1 << kSubBucketBits;  // 16
+  static const int kRanges = 32;
+  static const int kNumBuckets = kRanges * kSubBuckets;
+
+  static int BucketFor(uint64_t micros);
+  static uint64_t BucketUpperBound(int bucket);
+
+  std::atomic<uint64_t> buckets_[kNumBuckets];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+};
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_UTIL_HISTOGRAM_H_
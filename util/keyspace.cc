@@ -0,0 +1,168 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/keyspace.h"
+
+#include <string>
+
+#include "leveldb/iterator.h"
+#include "leveldb/write_batch.h"
+
+namespace leveldb {
+
+namespace {
+
+// Iterator over one keyspace: seeks are prefixed, iteration is bounded
+// to keys carrying the prefix, and returned keys have it stripped.
+class KeyspaceIterator : public Iterator {
+ public:
+  KeyspaceIterator(Iterator* base, const std::string& prefix)
+      : base_(base), prefix_(prefix) {}
+  ~KeyspaceIterator() override { delete base_; }
+
+  bool Valid() const override {
+    return base_->Valid() && InKeyspace(base_->key());
+  }
+  void SeekToFirst() override { base_->Seek(prefix_); }
+  void SeekToLast() override {
+    // One past the keyspace: the prefix ends with '\0', so bumping the
+    // terminator bounds it.
+    std::string limit = prefix_;
+    limit[limit.size() - 1] = '\x01';
+    base_->Seek(limit);
+    if (base_->Valid()) {
+      base_->Prev();
+    } else {
+      base_->SeekToLast();
+    }
+  }
+  void Seek(const Slice& target) override {
+    std::string full = prefix_;
+    full.append(target.data(), target.size());
+    base_->Seek(full);
+  }
+  void Next() override { base_->Next(); }
+  void Prev() override { base_->Prev(); }
+  Slice key() const override {
+    assert(Valid());
+    Slice k = base_->key();
+    k.remove_prefix(prefix_.size());
+    return k;
+  }
+  Slice value() const override { return base_->value(); }
+  Status status() const override { return base_->status(); }
+
+ private:
+  bool InKeyspace(const Slice& key) const {
+    return key.size() >= prefix_.size() &&
+           memcmp(key.data(), prefix_.data(), prefix_.size()) == 0;
+  }
+
+  Iterator* const base_;
+  const std::string prefix_;
+};
+
+// Rewrites a batch's records with the keyspace prefix applied.
+class PrefixingHandler : public WriteBatch::Handler {
+ public:
+  PrefixingHandler(WriteBatch* out, const std::string& prefix)
+      : out_(out), prefix_(prefix) {}
+
+  void Put(const Slice& key, const Slice& value) override {
+    out_->Put(Prefixed(key), value);
+  }
+  void Delete(const Slice& key) override { out_->Delete(Prefixed(key)); }
+  void DeleteRange(const Slice& begin, const Slice& end) override {
+    const std::string b = Prefixed(begin);
+    out_->DeleteRange(b, Prefixed(end));
+  }
+  void Merge(const Slice& key, const Slice& value) override {
+    out_->Merge(Prefixed(key), value);
+  }
+
+ private:
+  std::string Prefixed(const Slice& key) const {
+    std::string full = prefix_;
+    full.append(key.data(), key.size());
+    return full;
+  }
+
+  WriteBatch* const out_;
+  const std::string& prefix_;
+};
+
+class KeyspaceDB : public DB {
+ public:
+  KeyspaceDB(DB* base, const std::string& name)
+      : base_(base), prefix_(name + '\0') {}
+
+  Status Put(const WriteOptions& options, const Slice& key,
+             const Slice& value) override {
+    return base_->Put(options, prefix_ + key.ToString(), value);
+  }
+  Status Delete(const WriteOptions& options, const Slice& key) override {
+    return base_->Delete(options, prefix_ + key.ToString());
+  }
+  Status Write(const WriteOptions& options, WriteBatch* updates) override {
+    WriteBatch prefixed;
+    prefixed.Reserve(updates->ApproximateSize() + 64);
+    PrefixingHandler handler(&prefixed, prefix_);
+    Status s = updates->Iterate(&handler);
+    if (!s.ok()) {
+      return s;
+    }
+    return base_->Write(options, &prefixed);
+  }
+  Status Get(const ReadOptions& options, const Slice& key,
+             std::string* value) override {
+    return base_->Get(options, prefix_ + key.ToString(), value);
+  }
+  Iterator* NewIterator(const ReadOptions& options) override {
+    return new KeyspaceIterator(base_->NewIterator(options), prefix_);
+  }
+  const Snapshot* GetSnapshot() override { return base_->GetSnapshot(); }
+  void ReleaseSnapshot(const Snapshot* snapshot) override {
+    base_->ReleaseSnapshot(snapshot);
+  }
+  bool GetProperty(const Slice& property, std::string* value) override {
+    return base_->GetProperty(property, value);
+  }
+  void GetApproximateSizes(const Range* range, int n,
+                           uint64_t* sizes) override {
+    for (int i = 0; i < n; i++) {
+      const std::string start = prefix_ + range[i].start.ToString();
+      const std::string limit = prefix_ + range[i].limit.ToString();
+      Range prefixed(start, limit);
+      base_->GetApproximateSizes(&prefixed, 1, &sizes[i]);
+    }
+  }
+  void CompactRange(const Slice* begin, const Slice* end) override {
+    std::string b = prefix_ + (begin != nullptr ? begin->ToString() : "");
+    std::string e;
+    Slice begin_slice(b);
+    Slice end_slice;
+    if (end != nullptr) {
+      e = prefix_ + end->ToString();
+      end_slice = Slice(e);
+    } else {
+      e = prefix_;
+      e[e.size() - 1] = '\x01';
+      end_slice = Slice(e);
+    }
+    base_->CompactRange(&begin_slice, &end_slice);
+  }
+
+ private:
+  DB* const base_;
+  const std::string prefix_;
+};
+
+}  // namespace
+
+DB* NewKeyspace(DB* base, const std::string& name) {
+  assert(name.find('\0') == std::string::npos);
+  return new KeyspaceDB(base, name);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,73 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Tiny thread-local free lists for the fixed-size objects the read
+// path allocates on every scan (DBIter, MergingIterator).  Lock free
+// by construction; memory freed on one thread and reused on another
+// simply takes the slow path.
+
+#ifndef STORAGE_LEVELDB_UTIL_OBJECT_POOL_H_
+#define STORAGE_LEVELDB_UTIL_OBJECT_POOL_H_
+
+#include <cstddef>
+#include <cstdlib>
+
+namespace leveldb {
+
+namespace pool_internal {
+struct SizeClass {
+  size_t size = 0;
+  int count = 0;
+  void* slots[8];
+};
+// A handful of distinct sizes is plenty: the pool serves two or three
+// iterator types.
+struct ThreadPool {
+  SizeClass classes[4];
+  ~ThreadPool() {
+    for (int i = 0; i < 4; i++) {
+      while (classes[i].count > 0) {
+        ::free(classes[i].slots[--classes[i].count]);
+      }
+    }
+  }
+};
+inline ThreadPool* GetThreadPool() {
+  static thread_local ThreadPool pool;
+  return &pool;
+}
+}  // namespace pool_internal
+
+inline void* PooledAllocate(size_t size) {
+  pool_internal::ThreadPool* pool = pool_internal::GetThreadPool();
+  for (int i = 0; i < 4; i++) {
+    pool_internal::SizeClass& c = pool->classes[i];
+    if (c.size == size && c.count > 0) {
+      return c.slots[--c.count];
+    }
+  }
+  return ::malloc(size);
+}
+
+inline void PooledFree(void* ptr, size_t size) {
+  pool_internal::ThreadPool* pool = pool_internal::GetThreadPool();
+  for (int i = 0; i < 4; i++) {
+    pool_internal::SizeClass& c = pool->classes[i];
+    if (c.size == 0) {
+      c.size = size;
+    }
+    if (c.size == size) {
+      if (c.count < 8) {
+        c.slots[c.count++] = ptr;
+        return;
+      }
+      break;
+    }
+  }
+  ::free(ptr);
+}
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_OBJECT_POOL_H_
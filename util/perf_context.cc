@@ -0,0 +1,62 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/perf_context.h"
+
+#include <cstdio>
+
+namespace leveldb {
+
+PerfContext* GetPerfContext() {
+  static thread_local PerfContext perf_context;
+  return &perf_context;
+}
+
+std::string PerfContext::ToString() const {
+  char buf[256];
+  std::snprintf(
+      buf, sizeof(buf),
+      "block_cache_hits=%llu block_reads=%llu block_read_bytes=%llu "
+      "filter_useful=%llu memtable_probes=%llu internal_keys_skipped=%llu",
+      static_cast<unsigned long long>(block_cache_hits),
+      static_cast<unsigned long long>(block_reads),
+      static_cast<unsigned long long>(block_read_bytes),
+      static_cast<unsigned long long>(filter_useful),
+      static_cast<unsigned long long>(memtable_probes),
+      static_cast<unsigned long long>(internal_keys_skipped));
+  return std::string(buf);
+}
+
+GlobalPerfCounters* GetGlobalPerfCounters() {
+  static GlobalPerfCounters counters;
+  return &counters;
+}
+
+std::string GlobalPerfCounters::ToString() const {
+  const uint64_t hits = block_cache_hits.load(std::memory_order_relaxed);
+  const uint64_t misses = block_cache_misses.load(std::memory_order_relaxed);
+  const uint64_t checked = filter_checked.load(std::memory_order_relaxed);
+  const uint64_t useful = filter_useful.load(std::memory_order_relaxed);
+  const uint64_t mem_lookups =
+      memtable_lookups.load(std::memory_order_relaxed);
+  const uint64_t mem_hits = memtable_hits.load(std::memory_order_relaxed);
+  char buf[256];
+  std::snprintf(
+      buf, sizeof(buf),
+      "block_cache: %llu hits, %llu misses (%.1f%% hit rate)\n"
+      "filters: %llu useful of %llu checked (%.1f%%)\n"
+      "memtable: %llu hits of %llu lookups (%.1f%%)\n",
+      static_cast<unsigned long long>(hits),
+      static_cast<unsigned long long>(misses),
+      hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0,
+      static_cast<unsigned long long>(useful),
+      static_cast<unsigned long long>(checked),
+      checked > 0 ? 100.0 * useful / checked : 0.0,
+      static_cast<unsigned long long>(mem_hits),
+      static_cast<unsigned long long>(mem_lookups),
+      mem_lookups > 0 ? 100.0 * mem_hits / mem_lookups : 0.0);
+  return std::string(buf);
+}
+
+}  // namespace leveldb
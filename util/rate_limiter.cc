@@ -0,0 +1,133 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/rate_limiter.h"
+
+#include "port/port.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+RateLimiter::~RateLimiter() = default;
+
+namespace {
+
+// Token bucket per I/O type, refilled from the wall clock.  Requests
+// larger than the remaining budget sleep until enough tokens have
+// accumulated; the bucket is capped at a quarter second of budget so
+// an idle period cannot bankroll an unbounded burst.
+class GenericRateLimiter : public RateLimiter {
+ public:
+  GenericRateLimiter(int64_t flush_bytes_per_second,
+                     int64_t compaction_bytes_per_second)
+      : env_(Env::Default()) {
+    buckets_[kFlush].bytes_per_second = flush_bytes_per_second;
+    buckets_[kCompaction].bytes_per_second = compaction_bytes_per_second;
+    const uint64_t now = env_->NowMicros();
+    for (int i = 0; i < 2; i++) {
+      buckets_[i].available = 0;
+      buckets_[i].last_refill_micros = now;
+      buckets_[i].total_through = 0;
+    }
+  }
+
+  void Request(int64_t bytes, IOType type) override {
+    Bucket* bucket = &buckets_[type];
+    if (bucket->bytes_per_second <= 0) {
+      MutexLock l(&mutex_);
+      bucket->total_through += bytes;
+      return;
+    }
+    while (true) {
+      uint64_t sleep_micros = 0;
+      {
+        MutexLock l(&mutex_);
+        Refill(bucket);
+        if (bucket->available >= bytes ||
+            bucket->available >= bucket->bytes_per_second / 4) {
+          // Large single requests may overdraw the bucket; the debt is
+          // paid off by later refills.
+          bucket->available -= bytes;
+          bucket->total_through += bytes;
+          return;
+        }
+        const int64_t needed = bytes - bucket->available;
+        sleep_micros = static_cast<uint64_t>(
+            (needed * 1000000) / bucket->bytes_per_second + 1);
+      }
+      if (sleep_micros > 100000) {
+        sleep_micros = 100000;  // Re-check at least every 100ms
+      }
+      env_->SleepForMicroseconds(static_cast<int>(sleep_micros));
+    }
+  }
+
+  int64_t TotalBytesThrough(IOType type) const override {
+    MutexLock l(&mutex_);
+    return buckets_[type].total_through;
+  }
+
+ private:
+  struct Bucket {
+    int64_t bytes_per_second;
+    int64_t available;
+    uint64_t last_refill_micros;
+    int64_t total_through;
+  };
+
+  void Refill(Bucket* bucket) EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    const uint64_t now = env_->NowMicros();
+    const uint64_t elapsed = now - bucket->last_refill_micros;
+    bucket->last_refill_micros = now;
+    bucket->available +=
+        static_cast<int64_t>((bucket->bytes_per_second * elapsed) / 1000000);
+    const int64_t cap = bucket->bytes_per_second / 4;
+    if (bucket->available > cap) {
+      bucket->available = cap;
+    }
+  }
+
+  Env* const env_;
+  mutable port::Mutex mutex_;
+  Bucket buckets_[2] GUARDED_BY(mutex_);
+};
+
+// Forwards everything to the wrapped file, charging Append() bytes to
+// the limiter first.
+class RateLimitedWritableFile : public WritableFile {
+ public:
+  RateLimitedWritableFile(WritableFile* file, RateLimiter* limiter,
+                          RateLimiter::IOType type)
+      : file_(file), limiter_(limiter), type_(type) {}
+  ~RateLimitedWritableFile() override { delete file_; }
+
+  Status Append(const Slice& data) override {
+    limiter_->Request(static_cast<int64_t>(data.size()), type_);
+    return file_->Append(data);
+  }
+  Status Close() override { return file_->Close(); }
+  Status Flush() override { return file_->Flush(); }
+  Status Sync() override { return file_->Sync(); }
+
+ private:
+  WritableFile* const file_;
+  RateLimiter* const limiter_;
+  const RateLimiter::IOType type_;
+};
+
+}  // namespace
+
+RateLimiter* NewGenericRateLimiter(int64_t flush_bytes_per_second,
+                                   int64_t compaction_bytes_per_second) {
+  return new GenericRateLimiter(flush_bytes_per_second,
+                                compaction_bytes_per_second);
+}
+
+WritableFile* NewRateLimitedWritableFile(WritableFile* file,
+                                         RateLimiter* limiter,
+                                         RateLimiter::IOType type) {
+  return new RateLimitedWritableFile(file, limiter, type);
+}
+
+}  // namespace leveldb
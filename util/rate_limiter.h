@@ -0,0 +1,22 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
+
+#include "leveldb/env.h"
+#include "leveldb/rate_limiter.h"
+
+namespace leveldb {
+
+// Wrap *file so that every Append() first requests its byte count from
+// *limiter under the given type.  Takes ownership of *file; *limiter
+// must outlive the result.
+WritableFile* NewRateLimitedWritableFile(WritableFile* file,
+                                         RateLimiter* limiter,
+                                         RateLimiter::IOType type);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
@@ -0,0 +1,68 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/tracing.h"
+
+#include <cstdio>
+#include <thread>
+
+#include "leveldb/env.h"
+#include "util/mutexlock.h"
+#include "util/no_destructor.h"
+
+namespace leveldb {
+
+SpanRecorder* SpanRecorder::Global() {
+  static NoDestructor<SpanRecorder> recorder;
+  return recorder.get();
+}
+
+void SpanRecorder::Record(const char* name, uint64_t start_micros,
+                          uint64_t end_micros, int depth) {
+  const uint64_t thread =
+      std::hash<std::thread::id>{}(std::this_thread::get_id());
+  MutexLock l(&mutex_);
+  Span* span = &ring_[next_];
+  next_ = (next_ + 1) % kRingSize;
+  if (count_ < kRingSize) {
+    count_++;
+  }
+  span->name = name;
+  span->start_micros = start_micros;
+  span->end_micros = end_micros;
+  span->thread = thread;
+  span->depth = depth;
+}
+
+void SpanRecorder::Dump(std::string* out) {
+  MutexLock l(&mutex_);
+  const size_t first = (next_ + kRingSize - count_) % kRingSize;
+  char buf[200];
+  for (size_t i = 0; i < count_; i++) {
+    const Span* span = &ring_[(first + i) % kRingSize];
+    std::snprintf(buf, sizeof(buf), "%llu %8llu %08llx %*s%s\n",
+                  static_cast<unsigned long long>(span->start_micros),
+                  static_cast<unsigned long long>(span->end_micros -
+                                                  span->start_micros),
+                  static_cast<unsigned long long>(span->thread & 0xffffffff),
+                  span->depth * 2, "", span->name);
+    out->append(buf);
+  }
+}
+
+namespace {
+thread_local int span_depth = 0;
+}  // namespace
+
+ScopedSpan::ScopedSpan(const char* name, Env* env)
+    : name_(name), env_(env), start_micros_(env->NowMicros()),
+      depth_(span_depth++) {}
+
+ScopedSpan::~ScopedSpan() {
+  span_depth--;
+  SpanRecorder::Global()->Record(name_, start_micros_, env_->NowMicros(),
+                                 depth_);
+}
+
+}  // namespace leveldb
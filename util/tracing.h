@@ -0,0 +1,73 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Lightweight in-process spans for background work.  Completed spans
+// land in a fixed-size process-wide ring buffer and can be dumped
+// post-hoc (GetProperty "leveldb.trace-spans"), so a p99 spike can be
+// attributed to flush, compaction phases or WAL sync without
+// correlating log timestamps.
+
+#ifndef STORAGE_LEVELDB_UTIL_TRACING_H_
+#define STORAGE_LEVELDB_UTIL_TRACING_H_
+
+#include <cstdint>
+#include <string>
+
+#include "port/port.h"
+
+namespace leveldb {
+
+class Env;
+
+class SpanRecorder {
+ public:
+  static SpanRecorder* Global();
+
+  // "name" must be a string literal (stored by pointer).
+  void Record(const char* name, uint64_t start_micros, uint64_t end_micros,
+              int depth);
+
+  // Append the buffered spans, oldest first, as one line each:
+  //   <start_micros> <duration_micros> <thread> <indented name>
+  void Dump(std::string* out);
+
+  SpanRecorder() = default;
+
+ private:
+  struct Span {
+    const char* name;
+    uint64_t start_micros;
+    uint64_t end_micros;
+    uint64_t thread;
+    int depth;
+  };
+
+  static const size_t kRingSize = 4096;
+
+  port::Mutex mutex_;
+  Span ring_[kRingSize];
+  size_t next_ = 0;
+  size_t count_ = 0;
+};
+
+// Records one span from construction to destruction.  Nesting depth is
+// tracked per thread so the dump shows structure.
+class ScopedSpan {
+ public:
+  ScopedSpan(const char* name, Env* env);
+  ~ScopedSpan();
+
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+ private:
+  const char* const name_;
+  Env* const env_;
+  const uint64_t start_micros_;
+  const int depth_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_TRACING_H_
@@ -0,0 +1,186 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <vector>
+
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+
+// An xor8 filter (Graf & Lemire): ~9.84 bits per key for a 0.39% false
+// positive rate, versus ~10 bits per key for 1% with the bloom filter.
+// Filter layout:
+//     seed: fixed32       (construction seed that succeeded)
+//     block_length: fixed32
+//     fingerprints: uint8[3 * block_length]
+
+inline uint64_t Hash64(const Slice& key, uint32_t seed) {
+  const uint64_t hi = Hash(key.data(), key.size(), seed ^ 0xdeadbeef);
+  const uint64_t lo = Hash(key.data(), key.size(), seed ^ 0x12fade34);
+  return (hi << 32) | lo;
+}
+
+inline uint64_t Mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+inline uint32_t Reduce(uint32_t x, uint32_t n) {
+  return static_cast<uint32_t>((static_cast<uint64_t>(x) * n) >> 32);
+}
+
+inline uint8_t Fingerprint(uint64_t hash) {
+  return static_cast<uint8_t>(hash ^ (hash >> 32));
+}
+
+struct HashedKey {
+  uint64_t hash;
+  uint32_t index[3];
+};
+
+inline uint64_t RotL(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+void FillIndexes(uint64_t hash, uint32_t block_length, uint32_t* index) {
+  index[0] = Reduce(static_cast<uint32_t>(hash), block_length);
+  index[1] =
+      Reduce(static_cast<uint32_t>(RotL(hash, 21)), block_length) +
+      block_length;
+  index[2] =
+      Reduce(static_cast<uint32_t>(RotL(hash, 42)), block_length) +
+      2 * block_length;
+}
+
+class XorFilterPolicy : public FilterPolicy {
+ public:
+  const char* Name() const override { return "leveldb.BuiltinXorFilter"; }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    // Duplicate keys make the xor construction deterministically
+    // impossible: equal keys hash identically under every seed, their
+    // contributions cancel in xor_hash, and the affected cells can
+    // never peel.  The CreateFilter contract explicitly allows
+    // duplicates (the internal policy forwards one entry per key
+    // *version*), and keys arrive ordered, so equal neighbours are
+    // skipped up front instead of burning all the retry seeds.
+    std::vector<Slice> unique;
+    unique.reserve(n);
+    for (int i = 0; i < n; i++) {
+      if (i == 0 || keys[i] != keys[i - 1]) {
+        unique.push_back(keys[i]);
+      }
+    }
+    const int num_keys = static_cast<int>(unique.size());
+
+    const uint32_t block_length =
+        static_cast<uint32_t>((1.23 * num_keys) / 3 + 32 / 3 + 1);
+    const uint32_t m = 3 * block_length;
+
+    std::vector<HashedKey> hashed(num_keys);
+    std::vector<uint8_t> fingerprints(m, 0);
+    std::vector<uint64_t> xor_hash(m);
+    std::vector<uint32_t> count(m);
+    std::vector<uint32_t> queue(m);
+    std::vector<std::pair<uint64_t, uint32_t>> stack(num_keys);
+
+    uint32_t seed = 0x9747b28c;
+    for (int attempt = 0; attempt < 100; attempt++, seed += 0x9e3779b9) {
+      for (int i = 0; i < num_keys; i++) {
+        hashed[i].hash = Mix(Hash64(unique[i], seed));
+        FillIndexes(hashed[i].hash, block_length, hashed[i].index);
+      }
+      std::fill(xor_hash.begin(), xor_hash.end(), 0);
+      std::fill(count.begin(), count.end(), 0);
+      for (int i = 0; i < num_keys; i++) {
+        for (int j = 0; j < 3; j++) {
+          xor_hash[hashed[i].index[j]] ^= hashed[i].hash;
+          count[hashed[i].index[j]]++;
+        }
+      }
+
+      // Peel cells holding a single key.
+      size_t queue_size = 0;
+      for (uint32_t i = 0; i < m; i++) {
+        if (count[i] == 1) queue[queue_size++] = i;
+      }
+      size_t stack_size = 0;
+      while (queue_size > 0) {
+        const uint32_t i = queue[--queue_size];
+        if (count[i] != 1) continue;
+        const uint64_t hash = xor_hash[i];
+        stack[stack_size++] = std::make_pair(hash, i);
+        uint32_t index[3];
+        FillIndexes(hash, block_length, index);
+        for (int j = 0; j < 3; j++) {
+          xor_hash[index[j]] ^= hash;
+          if (--count[index[j]] == 1) {
+            queue[queue_size++] = index[j];
+          }
+        }
+      }
+      if (stack_size != static_cast<size_t>(num_keys)) {
+        continue;  // Rare (a genuine hash collision); retry reseeded.
+      }
+
+      // Assign fingerprints in reverse peeling order.
+      while (stack_size > 0) {
+        const uint64_t hash = stack[--stack_size].first;
+        const uint32_t cell = stack[stack_size].second;
+        uint32_t index[3];
+        FillIndexes(hash, block_length, index);
+        uint8_t fp = Fingerprint(hash);
+        for (int j = 0; j < 3; j++) {
+          if (index[j] != cell) fp ^= fingerprints[index[j]];
+        }
+        fingerprints[cell] = fp;
+      }
+
+      PutFixed32(dst, seed);
+      PutFixed32(dst, block_length);
+      dst->append(reinterpret_cast<const char*>(fingerprints.data()), m);
+      return;
+    }
+
+    // Construction failed repeatedly (adversarial duplicates); emit an
+    // empty marker that matches everything.
+    PutFixed32(dst, 0);
+    PutFixed32(dst, 0);
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& filter) const override {
+    if (filter.size() < 8) {
+      return true;  // Malformed; err on the side of a match
+    }
+    const uint32_t seed = DecodeFixed32(filter.data());
+    const uint32_t block_length = DecodeFixed32(filter.data() + 4);
+    if (block_length == 0 ||
+        filter.size() != 8 + 3 * static_cast<size_t>(block_length)) {
+      return true;
+    }
+    const uint8_t* fingerprints =
+        reinterpret_cast<const uint8_t*>(filter.data() + 8);
+    const uint64_t hash = Mix(Hash64(key, seed));
+    uint32_t index[3];
+    FillIndexes(hash, block_length, index);
+    const uint8_t fp = Fingerprint(hash);
+    return fp == (fingerprints[index[0]] ^ fingerprints[index[1]] ^
+                  fingerprints[index[2]]);
+  }
+};
+
+}  // namespace
+
+const FilterPolicy* NewXorFilterPolicy() { return new XorFilterPolicy; }
+
+}  // namespace leveldb